@@ -0,0 +1,35 @@
+#version 400
+
+out vec4 FragColor;
+in vec2 TexCoord;
+
+//bigger level of the chain (or the bright pass)
+uniform sampler2D srcTex;
+
+//13 taps filter: 4 overlapping 4x4 boxes plus the central one,
+//the bilinear filter makes every tap the average of 4 texels
+void main()
+{
+    vec2 texel = 1.0 / textureSize(srcTex, 0);
+
+    vec3 a = texture(srcTex, TexCoord + texel * vec2(-2.0,  2.0)).rgb;
+    vec3 b = texture(srcTex, TexCoord + texel * vec2( 0.0,  2.0)).rgb;
+    vec3 c = texture(srcTex, TexCoord + texel * vec2( 2.0,  2.0)).rgb;
+    vec3 d = texture(srcTex, TexCoord + texel * vec2(-2.0,  0.0)).rgb;
+    vec3 e = texture(srcTex, TexCoord).rgb;
+    vec3 f = texture(srcTex, TexCoord + texel * vec2( 2.0,  0.0)).rgb;
+    vec3 g = texture(srcTex, TexCoord + texel * vec2(-2.0, -2.0)).rgb;
+    vec3 h = texture(srcTex, TexCoord + texel * vec2( 0.0, -2.0)).rgb;
+    vec3 i = texture(srcTex, TexCoord + texel * vec2( 2.0, -2.0)).rgb;
+    vec3 j = texture(srcTex, TexCoord + texel * vec2(-1.0,  1.0)).rgb;
+    vec3 k = texture(srcTex, TexCoord + texel * vec2( 1.0,  1.0)).rgb;
+    vec3 l = texture(srcTex, TexCoord + texel * vec2(-1.0, -1.0)).rgb;
+    vec3 m = texture(srcTex, TexCoord + texel * vec2( 1.0, -1.0)).rgb;
+
+    vec3 result = e * 0.125;
+    result += (a + c + g + i) * 0.03125;
+    result += (b + d + f + h) * 0.0625;
+    result += (j + k + l + m) * 0.125;
+
+    FragColor = vec4(result, 1.0);
+}
@@ -0,0 +1,27 @@
+#version 400
+
+out vec4 FragColor;
+in vec2 TexCoord;
+
+//smaller level of the chain, the result is added to the bigger one
+uniform sampler2D srcTex;
+//in texels of srcTex
+uniform float filterRadius;
+
+//3x3 tent filter
+void main()
+{
+    vec2 r = filterRadius / textureSize(srcTex, 0);
+
+    vec3 result = texture(srcTex, TexCoord).rgb * 4.0;
+    result += texture(srcTex, TexCoord + vec2(-r.x, 0.0)).rgb * 2.0;
+    result += texture(srcTex, TexCoord + vec2( r.x, 0.0)).rgb * 2.0;
+    result += texture(srcTex, TexCoord + vec2(0.0, -r.y)).rgb * 2.0;
+    result += texture(srcTex, TexCoord + vec2(0.0,  r.y)).rgb * 2.0;
+    result += texture(srcTex, TexCoord + vec2(-r.x, -r.y)).rgb;
+    result += texture(srcTex, TexCoord + vec2( r.x, -r.y)).rgb;
+    result += texture(srcTex, TexCoord + vec2(-r.x,  r.y)).rgb;
+    result += texture(srcTex, TexCoord + vec2( r.x,  r.y)).rgb;
+
+    FragColor = vec4(result / 16.0, 1.0);
+}
@@ -7,14 +7,32 @@ in vec2 TexCoords;
 uniform sampler2D scene;
 uniform sampler2D highlight;
 uniform float exposure;
+//the bloom chain adds the bright pass once per level
+uniform float bloomIntensity = 1.0;
+//the scene can be smaller than the window: 0 is a plain bilinear upscale,
+//up to 1 the edges lost by the upscale are sharpened
+uniform float sharpness = 0.0;
 
 void main()
 {             
     const float gamma = 2.2;
     vec3 hdrColor = texture(scene, TexCoords).rgb;      
+    if(sharpness > 0.0)
+    {
+        //unsharp mask on the 4 neighbours, clamped to their range so there is no ringing
+        vec2 texel = 1.0 / textureSize(scene, 0);
+        vec3 n = texture(scene, TexCoords + vec2(0.0, texel.y)).rgb;
+        vec3 s = texture(scene, TexCoords - vec2(0.0, texel.y)).rgb;
+        vec3 e = texture(scene, TexCoords + vec2(texel.x, 0.0)).rgb;
+        vec3 w = texture(scene, TexCoords - vec2(texel.x, 0.0)).rgb;
+        vec3 minColor = min(hdrColor, min(min(n, s), min(e, w)));
+        vec3 maxColor = max(hdrColor, max(max(n, s), max(e, w)));
+        vec3 sharpened = hdrColor + (4.0 * hdrColor - n - s - e - w) * 0.25 * sharpness;
+        hdrColor = clamp(sharpened, minColor, maxColor);
+    }
     vec3 highLightColor = texture(highlight, TexCoords).rgb;
     if(highLightColor != vec3(0.0, 0.0, 0.0))
-        hdrColor += highLightColor; // additive blending
+        hdrColor += highLightColor * bloomIntensity; // additive blending
     
     // tone mapping
     vec3 result = vec3(1.0) - exp(-hdrColor * exposure);
@@ -0,0 +1,35 @@
+#version 400 core
+
+layout (location = 0) out vec4 FragColor;
+layout (location = 1) out vec4 BrightColor;
+
+in vec2 TexCoords;
+in vec4 Color;
+
+uniform sampler2D sprite_tex;
+uniform bool useTexture;
+uniform float bloom;
+
+void main()
+{
+    vec3 col = Color.rgb;
+    float alpha;
+
+    if(useTexture)
+    {
+        vec4 texel = texture(sprite_tex, TexCoords);
+        col *= texel.rgb;
+        alpha = texel.a;
+    }
+    else
+    {
+        //soft disc
+        float d = clamp(1.0 - length(TexCoords * 2.0 - 1.0), 0.0, 1.0);
+        alpha = d * d;
+    }
+
+    //additive blending: the alpha only scales the color
+    col *= alpha * Color.a;
+    FragColor = vec4(col, 0.0);
+    BrightColor = vec4(col * bloom, 0.0);
+}
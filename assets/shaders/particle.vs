@@ -0,0 +1,25 @@
+#version 400 core
+
+layout (location = 0) in vec4 aPosSize;
+layout (location = 1) in vec4 aColor;
+
+uniform mat4 view;
+uniform mat4 projection;
+
+out vec2 TexCoords;
+out vec4 Color;
+
+//one instance per particle, the quad is a triangle strip without vertex buffer
+const vec2 corners[4] = vec2[](vec2(-0.5, -0.5), vec2(0.5, -0.5), vec2(-0.5, 0.5), vec2(0.5, 0.5));
+
+void main()
+{
+    vec2 corner = corners[gl_VertexID];
+    TexCoords = corner + 0.5;
+    Color = aColor;
+
+    //billboard: the quad is expanded in view space
+    vec4 viewPos = view * vec4(aPosSize.xyz, 1.0);
+    viewPos.xy += corner * aPosSize.w;
+    gl_Position = projection * viewPos;
+}
@@ -1,9 +1,46 @@
 #version 400 core
 
 layout (location = 0) out vec4 FragColor;
+#ifdef IMPOSTOR_BAKE
+// object space normal and depth in the bounding sphere, the second target of the atlas
+layout (location = 1) out vec4 NormalDepth;
+#endif
 in vec2 TexCoords;
-in vec3 WorldPos;
 in vec3 Normal;
+#ifdef IMPOSTOR
+// position on the quad, moved on the surface by the depth of the atlas
+in vec3 QuadWorldPos;
+in float QuadViewDepth;
+vec3 WorldPos;
+float ViewDepth;
+#else
+in vec3 WorldPos;
+in float ViewDepth;
+#endif
+
+#if defined(IMPOSTOR) || defined(IMPOSTOR_FADE)
+// weight of the mesh in the cross-fade, the impostor draws the other pixels
+flat in float Fade;
+#endif
+
+#ifdef IMPOSTOR
+in vec4 FrameUV01;
+in vec4 FrameUV23;
+flat in vec4 FrameCells01;
+flat in vec4 FrameCells23;
+flat in vec4 FrameWeights;
+flat in mat3 ObjectToWorld;
+flat in vec4 ToCameraRadius;
+
+uniform sampler2D impostor_albedo;
+uniform sampler2D impostor_normal_depth;
+uniform float impostorGrid;
+uniform mat4 projection;
+
+// blended frames, filled by sampleImpostor
+vec3 impostorAlbedo;
+vec3 impostorNormal;
+#endif
 
 // material params
 uniform vec4 albedo_color_val;
@@ -31,74 +68,67 @@ struct Light
     int type;
 };
 
+// lights without range (directional, no decay), applied to every fragment
 uniform Light lights[4];
+uniform int numLights;
+
+// point lights culled per cluster, the grid must match LightClusters
+const uint CLUSTER_GRID_X = 16u;
+const uint CLUSTER_GRID_Y = 9u;
+const int CLUSTER_GRID_Z = 24;
+
+// 2 texels per light: position and range, color
+uniform samplerBuffer clusterLights;
+// offset and count of the lights of every cluster
+uniform usamplerBuffer clusterGrid;
+uniform usamplerBuffer clusterIndices;
+// clusters per pixel
+uniform vec2 clusterScale;
+uniform float clusterNear;
+// slices per log unit of depth
+uniform float clusterSliceScale;
 
 // camera
 uniform vec3 camPos;
 
 const float PI = 3.14159265359;
 
-// subroutines
-subroutine vec3 sAlbedo();
-subroutine uniform sAlbedo albedoMode;
-subroutine float sMetalness();
-subroutine uniform sMetalness metalnessMode;
-subroutine float sRoughness();
-subroutine uniform sRoughness roughnessMode;
-subroutine vec3 sNormals();
-subroutine uniform sNormals normalsMode;
-subroutine float sAO();
-subroutine uniform sAO AOMode;
-
-// Albedo
-subroutine( sAlbedo )
-vec3 getAlbedoFromVal()
-{
-    return albedo_color_val.xyz;
-}
+// material sources: the HAS_* defines are set by the PBR material, one program per texture set
 
-subroutine( sAlbedo )
-vec3 getAlbedoFromTex()
+vec3 getAlbedo()
 {
+#if defined(IMPOSTOR)
+    return impostorAlbedo;
+#elif defined(HAS_ALBEDO_TEX)
     return pow(texture(albedo_tex, TexCoords).rgb, vec3(2.2));
+#else
+    return albedo_color_val.xyz;
+#endif
 }
 
-// Metalness
-subroutine( sMetalness )
-float getMetalnessFromVal()
-{
-    return metallic_val;
-}
-
-subroutine( sMetalness )
-float getMetalnessFromTex()
+float getMetalness()
 {
+#ifdef HAS_METALNESS_TEX
     return texture(metalness_tex, TexCoords).r;
+#else
+    return metallic_val;
+#endif
 }
 
-// Roughness
-subroutine( sRoughness )
-float getRoughnessFromVal()
-{
-    return roughness_val;
-}
-
-subroutine( sRoughness )
-float getRoughnessFromTex()
+float getRoughness()
 {
+#ifdef HAS_ROUGHNESS_TEX
     return texture(roughness_tex, TexCoords).r;
+#else
+    return roughness_val;
+#endif
 }
 
-// Normals
-subroutine( sNormals )
-vec3 getNormalsFromVal()
-{
-    return normalize(Normal);
-}
-
-subroutine( sNormals )
-vec3 getNormalsFromTex()
+vec3 getNormal()
 {
+#if defined(IMPOSTOR)
+    return impostorNormal;
+#elif defined(HAS_NORMAL_MAP)
     vec3 tangentNormal = texture(normal_map_tex, TexCoords).xyz * 2.0 - 1.0;
 
     vec3 Q1  = dFdx(WorldPos);
@@ -112,19 +142,18 @@ vec3 getNormalsFromTex()
     mat3 TBN = mat3(T, B, N);
 
     return normalize(TBN * tangentNormal);
+#else
+    return normalize(Normal);
+#endif
 }
 
-// Ambient Occlusion
-subroutine( sAO )
-float getAOFromVal()
-{
-    return ambient_occlusion_val;
-}
-
-subroutine( sAO )
-float getAOFromTex()
+float getAO()
 {
+#ifdef HAS_AO_TEX
     return texture(ambient_occlusion_tex, TexCoords).r;
+#else
+    return ambient_occlusion_val;
+#endif
 }
 
 // Cook-Torrance functions
@@ -187,14 +216,119 @@ vec3 getLightRadiance(Light light)
     return light.color * attenuation;
 }
 
+// inverse square windowed to 0 at the range, so the light never pops at the cluster borders
+float getWindowedAttenuation(float distance, float range)
+{
+    float ratio = distance / range;
+    float window = clamp(1.0 - ratio * ratio * ratio * ratio, 0.0, 1.0);
+
+    return window * window / max(distance * distance, 0.0001);
+}
+
+//cook-torrance BRDF of a light
+vec3 shade(vec3 N, vec3 V, vec3 L, vec3 radiance, vec3 albedo, float metallic, float roughness, vec3 F0)
+{
+    vec3 H = normalize(V + L);
+
+    float NDF = distributionGGX(N, H, roughness);
+    float G = geometrySmith(N, V, L, roughness);
+    vec3 F = fresnelSchlick(max(dot(H, V), 0.0), F0);
+
+    vec3 numerator = NDF * G * F;
+    float denominator = 4.0 * max(dot(N, V), 0.0) * max(dot(N, L), 0.0) + 0.0001;
+    vec3 specular = numerator / denominator;
+
+    vec3 kS = F;
+    vec3 kD = vec3(1.0) - kS;
+    kD *= 1.0 - metallic;
+
+    float NdotL = max(dot(N, L), 0.0);
+
+    return (kD * albedo / PI + specular) * radiance * NdotL;
+}
+
+int getCluster()
+{
+    uvec2 tile = min(uvec2(gl_FragCoord.xy * clusterScale), uvec2(CLUSTER_GRID_X - 1u, CLUSTER_GRID_Y - 1u));
+    int slice = int(log(max(ViewDepth, clusterNear) / clusterNear) * clusterSliceScale);
+    slice = clamp(slice, 0, CLUSTER_GRID_Z - 1);
+
+    return int((uint(slice) * CLUSTER_GRID_Y + tile.y) * CLUSTER_GRID_X + tile.x);
+}
+
+// 4x4 ordered dither of the pixel in (0, 1): the mesh keeps the pixels under its fade, the impostor the others
+float ditherThreshold()
+{
+    const float bayer[16] = float[](0.0, 8.0, 2.0, 10.0, 12.0, 4.0, 14.0, 6.0, 3.0, 11.0, 1.0, 9.0, 15.0, 7.0, 13.0, 5.0);
+    ivec2 p = ivec2(gl_FragCoord.xy) & 3;
+    return (bayer[p.y * 4 + p.x] + 0.5) / 16.0;
+}
+
+#ifdef IMPOSTOR
+// premultiplied frame at weight, the samples are outside the branches for the derivatives of the mips
+void addFrame(vec2 uv, vec2 cell, float weight, inout vec4 albedo, inout vec4 normalDepth)
+{
+    vec2 atlasUV = (cell + clamp(uv, 0.0, 1.0)) / impostorGrid;
+    vec4 a = texture(impostor_albedo, atlasUV);
+    vec4 nd = texture(impostor_normal_depth, atlasUV);
+    // outside the frame the quad sees nothing of it
+    float inside = step(0.0, uv.x) * step(uv.x, 1.0) * step(0.0, uv.y) * step(uv.y, 1.0);
+    albedo += a * weight * inside;
+    normalDepth += nd * weight * inside;
+}
+
+// false where the frames have no coverage
+bool sampleImpostor()
+{
+    vec4 albedo = vec4(0.0);
+    vec4 normalDepth = vec4(0.0);
+    addFrame(FrameUV01.xy, FrameCells01.xy, FrameWeights.x, albedo, normalDepth);
+    addFrame(FrameUV01.zw, FrameCells01.zw, FrameWeights.y, albedo, normalDepth);
+    addFrame(FrameUV23.xy, FrameCells23.xy, FrameWeights.z, albedo, normalDepth);
+    addFrame(FrameUV23.zw, FrameCells23.zw, FrameWeights.w, albedo, normalDepth);
+    if(albedo.a < 0.5)
+        return false;
+
+    impostorAlbedo = albedo.rgb / albedo.a;
+    impostorNormal = normalize(ObjectToWorld * normalDepth.xyz);
+
+    // the surface is in front of the quad by radius at depth 0 and behind it by radius at depth 1
+    float offset = ToCameraRadius.w * (1.0 - 2.0 * normalDepth.w / albedo.a);
+    WorldPos = QuadWorldPos + ToCameraRadius.xyz * offset;
+    ViewDepth = QuadViewDepth - offset;
+    float z = -ViewDepth;
+    gl_FragDepth = ((projection[2][2] * z + projection[3][2]) / -z) * 0.5 + 0.5;
+    return true;
+}
+#endif
+
+#ifdef IMPOSTOR_BAKE
+
 void main()
 {
-    vec3 albedo = albedoMode();
-    float metallic = metalnessMode();
-    float roughness = roughnessMode();
-    float ao = AOMode();
+    // the clears are 0: the atlas is premultiplied by the coverage
+    FragColor = vec4(getAlbedo(), 1.0);
+    NormalDepth = vec4(getNormal(), gl_FragCoord.z);
+}
 
-    vec3 N = normalsMode();
+#else
+
+void main()
+{
+#if defined(IMPOSTOR)
+    if(ditherThreshold() < Fade || !sampleImpostor())
+        discard;
+#elif defined(IMPOSTOR_FADE)
+    if(ditherThreshold() >= Fade)
+        discard;
+#endif
+
+    vec3 albedo = getAlbedo();
+    float metallic = getMetalness();
+    float roughness = getRoughness();
+    float ao = getAO();
+
+    vec3 N = getNormal();
     vec3 V = normalize(camPos - WorldPos);
 
     vec3 F0 = vec3(0.04);
@@ -202,31 +336,23 @@ void main()
 
     vec3 Lo = vec3(0.0);
 
-    for(int i = 0; i < 4; i++)
-    {
-        // calculate per-light radiance
-        vec3 L = dirLight(lights[i]);
-        vec3 H = normalize(V + L);
-
-        //float distance = length(lights[i].pos - WorldPos);
-        //float attenuation = 1.0 / (distance * distance);
-        vec3 radiance = getLightRadiance(lights[i]);
-        //cook-torrance BRDF
-        float NDF = distributionGGX(N, H, roughness);
-        float G = geometrySmith(N, V, L, roughness);
-        vec3 F = fresnelSchlick(max(dot(H, V), 0.0), F0);
-
-        vec3 numerator = NDF * G * F;
-        float denominator = 4.0 * max(dot(N, V), 0.0) * max(dot(N, L), 0.0) + 0.0001;
-        vec3 specular = numerator / denominator;
+    for(int i = 0; i < numLights; i++)
+        Lo += shade(N, V, dirLight(lights[i]), getLightRadiance(lights[i]), albedo, metallic, roughness, F0);
 
-        vec3 kS = F;
-        vec3 kD = vec3(1.0) - kS;
-        kD *= 1.0 - metallic;
+    uvec2 cluster = texelFetch(clusterGrid, getCluster()).xy;
+    for(uint i = 0u; i < cluster.y; i++)
+    {
+        int light = int(texelFetch(clusterIndices, int(cluster.x + i)).r);
+        vec4 posRange = texelFetch(clusterLights, light * 2);
+        vec3 color = texelFetch(clusterLights, light * 2 + 1).rgb;
 
-        float NdotL = max(dot(N, L), 0.0);
+        vec3 toLight = posRange.xyz - WorldPos;
+        float distance = length(toLight);
+        if(distance >= posRange.w)
+            continue;
 
-        Lo += (kD * albedo / PI + specular) * radiance * NdotL;
+        vec3 radiance = color * getWindowedAttenuation(distance, posRange.w);
+        Lo += shade(N, V, toLight / max(distance, 0.0001), radiance, albedo, metallic, roughness, F0);
     }
 
     vec3 ambient = vec3(0.03) * albedo * ao;
@@ -238,4 +364,6 @@ void main()
     color = pow(color, vec3(1.0 / 2.2));
 
     FragColor = vec4(color, albedo_color_val.a);
-}
\ No newline at end of file
+}
+
+#endif
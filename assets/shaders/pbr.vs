@@ -1,23 +1,157 @@
 #version 400 core
 
+// IMPOSTOR: camera facing quad of an octahedral impostor, one instance per object
+// IMPOSTOR_BAKE: the mesh in object space, drawn in a frame of the impostor atlas
+// IMPOSTOR_FADE: the mesh cross-fading with its impostor
+
+#ifdef IMPOSTOR
+layout (location = 0) in vec4 aCenterRadius;
+// columns of the object to world rotation, the w of the first one is the fade of the mesh
+layout (location = 1) in vec4 aRotation0;
+layout (location = 2) in vec4 aRotation1;
+layout (location = 3) in vec4 aRotation2;
+#else
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec2 aTexCoords;
 layout (location = 2) in vec3 aNormal;
+#ifndef IMPOSTOR_BAKE
+//per draw, read with the base instance of the draw
+layout (location = 3) in mat4 aModel;
+layout (location = 7) in mat3 aNormalMatrix;
+// weight of the mesh in the cross-fade with its impostor
+layout (location = 10) in float aFade;
+#endif
+#endif
 
 out vec2 TexCoords;
-out vec3 WorldPos;
 out vec3 Normal;
+#ifdef IMPOSTOR
+// on the quad, the fragment moves them on the surface
+out vec3 QuadWorldPos;
+out float QuadViewDepth;
+#else
+out vec3 WorldPos;
+//distance from the camera plane, selects the light cluster
+out float ViewDepth;
+#endif
 
 uniform mat4 projection;
 uniform mat4 view;
-uniform mat4 model;
-uniform mat3 normalMatrix;
+
+#if defined(IMPOSTOR) || defined(IMPOSTOR_FADE)
+flat out float Fade;
+#endif
+
+#ifdef IMPOSTOR
+// uv of the quad in the 4 frames around the view direction, unclamped: outside [0, 1] the frame is empty
+out vec4 FrameUV01;
+out vec4 FrameUV23;
+// cells of the 4 frames in the atlas and their bilinear weights
+flat out vec4 FrameCells01;
+flat out vec4 FrameCells23;
+flat out vec4 FrameWeights;
+flat out mat3 ObjectToWorld;
+// direction to the camera and radius, the depth of the atlas runs along it
+flat out vec4 ToCameraRadius;
+
+uniform vec3 camPos;
+// frames per side of the atlas
+uniform float impostorGrid;
+
+const vec2 corners[4] = vec2[](vec2(-1.0, -1.0), vec2(1.0, -1.0), vec2(-1.0, 1.0), vec2(1.0, 1.0));
+
+// octahedral map of the directions, y is the pole; octDecode is ImpostorManager::octDecode
+vec2 octEncode(vec3 d)
+{
+    d /= abs(d.x) + abs(d.y) + abs(d.z);
+    vec2 p = d.xz;
+    if(d.y < 0.0)
+        p = (1.0 - abs(p.yx)) * vec2(p.x >= 0.0 ? 1.0 : -1.0, p.y >= 0.0 ? 1.0 : -1.0);
+    return p * 0.5 + 0.5;
+}
+
+vec3 octDecode(vec2 uv)
+{
+    vec2 f = uv * 2.0 - 1.0;
+    vec3 n = vec3(f.x, 1.0 - abs(f.x) - abs(f.y), f.y);
+    float t = max(-n.y, 0.0);
+    n.x += n.x >= 0.0 ? -t : t;
+    n.z += n.z >= 0.0 ? -t : t;
+    return normalize(n);
+}
+
+// position relative to the center projected on the frame of the cell, the basis of the bake camera
+vec2 frameUV(vec2 cell, vec3 p, float radius)
+{
+    vec3 d = octDecode(cell / (impostorGrid - 1.0));
+    vec3 up = abs(d.y) > 0.999 ? vec3(0.0, 0.0, 1.0) : vec3(0.0, 1.0, 0.0);
+    vec3 t = normalize(cross(up, d));
+    vec3 b = cross(d, t);
+    return vec2(dot(p, t), dot(p, b)) / (2.0 * radius) + 0.5;
+}
+
+void main()
+{
+    vec3 center = aCenterRadius.xyz;
+    float radius = aCenterRadius.w;
+    ObjectToWorld = mat3(aRotation0.xyz, aRotation1.xyz, aRotation2.xyz);
+    Fade = aRotation0.w;
+
+    // billboard on the view plane through the center
+    vec2 corner = corners[gl_VertexID];
+    vec3 offset = (corner.x * vec3(view[0][0], view[1][0], view[2][0]) + corner.y * vec3(view[0][1], view[1][1], view[2][1])) * radius;
+    TexCoords = corner * 0.5 + 0.5;
+    QuadWorldPos = center + offset;
+    Normal = vec3(0.0);
+    vec4 viewPos = view * vec4(QuadWorldPos, 1.0);
+    QuadViewDepth = -viewPos.z;
+    gl_Position = projection * viewPos;
+
+    vec3 toCamera = normalize(camPos - center);
+    ToCameraRadius = vec4(toCamera, radius);
+
+    // the 4 frames of the grid around the view direction in object space
+    mat3 worldToObject = transpose(ObjectToWorld);
+    vec2 grid = octEncode(worldToObject * toCamera) * (impostorGrid - 1.0);
+    vec2 cell = min(floor(grid), vec2(impostorGrid - 2.0));
+    vec2 f = grid - cell;
+    FrameWeights = vec4((1.0 - f.x) * (1.0 - f.y), f.x * (1.0 - f.y), (1.0 - f.x) * f.y, f.x * f.y);
+    FrameCells01 = vec4(cell, cell + vec2(1.0, 0.0));
+    FrameCells23 = vec4(cell + vec2(0.0, 1.0), cell + vec2(1.0, 1.0));
+
+    vec3 p = worldToObject * offset;
+    FrameUV01 = vec4(frameUV(FrameCells01.xy, p, radius), frameUV(FrameCells01.zw, p, radius));
+    FrameUV23 = vec4(frameUV(FrameCells23.xy, p, radius), frameUV(FrameCells23.zw, p, radius));
+}
+
+#elif defined(IMPOSTOR_BAKE)
+
+void main()
+{
+    TexCoords = aTexCoords;
+    WorldPos = aPos;
+    Normal = aNormal;
+    vec4 viewPos = view * vec4(aPos, 1.0);
+    ViewDepth = -viewPos.z;
+
+    gl_Position = projection * viewPos;
+}
+
+#else
 
 void main()
 {
     TexCoords = aTexCoords;
-    WorldPos = vec3(model * vec4(aPos, 1.0));
-    Normal = normalMatrix * aNormal;   
+    WorldPos = vec3(aModel * vec4(aPos, 1.0));
+    Normal = aNormalMatrix * aNormal;
+#ifdef IMPOSTOR_FADE
+    Fade = aFade;
+#endif
+
+    vec4 viewPos = view * vec4(WorldPos, 1.0);
+    ViewDepth = -viewPos.z;
+
+    gl_Position =  projection * viewPos;
+}
 
-    gl_Position =  projection * view * model * vec4(aPos, 1.0);
-}
\ No newline at end of file
+#endif
@@ -2,16 +2,17 @@
 
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec2 aTexCoords;
+//per draw, read with the base instance of the draw
+layout (location = 3) in mat4 aModel;
 
 out vec2 TexCoords;
 
 uniform mat4 projection;
 uniform mat4 view;
-uniform mat4 model;
 
 void main()
 {
     TexCoords = aTexCoords;
     // Calcolo standard della posizione
-    gl_Position = projection * view * model * vec4(aPos, 1.0);
+    gl_Position = projection * view * aModel * vec4(aPos, 1.0);
 }
\ No newline at end of file
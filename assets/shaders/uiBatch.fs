@@ -0,0 +1,16 @@
+#version 400 core
+
+out vec4 FragColor;
+
+in vec2 TexCoords;
+in vec4 Color;
+flat in float Hover;
+
+uniform sampler2D ui_tex;
+
+void main()
+{
+    //same tint of uiTextureHover in uiButton.fs
+    vec4 tint = mix(vec4(1.0), vec4(1, 0.36, 0, 1), Hover);
+    FragColor = texture(ui_tex, TexCoords)*Color*tint;
+}
\ No newline at end of file
@@ -0,0 +1,20 @@
+#version 400 core
+
+layout (location = 0) in vec2 aPos;
+layout (location = 1) in vec2 aTexCoords;
+layout (location = 2) in vec4 aColor;
+layout (location = 3) in float aHover;
+
+uniform mat4 projection;
+
+out vec2 TexCoords;
+out vec4 Color;
+flat out float Hover;
+
+void main()
+{
+    TexCoords = aTexCoords;
+    Color = aColor;
+    Hover = aHover;
+    gl_Position = projection * vec4(aPos, 0.0, 1.0);
+}
\ No newline at end of file
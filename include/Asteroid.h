@@ -19,6 +19,8 @@ namespace SpaceEngine {
         
         virtual void update(float dt) override;
         virtual void onCollisionEnter(Collider* col) override;
+        //particles where the asteroid is, the object is not destroyed
+        void Explode();
 
         inline void SetSpawnArea(float width, float height) {
             m_spawnRangeX = width / 2.0f;
@@ -38,6 +40,9 @@ namespace SpaceEngine {
 
         int m_score = 50;
 
+        static constexpr uint32_t ExplosionParticles = 48;
+        inline static const Vector4 ExplosionColor = {4.f, 1.6f, 0.4f, 1.f};
+
         void Spawn();
     };
 
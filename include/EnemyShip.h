@@ -24,6 +24,8 @@ namespace SpaceEngine {
         virtual void update(float dt) override;
         virtual void onCollisionEnter(Collider* col) override;
         void DecreaseHealth();
+        //particles where the ship is, the object is not destroyed
+        void Explode();
 
         void Shoot();
 
@@ -34,6 +36,8 @@ namespace SpaceEngine {
         PointSubject* m_pSub;
         SpawnerSubject* m_pSpawnerSub;
         const Bullet* m_pBulletPrefab;
+        //created by Init, the prefab has none
+        ParticleEmitter* m_pTrail = nullptr;
 
         float m_speed;
         float m_spawnRangeX;
@@ -49,6 +53,10 @@ namespace SpaceEngine {
     
         EnemyType m_type;
 
+        static constexpr uint32_t ExplosionParticles = 64;
+        inline static const Vector4 ExplosionColor = {6.f, 1.2f, 0.6f, 1.f};
+        inline static const Vector4 TrailColor = {3.f, 0.6f, 0.4f, 1.f};
+
         void performAI(float dt);
     };
 }
\ No newline at end of file
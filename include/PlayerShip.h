@@ -41,6 +41,10 @@ namespace SpaceEngine {
         void HandleInput(float dt);
         
         Bullet* m_pBullet = nullptr;
+        ParticleEmitter* m_pTrail = nullptr;
+        static constexpr uint32_t ExplosionParticles = 96;
+        inline static const Vector4 ExplosionColor = {2.f, 2.f, 6.f, 1.f};
+        inline static const Vector4 TrailColor = {0.8f, 0.8f, 6.f, 1.f};
         float m_speed;
         float m_dt = 0.f;
         int m_health = 3;
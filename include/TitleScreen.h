@@ -25,6 +25,8 @@ namespace SpaceEngine{
         virtual void UpdateScene(float dt) override; // Per controllare la risoluzione ogni frame
         int m_lastWidth = 0;
         int m_lastHeight = 0;
+        //time of the background shader, it follows the game clock
+        float m_time = 0.f;
         bool StartNewGame(); 
         bool OpenOptions();
         bool OpenLeaderboard();
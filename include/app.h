@@ -11,15 +11,35 @@
 #include "shader.h"
 
 #include <glad/gl.h>
+#include <string>
 
 namespace SpaceEngine
 {
+    struct AppConfig
+    {
+        //invisible window, RendererV2 draws in an offscreen target
+        bool headless = false;
+        //seed of rand and PRNG, 0 seeds with the time
+        uint32_t seed = 0;
+        //records the GL calls of the first captureFrames frames in the file, empty doesn't record
+        std::string capturePath;
+        uint32_t captureFrames = 0;
+        //records every frame in a .y4m file or in a directory of PNGs, empty doesn't record
+        std::string frameCapturePath;
+        uint32_t frameCaptureFps = 60;
+    };
+
     class App
     {
         public:
-            App();
+            App(const AppConfig& config = AppConfig());
             ~App();
             void Run();
+            //one iteration of the game loop, the headless tests call it with a fixed dt
+            void Frame(float dt);
+            //handle the tunneling caused by a to slow frame dt
+            //fixed time step
+            static constexpr float fixed_dt = 1.f/30.f;
             static InputHandler& GetInputHandler();
             static EAppState state;
         private:
@@ -43,5 +63,12 @@ namespace SpaceEngine
             ScreenRenderer* screenRenderer;
             WindowManager windowManager;
             static InputHandler* inputHandler;
+            float accumulator = 0.f;
+            //Gathers
+            std::vector<RenderObject> worldRenderables;
+            std::vector<UIRenderObject> uiRenderables;
+            std::vector<TextRenderObject> textRenderables;
+            std::vector<ScreenRenderObject> screenRenderables;
+            CameraView cameraView;
     };
 };
\ No newline at end of file
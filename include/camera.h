@@ -5,6 +5,37 @@
 
 namespace SpaceEngine
 {
+    //camera data computed once per frame and shared by culling and rendering
+    struct CameraView
+    {
+        enum EPlane
+        {
+            PLANE_LEFT = 0,
+            PLANE_RIGHT,
+            PLANE_BOTTOM,
+            PLANE_TOP,
+            PLANE_NEAR,
+            PLANE_FAR,
+            NUM_PLANES
+        };
+
+        Matrix4 view;
+        Matrix4 projection;
+        Matrix4 viewProjection;
+        Vector3 pos;
+        //normals point inside the frustum, w is the distance from the origin
+        Vector4 planes[NUM_PLANES];
+    };
+
+    struct CullStats
+    {
+        uint32_t tested = 0;
+        uint32_t culled = 0;
+    };
+
+    //tests count bounding spheres (SoA) against the frustum, visible[i] is 1 if the sphere is inside or intersects it
+    void cullSpheres(const CameraView& view, const float* cx, const float* cy, const float* cz, const float* r, uint32_t count, uint8_t* visible);
+
     class BaseCamera
     {
         public:
@@ -13,6 +44,7 @@ namespace SpaceEngine
             ~BaseCamera() = default;
             Matrix4 getViewMatrix() const;
             Matrix4 getProjectionMatrix() const { return projection;};
+            CameraView getCameraView() const;
             Transform transf;
         protected:
             Matrix4 projection;
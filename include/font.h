@@ -3,6 +3,8 @@
 #include <string>
 #include <unordered_map>
 #include <map>
+#include <vector>
+#include <array>
 
 #include "texture.h"
 #include "utils/utils.h"
@@ -11,10 +13,14 @@ namespace SpaceEngine
 {
     struct Character
     {
+        //glyph atlas of the font
         Texture* pTex = nullptr;
         Vector2i size = {0, 0};
         Vector2i bearing = {0, 0};
         unsigned int advance = 0;
+        //rect of the glyph inside the atlas
+        Vector2 uvMin = {0.f, 0.f};
+        Vector2 uvMax = {0.f, 0.f};
     };
 
     class FontLoader
@@ -36,7 +42,8 @@ namespace SpaceEngine
         bool dirty = true;
         
         public:
-        void setPos(const Vector2& newPos){pos = newPos;}
+        void setPos(const Vector2& newPos){pos = newPos; dirty = true;}
+        void setScale(const Vector2& newScale){scale = newScale; dirty = true;}
         Transform2D(Vector2 anchor, Vector2 scale, Vector2 pos):
         anchor(anchor), scale(scale), pos(pos){}
 
@@ -60,11 +67,21 @@ namespace SpaceEngine
             
             ~Text();
         
-            inline std::string getString(){return m_string;}
+            inline const std::string& getString() const {return m_string;}
             void setColor(const Vector3& color);
             
-            inline void setString(const std::string& str){m_string = str;}
-            inline void appendString(const std::string& str){m_string.append(str);}
+            inline void setString(const std::string& str)
+            {
+                if(str != m_string)
+                {
+                    m_string = str;
+                    m_layoutDirty = true;
+                }
+            }
+            inline void appendString(const std::string& str){m_string.append(str); m_layoutDirty = true;}
+            inline void setScale(const Vector2& scale){pTransf->setScale(scale);}
+            //rebuilds the glyph quads only if the string, the transform or the resolution changed
+            void updateLayout();
 
             void setActive(bool active) { m_active = active; }
             bool isActive() const { return m_active; }
@@ -76,6 +93,10 @@ namespace SpaceEngine
             std::string m_string = "";
             TextMaterial* m_pMaterial = nullptr;
             bool m_active = true;
+            //cached layout
+            std::vector<std::array<float, 4>> m_vertices;
+            bool m_layoutDirty = true;
+            uint32_t m_resolutionGeneration = 0;
     };
 
 }
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <glad/gl.h>
+#include <cstdint>
+#include <string>
+
+namespace SpaceEngine
+{
+    enum class ECaptureFormat
+    {
+        //numbered files in a directory
+        PNG = 0,
+        //one YUV4MPEG2 stream, 4:4:4 limited range
+        Y4M
+    };
+
+    struct FrameCaptureStats
+    {
+        //frames copied in the ring
+        uint64_t readbacks = 0;
+        //frames the worker had no room for
+        uint32_t dropped = 0;
+        //slots whose copy wasn't done when the ring came back to them
+        uint32_t stalls = 0;
+        //CPU time of the map and copy of the last resolved frame
+        float lastResolveMs = 0.f;
+    };
+
+    //readback of the final frame without stalling the pipeline: the frame is copied in a ring of pixel
+    //pack buffers behind a fence and mapped RingSize - 1 frames later, when the GPU is done with it.
+    //A worker thread flips the rows and writes the files
+    class FrameCapture
+    {
+        public:
+            static constexpr uint32_t RingSize = 3;
+            //frames waiting for the worker, the next ones are dropped
+            static constexpr uint32_t MaxQueuedFrames = 8;
+
+            static void init();
+            //writes the frames in the ring and waits the worker
+            static void shutdown();
+
+            //the next frame in one PNG
+            static void screenshot(const std::string& path);
+            //every frame until stopSequence, path is the directory of the PNGs or the .y4m file
+            static bool startSequence(const std::string& path, ECaptureFormat format, uint32_t fps);
+            //the frames in the ring are resolved at once
+            static void stopSequence();
+            inline static bool isRecording() { return m_recording; }
+
+            //after the last pass of the frame, before the swap; framebuffer 0 reads the back buffer
+            static void captureFrame(GLuint framebuffer, int width, int height);
+
+            inline static const FrameCaptureStats& getStats() { return m_stats; }
+            //frames written by the worker
+            static uint64_t getWrittenFrames();
+
+        private:
+            struct Slot
+            {
+                GLuint buffer = 0;
+                GLsizeiptr size = 0;
+                GLsync fence = nullptr;
+                int width = 0;
+                int height = 0;
+                //empty without a screenshot request
+                std::string screenshot;
+                bool sequence = false;
+                uint64_t sequenceFrame = 0;
+            };
+
+            static void resolve(Slot& slot);
+            //the pending slots, oldest first
+            static void flush();
+
+            static bool m_initialized;
+            static Slot m_slots[RingSize];
+            static uint64_t m_frame;
+            static std::string m_pendingScreenshot;
+            static bool m_recording;
+            static ECaptureFormat m_format;
+            static std::string m_sequencePath;
+            static uint64_t m_sequenceFrame;
+            static FrameCaptureStats m_stats;
+    };
+}
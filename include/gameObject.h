@@ -81,6 +81,8 @@ namespace SpaceEngine
                 }
             }
             bool pendingDestroy = false;
+            //LOD of the mesh in the last frame, the selection keeps it inside the hysteresis band
+            uint8_t lod = 0;
         private:
         
         protected:
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <glad/gl.h>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace SpaceEngine
+{
+    //records the GL calls of the engine in a binary file: the entry points of the loader are swapped with hooks
+    //that write the call and its arguments, the uploaded buffer and texture data included, and forward it.
+    //The capture starts with the context, so the file holds every object the frames use.
+    //Only the state changing calls in the tables of glCapture.cpp are recorded, the queries go straight to the driver
+    class GLCapture
+    {
+        public:
+            //hooks the entry points; the file is written after numFrames frames, before begin the state
+            //is default but the viewport, the capabilities and the blend function, recorded as calls
+            static bool begin(const std::string& path, uint32_t numFrames);
+            //after the swap
+            static void endFrame();
+            //writes the file and restores the entry points, endFrame calls it after the last frame
+            static void end();
+            inline static bool isActive() { return m_active; }
+
+            //writes in the mapped ranges don't go through GL: the owners of the mappings report them
+            static void onBufferWrite(GLuint buffer, GLintptr offset, GLsizeiptr size, const void* pData);
+
+        private:
+            static bool m_active;
+            static std::string m_path;
+            static uint32_t m_numFrames;
+            static uint32_t m_frames;
+    };
+
+    //calls of a type in the timed frames of a replay
+    struct GLReplayCallStats
+    {
+        const char* name;
+        uint32_t count = 0;
+        double ms = 0.0;
+    };
+
+    //re-issues a capture on the current context. The object names must come back the same in a fresh context
+    //(the drivers hand out the lowest free name) and the mismatches are counted; the uniform locations,
+    //the subroutine indices, the syncs and the mappings are translated
+    class GLReplay
+    {
+        public:
+            bool load(const std::string& path);
+            //the frames before warmupFrames run untimed
+            bool run(uint32_t warmupFrames);
+
+            //size of the default framebuffer at the capture
+            inline int getWidth() const { return m_width; }
+            inline int getHeight() const { return m_height; }
+            inline uint32_t getFrames() const { return m_frames; }
+            //call types issued in the timed frames, sorted by time
+            std::vector<GLReplayCallStats> getCallStats() const;
+            //CPU time of the timed frames, up to the glFinish at their end
+            inline const std::vector<double>& getFrameMs() const { return m_frameMs; }
+            inline uint32_t getNameMismatches() const { return m_nameMismatches; }
+            //calls whose entry point is missing in the replay context
+            inline uint32_t getSkippedCalls() const { return m_skippedCalls; }
+
+        private:
+            struct Mapping
+            {
+                uint8_t* pData;
+                GLintptr offset;
+                GLsizeiptr length;
+            };
+
+            //decoders of the calls, in glCapture.cpp
+            struct Calls;
+
+            std::vector<uint8_t> m_data;
+            size_t m_cursor = 0;
+            bool m_error = false;
+            int m_width = 0;
+            int m_height = 0;
+            uint32_t m_frames = 0;
+
+            GLuint m_program = 0;
+            //(program, captured location) -> location
+            std::unordered_map<uint64_t, GLint> m_uniforms;
+            //(program, stage, captured index) -> index
+            std::unordered_map<uint64_t, GLuint> m_subroutines;
+            std::unordered_map<uint64_t, GLint> m_subroutineUniforms;
+            std::unordered_map<uint64_t, GLsync> m_syncs;
+            std::unordered_map<GLuint, Mapping> m_mappings;
+
+            std::vector<uint32_t> m_counts;
+            std::vector<double> m_callMs;
+            std::vector<double> m_frameMs;
+            bool m_timed = false;
+            uint32_t m_nameMismatches = 0;
+            uint32_t m_skippedCalls = 0;
+    };
+}
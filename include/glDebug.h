@@ -0,0 +1,26 @@
+#pragma once
+
+#include <glad/gl.h>
+#include <string>
+
+namespace SpaceEngine
+{
+    //driver messages of KHR_debug (core in GL 4.3) in the log. In the debug builds the context is a debug one
+    //and the messages are synchronous: they are logged inside the call that raised them, with its labels,
+    //and GL_CHECK_ERRORS stops polling glGetError. The release builds register nothing and label nothing
+    class GLDebug
+    {
+        public:
+            //after the loader, false without KHR_debug or in release
+            static bool init();
+            //name of the object in the messages and in the frame debuggers, the object must exist (bound once)
+            static void label(GLenum identifier, GLuint name, const std::string& label);
+            inline static bool isActive() { return m_active; }
+
+        private:
+            static void GLAD_API_PTR callback(GLenum source, GLenum type, GLuint id, GLenum severity,
+                GLsizei length, const GLchar* message, const void* userParam);
+
+            inline static bool m_active = false;
+    };
+}
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <glad/gl.h>
+#include <cstdint>
+#include <unordered_map>
+
+namespace SpaceEngine
+{
+    //fixed function state + program used by a render pass
+    //program = 0 means "keep the current program", drawBuffers = 0 means "keep the current MRT setup"
+    struct PipelineState
+    {
+        GLuint program = 0;
+        bool blend = false;
+        GLenum blendSrc = GL_SRC_ALPHA;
+        GLenum blendDst = GL_ONE_MINUS_SRC_ALPHA;
+        bool depthTest = true;
+        GLenum depthFunc = GL_LESS;
+        bool depthWrite = true;
+        bool cullFace = true;
+        uint8_t drawBuffers = 0;
+    };
+
+    struct GLStateStats
+    {
+        uint32_t issued = 0;
+        uint32_t skipped = 0;
+        //glBindTexture calls forwarded to the driver, counted also in issued
+        uint32_t textureBinds = 0;
+    };
+
+    //shadow copy of the GL state, every call is forwarded to the driver only if the value changes
+    class GLStateCache
+    {
+        public:
+            static void bindPipeline(const PipelineState& pso);
+
+            static void useProgram(GLuint program);
+            static void bindVertexArray(GLuint vao);
+            static void bindFramebuffer(GLuint fbo);
+            //applied to the framebuffer currently bound
+            static void drawBuffers(uint8_t numBuffers);
+            static void enable(GLenum cap, bool flag);
+            static void blendFunc(GLenum src, GLenum dst);
+            static void depthFunc(GLenum func);
+            static void depthMask(bool flag);
+            //unit is the index, not GL_TEXTURE0 + index, the active unit is changed only if the binding changes
+            static void bindTexture(GLuint unit, GLenum target, GLuint texture);
+
+            //call them before the object is deleted
+            static void onDeleteProgram(GLuint program);
+            static void onDeleteVertexArray(GLuint vao);
+            static void onDeleteFramebuffer(GLuint fbo);
+            static void onDeleteTexture(GLuint texture);
+
+            //forget everything, used when someone changes the state behind the cache
+            static void invalidate();
+            static void newFrame();
+
+            //GL 4.5 or ARB_direct_state_access: the objects are created and edited by name, the GL 4.0
+            //contexts bind them to edit them. Both keep the bindings of the cache valid
+            inline static bool hasDirectStateAccess()
+            {
+                return glCreateTextures && glCreateBuffers && glCreateFramebuffers && glCreateRenderbuffers;
+            }
+
+            inline static GLuint getBoundFramebuffer() { return m_fbo; }
+            inline static const GLStateStats& getFrameStats() { return m_lastFrameStats; }
+
+        private:
+            enum ECap
+            {
+                BLEND = 0,
+                DEPTH_TEST,
+                CULL_FACE,
+                NUM_CAPS
+            };
+
+            enum ETexTarget
+            {
+                TEX_2D = 0,
+                TEX_CUBE_MAP,
+                TEX_BUFFER,
+                NUM_TEX_TARGETS
+            };
+
+            //the units the engine uses, the others are not tracked
+            static constexpr GLuint MaxTextureUnits = 16;
+
+            static constexpr GLuint InvalidHandle = 0xFFFFFFFF;
+            static constexpr GLenum InvalidEnum = 0xFFFFFFFF;
+
+            static inline bool changed(bool isChanged)
+            {
+                isChanged ? m_stats.issued++ : m_stats.skipped++;
+                return isChanged;
+            }
+
+            static GLuint m_program;
+            static GLuint m_vao;
+            static GLuint m_fbo;
+            //draw buffers are a framebuffer state
+            static std::unordered_map<GLuint, uint8_t> m_drawBuffers;
+            //-1 unknown, 0 disabled, 1 enabled
+            static int8_t m_caps[NUM_CAPS];
+            static GLenum m_blendSrc;
+            static GLenum m_blendDst;
+            static GLenum m_depthFunc;
+            static int8_t m_depthMask;
+            //every unit has a binding point for each target
+            static GLuint m_textures[MaxTextureUnits][NUM_TEX_TARGETS];
+            static GLuint m_activeUnit;
+            static GLStateStats m_stats;
+            static GLStateStats m_lastFrameStats;
+            static uint64_t m_frame;
+    };
+}
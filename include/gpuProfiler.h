@@ -0,0 +1,98 @@
+#pragma once
+
+#include <glad/gl.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace SpaceEngine
+{
+    //rolling GPU time of a named section, in ms
+    struct GPUTimerStats
+    {
+        std::string name;
+        float lastMs = 0.f;
+        float avgMs = 0.f;
+        float maxMs = 0.f;
+    };
+
+    //GPU time of the render passes measured with timestamp queries,
+    //the queries of a frame are read FramesInFlight frames later so the CPU never waits the GPU
+    class GPUProfiler
+    {
+        public:
+            static constexpr uint32_t FramesInFlight = 4;
+            //rolling window of the stats, ~2 seconds at 60 fps
+            static constexpr uint32_t HistorySize = 120;
+
+            static void init();
+            static void shutdown();
+            //reads the oldest frame of the ring and opens the "frame" section
+            static void beginFrame();
+            static void endFrame();
+
+            //sections can be nested, the sections with the same name are summed in the frame
+            static void begin(const char* name);
+            static void end();
+
+            inline static bool isSupported() { return m_supported; }
+            //sections in order of first appearance, "frame" is the first one
+            inline static const std::vector<GPUTimerStats>& getStats() { return m_stats; }
+            static const GPUTimerStats* findStats(const std::string& name);
+            //frames whose results were dropped because the GPU was more than FramesInFlight behind
+            inline static uint32_t getDroppedFrames() { return m_droppedFrames; }
+            //frames with results read back
+            inline static uint64_t getResolvedFrames() { return m_resolvedFrames; }
+
+        private:
+            static constexpr uint32_t MaxScopesPerFrame = 64;
+
+            struct Scope
+            {
+                uint32_t section;
+                uint32_t beginQuery;
+                uint32_t endQuery;
+            };
+
+            struct FrameSlot
+            {
+                GLuint queries[MaxScopesPerFrame * 2] = {};
+                uint32_t usedQueries = 0;
+                std::vector<Scope> scopes;
+                //sections known when the frame was recorded
+                uint32_t numSections = 0;
+                bool pending = false;
+            };
+
+            struct SectionHistory
+            {
+                float samples[HistorySize] = {};
+                uint32_t head = 0;
+                uint32_t count = 0;
+            };
+
+            static uint32_t findOrAddSection(const char* name);
+            static void resolve(FrameSlot& slot);
+
+            static bool m_supported;
+            static bool m_inFrame;
+            static uint64_t m_frameIndex;
+            static uint64_t m_resolvedFrames;
+            static uint32_t m_droppedFrames;
+            static FrameSlot m_slots[FramesInFlight];
+            //indices in the scopes of the current frame
+            static std::vector<uint32_t> m_openScopes;
+            static std::vector<GPUTimerStats> m_stats;
+            static std::vector<SectionHistory> m_history;
+    };
+
+    //section open for the lifetime of the object
+    class GPUProfileScope
+    {
+        public:
+            explicit GPUProfileScope(const char* name) { GPUProfiler::begin(name); }
+            ~GPUProfileScope() { GPUProfiler::end(); }
+            GPUProfileScope(const GPUProfileScope&) = delete;
+            GPUProfileScope& operator=(const GPUProfileScope&) = delete;
+    };
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <glad/gl.h>
+#include <unordered_map>
+
+#include "utils/utils.h"
+
+namespace SpaceEngine
+{
+    class Mesh;
+
+    //per object data of the impostor draws
+    struct ImpostorInstance
+    {
+        //world center and radius of the bounding sphere
+        Vector4 centerRadius;
+        //columns of the rotation from object to world space, the w of the first one is the fade of the mesh
+        Vector4 rotation[3];
+    };
+
+    //views of a mesh from GridSize x GridSize directions over the sphere, laid out on an octahedral map:
+    //the frame (i, j) looks at the mesh from octDecode((i, j) / (GridSize - 1))
+    struct ImpostorAtlas
+    {
+        //RGBA8: linear albedo premultiplied by the coverage, coverage
+        GLuint albedo = 0;
+        //RGBA16F: object space normal and depth in the sphere (0 front, 1 back), premultiplied by the coverage
+        GLuint normalDepth = 0;
+        //bounding sphere of the mesh in object space
+        Vector3 center = Vector3(0.f);
+        float radius = 0.f;
+        //shading constants of the first material, the atlas keeps only albedo and normal
+        float metalness = 0.f;
+        float roughness = 0.5f;
+        float ambientOcclusion = 1.f;
+    };
+
+    //octahedral impostors baked at load: far objects are drawn as camera facing quads that blend the
+    //4 frames around the view direction and are shaded like the meshes. In the fade band the mesh and
+    //its impostor are drawn with complementary dither patterns
+    class ImpostorManager
+    {
+        public:
+            static constexpr uint32_t GridSize = 8;
+            static constexpr uint32_t FrameSize = 64;
+            static constexpr uint32_t AtlasSize = GridSize * FrameSize;
+            //the mips stop at one texel per frame, so they never mix two frames
+            static constexpr GLsizei MipLevels = 7;
+            //after the units of the light clusters
+            static constexpr GLuint AlbedoTexUnit = 14;
+            static constexpr GLuint NormalDepthTexUnit = 15;
+
+            //renders the atlas of the mesh and compiles the fade programs of its materials, once per mesh
+            static const ImpostorAtlas* bake(Mesh* pMesh);
+            static const ImpostorAtlas* find(const Mesh* pMesh);
+            static void destroy();
+
+            //the objects farther than distance are impostors, the cross-fade starts fadeRange before
+            static void setDistance(float distance, float fadeRange);
+            inline static float getDistance() { return m_distance; }
+            inline static float getFadeRange() { return m_fadeRange; }
+            //weight of the mesh at the distance from the camera: 1 only the mesh, 0 only the impostor
+            static float getMeshFade(const Mesh* pMesh, float distance);
+
+            //unit direction of a point of the octahedral map, uv in [0, 1]; same function of pbr.vs
+            static Vector3 octDecode(Vector2 uv);
+
+        private:
+            static std::unordered_map<const Mesh*, ImpostorAtlas> m_atlases;
+            static float m_distance;
+            static float m_fadeRange;
+    };
+}
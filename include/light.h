@@ -17,6 +17,8 @@ namespace SpaceEngine
         Vector3 color = {255.f, 255.f, 255.f};
         Vector3 dir = {0.f, 0.f, 0.f};
         int type;
+        //POINT_LIGHT only: distance where the light fades to zero, 0 is computed from the color
+        float range = 0.f;
 
         Light(Vector3 pos, Vector3 color, bool dec = false) : 
         pos(pos), color(color)
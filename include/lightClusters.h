@@ -0,0 +1,97 @@
+#pragma once
+
+#include <glad/gl.h>
+#include <vector>
+
+#include "utils/utils.h"
+#include "light.h"
+#include "camera.h"
+#include "shader.h"
+#include "streamBuffer.h"
+
+namespace SpaceEngine
+{
+    struct LightClusterStats
+    {
+        uint32_t localLights = 0;
+        uint32_t globalLights = 0;
+        //lights over the limits, not drawn
+        uint32_t dropped = 0;
+        uint32_t indices = 0;
+        uint32_t maxPerCluster = 0;
+    };
+
+    //froxel grid of the view frustum (screen tiles x exponential depth slices):
+    //every cluster keeps the list of the point lights whose range touches it, so a fragment
+    //shades only the lights of its cluster. The lists are built on the CPU every frame and read
+    //by the shaders from texture buffers; the lights without range (directional, no decay)
+    //are uniforms applied to every fragment
+    class LightClusters
+    {
+        public:
+            //same values of pbr.fs
+            static constexpr uint32_t GridX = 16;
+            static constexpr uint32_t GridY = 9;
+            static constexpr uint32_t GridZ = 24;
+            static constexpr uint32_t NumClusters = GridX * GridY * GridZ;
+            static constexpr uint32_t MaxLocalLights = 1024;
+            static constexpr uint32_t MaxGlobalLights = 4;
+            //the radiance of a light without range drops under it at the computed range
+            static constexpr float MinRadiance = 0.05f;
+            //after the units of the composite
+            static constexpr GLuint LightsTexUnit = 11;
+            static constexpr GLuint GridTexUnit = 12;
+            static constexpr GLuint IndicesTexUnit = 13;
+
+            void init();
+            void destroy();
+            //sorts the lights in global and local ones and fills the lists of the view
+            void build(const CameraView& view, const std::vector<Light*>& lights);
+            //copies the lists in the segment of the frame and points the texture buffers at them
+            void upload();
+            //fences the segment after the last pass that reads the lists
+            void endFrame();
+            //global lights, grid parameters and texture buffers of the program,
+            //the size is the one of the target the fragments are drawn in
+            void bind(ShaderProgram& shader, int targetWidth, int targetHeight) const;
+
+            static float getRange(const Light& light);
+            //index of the cluster, -1 outside the tiles; the depth is clamped to the slices like in pbr.fs
+            int getCluster(int tileX, int tileY, float viewDepth) const;
+            //lights of a cluster, indices in the local lights of the last build
+            inline uint32_t getClusterCount(int cluster) const { return m_grid[cluster * 2 + 1]; }
+            inline const uint32_t* getClusterLights(int cluster) const { return m_indices.data() + m_grid[cluster * 2]; }
+            inline const std::vector<const Light*>& getLocalLights() const { return m_local; }
+            inline const LightClusterStats& getStats() const { return m_stats; }
+
+        private:
+            struct ClusterBounds
+            {
+                int x0, x1, y0, y1, z0, z1;
+            };
+
+            //false if the light doesn't touch the frustum
+            bool computeBounds(const CameraView& view, const Light& light, ClusterBounds& bounds) const;
+            int getSlice(float viewDepth) const;
+
+            float m_near = 0.1f;
+            float m_far = 100.f;
+            //slices per log unit of depth
+            float m_sliceScale = 1.f;
+            std::vector<const Light*> m_global;
+            std::vector<const Light*> m_local;
+            std::vector<ClusterBounds> m_bounds;
+            //offset and count of every cluster
+            std::vector<uint32_t> m_grid;
+            std::vector<uint32_t> m_indices;
+            //2 texels per light: position and range, color
+            std::vector<Vector4> m_lightData;
+            LightClusterStats m_stats;
+
+            //the textures read ranges of the ring, the buffers are orphaned every frame without glTexBufferRange
+            StreamBuffer m_stream;
+            GLint m_offsetAlignment = 1;
+            GLuint m_buffers[3] = {};
+            GLuint m_textures[3] = {};
+    };
+}
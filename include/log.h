@@ -6,6 +6,7 @@
 
 #include <spdlog/spdlog.h>
 #include <glad/gl.h>
+#include "glDebug.h"
 
 #define DEFAULT_LOGGER_NAME "SpaceEngineLogger"
 #ifdef SPACE_ENGINE_PLATFORM_WINDOWS
@@ -112,18 +113,27 @@ static const char* getGLErrorString(GLenum error)
     }
 }
 
+//glGetError waits the driver: only the debug builds without KHR_debug poll it,
+//the debug output reports the errors inside the calls
+#ifdef SPACE_ENGINE_DEBUG_CONFIG
 #define GL_CHECK(call)                                                   \
     do {                                                                 \
         call;                                                            \
+        if (SpaceEngine::GLDebug::isActive()) break;                     \
         if (GLenum err = glGetError(); err != GL_NO_ERROR)               \
-            SPACE_ENGINE_FATAL("GL error: %s for " #call, getGLErrorString(err)); \
+            SPACE_ENGINE_FATAL("GL error: {} for " #call, getGLErrorString(err)); \
     } while (0)
 
 #define GL_CHECK_ERRORS()                                     \
     do {                                                      \
+        if (SpaceEngine::GLDebug::isActive()) break;          \
         if (GLenum err = glGetError(); err != GL_NO_ERROR)    \
             SPACE_ENGINE_FATAL("GL error: {}, file:{}, line:{}", getGLErrorString(err), __FILE__, __LINE__); \
     } while (0)
+#else
+#define GL_CHECK(call) do { call; } while (0)
+#define GL_CHECK_ERRORS() (void)0
+#endif
 
 #define GL_CHECK_FRAMEBUFFER_STATUS()                                     \
     do {                                                      \
@@ -131,6 +141,13 @@ static const char* getGLErrorString(GLenum error)
             SPACE_ENGINE_FATAL("GL Framebuffer not complete: {}, file:{}, line:{}", getGLErrorString(err), __FILE__, __LINE__); \
     } while (0)
 
+//the framebuffers edited by name aren't bound
+#define GL_CHECK_NAMED_FRAMEBUFFER_STATUS(fbo)                                                  \
+    do {                                                                                        \
+        if (GLenum status = glCheckNamedFramebufferStatus(fbo, GL_FRAMEBUFFER); status != GL_FRAMEBUFFER_COMPLETE) \
+            SPACE_ENGINE_FATAL("GL Framebuffer {} not complete: 0x{:x}, file:{}, line:{}", fbo, status, __FILE__, __LINE__); \
+    } while (0)
+
 #define FT_CHECK(call)                                                  \
     do                                                                  \
     {                                                                   \
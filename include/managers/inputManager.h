@@ -53,6 +53,8 @@ enum
     SPACE_ENGINE_KEY_BUTTON_ENTER=257,
     SPACE_ENGINE_KEY_TAB=258,
     SPACE_ENGINE_KEY_BUTTON_BACKSPACE=259,
+    SPACE_ENGINE_KEY_BUTTON_F3=292,
+    SPACE_ENGINE_KEY_BUTTON_F12=301,
     SPACE_ENGINE_KEY_BUTTON_SPACE=32, 
     //Joystick buttons
     SPACE_ENGINE_JK_BUTTON_A=0, 
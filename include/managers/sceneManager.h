@@ -18,10 +18,13 @@ namespace SpaceEngine
             void Shutdown();
             void Update(float dt);
             void LateUpdate();
-            void GatherRenderables(std::vector<RenderObject>& worldRenderables, 
+            void GatherRenderables(const CameraView* pView,
+                std::vector<RenderObject>& worldRenderables, 
                 std::vector<UIRenderObject>& uiRenderables, 
                 std::vector<TextRenderObject>& textRenderables,
                 std::vector<ScreenRenderObject>& screenRenderables);
+            //culling result of the last gather
+            inline const CullStats& GetCullStats() const { return m_cullStats; }
             BaseCamera* GetActiveCamera();
             std::vector<Light*>* GetLights();
             Skybox* GetSkybox();
@@ -39,5 +42,6 @@ namespace SpaceEngine
             static std::vector<Scene*> m_vecScenes;
             static Scene* m_currScene;
             static std::queue<Scene*> m_pendingUnloadQ;
+            CullStats m_cullStats;
     };
 }
\ No newline at end of file
@@ -33,6 +33,10 @@ namespace SpaceEngine
             static bool fullScreenState;
             constexpr static const float aspectRatio = 16.f/9.f;
             static Matrix4 sceenProjMatrix; 
+            //bumped every time the resolution changes, used to invalidate the cached layouts
+            static uint32_t resolutionGeneration;
+            //set it before Initialize: invisible window, the frames are rendered offscreen
+            static bool headless;
         private:
             bool setUpGLFW();
     };
@@ -8,6 +8,7 @@
 #include <variant>
 #include <map>
 #include <array>
+#include <vector>
 
 namespace SpaceEngine
 {
@@ -67,12 +68,16 @@ namespace SpaceEngine
             virtual ~BaseMaterial() {} 
             void bindingPropsToShader();
             void bindingPropsToShader(ShaderProgram* pShaderProg);
+            //props and textures in another program of the material, pShader doesn't change
+            void bindingPropsToProgram(ShaderProgram& program);
             ShaderProgram* getShader();
             int addTexture(const std::string& nameTex, Texture* pTex);
             int addProperty(const std::string& nameProp, PropertyValue val);
             int removeProperty(const std::string& nameProp);
             int removeTexture(const std::string& nameTex);
             Texture* getTexture(std::string nameTex);
+            //alpha of albedo_color_val under 1, the draw blends with what is behind it
+            bool isTranslucent() const;
             
             std::string name;
             std::unordered_map<std::string, PropertyValue> props;
@@ -87,6 +92,8 @@ namespace SpaceEngine
             //subroutines["nameSubroutine, nameSubroutineUniform"]
             std::unordered_map<std::string, subroutineInfo> subroutines;
             ShaderProgram* pShader = nullptr;
+            //program of the mesh while it cross-fades with its impostor, set by the impostor bake
+            ShaderProgram* pFadeShader = nullptr;
             protected:
                 BaseMaterial() = default;
                 BaseMaterial(std::string name);
@@ -103,38 +110,42 @@ namespace SpaceEngine
     {
         friend class MaterialManager;
         public:
-        std::array<std::array<float, 4>, 6> bindCharacter(char c, float& offsetX, float resScale,  Vector2 pos, Transform2D& transf)
+        //appends the 6 vertices <vec2 pos, vec2 uv> of the glyph quad, the uv are in the font atlas
+        void appendCharacter(char c, float& offsetX, float resScale,  Vector2 pos, const Transform2D& transf, std::vector<std::array<float, 4>>& vertices)
         {
-            if(m_font.find(c) == m_font.end())
+            auto it = m_font.find(c);
+            if(it == m_font.end())
             {
                 SPACE_ENGINE_FATAL("TextMaterial: Charater not found");
                 exit(-1);
             }
 
-            Character ch = m_font[c];
-            //bind texture
-            ch.pTex->bind(); 
-            GL_CHECK_ERRORS();
+            const Character& ch = it->second;
             float xpos = offsetX + ch.bearing.x * transf.scale.x * resScale;
             float ypos = pos.y - (ch.size.y - ch.bearing.y) * transf.scale.y * resScale;
 
             float w = ch.size.x * transf.scale.x * resScale;
             float h = ch.size.y * transf.scale.y * resScale;
         
-            std::array<std::array<float, 4>, 6> vertices
-            {{
-                { xpos + w, ypos,       1.0f, 0.0f }, //bottom-right
-                { xpos,     ypos,       0.0f, 0.0f }, //bottom-left
-                { xpos,     ypos + h,   0.0f, 1.0f }, //top-left
+            vertices.insert(vertices.end(),
+            {
+                { xpos + w, ypos,       ch.uvMax.x, ch.uvMin.y }, //bottom-right
+                { xpos,     ypos,       ch.uvMin.x, ch.uvMin.y }, //bottom-left
+                { xpos,     ypos + h,   ch.uvMin.x, ch.uvMax.y }, //top-left
                 
-                { xpos,     ypos + h,   0.0f, 1.0f }, //top-left
-                { xpos + w, ypos + h,   1.0f, 1.0f },  //top-right
-                { xpos + w, ypos,       1.0f, 0.0f } //bottom-right
-            }};
+                { xpos,     ypos + h,   ch.uvMin.x, ch.uvMax.y }, //top-left
+                { xpos + w, ypos + h,   ch.uvMax.x, ch.uvMax.y },  //top-right
+                { xpos + w, ypos,       ch.uvMax.x, ch.uvMin.y } //bottom-right
+            });
 
             offsetX += (ch.advance >> 6) * transf.scale.x * resScale;
-            
-            return vertices;
+        }
+
+        //all the characters of the font share the same atlas
+        inline void bindAtlas() const
+        {
+            if(!m_font.empty())
+                m_font.begin()->second.pTex->bind();
         }
 
         private:
@@ -160,6 +171,12 @@ namespace SpaceEngine
 
     class PBRMaterial : public BaseMaterial
     {
+        public:
+            //picks the pbr program specialized for the textures of the material,
+            //call it when the textures are set
+            void selectVariant();
+            //the pbr program of the textures of the material with one more define
+            ShaderProgram* getVariant(const char* extraDefine);
         private:
             PBRMaterial()
             {
@@ -181,8 +198,6 @@ namespace SpaceEngine
                     {"ambient_occlusion_val", float{1.f}}
                 };
             }
-            
-            void bindSubroutines() override;
         friend class MaterialManager;
     };
 
@@ -212,6 +227,9 @@ namespace SpaceEngine
         public:
             void setSubroutineBase(bool flag);
             void setSubroutineHover(bool flag);
+            bool isHovered();
+            //nullptr when the button has no hover texture
+            Texture* getHoverTexture();
         private:
             UIButtonMaterial()
             {
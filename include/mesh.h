@@ -4,63 +4,162 @@
 #include <glad/gl.h>
 #include <memory>
 #include <unordered_map>
+#include <vector>
 
 #include "utils/utils.h"
 #include "material.h"
+#include "streamBuffer.h"
 
 #define INVALID_MATERIAL 0xFFFFFFFF
 
 namespace SpaceEngine
 {
+    //layout of the arguments read by glMultiDrawElementsIndirect
+    struct DrawElementsIndirectCommand
+    {
+        GLuint count;
+        GLuint instanceCount;
+        GLuint firstIndex;
+        GLint baseVertex;
+        GLuint baseInstance;
+    };
+
+    //per draw data of the meshes, read as instanced attributes with the base instance of the draw
+    struct MeshInstance
+    {
+        Matrix4 model;
+        //columns of the normal matrix, the w of the first one is the weight of the mesh in the cross-fade
+        //with its impostor, the others are padding
+        Vector4 normalMatrix[3];
+    };
+
+    struct MeshVertex
+    {
+        Vector3 position;
+        Vector2 texCoords;
+        Vector3 normal;
+    };
+
+    //first fit allocator of element ranges, the free ranges are merged
+    class RangeAllocator
+    {
+        public:
+            void reset(uint32_t capacity);
+            //false if there isn't a free range big enough
+            bool allocate(uint32_t count, uint32_t& offset);
+            void free(uint32_t offset, uint32_t count);
+            //adds the new elements at the end as free
+            void grow(uint32_t capacity);
+            inline uint32_t getCapacity() const { return m_capacity; }
+
+        private:
+            struct Range
+            {
+                uint32_t offset;
+                uint32_t count;
+            };
+
+            //sorted by offset
+            std::vector<Range> m_free;
+            uint32_t m_capacity = 0;
+    };
+
+    //quadric edge collapse (Garland-Heckbert) of an indexed triangle list: every collapse moves a vertex on a
+    //neighbour, so the result indexes the same vertices. The vertices on the borders and on the UV seams don't move.
+    //Stops at targetIndices or when the next collapse moves the surface more than maxError, pResultError is the
+    //biggest error of the collapses done
+    std::vector<uint32_t> simplifyMesh(const MeshVertex* pVertices, uint32_t numVertices, const std::vector<uint32_t>& indices,
+        uint32_t targetIndices, float maxError, float* pResultError = nullptr);
+
+    //vertices and indices of all the meshes in one vertex buffer and one index buffer,
+    //all the meshes are drawn with the same vertex array
+    class GeometryArena
+    {
+        public:
+            static constexpr uint32_t InitialVertices = 1 << 16;
+            static constexpr uint32_t InitialIndices = 1 << 18;
+
+            //baseVertex and firstIndex are the offsets of the data in the arena, the buffers grow when needed
+            static void allocate(const std::vector<MeshVertex>& vertices, const std::vector<uint32_t>& indices,
+                uint32_t& baseVertex, uint32_t& firstIndex);
+            static void free(uint32_t baseVertex, uint32_t numVertices, uint32_t firstIndex, uint32_t numIndices);
+            static void bindVAO();
+            //points the instanced attributes to the MeshInstance array at offset
+            static void setInstanceBuffer(GLuint buffer, GLintptr offset);
+            inline static GLuint getVAO() { return m_VAO; }
+
+        private:
+            static void init();
+            static GLuint createBuffer(GLsizeiptr size, const char* label);
+            static void growBuffer(GLuint& buffer, GLsizeiptr oldSize, GLsizeiptr newSize, const char* label);
+            static void bindVertexAttribs();
+
+            static GLuint m_VAO;
+            static GLuint m_vertexBuffer;
+            static GLuint m_indexBuffer;
+            static RangeAllocator m_vertices;
+            static RangeAllocator m_indices;
+    };
+
     class Mesh
     {
     public:
+        static constexpr uint32_t MaxLods = 4;
+        //radius of the bounding sphere on the screen, as a fraction of the half height, under which the LOD i + 1 is drawn
+        static constexpr float LodCoverage[MaxLods - 1] = {0.25f, 0.1f, 0.04f};
+        //simplification error of the LODs relative to the bounds radius, about one pixel at 1080p at the thresholds
+        static constexpr float LodError[MaxLods - 1] = {0.01f, 0.03f, 0.08f};
+        //the coverage has to cross the threshold by this fraction to change LOD
+        static constexpr float LodHysteresis = 0.15f;
+
         Mesh() = default;
         ~Mesh() = default;
         void bindVAO();
         int getNumSubMesh();
         int bindMaterialToSubMeshIndex(int index, BaseMaterial *pMat);
         BaseMaterial *getMaterialBySubMeshIndex(int index);
-        void drawSubMesh(unsigned int idSubMesh);
+        void drawSubMesh(unsigned int idSubMesh, uint32_t lod = 0);
+        //one instance, the base instance is set by the renderer; the sub meshes with less LODs draw their last one
+        DrawElementsIndirectCommand getDrawCommand(unsigned int idSubMesh, uint32_t lod = 0) const;
+        inline uint32_t getNumLods() const { return numLods; }
+        //LOD for the coverage of the bounding sphere, current is the LOD of the object in the last frame
+        uint32_t selectLod(float coverage, uint32_t current) const;
 
     private:
         void clear();
         void populateBuffers();
 
-        struct Vertex
-        {
-            Vector3 position;
-            Vector2 texCoords;
-            Vector3 normal;
-        };
-
-        enum BUFFER_TYPE
-        {
-            INDEX_BUFFER = 0,
-            VERTEX_BUFFER = 1,
-            WVP_MAT_BUFFER = 2,
-            WORLD_MAT_BUFFER = 3,
-            NUM_BUFFER = 4,
-        };
+        using Vertex = MeshVertex;
 
         struct MeshEntry
         {
+            struct Lod
+            {
+                uint32_t baseIndex = 0;
+                uint32_t numIndices = 0;
+            };
+
             MeshEntry()
             {
-                numIndices = 0;
                 baseVertex = 0;
-                baseIndex = 0;
                 materialIndex = INVALID_MATERIAL;
+                numLods = 1;
             }
 
-            uint32_t numIndices;
             uint32_t baseVertex;
-            uint32_t baseIndex;
             uint32_t materialIndex;
+            //lods[0] is the imported mesh, the simplified ones follow the indices of all the sub meshes
+            Lod lods[MaxLods];
+            uint32_t numLods;
         };
 
-        GLuint VAO = 0;
-        GLuint buffers[NUM_BUFFER] = {0};
+        //ranges in the GeometryArena, the sub meshes are relative to them
+        uint32_t baseVertex = 0;
+        uint32_t firstIndex = 0;
+        uint32_t numVertices = 0;
+        uint32_t numIndices = 0;
+        //the most LODs of the sub meshes
+        uint32_t numLods = 1;
         std::vector<BaseMaterial *> materials;
         std::vector<MeshEntry> subMeshes;
         std::vector<uint32_t> indices;
@@ -72,6 +171,10 @@ namespace SpaceEngine
         Vector3 maxPos;
         Vector3 minPos;
 
+        //local bounding sphere from the AABB
+        inline Vector3 getBoundsCenter() const { return (minPos + maxPos) * 0.5f; }
+        inline float getBoundsRadius() const { return glm::length(maxPos - minPos) * 0.5f; }
+
         friend class MeshManager;
     };
 
@@ -104,27 +207,43 @@ namespace SpaceEngine
     {
     public:
         TextMesh();
+        ~TextMesh();
+        TextMesh(const TextMesh &) = delete;
+        TextMesh &operator=(const TextMesh &) = delete;
+        //draws the quads of the last subData from the buffer of the text
         void draw();
         void bindVAO();
-        void subData(const std::array<std::array<float, 4>, 6>& vertices);
+        //the quads of a changed layout go through the ring shared by the texts and are copied on the GPU
+        //in the buffer of the text, call it between beginFrame and endFrame; unchanged texts upload nothing
+        void subData(const std::vector<std::array<float, 4>>& vertices);
+        //fences the ring shared by all the texts, once per frame around the text draws
+        static void beginFrame();
+        static void endFrame();
 
 
     private:
         void populateBuffers();
         GLuint VAO = 0;
         GLuint buffer = 0;
+        GLsizei m_numVertices = 0;
+        GLsizeiptr m_capacity = 0;
+        //staging of the changed layouts
+        static StreamBuffer stream;
+        static uint32_t numMeshes;
     };
 
     class TextMeshRenderer
     {
         public:
         TextMeshRenderer();
+        ~TextMeshRenderer();
         
         int bindMaterial(TextMaterial *pMat);
         TextMaterial *getMaterial();
         TextMesh *getTextMesh();
 
     private:
+        //every text owns its mesh, it keeps the cached layout on the GPU
         TextMesh *pMesh;
         TextMaterial *pMat;    
     };
@@ -152,6 +271,8 @@ namespace SpaceEngine
         static void reserveSpace(unsigned int numVertices, unsigned int numIndices);
         static void initAllMeshes(const aiScene *pScene);
         static void initSingleMesh(uint32_t meshIndex, const aiMesh *paiMesh);
+        //simplified index ranges of the sub meshes, appended to the indices of the mesh
+        static void buildLods();
         static bool initMaterials(const aiScene *pScene, const std::string &fileName);
         static void loadTextures(const std::string &dir, const aiMaterial *pMaterial, const aiScene *pScene, int index);
         static void loadDiffuseTexture(const std::string &dir, const aiMaterial *pMaterial, const aiScene *pScene, int materialIndex);
@@ -0,0 +1,178 @@
+#pragma once
+
+#include "utils/utils.h"
+#include "transform.h"
+#include "texture.h"
+
+#include <vector>
+
+namespace SpaceEngine
+{
+    //look of the billboards: the particles of the emitters with the same material are drawn with one call
+    struct ParticleMaterial
+    {
+        //null: soft disc
+        Texture* pTexture = nullptr;
+        //fraction of the color written in the bright target read by the bloom
+        float bloom = 1.f;
+    };
+
+    struct ParticleEmitterDesc
+    {
+        ParticleMaterial* pMaterial = nullptr;
+        //particles per second while the emitter is active, the bursts ignore it
+        float rate = 0.f;
+        float minLife = 0.5f;
+        float maxLife = 1.f;
+        float minSpeed = 1.f;
+        float maxSpeed = 2.f;
+        //direction in the space of the transform and half angle of the cone in degrees, 180 is a sphere
+        Vector3 direction = {0.f, 0.f, 1.f};
+        float spread = 180.f;
+        //from the origin of the transform
+        Vector3 offset = {0.f, 0.f, 0.f};
+        //fraction of the speed lost every second
+        float drag = 0.f;
+        float startSize = 0.2f;
+        float endSize = 0.f;
+        //HDR colors, the values above 1 glow, the alpha scales the color (additive blending)
+        Vector4 startColor = {1.f, 1.f, 1.f, 1.f};
+        Vector4 endColor = {1.f, 1.f, 1.f, 0.f};
+    };
+
+    //fixed capacity pool with one array per attribute: the live particles are the first getCount() entries,
+    //a dead particle is replaced by the last one
+    class ParticlePool
+    {
+        public:
+            void init(uint32_t capacity);
+            inline void clear() { m_count = 0; }
+            //false when the pool is full
+            bool emit(const Vector3& pos, const Vector3& vel, float life, float drag, uint16_t style);
+            //integrates and ages the particles (4 at a time with SSE), returns the number of the dead ones removed
+            uint32_t simulate(float dt);
+            inline uint32_t getCount() const { return m_count; }
+            inline uint32_t getCapacity() const { return static_cast<uint32_t>(age.size()); }
+
+            //read by the instance build
+            std::vector<float> posX, posY, posZ;
+            std::vector<float> velX, velY, velZ;
+            std::vector<float> age, life, drag;
+            std::vector<uint16_t> style;
+
+        private:
+            uint32_t m_count = 0;
+    };
+
+    //billboard of a live particle, per instance attributes of the particle shader
+    struct ParticleInstance
+    {
+        Vector4 posSize;
+        Vector4 color;
+    };
+
+    //instances [first, first + count) share the material
+    struct ParticleBatch
+    {
+        ParticleMaterial* pMaterial;
+        uint32_t first;
+        uint32_t count;
+    };
+
+    struct ParticleStats
+    {
+        uint32_t alive = 0;
+        uint32_t spawned = 0;
+        //spawns over the budget
+        uint32_t dropped = 0;
+        uint32_t died = 0;
+    };
+
+    class ParticleEmitter
+    {
+        friend class ParticleSystem;
+        public:
+            inline void setActive(bool flag) { m_active = flag; }
+            inline bool isActive() const { return m_active; }
+
+        private:
+            ParticleEmitterDesc m_desc;
+            Transform* m_pTransform = nullptr;
+            uint16_t m_style = 0;
+            //fraction of particle carried to the next frame
+            float m_pending = 0.f;
+            bool m_active = true;
+    };
+
+    //effects that don't need GameObjects: the emitters follow a Transform, the bursts are spawned at a position;
+    //the particles outlive their emitter and are drawn by RendererV2
+    class ParticleSystem
+    {
+        public:
+            static constexpr uint32_t Capacity = 16384;
+            static constexpr uint32_t DefaultBudget = 4096;
+            static constexpr uint32_t MaxMaterials = 16;
+
+            static void init(uint32_t capacity = Capacity);
+            static void shutdown();
+            //removes the particles, the emitters stay
+            static void clear();
+            //emits, simulates and rebuilds the instances
+            static void update(float dt);
+
+            //the emitter follows the transform: destroy it before the transform is deleted
+            static ParticleEmitter* createEmitter(const ParticleEmitterDesc& desc, Transform* pTransform);
+            static void destroyEmitter(ParticleEmitter* pEmitter);
+            //count particles at a world position
+            static void burst(const ParticleEmitterDesc& desc, const Vector3& pos, uint32_t count);
+
+            //max live particles, the spawns over it are dropped; it's clamped to the capacity
+            static void setBudget(uint32_t budget);
+            inline static uint32_t getBudget() { return m_budget; }
+            //counts of the last update
+            inline static const ParticleStats& getStats() { return m_lastStats; }
+            inline static const ParticlePool& getPool() { return m_pool; }
+
+            //live particles grouped by material
+            inline static const std::vector<ParticleInstance>& getInstances() { return m_instances; }
+            inline static const std::vector<ParticleBatch>& getBatches() { return m_batches; }
+
+        private:
+            //everything a particle needs after its emitter is gone
+            struct ParticleStyle
+            {
+                float startSize;
+                float endSize;
+                Vector4 startColor;
+                Vector4 endColor;
+                uint8_t material;
+            };
+
+            static constexpr uint32_t MaxStyles = 256;
+
+            static uint16_t findStyle(const ParticleEmitterDesc& desc);
+            static void spawn(const ParticleEmitterDesc& desc, uint16_t style, const Vector3& pos, const Matrix3& basis, uint32_t count);
+            static void buildInstances();
+            //xorshift, separate from PRNG so the effects don't change the spawns of the game
+            static float random();
+
+            static ParticlePool m_pool;
+            static std::vector<ParticleEmitter*> m_emitters;
+            static std::vector<ParticleStyle> m_styles;
+            static std::vector<ParticleMaterial*> m_materials;
+            static std::vector<ParticleInstance> m_instances;
+            static std::vector<ParticleBatch> m_batches;
+            static uint32_t m_budget;
+            static ParticleStats m_stats;
+            static ParticleStats m_lastStats;
+            static uint32_t m_random;
+    };
+
+    //the effects of the game
+    namespace ParticleEffects
+    {
+        ParticleEmitterDesc explosion(const Vector4& color);
+        ParticleEmitterDesc engineTrail(const Vector4& color);
+        ParticleEmitterDesc pickup(const Vector4& color);
+    }
+}
@@ -23,5 +23,9 @@ namespace SpaceEngine {
         float m_lifeTime = 10.0f;
         float m_velocity; 
         float m_despawnZ;
+
+        static constexpr uint32_t PickupParticles = 32;
+        //indexed by PowerUpType
+        inline static const Vector4 PickupColors[] = {{4.f, 3.f, 0.5f, 1.f}, {5.f, 1.f, 4.f, 1.f}, {0.5f, 4.f, 1.f, 1.f}};
     };
 }
\ No newline at end of file
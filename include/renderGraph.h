@@ -0,0 +1,139 @@
+#pragma once
+
+#include <glad/gl.h>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <string>
+#include <vector>
+
+namespace SpaceEngine
+{
+    using RGResource = uint32_t;
+    constexpr RGResource RGInvalidResource = 0xFFFFFFFF;
+
+    //render target size is the graph size * render scale >> downscale
+    struct RGTextureDesc
+    {
+        GLenum format = GL_RGBA16F;
+        uint8_t downscale = 0;
+    };
+
+    //frame described as a list of passes that declare the targets they read and write,
+    //the targets no pass uses are not allocated; the depth targets that no pass reads are renderbuffers
+    class RenderGraph
+    {
+        public:
+            RenderGraph() = default;
+            ~RenderGraph();
+            RenderGraph(const RenderGraph&) = delete;
+            RenderGraph& operator=(const RenderGraph&) = delete;
+
+            RGResource createTexture(const std::string& name, const RGTextureDesc& desc);
+            //texture owned by someone else, never resized
+            RGResource importTexture(const std::string& name, GLuint texture, int width, int height);
+            //a pass without outputs draws on the output framebuffer
+            uint32_t addPass(const std::string& name,
+                std::initializer_list<RGResource> reads,
+                std::initializer_list<RGResource> writes,
+                std::function<void()> execute);
+
+            //targets used by the passes and allocation, call it after the last addPass
+            void compile();
+            void execute();
+            //forget passes and targets
+            void reset();
+
+            //immediate reallocation
+            void setSize(int width, int height);
+            //the default framebuffer follows the new size at once, the targets when the size settles:
+            //until then the old targets are drawn and stretched on the window
+            void requestResize(int width, int height);
+            //applies a settled resize, call it once per frame before execute
+            void update();
+            //target of the passes without outputs, 0 is the window
+            inline void setOutputFramebuffer(GLuint fbo) { m_outputFbo = fbo; }
+            //fraction of the graph size of the transient targets, the output keeps its size;
+            //the targets are reallocated at once
+            void setRenderScale(float scale);
+
+            //0 for the depth targets no pass reads, they are renderbuffers
+            GLuint getTexture(RGResource resource) const;
+            inline int getWidth() const { return m_width; }
+            inline int getHeight() const { return m_height; }
+            //viewport of the passes drawn in the output framebuffer
+            inline int getOutputWidth() const { return m_outputWidth; }
+            inline int getOutputHeight() const { return m_outputHeight; }
+            inline float getRenderScale() const { return m_renderScale; }
+            //size of the transient targets without downscale
+            int getRenderWidth() const;
+            int getRenderHeight() const;
+            inline uint32_t getNumPhysicalTextures() const { return static_cast<uint32_t>(m_physical.size()); }
+            inline size_t getAllocatedBytes() const { return m_allocatedBytes; }
+
+        private:
+            struct VirtualTexture
+            {
+                std::string name;
+                RGTextureDesc desc;
+                bool imported = false;
+                GLuint importedTexture = 0;
+                int importedWidth = 0;
+                int importedHeight = 0;
+                //first pass that uses it, -1 for an unused target
+                int firstPass = -1;
+                int physical = -1;
+                //read by a pass
+                bool sampled = false;
+            };
+
+            struct PhysicalTexture
+            {
+                RGTextureDesc desc;
+                std::string name;
+                //texture or renderbuffer name
+                GLuint texture = 0;
+                bool renderbuffer = false;
+                int width = 0;
+                int height = 0;
+            };
+
+            struct Pass
+            {
+                std::string name;
+                std::vector<RGResource> reads;
+                std::vector<RGResource> writes;
+                std::function<void()> execute;
+                GLuint fbo = 0;
+                int width = 0;
+                int height = 0;
+            };
+
+            void allocate();
+            void release();
+            void buildFramebuffers();
+            void targetSize(const VirtualTexture& vt, int& width, int& height) const;
+            static size_t bytesPerPixel(GLenum format);
+            static bool isDepthFormat(GLenum format);
+
+            //after the last resize request, wait before reallocating
+            static constexpr std::chrono::milliseconds ResizeDelay{200};
+
+            std::vector<VirtualTexture> m_textures;
+            std::vector<PhysicalTexture> m_physical;
+            std::vector<Pass> m_passes;
+            int m_width = 0;
+            int m_height = 0;
+            int m_outputWidth = 0;
+            int m_outputHeight = 0;
+            GLuint m_outputFbo = 0;
+            float m_renderScale = 1.f;
+            bool m_compiled = false;
+            bool m_resizePending = false;
+            int m_pendingWidth = 0;
+            int m_pendingHeight = 0;
+            std::chrono::steady_clock::time_point m_lastResizeRequest;
+            size_t m_allocatedBytes = 0;
+    };
+}
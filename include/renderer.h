@@ -9,6 +9,13 @@
 #include "light.h"
 #include "font.h"
 #include "texture.h"
+#include "glState.h"
+#include "uiBatch.h"
+#include "renderGraph.h"
+#include "gpuProfiler.h"
+#include "particles.h"
+#include "lightClusters.h"
+#include "impostor.h"
 
 #include <vector>
 
@@ -19,6 +26,10 @@ namespace SpaceEngine
     {
         Matrix4 modelMatrix;
         Mesh* mesh = nullptr;
+        //selected by the scene from the size on the screen
+        uint32_t lod = 0;
+        //weight of the mesh against its impostor, set by the scene from the distance: 0 draws only the impostor
+        float meshFade = 1.f;
     };
 
     struct UIRenderObject
@@ -43,7 +54,7 @@ namespace SpaceEngine
     {
         const std::vector<RenderObject>& renderables; 
         const std::vector<Light*>& lights;
-        const BaseCamera* cam;
+        const CameraView* view;
         Skybox* pSkybox = nullptr; 
     };
 
@@ -51,8 +62,9 @@ namespace SpaceEngine
     {
         friend class FrameBuffer;
         public:
-            RenderBuffer(GLenum target, GLenum attachment);
-            void init(GLenum target, GLenum attachment);
+            //attached to the depth of frameBuffer
+            RenderBuffer(GLenum target, GLenum attachment, GLuint frameBuffer);
+            void init(GLenum target, GLenum attachment, GLuint frameBuffer);
         private:
             GLenum m_renderBufferObj = 0;
             GLenum m_target = 0;
@@ -77,14 +89,14 @@ namespace SpaceEngine
         {
             if(m_frameBufferObj)
             {
-                glBindFramebuffer(GL_FRAMEBUFFER, m_frameBufferObj);
+                GLStateCache::bindFramebuffer(m_frameBufferObj);
                 return 0;
             }
             
             return -1;
         }
 
-        inline void unbindFrameBuffer(){glBindFramebuffer(GL_FRAMEBUFFER, 0);}
+        inline void unbindFrameBuffer(){GLStateCache::bindFramebuffer(0);}
         inline int getColorBuffer(uint32_t index)
         {
             if(index < m_vecColorBuffers.size())
@@ -97,11 +109,98 @@ namespace SpaceEngine
     private:
         GLuint m_frameBufferObj = 0;
         std::vector<Texture*> m_vecColorBuffers;
-        RenderBuffer* m_pRenderBuffer;
+        RenderBuffer* m_pRenderBuffer = nullptr;
     };
 
+    //progressive downsample (13 taps) of the bright pass followed by a tent upsample,
+    //every level is accumulated on the bigger one
+    class Bloom
+    {
+        public:
+            static constexpr uint8_t MaxMips = 8;
+
+            void init();
+            //declares the chain passes, returns the target with the bloom (half resolution)
+            RGResource addPasses(RenderGraph& graph, RGResource brightPass);
+            //number of levels of the chain, the first one is half resolution
+            //it's read by addPasses
+            inline void setMipCount(uint8_t count) { m_mipCount = count < 1 ? 1 : (count > MaxMips ? MaxMips : count); }
+            //upsample tent radius in texels of the smaller level
+            inline void setFilterRadius(float radius) { m_filterRadius = radius; }
+            //the passes are skipped when disabled
+            inline void setEnabled(bool flag) { m_enabled = flag; }
+            //format of the levels, read by addPasses
+            inline void setFormat(GLenum format) { m_format = format; }
+            inline uint8_t getMipCount() const { return m_mipCount; }
+            inline float getFilterRadius() const { return m_filterRadius; }
+            //every level adds the whole energy of the bright pass
+            inline float getIntensityScale() const { return 1.f / static_cast<float>(m_mipCount); }
+
+        private:
+            //the units below are left to the materials
+            static constexpr GLuint SrcTexUnit = 8;
+
+            uint8_t m_mipCount = 3;
+            float m_filterRadius = 1.f;
+            //no alpha: the chain carries only the color
+            GLenum m_format = GL_R11F_G11F_B10F;
+            bool m_enabled = true;
+            ShaderProgram* m_pDownsampleShader = nullptr;
+            ShaderProgram* m_pUpsampleShader = nullptr;
+            PipelineState m_downsamplePSO = {.blend = false, .depthTest = false, .cullFace = false};
+            //additive
+            PipelineState m_upsamplePSO = {.blend = true, .blendSrc = GL_ONE, .blendDst = GL_ONE, .depthTest = false, .cullFace = false};
+    };
+
+    //feedback loop on the GPU frame time that picks the scale of the HDR targets:
+    //it drops at once to the scale that fits the target, it grows one step at a time
+    //only when the bigger scale is expected to stay under the target
+    class DynamicResolution
+    {
+        public:
+            //50% to 100% in steps of 10%
+            static constexpr float MinScale = 0.5f;
+            static constexpr float ScaleStep = 0.1f;
+            static constexpr uint32_t NumLevels = 6;
+            //frames averaged before a decision
+            static constexpr uint32_t HistorySize = 20;
+            //the GPU times arrive some frames late: after a change the first ones are of the old scale
+            static constexpr uint32_t SettleFrames = 4;
+
+            //returns true when the scale changes
+            bool addFrameTime(float ms);
+            //back to the full scale, the history is cleared
+            void reset();
+            inline void setTargetFrameTime(float ms) { m_targetMs = ms; }
+            inline float getTargetFrameTime() const { return m_targetMs; }
+            inline float getScale() const { return scaleOf(m_level); }
+
+        private:
+            inline static float scaleOf(uint32_t level) { return MinScale + ScaleStep * static_cast<float>(level); }
+            void restartHistory();
 
+            //fraction of the target the bigger scale must fit in
+            static constexpr float GrowHeadroom = 0.9f;
 
+            float m_targetMs = 1000.f / 60.f;
+            uint32_t m_level = NumLevels - 1;
+            float m_samples[HistorySize] = {};
+            uint32_t m_count = 0;
+            uint32_t m_skip = 0;
+    };
+
+    //formats of the HDR targets: the packed float formats have no alpha and take half the room of RGBA16F,
+    //the positive range up to 65000 with ~2 decimal digits covers the scene colors
+    struct HDRFormats
+    {
+        GLenum color = GL_R11F_G11F_B10F;
+        GLenum bright = GL_R11F_G11F_B10F;
+        GLenum bloom = GL_R11F_G11F_B10F;
+        GLenum depth = GL_DEPTH_COMPONENT24;
+    };
+
+    //the render calls record the draw lists of the frame,
+    //postprocessing executes the render graph: scene -> bloom chain -> tone mapping
     class RendererV2
     {
         public:
@@ -113,17 +212,169 @@ namespace SpaceEngine
             static void render(const RendererParams& rParams); //mesh renderer
             static void render(const std::vector<UIRenderObject>& uiRenderables); //UI renderer
             static void render(const std::vector<TextRenderObject>& textRenderables); //Text renderer
+            //the bright pass and the bloom chain are in the graph only while bloomVFX is on,
+            //a change builds the graph again
             static void postprocessing(bool bloomVFX);
+            //the targets are reallocated when the size stops changing
             static void resizeBuffers(int width, int height);
+            static void setBloomMipCount(uint8_t count);
+            static void setBloomFilterRadius(float radius);
+            //the targets are built again
+            static void setHDRFormats(const HDRFormats& formats);
+            inline static const HDRFormats& getHDRFormats() { return m_hdrFormats; }
+            //the scene and the bloom follow the GPU frame time, UI and text stay at the window resolution;
+            //it needs the GPU timers
+            static void setDynamicResolution(bool flag, float targetMs = DefaultGPUFrameMs);
+            inline static bool isDynamicResolution() { return m_dynamicResolution; }
+            //fixed scale of the HDR targets, it's overridden by the dynamic resolution
+            static void setRenderScale(float scale);
+            inline static float getRenderScale() { return m_graph.getRenderScale(); }
+            //sharpening of the upscale in the tone mapping, 0 is bilinear
+            inline static void setUpscaleSharpness(float sharpness) { m_upscaleSharpness = sharpness; }
+            inline static const RenderGraph& getRenderGraph() { return m_graph; }
+            //GPU time of the passes drawn on the screen, the times are in GPUProfiler::getStats
+            static void setProfilerOverlay(bool flag);
+            inline static bool isProfilerOverlay() { return m_profilerOverlay; }
+            //the final image goes in an RGBA8 target of the window size instead of the window
+            static void setOffscreen(bool flag);
+            //last frame drawn, RGBA8 rows from the top
+            static bool readFrame(std::vector<uint8_t>& pixels, int& width, int& height);
+            //framebuffer of the final image, 0 is the window
+            inline static GLuint getOutputFramebuffer() { return m_offscreenFBO; }
+            //size of the framebuffer of the final image, the offscreen target keeps the window size of setOffscreen
+            static void getOutputSize(int& width, int& height);
+            //mesh draw submissions of the last frame: one per batch with glMultiDrawElementsIndirect
+            inline static uint32_t getMeshDrawCalls() { return m_meshDrawCalls; }
+            //indices of the mesh draws of the last frame, with the LODs selected
+            inline static uint64_t getMeshIndices() { return m_meshIndices; }
+            //impostor draws of the last frame: one per atlas
+            inline static uint32_t getImpostorDrawCalls() { return m_impostorDrawCalls; }
+            //objects drawn as impostors in the last frame, also the ones cross-fading with their mesh
+            inline static uint32_t getImpostorInstances() { return static_cast<uint32_t>(m_impostorInstances.size()); }
+            //particle draws of the last frame: one per material
+            inline static uint32_t getParticleDrawCalls() { return m_particleDrawCalls; }
+            //light lists of the last mesh pass
+            inline static const LightClusterStats& getLightClusterStats() { return m_lightClusters.getStats(); }
 
         private:
+            static void buildGraph();
+            static void drawScreen(const std::vector<ScreenRenderObject>& screenRenderables);
+            static void drawMeshes(const RendererParams& rParams);
+            static void drawUI(const std::vector<UIRenderObject>& uiRenderables);
+            static void drawText(const std::vector<TextRenderObject>& textRenderables);
+            static void composite();
+            //draws the commands [first, first + count) of the frame
+            static void submitMeshBatch(GLintptr commandOffset, GLintptr instanceOffset, size_t first, size_t count);
+            //additive billboards of the ParticleSystem, after the skybox
+            static void drawParticles(const CameraView& view);
+            //points the particle vertex array to the ring at offset
+            static void bindParticleStream(GLintptr offset);
+            //quads of the impostors queued by drawMeshes, before the skybox
+            static void drawImpostors(const CameraView& view);
+            //points the impostor vertex array to the ring at offset
+            static void bindImpostorStream(GLintptr offset);
+            static void updateRenderScale();
+            //adds the overlay lines to the text of the frame
+            static void appendProfilerOverlay(std::vector<TextRenderObject>& textRenderables);
+
+            //scene color + bright pass
+            static constexpr uint8_t MaxSceneColorTargets = 2;
+            //composite inputs, not shared with the materials and the bloom chain
+            static constexpr GLuint SceneTexUnit = 9;
+            static constexpr GLuint HighlightTexUnit = 10;
+            //the overlay strings are rebuilt twice a second at 60 fps
+            static constexpr uint32_t OverlayRefreshFrames = 30;
+            //60 fps with some room for the CPU and the compositor
+            static constexpr float DefaultGPUFrameMs = 14.f;
+
+            //draw lists recorded in the frame, they live until postprocessing
+            struct FrameLists
+            {
+                const std::vector<ScreenRenderObject>* pScreen = nullptr;
+                const RendererParams* pParams = nullptr;
+                const std::vector<UIRenderObject>* pUI = nullptr;
+                const std::vector<TextRenderObject>* pText = nullptr;
+            };
+
             static bool m_preprocessing;
             static bool m_bloomVFX;
             static bool m_debug;
-            static FrameBuffer m_HDRFrameBuffer;
-            static FrameBuffer m_BloomFrameBuffers[2];
+            static FrameLists m_frame;
+            static RenderGraph m_graph;
+            static RGResource m_hdrColor;
+            static RGResource m_hdrBright;
+            static RGResource m_hdrDepth;
+            static RGResource m_bloomResult;
+            static Bloom m_bloom;
+            static HDRFormats m_hdrFormats;
+            //bloom of the graph built, the scene draws only the color without it
+            static bool m_graphBloom;
+            static uint8_t m_sceneColorTargets;
             static ShaderProgram* m_pHDRShader;
-            static ShaderProgram* m_pBloomShader;
+            //pipeline states of the passes
+            static PipelineState m_screenPSO;
+            static PipelineState m_meshPSO;
+            static PipelineState m_skyboxPSO;
+            static PipelineState m_uiPSO;
+            static PipelineState m_textPSO;
+            static PipelineState m_hdrPSO;
+            static UIBatcher m_uiBatcher;
+            static bool m_profilerOverlay;
+            static uint32_t m_overlayFrame;
+            static std::vector<Text*> m_overlayLines;
+            //text of the frame and overlay lines, drawn in one text pass
+            static std::vector<TextRenderObject> m_textDraws;
+            static bool m_dynamicResolution;
+            static DynamicResolution m_resolutionController;
+            //last GPU frame given to the controller
+            static uint64_t m_resolvedFrame;
+            static float m_upscaleSharpness;
+            //sub mesh draw of the frame, the draws with the same program and material are one batch
+            struct MeshDraw
+            {
+                ShaderProgram* pShader;
+                BaseMaterial* pMaterial;
+                const RenderObject* pObj;
+                uint32_t subMesh;
+            };
+
+            static std::vector<MeshDraw> m_meshDraws;
+            static std::vector<MeshInstance> m_meshInstances;
+            static std::vector<DrawElementsIndirectCommand> m_meshCommands;
+            static StreamBuffer m_instanceStream;
+            static StreamBuffer m_indirectStream;
+            static uint32_t m_meshDrawCalls;
+            static uint64_t m_meshIndices;
+            static ShaderProgram* m_pParticleShader;
+            static PipelineState m_particlePSO;
+            static GLuint m_particleVAO;
+            static StreamBuffer m_particleStream;
+            //buffer the particle vertex array points to
+            static GLuint m_particleStreamBuffer;
+            static uint32_t m_particleDrawCalls;
+            //object of the frame drawn as an impostor, the draws with the same atlas are one batch
+            struct ImpostorDraw
+            {
+                const ImpostorAtlas* pAtlas;
+                const RenderObject* pObj;
+            };
+
+            static ShaderProgram* m_pImpostorShader;
+            static PipelineState m_impostorPSO;
+            static GLuint m_impostorVAO;
+            static StreamBuffer m_impostorStream;
+            //buffer the impostor vertex array points to
+            static GLuint m_impostorStreamBuffer;
+            static std::vector<ImpostorDraw> m_impostorDraws;
+            static std::vector<ImpostorInstance> m_impostorInstances;
+            static uint32_t m_impostorDrawCalls;
+            static LightClusters m_lightClusters;
+            //headless output
+            static GLuint m_offscreenFBO;
+            static GLuint m_offscreenColor;
+            static GLuint m_offscreenDepth;
+            static GLsizei m_offscreenWidth;
+            static GLsizei m_offscreenHeight;
     }; 
 
     class Renderer
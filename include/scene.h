@@ -104,10 +104,13 @@ namespace SpaceEngine
                 SPACE_ENGINE_ERROR("Component not valid!");
             }
 
-            void gatherRenderables(std::vector<RenderObject>& worldRenderables, 
+            //pView can be null, in that case the world renderables are not culled
+            void gatherRenderables(const CameraView* pView,
+                std::vector<RenderObject>& worldRenderables, 
                 std::vector<UIRenderObject>& uiRenderables, 
                 std::vector<TextRenderObject>& textRenderables,
                 std::vector<ScreenRenderObject>& screenRenderables);
+            inline const CullStats& getCullStats() const { return m_cullStats; }
                 
             void requestDestroy(GameObject* pGameObj);
             
@@ -183,6 +186,13 @@ namespace SpaceEngine
             //scene property
             bool active = true;
             bool postprocessing = false;
+            //culling scratch buffers (SoA world bounding spheres)
+            std::vector<float> m_cullX;
+            std::vector<float> m_cullY;
+            std::vector<float> m_cullZ;
+            std::vector<float> m_cullR;
+            std::vector<uint8_t> m_cullVisible;
+            CullStats m_cullStats;
         protected:
             vector<GameObject*> gameObjects;
             std::vector<ScreenRenderObject> m_vecScreenRendObj;
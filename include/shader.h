@@ -2,10 +2,12 @@
 
 #include <glad/gl.h>
 #include <glm/glm.hpp>
+#include <filesystem>
 #include <map>
 #include <unordered_map>
 #include <string>
 #include <tuple>
+#include <vector>
 
 namespace SpaceEngine
 {
@@ -32,7 +34,20 @@ namespace SpaceEngine
             int compileShader(const char* fileName, Type type);
             int compileShader(const std::string &source, Type type, const char *fileName = NULL);
 
+            //with deferred set the link returns at once, the status is read when the program is needed
             int link();
+            //the compile and link statuses are not queried, the driver works on other threads
+            inline void setDeferred(bool flag) { deferred = flag; }
+            //false while the driver is linking, it never waits
+            bool isReady();
+            //the binary is written in the cache when the link completes
+            void setBinaryCache(const std::string& path, uint64_t sourceHash);
+            //"#define <name>" lines added after the #version of the next compiled sources
+            void setDefines(const std::vector<std::string>& defines);
+            //linked program from the binary cache, the reflection tables are read from the file too:
+            //false if the file is missing, of other sources or rejected by the driver
+            bool loadBinary(const std::string& path, uint64_t sourceHash);
+            bool saveBinary(const std::string& path, uint64_t sourceHash);
             int validate();
             int use();
 
@@ -55,6 +70,8 @@ namespace SpaceEngine
             void setUniform(const char *name, int val);
             void setUniform(const char *name, bool val);
             void setUniform(const char *name, GLuint val);
+            //texture unit of a sampler, the uniform is a program state so it's sent only when it changes
+            void setSampler(const char *name, GLint unit);
             void setSubroutinesUniform(const char *name, const std::string& type);
             void setSubroutinesUniform(GLenum shadertype, GLsizei count, const GLuint* indices);
             
@@ -79,15 +96,26 @@ namespace SpaceEngine
             GLuint handle;
             uint8_t m_MRTBuffers = 1;
             bool linked;
+            bool deferred = false;
+            //link submitted, status not read yet
+            bool pending = false;
+            std::string cachePath;
+            uint64_t cacheHash = 0;
+            std::string definesPreamble;
             bool isVSComp = false;
             bool isFSComp = false;
             std::unordered_map<std::string, UniformInfo> uniformsInfo;
+            //unit set on every sampler location by setSampler, the samplers start from 0 after the link
+            std::unordered_map<GLint, GLint> samplerUnits;
             std::unordered_map<Type, std::unordered_map<std::string, GLint>> subroutineUniformsInfo;
             std::unordered_map<std::string, GLuint> vsSubroutinesInfo;
             std::unordered_map<std::string, GLuint> fsSubroutinesInfo;
             std::vector<GLuint> vsIdxSubRoutUniform;
             std::vector<GLuint> fsIdxSubRoutUniform;
 
+            //reads the link status, it waits the driver
+            int finishLink();
+            inline void resolve() { if(pending) finishLink(); }
             void reflectUniforms();
             void reflectionSubrroutines(Type shType);
             inline GLint getUniformLocation(const char *name);
@@ -100,6 +128,7 @@ namespace SpaceEngine
 
     int ShaderProgram::getUniformLocation(const char *name) 
     {
+        resolve();
 	    auto pos = uniformsInfo.find(name);
 
 	    if (pos == uniformsInfo.end()) 
@@ -118,8 +147,32 @@ namespace SpaceEngine
             void Initialize();
             static ShaderProgram* createShaderProgram(const std::string nameFile);
             static ShaderProgram* findShaderProgram(const std::string nameShader);
+            //program of the files nameFile.* compiled with the defines, every set is compiled once
+            //and stored as "nameFile+DEFINE+..." (the program without defines is nameFile)
+            static ShaderProgram* getVariant(const std::string& nameFile, std::vector<std::string> defines);
             void Shutdown();
+            //reads the programs the driver finished linking, it never waits
+            void Update();
+            //the linked programs are stored in SHADER_CACHE_PATH, a warm start doesn't compile
+            inline static bool isBinaryCacheSupported() { return binaryCache; }
+            //programs linked from the cache since Initialize
+            inline static uint32_t getCacheHits() { return cacheHits; }
+            //KHR_parallel_shader_compile: Initialize submits every compile, then every link
+            inline static bool isParallelCompile() { return parallelCompile; }
+            //programs still linking
+            static uint32_t getPendingPrograms();
         private:
+            //binary from the cache or compiles submitted, the link is left to the caller
+            static ShaderProgram* compileProgram(const std::string& nameFile, const std::string& key,
+                const std::vector<std::string>& defines);
+
+            //sources and driver
+            static uint64_t sourceHash(const std::vector<std::filesystem::path>& files);
+
             static std::unordered_map<std::string, ShaderProgram*> shadersMap;
+            static bool binaryCache;
+            static uint32_t cacheHits;
+            static bool parallelCompile;
+            static uint64_t driverHash;
     };
 }
\ No newline at end of file
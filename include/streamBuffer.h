@@ -0,0 +1,56 @@
+#pragma once
+
+#include <glad/gl.h>
+#include <cstdint>
+
+namespace SpaceEngine
+{
+    //ring of FramesInFlight segments for the data written every frame (vertices, uniforms),
+    //a segment is written again only when the fence of its frame is signaled so the uploads never stall:
+    //mapped once with GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT when glBufferStorage is available,
+    //otherwise every upload maps its range with GL_MAP_UNSYNCHRONIZED_BIT
+    class StreamBuffer
+    {
+        public:
+            static constexpr uint32_t FramesInFlight = 3;
+
+            StreamBuffer() = default;
+            StreamBuffer(const StreamBuffer&) = delete;
+            StreamBuffer& operator=(const StreamBuffer&) = delete;
+
+            //frameSize is the room of one frame, the ring grows when a frame needs more;
+            //the label names the buffer in the GL debug messages
+            void init(GLenum target, GLsizeiptr frameSize, const char* label);
+            void destroy();
+
+            //moves to the next segment, it waits its fence only if the GPU is FramesInFlight frames behind
+            void beginFrame();
+            //fences the commands that read the segment, it can be called more than once in a frame
+            void endFrame();
+
+            //copies the data in the segment of the frame, returns the offset in the buffer
+            //aligned to alignment (the vertex stride for the draws that use first = offset / stride)
+            GLintptr upload(const void* pData, GLsizeiptr size, GLsizeiptr alignment);
+
+            //it changes when the ring grows, the vertex arrays must point the new buffer
+            inline GLuint getBuffer() const { return m_buffer; }
+            inline bool isPersistent() const { return m_pMapped != nullptr; }
+            //beginFrame calls that found the GPU still reading the segment
+            inline uint32_t getStalls() const { return m_stalls; }
+
+        private:
+            void allocate(GLsizeiptr frameSize);
+            void release();
+
+            GLenum m_target = GL_ARRAY_BUFFER;
+            GLuint m_buffer = 0;
+            const char* m_label = "";
+            GLsizeiptr m_frameSize = 0;
+            uint8_t* m_pMapped = nullptr;
+            GLsync m_fences[FramesInFlight] = {};
+            uint32_t m_segment = 0;
+            //write position in the segment
+            GLsizeiptr m_head = 0;
+            uint32_t m_stalls = 0;
+    };
+}
@@ -71,6 +71,15 @@ namespace SpaceEngine
         static int destroyTex(Texture* pTex);
         static std::map<char, Character> loadFontChars(const std::string &nameFont);
 
+        //GL_TEXTURE_2D objects with immutable storage: created and edited by name with DSA,
+        //bound to the unit 0 in GL 4.0, where every level is specified without glTexStorage2D
+        static GLuint createStorage2D(GLenum internalFormat, GLsizei levels, GLsizei width, GLsizei height);
+        static void upload2D(GLuint texture, GLsizei width, GLsizei height, GLenum format, GLenum type, const void *pData);
+        static void setParameter2D(GLuint texture, GLenum pname, GLint value);
+        static void generateMipmap2D(GLuint texture);
+        //full chain down to 1x1
+        static GLsizei numMipLevels(GLsizei width, GLsizei height);
+
         void Shutdown();
 
     private:
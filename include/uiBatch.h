@@ -0,0 +1,93 @@
+#pragma once
+
+#include <glad/gl.h>
+#include <unordered_map>
+#include <vector>
+
+#include "utils/utils.h"
+#include "texture.h"
+#include "shader.h"
+#include "streamBuffer.h"
+
+namespace SpaceEngine
+{
+    struct UIRenderObject;
+
+    //region of a UI texture inside the atlas
+    struct UIAtlasRegion
+    {
+        GLuint texture = 0;
+        Vector2 uvMin = {0.f, 0.f};
+        Vector2 uvMax = {1.f, 1.f};
+    };
+
+    //packs the small UI textures (buttons, icons) in one RGBA texture
+    //the big ones (backgrounds) stay in their own texture
+    class UIAtlas
+    {
+        public:
+            void init();
+            void destroy();
+            //the texture is copied in the atlas the first time it is requested
+            UIAtlasRegion getRegion(Texture* pTex);
+
+        private:
+            bool insert(Texture* pTex, UIAtlasRegion& region);
+
+            static constexpr int AtlasSize = 2048;
+            static constexpr int MaxSubTexSize = 512;
+            static constexpr int Padding = 2;
+
+            GLuint m_texture = 0;
+            //shelf packing
+            int m_penX = 0;
+            int m_penY = 0;
+            int m_shelfHeight = 0;
+            std::unordered_map<Texture*, UIAtlasRegion> m_regions;
+    };
+
+    //collects the UI quads of a frame in a streaming ring,
+    //consecutive quads that sample the same texture are drawn with one call
+    class UIBatcher
+    {
+        public:
+            void init();
+            void destroy();
+            void begin();
+            //returns false if the element can't be batched (custom shader)
+            bool submit(const UIRenderObject& uiRendObj);
+            void flush();
+            inline uint32_t getDrawCalls() const { return m_drawCalls; }
+
+        private:
+            struct UIVertex
+            {
+                Vector2 pos;
+                Vector2 uv;
+                Vector4 color;
+                float hover;
+            };
+
+            struct UIBatch
+            {
+                GLuint texture;
+                GLint first;
+                GLsizei count;
+            };
+
+            //points the vertex array to the ring, again after the ring grows
+            void bindStream();
+
+            UIAtlas m_atlas;
+            ShaderProgram* m_pShader = nullptr;
+            ShaderProgram* m_pUIShader = nullptr;
+            ShaderProgram* m_pUIButtonShader = nullptr;
+            GLuint m_VAO = 0;
+            StreamBuffer m_stream;
+            //buffer the vertex array points to
+            GLuint m_streamBuffer = 0;
+            std::vector<UIVertex> m_vertices;
+            std::vector<UIBatch> m_batches;
+            uint32_t m_drawCalls = 0;
+    };
+}
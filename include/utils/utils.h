@@ -5,6 +5,7 @@
 #include <glm/gtc/quaternion.hpp>
 #include <assimp/matrix4x4.h>
 #include <string>
+#include <vector>
 #include <assimp/scene.h>
 
 namespace SpaceEngine
@@ -103,6 +104,8 @@ namespace SpaceEngine
     {
         public:
             static uint32_t getNumber();
+            //0 is a fixed point of the xorshift
+            static void setSeed(uint32_t seed) { m_state = seed ? seed : 1239131; }
         private: 
             static uint32_t xorShift(uint32_t value);
             static uint32_t m_state;
@@ -120,6 +123,8 @@ namespace SpaceEngine
             static std::string getFileNameNoExt(const std::string& filePath);
             static std::string joinPaths(const std::string& a, const std::string& b);
             static void applyRatioScreenRes(Vector2 anchor, Vector2 pos, float& outScale, Vector2& outOffset, Vector2& outPos);
+            //RGBA8 rows from the top, stored without compression
+            static bool writePNG(const std::string& path, int width, int height, const std::vector<uint8_t>& rgba);
     };
 
     //WARN: An Observer can only be part of one subject's observer list
@@ -2,15 +2,17 @@
 
 #include "collisionDetection.h"
 #include "scene.h"
+#include "impostor.h"
 
 #include <iostream>
-#include <ctime>
 
 
 namespace SpaceEngine {
 
     Asteroid::Asteroid(Scene* pScene, std::string filePathModel):GameObject(pScene) {
         m_pMesh = MeshManager::loadMesh(filePathModel);
+        //far away the asteroids are impostors, the atlas is baked once per model
+        ImpostorManager::bake(m_pMesh);
         m_pTransform = new Transform();
         m_pCollider = new Collider(this);
         
@@ -20,7 +22,7 @@ namespace SpaceEngine {
         m_despawnZ = 20.0f;     // Arriva fino a dietro la camera
 
         // Assegna un asse di rotazione casuale
-        srand(static_cast<unsigned int>(time(0)));
+        //rand is seeded once by the App, the headless tests need a repeatable sequence
         m_rotationAxis = glm::normalize(glm::vec3(
             static_cast <float> (rand()) / static_cast <float> (RAND_MAX),
             static_cast <float> (rand()) / static_cast <float> (RAND_MAX),
@@ -75,6 +77,10 @@ namespace SpaceEngine {
         }
     }
 
+    void Asteroid::Explode() {
+        ParticleSystem::burst(ParticleEffects::explosion(ExplosionColor), m_pTransform->getWorldPosition(), ExplosionParticles);
+    }
+
     void Asteroid::onCollisionEnter(Collider* col) {
         SPACE_ENGINE_INFO("PlayerShip Collision onEnter Called with Collider: {}", reinterpret_cast<std::uintptr_t>(col));
         if(col->gameObj->getLayer() == ELayers::PLAYER_LAYER)
@@ -82,6 +88,7 @@ namespace SpaceEngine {
             m_pSpawnerSub->notifyDestroy(*this);
             if (auto* audioMgr = pScene->getAudioManager()) 
                 audioMgr->PlaySound("asteroid_explosion");
+            Explode();
             pScene->requestDestroy(this);
         }
         else if(col->gameObj->getLayer() == ELayers::BULLET_PLAYER_LAYER)
@@ -90,6 +97,7 @@ namespace SpaceEngine {
             m_pSub->notifyPoints(*this, m_score);
             if (auto* audioMgr = pScene->getAudioManager()) 
                 audioMgr->PlaySound("asteroid_explosion");
+            Explode();
             pScene->requestDestroy(this);
         }
     }
@@ -23,6 +23,7 @@ namespace SpaceEngine {
     }
 
     EnemyShip::~EnemyShip() {
+        ParticleSystem::destroyEmitter(m_pTrail);
         delete m_pSub;
         delete m_pSpawnerSub;
     }
@@ -41,6 +42,8 @@ namespace SpaceEngine {
         }
 
         setLayer(ELayers::ENEMY_LAYER);
+        if (!m_pTrail)
+            m_pTrail = ParticleSystem::createEmitter(ParticleEffects::engineTrail(TrailColor), m_pTransform);
 
         // Setup statistiche in base al tipo
         switch (m_type) {
@@ -165,7 +168,13 @@ namespace SpaceEngine {
         {
                 m_pSub->notifyPoints(*this, m_score);
                 m_pSpawnerSub->notifyDestroy(*this);
+                Explode();
                 pScene->requestDestroy(this);
         }
     }
+
+    void EnemyShip::Explode()
+    {
+        ParticleSystem::burst(ParticleEffects::explosion(ExplosionColor), m_pTransform->getWorldPosition(), ExplosionParticles);
+    }
 }
\ No newline at end of file
@@ -95,6 +95,7 @@ namespace SpaceEngine {
 
         InputHandler& inputHandler = App::GetInputHandler();
         inputHandler.clearBindingsFor(this);
+        ParticleSystem::destroyEmitter(m_pTrail);
         
         delete m_playerMoveDown;
         delete m_playerMoveLeft;
@@ -111,6 +112,9 @@ namespace SpaceEngine {
             m_pTransform->setLocalScale(Vector3(1.0f));
             m_pTransform->rotateLocal(180, {0.f,1.f, 0.f});
             m_pTransform->getWorldMatrix();
+            //same color of the jet
+            if (!m_pTrail)
+                m_pTrail = ParticleSystem::createEmitter(ParticleEffects::engineTrail(TrailColor), m_pTransform);
         }     
         SetAlpha(1.0f);
     }
@@ -145,6 +149,8 @@ namespace SpaceEngine {
         m_isInvulnerable = false;
         m_invulnTimer = 0.0f;
         m_blinkTimer = 0.0f;
+        if (m_pTrail)
+            m_pTrail->setActive(true);
 
         //to review
         if (m_pMesh == nullptr) {
@@ -256,6 +262,9 @@ namespace SpaceEngine {
                 {
                     SPACE_ENGINE_INFO("GAME OVER - PlayerShip distrutta!");
                     m_pMesh = nullptr;
+                    ParticleSystem::burst(ParticleEffects::explosion(ExplosionColor), m_pTransform->getWorldPosition(), ExplosionParticles);
+                    if (m_pTrail)
+                        m_pTrail->setActive(false);
                     
                     if (auto* audioMgr = pScene->getAudioManager()) {
                         audioMgr->PlaySound("player_explosion");
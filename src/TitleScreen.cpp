@@ -120,9 +120,10 @@ namespace SpaceEngine{
             ExitGame(); // Chiama la tua funzione che fa exit(0)
         }
 
+        m_time += dt;
         if(m_vecScreenRendObj.size())
         {
-            m_vecScreenRendObj[0].pMaterial->addProperty("time", static_cast<float>(glfwGetTime()));
+            m_vecScreenRendObj[0].pMaterial->addProperty("time", m_time);
         }
     }
 
@@ -8,7 +8,12 @@
 #include "gameOverScene.h"
 #include "leaderboardScene.h"
 #include "font.h"
+#include "glState.h"
+#include "glCapture.h"
+#include "frameCapture.h"
 
+#include <ctime>
+#include <filesystem>
 #include <vector>
 
 #define DEBUG_RENDERERV2 1
@@ -18,11 +23,20 @@ namespace SpaceEngine
     EAppState App::state = EAppState::START;
     InputHandler* App::inputHandler = nullptr;
     
-    App::App()
+    App::App(const AppConfig& config)
     {
+        //same spawns at every run with a seed
+        srand(config.seed ? config.seed : static_cast<unsigned int>(time(nullptr)));
+        if(config.seed)
+            PRNG::setSeed(config.seed);
+
         //initialize Managers
         logManager.Initialize();
+        WindowManager::headless = config.headless;
         windowManager.Initialize();
+        //before the first GL object of the engine
+        if(!config.capturePath.empty())
+            GLCapture::begin(config.capturePath, config.captureFrames);
         physicsManager.Initialization();
         inputManager.Initialize();
         shaderManager.Initialize();
@@ -30,6 +44,19 @@ namespace SpaceEngine
         textureManager.Initialize();
         sceneManager.Initialize();
         rendererV2.Initialize();
+        ParticleSystem::init();
+        FrameCapture::init();
+        if(!config.frameCapturePath.empty())
+        {
+            bool y4m = std::filesystem::path(config.frameCapturePath).extension() == ".y4m";
+            FrameCapture::startSequence(config.frameCapturePath, y4m ? ECaptureFormat::Y4M : ECaptureFormat::PNG,
+                config.frameCaptureFps);
+        }
+        //the golden images need the full resolution at every frame
+        if(config.headless)
+            rendererV2.setOffscreen(true);
+        else
+            rendererV2.setDynamicResolution(true);
         audioManager.Initialize();
 
         audioManager.LoadSound("menu_music", AUDIO_PATH"menu.wav");
@@ -66,11 +93,17 @@ namespace SpaceEngine
     {
         //Shutdown Managers
         sceneManager.Shutdown();
+        ParticleSystem::shutdown();
+        rendererV2.Shutdown();
         textureManager.Shutdown();
         materialManager.Shutdown();
         shaderManager.Shutdown();
         inputManager.Shutdown();
         physicsManager.Shutdown();
+        //the frames in the ring are written
+        FrameCapture::shutdown();
+        //closed before its frames: the file holds the frames done
+        GLCapture::end();
         windowManager.Shutdown();
         logManager.Shutdown();
         audioManager.Shutdown();
@@ -179,6 +212,19 @@ namespace SpaceEngine
             token = false;
         }*/
 
+        if(Keyboard::keyDown(SPACE_ENGINE_KEY_BUTTON_F12))
+        {
+            char name[64];
+            std::time_t now = std::time(nullptr);
+            std::strftime(name, sizeof(name), "screenshot_%Y%m%d_%H%M%S.png", std::localtime(&now));
+            FrameCapture::screenshot(name);
+        }
+
+        #if DEBUG_RENDERERV2
+        //GPU time of the render passes
+        if(Keyboard::keyDown(SPACE_ENGINE_KEY_BUTTON_F3))
+            RendererV2::setProfilerOverlay(!RendererV2::isProfilerOverlay());
+        #endif
     }
 
     InputHandler& App::GetInputHandler()
@@ -194,85 +240,100 @@ namespace SpaceEngine
         
         float lastTime = static_cast<float>(glfwGetTime());
         float currentTime;
-        //handle the tunneling caused by a to slow frame dt
-        //fixed time step
-        float fixed_dt = 1.f/30.f;
-        float accumulator = 0.0;
-        
-        //Gathers
-        std::vector<RenderObject> worldRenderables;
-        std::vector<UIRenderObject> uiRenderables;
-        std::vector<TextRenderObject> textRenderables;
-        std::vector<ScreenRenderObject> screenRenderables;
 
         while(!windowManager.WindowShouldClose())
         {
             currentTime = static_cast<float>(glfwGetTime()); 
             float dt = currentTime - lastTime;
             lastTime = currentTime;
-           
-            //collision/physic system
-            accumulator += dt;
-            //SPACE_ENGINE_INFO("Accumulator: {}, dt: {}", accumulator, dt);
-            while(accumulator >= fixed_dt)
-            {
-                //SPACE_ENGINE_INFO("Physics Step Start");
-                physicsManager.Step(fixed_dt);
-                //SPACE_ENGINE_INFO("Physics Step End");
-                accumulator -= fixed_dt;
-            }
 
-            //refresh the input data
-            inputManager.Update();
-            InputHandle();
-            inputHandler->handleInput();
+            Frame(dt);
+        }
+    }
+
+    void App::Frame(float dt)
+    {
+        //collision/physic system
+        accumulator += dt;
+        //SPACE_ENGINE_INFO("Accumulator: {}, dt: {}", accumulator, dt);
+        while(accumulator >= fixed_dt)
+        {
+            //SPACE_ENGINE_INFO("Physics Step Start");
+            physicsManager.Step(fixed_dt);
+            //SPACE_ENGINE_INFO("Physics Step End");
+            accumulator -= fixed_dt;
+        }
 
-            //SPACE_ENGINE_INFO("Scene Update Start");
-            //update game objects in the scene
-            sceneManager.Update(dt);
+        //programs the driver finished linking in the background
+        shaderManager.Update();
+        //refresh the input data
+        inputManager.Update();
+        InputHandle();
+        inputHandler->handleInput();
 
-            //collects the renderizable objects in the scene
-            sceneManager.GatherRenderables(worldRenderables, 
-                uiRenderables,
-                textRenderables,
-                screenRenderables);
-            //gather scene object to rendering the scene
-            RendererParams rParams{worldRenderables, 
-                *(sceneManager.GetLights()), 
-                sceneManager.GetActiveCamera(), 
-                sceneManager.GetSkybox()};
-            
-            #if !DEBUG_RENDERERV2
-            GL_CHECK_ERRORS();
-            screenRenderer->render(screenRenderables);
-            GL_CHECK_ERRORS();
-            renderer->render(rParams);
-            GL_CHECK_ERRORS();
-            uiRenderer->render(uiRenderables);
-            GL_CHECK_ERRORS();
-            textRenderer->render(textRenderables);
-            GL_CHECK_ERRORS();
-            #else
-            GL_CHECK_ERRORS();
-            rendererV2.clear();
-            GL_CHECK_ERRORS();
-            rendererV2.render(screenRenderables);
-            GL_CHECK_ERRORS();
-            rendererV2.render(rParams);
-            GL_CHECK_ERRORS();
-            rendererV2.render(uiRenderables);
-            GL_CHECK_ERRORS();
-            rendererV2.render(textRenderables);
-            GL_CHECK_ERRORS();
-            rendererV2.postprocessing(sceneManager.GetActiveScene()->getPostprocessing());
-            GL_CHECK_ERRORS();
-            #endif
+        //SPACE_ENGINE_INFO("Scene Update Start");
+        //update game objects in the scene
+        sceneManager.Update(dt);
+        //the effects freeze with the pause and belong only to the game
+        if(state == EAppState::RUN)
+            ParticleSystem::update(dt);
+        else if(state != EAppState::PAUSE)
+            ParticleSystem::clear();
 
-            
-            sceneManager.LateUpdate();
-            
-            windowManager.PollEvents();
-            windowManager.SwapBuffers();
-        }
+        //camera data shared by culling and rendering
+        BaseCamera* pCamera = sceneManager.GetActiveCamera();
+        if(pCamera)
+            cameraView = pCamera->getCameraView();
+
+        //collects the renderizable objects in the scene
+        sceneManager.GatherRenderables(pCamera ? &cameraView : nullptr,
+            worldRenderables, 
+            uiRenderables,
+            textRenderables,
+            screenRenderables);
+        //gather scene object to rendering the scene
+        RendererParams rParams{worldRenderables, 
+            *(sceneManager.GetLights()), 
+            pCamera ? &cameraView : nullptr, 
+            sceneManager.GetSkybox()};
+        
+        #if !DEBUG_RENDERERV2
+        GL_CHECK_ERRORS();
+        screenRenderer->render(screenRenderables);
+        GL_CHECK_ERRORS();
+        renderer->render(rParams);
+        GL_CHECK_ERRORS();
+        uiRenderer->render(uiRenderables);
+        GL_CHECK_ERRORS();
+        textRenderer->render(textRenderables);
+        GL_CHECK_ERRORS();
+        #else
+        GL_CHECK_ERRORS();
+        GLStateCache::newFrame();
+        rendererV2.clear();
+        GL_CHECK_ERRORS();
+        rendererV2.render(screenRenderables);
+        GL_CHECK_ERRORS();
+        rendererV2.render(rParams);
+        GL_CHECK_ERRORS();
+        rendererV2.render(uiRenderables);
+        GL_CHECK_ERRORS();
+        rendererV2.render(textRenderables);
+        GL_CHECK_ERRORS();
+        rendererV2.postprocessing(sceneManager.GetActiveScene()->getPostprocessing());
+        GL_CHECK_ERRORS();
+        #endif
+
+        
+        sceneManager.LateUpdate();
+        
+        //the final image, read back some frames later; before the events, a resize changes the size of the output
+        int outputWidth = 0;
+        int outputHeight = 0;
+        RendererV2::getOutputSize(outputWidth, outputHeight);
+        FrameCapture::captureFrame(RendererV2::getOutputFramebuffer(), outputWidth, outputHeight);
+        windowManager.PollEvents();
+        windowManager.SwapBuffers();
+        GLCapture::endFrame();
     }
 };
@@ -2,8 +2,62 @@
 #include "utils/utils.h"
 #include "managers/windowManager.h"
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #define SPACE_ENGINE_SSE 1
+    #include <emmintrin.h>
+#else
+    #define SPACE_ENGINE_SSE 0
+#endif
+
 namespace SpaceEngine
 {
+    //culling
+    void cullSpheres(const CameraView& view, const float* cx, const float* cy, const float* cz, const float* r, uint32_t count, uint8_t* visible)
+    {
+        uint32_t i = 0;
+
+        #if SPACE_ENGINE_SSE
+        //4 spheres for each plane test
+        for(; i + 4 <= count; i += 4)
+        {
+            __m128 x = _mm_loadu_ps(cx + i);
+            __m128 y = _mm_loadu_ps(cy + i);
+            __m128 z = _mm_loadu_ps(cz + i);
+            __m128 negR = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(r + i));
+            __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+
+            for(int p = 0; p < CameraView::NUM_PLANES; p++)
+            {
+                const Vector4& plane = view.planes[p];
+                __m128 dist = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(plane.x)),
+                                                    _mm_mul_ps(y, _mm_set1_ps(plane.y))),
+                                         _mm_add_ps(_mm_mul_ps(z, _mm_set1_ps(plane.z)),
+                                                    _mm_set1_ps(plane.w)));
+                inside = _mm_and_ps(inside, _mm_cmpge_ps(dist, negR));
+            }
+
+            int mask = _mm_movemask_ps(inside);
+
+            for(uint32_t j = 0; j < 4; j++)
+                visible[i + j] = static_cast<uint8_t>((mask >> j) & 1);
+        }
+        #endif
+
+        for(; i < count; i++)
+        {
+            uint8_t inside = 1;
+
+            for(int p = 0; p < CameraView::NUM_PLANES && inside; p++)
+            {
+                const Vector4& plane = view.planes[p];
+                float dist = plane.x * cx[i] + plane.y * cy[i] + plane.z * cz[i] + plane.w;
+                inside = dist >= -r[i];
+            }
+
+            visible[i] = inside;
+        }
+    }
+
     //camera
     BaseCamera::BaseCamera() : nearPlane(0.1f), farPlane(100.f){}
     
@@ -14,6 +68,36 @@ namespace SpaceEngine
         return Math::inverse(transf.getWorldMatrix());
     }
 
+    CameraView BaseCamera::getCameraView() const
+    {
+        CameraView cv;
+        Matrix4 world = transf.getWorldMatrix();
+
+        cv.view = Math::inverse(world);
+        cv.projection = projection;
+        cv.viewProjection = projection * cv.view;
+        cv.pos = Vector3(world[3]);
+
+        //Gribb-Hartmann: planes are combinations of the rows of the view-projection matrix
+        const Matrix4& m = cv.viewProjection;
+        Vector4 row0(m[0][0], m[1][0], m[2][0], m[3][0]);
+        Vector4 row1(m[0][1], m[1][1], m[2][1], m[3][1]);
+        Vector4 row2(m[0][2], m[1][2], m[2][2], m[3][2]);
+        Vector4 row3(m[0][3], m[1][3], m[2][3], m[3][3]);
+
+        cv.planes[CameraView::PLANE_LEFT] = row3 + row0;
+        cv.planes[CameraView::PLANE_RIGHT] = row3 - row0;
+        cv.planes[CameraView::PLANE_BOTTOM] = row3 + row1;
+        cv.planes[CameraView::PLANE_TOP] = row3 - row1;
+        cv.planes[CameraView::PLANE_NEAR] = row3 + row2;
+        cv.planes[CameraView::PLANE_FAR] = row3 - row2;
+
+        for(Vector4& plane : cv.planes)
+            plane /= glm::length(Vector3(plane));
+
+        return cv;
+    }
+
     //PerspectiveCamera
     PerspectiveCamera::PerspectiveCamera() : fov(45), aspectRatio(WindowManager::aspectRatio)
     {
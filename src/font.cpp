@@ -2,6 +2,7 @@
 #include "log.h"
 #include "material.h"
 #include "mesh.h"
+#include "managers/windowManager.h"
 
 namespace SpaceEngine
 {
@@ -50,7 +51,7 @@ namespace SpaceEngine
     Text::Text(Vector2 posAncor, Vector2 pos, Vector2 scale, TextMaterial* pTextMaterial):
     Text(posAncor, pos, pTextMaterial)
     {
-        pTransf->scale = scale;
+        pTransf->setScale(scale);
     }
 
     Text::~Text()
@@ -59,6 +60,35 @@ namespace SpaceEngine
         delete pTransf;
     }
 
+    void Text::updateLayout()
+    {
+        if(!pTransf)
+            return;
+
+        if(!m_layoutDirty && !pTransf->dirty && m_resolutionGeneration == WindowManager::resolutionGeneration)
+            return;
+
+        //resolution adaption
+        float resScale = 1.f;
+        Vector2 finalOffset = {0.f, 0.f}; 
+        Vector2 finalPos = {pTransf->pos.x, pTransf->pos.y};
+        Utils::applyRatioScreenRes(pTransf->anchor, pTransf->pos, resScale, finalOffset, finalPos);
+        
+        float offsetX = finalPos.x;
+        m_vertices.clear();
+
+        for(char c : m_string)
+        {
+            m_pMaterial->appendCharacter(c, offsetX, resScale, finalPos, *pTransf, m_vertices);
+        }
+
+        pTextMeshRend->getTextMesh()->subData(m_vertices);
+
+        pTransf->setDirty(false);
+        m_layoutDirty = false;
+        m_resolutionGeneration = WindowManager::resolutionGeneration;
+    }
+
     void Text::setColor(const Vector3& color)
     {
         if (m_pMaterial)
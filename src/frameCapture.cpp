@@ -0,0 +1,414 @@
+#include "frameCapture.h"
+#include "glState.h"
+#include "log.h"
+#include "utils/utils.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace SpaceEngine
+{
+    bool FrameCapture::m_initialized = false;
+    FrameCapture::Slot FrameCapture::m_slots[FrameCapture::RingSize];
+    uint64_t FrameCapture::m_frame = 0;
+    std::string FrameCapture::m_pendingScreenshot;
+    bool FrameCapture::m_recording = false;
+    ECaptureFormat FrameCapture::m_format = ECaptureFormat::PNG;
+    std::string FrameCapture::m_sequencePath;
+    uint64_t FrameCapture::m_sequenceFrame = 0;
+    FrameCaptureStats FrameCapture::m_stats;
+
+    //worker: only the queue and the pool are shared with the render thread
+    namespace
+    {
+        enum class EJob
+        {
+            Png,
+            OpenVideo,
+            VideoFrame,
+            CloseVideo,
+            Quit
+        };
+
+        struct Job
+        {
+            EJob type = EJob::Png;
+            std::string path{};
+            //RGBA8 rows from the bottom, like GL reads them
+            std::vector<uint8_t> pixels{};
+            int width = 0;
+            int height = 0;
+            uint32_t fps = 0;
+        };
+
+        std::thread s_thread;
+        std::mutex s_mutex;
+        std::condition_variable s_cv;
+        std::deque<Job> s_jobs;
+        //frames in the queue, the other jobs don't count
+        uint32_t s_queuedFrames = 0;
+        //the buffers of the written frames, reused by the next ones
+        std::vector<std::vector<uint8_t>> s_pool;
+        std::atomic<uint64_t> s_written = 0;
+
+        //owned by the worker
+        std::ofstream s_video;
+        std::string s_videoPath;
+        uint32_t s_videoFps = 0;
+        int s_videoWidth = 0;
+        int s_videoHeight = 0;
+        std::vector<uint8_t> s_scratch;
+
+        std::vector<uint8_t> takeBuffer(size_t size)
+        {
+            std::vector<uint8_t> buffer;
+            {
+                std::lock_guard<std::mutex> lock(s_mutex);
+                if(!s_pool.empty())
+                {
+                    buffer = std::move(s_pool.back());
+                    s_pool.pop_back();
+                }
+            }
+            buffer.resize(size);
+            return buffer;
+        }
+
+        //false if the queue is full, the frame goes back in the pool
+        bool push(Job&& job)
+        {
+            const bool frame = job.type == EJob::Png || job.type == EJob::VideoFrame;
+            {
+                std::lock_guard<std::mutex> lock(s_mutex);
+                if(frame && s_queuedFrames >= FrameCapture::MaxQueuedFrames)
+                {
+                    s_pool.push_back(std::move(job.pixels));
+                    return false;
+                }
+
+                s_queuedFrames += frame ? 1 : 0;
+                s_jobs.push_back(std::move(job));
+            }
+            s_cv.notify_one();
+            return true;
+        }
+
+        void writePNG(const Job& job)
+        {
+            const size_t rowSize = static_cast<size_t>(job.width) * 4;
+            s_scratch.resize(rowSize * job.height);
+            for(int y = 0; y < job.height; y++)
+                std::memcpy(&s_scratch[y * rowSize], &job.pixels[(job.height - 1 - y) * rowSize], rowSize);
+
+            if(!Utils::writePNG(job.path, job.width, job.height, s_scratch))
+                SPACE_ENGINE_ERROR("FrameCapture: can't write {}", job.path);
+        }
+
+        //BT.601 limited range, the planes one after the other
+        void writeVideoFrame(const Job& job)
+        {
+            if(!s_video.is_open())
+                return;
+
+            //the size of the stream is the one of the first frame
+            if(!s_videoWidth)
+            {
+                s_videoWidth = job.width;
+                s_videoHeight = job.height;
+                s_video << "YUV4MPEG2 W" << job.width << " H" << job.height << " F" << s_videoFps << ":1 Ip A1:1 C444\n";
+            }
+            else if(job.width != s_videoWidth || job.height != s_videoHeight)
+            {
+                SPACE_ENGINE_WARN("FrameCapture: {}x{} frame skipped in the {}x{} stream {}",
+                    job.width, job.height, s_videoWidth, s_videoHeight, s_videoPath);
+                return;
+            }
+
+            const size_t planeSize = static_cast<size_t>(job.width) * job.height;
+            s_scratch.resize(planeSize * 3);
+            uint8_t* pY = s_scratch.data();
+            uint8_t* pU = pY + planeSize;
+            uint8_t* pV = pU + planeSize;
+            for(int y = 0; y < job.height; y++)
+            {
+                const uint8_t* pSrc = &job.pixels[static_cast<size_t>(job.height - 1 - y) * job.width * 4];
+                for(int x = 0; x < job.width; x++, pSrc += 4)
+                {
+                    const int r = pSrc[0];
+                    const int g = pSrc[1];
+                    const int b = pSrc[2];
+                    *pY++ = static_cast<uint8_t>(((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+                    *pU++ = static_cast<uint8_t>(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+                    *pV++ = static_cast<uint8_t>(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+                }
+            }
+
+            s_video << "FRAME\n";
+            s_video.write(reinterpret_cast<const char*>(s_scratch.data()), static_cast<std::streamsize>(s_scratch.size()));
+        }
+
+        void worker()
+        {
+            while(true)
+            {
+                Job job;
+                {
+                    std::unique_lock<std::mutex> lock(s_mutex);
+                    s_cv.wait(lock, []() { return !s_jobs.empty(); });
+                    job = std::move(s_jobs.front());
+                    s_jobs.pop_front();
+                }
+
+                switch(job.type)
+                {
+                    case EJob::Png:
+                        writePNG(job);
+                        break;
+                    case EJob::OpenVideo:
+                        s_video.open(job.path, std::ios::binary | std::ios::trunc);
+                        s_videoPath = job.path;
+                        s_videoFps = job.fps;
+                        s_videoWidth = 0;
+                        s_videoHeight = 0;
+                        if(!s_video)
+                            SPACE_ENGINE_ERROR("FrameCapture: can't open {}", job.path);
+                        break;
+                    case EJob::VideoFrame:
+                        writeVideoFrame(job);
+                        break;
+                    case EJob::CloseVideo:
+                        s_video.close();
+                        break;
+                    case EJob::Quit:
+                        return;
+                }
+
+                if(job.type == EJob::Png || job.type == EJob::VideoFrame)
+                {
+                    s_written++;
+                    std::lock_guard<std::mutex> lock(s_mutex);
+                    s_queuedFrames--;
+                    s_pool.push_back(std::move(job.pixels));
+                }
+            }
+        }
+    }
+
+    void FrameCapture::init()
+    {
+        if(m_initialized)
+            return;
+
+        for(Slot& slot : m_slots)
+            glGenBuffers(1, &slot.buffer);
+
+        s_thread = std::thread(worker);
+        m_initialized = true;
+    }
+
+    void FrameCapture::shutdown()
+    {
+        if(!m_initialized)
+            return;
+
+        stopSequence();
+        flush();
+        //the jobs before the quit are done
+        push({.type = EJob::Quit});
+        s_thread.join();
+
+        for(Slot& slot : m_slots)
+        {
+            glDeleteBuffers(1, &slot.buffer);
+            slot = Slot();
+        }
+
+        s_pool.clear();
+        m_pendingScreenshot.clear();
+        m_initialized = false;
+        SPACE_ENGINE_DEBUG("FrameCapture: {} frames read back, {} written, {} dropped, {} stalls",
+            m_stats.readbacks, getWrittenFrames(), m_stats.dropped, m_stats.stalls);
+    }
+
+    void FrameCapture::screenshot(const std::string& path)
+    {
+        m_pendingScreenshot = path;
+    }
+
+    bool FrameCapture::startSequence(const std::string& path, ECaptureFormat format, uint32_t fps)
+    {
+        if(!m_initialized || m_recording)
+            return false;
+
+        if(format == ECaptureFormat::PNG)
+        {
+            std::error_code error;
+            std::filesystem::create_directories(path, error);
+            if(error)
+            {
+                SPACE_ENGINE_ERROR("FrameCapture: can't create {}", path);
+                return false;
+            }
+        }
+        else push({.type = EJob::OpenVideo, .path = path, .fps = fps ? fps : 60});
+
+        m_recording = true;
+        m_format = format;
+        m_sequencePath = path;
+        m_sequenceFrame = 0;
+        SPACE_ENGINE_INFO("FrameCapture: recording in {}", path);
+        return true;
+    }
+
+    void FrameCapture::stopSequence()
+    {
+        if(!m_recording)
+            return;
+
+        //the close follows the last frames
+        flush();
+        if(m_format == ECaptureFormat::Y4M)
+            push({.type = EJob::CloseVideo});
+        m_recording = false;
+        SPACE_ENGINE_INFO("FrameCapture: {} frames recorded in {}", m_sequenceFrame, m_sequencePath);
+    }
+
+    uint64_t FrameCapture::getWrittenFrames()
+    {
+        return s_written.load();
+    }
+
+    void FrameCapture::captureFrame(GLuint framebuffer, int width, int height)
+    {
+        if(!m_initialized)
+            return;
+
+        //the copy issued RingSize frames ago
+        Slot& slot = m_slots[m_frame++ % RingSize];
+        if(slot.fence)
+            resolve(slot);
+
+        if((m_pendingScreenshot.empty() && !m_recording) || width <= 0 || height <= 0)
+            return;
+
+        const GLsizeiptr size = static_cast<GLsizeiptr>(width) * height * 4;
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+        if(slot.size != size)
+        {
+            glBufferData(GL_PIXEL_PACK_BUFFER, size, nullptr, GL_STREAM_READ);
+            slot.size = size;
+        }
+
+        GLStateCache::bindFramebuffer(framebuffer);
+        if(!framebuffer)
+            glReadBuffer(GL_BACK);
+        //the rows of RGBA8 are always aligned
+        glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        GL_CHECK_ERRORS();
+
+        slot.width = width;
+        slot.height = height;
+        slot.screenshot = std::move(m_pendingScreenshot);
+        m_pendingScreenshot.clear();
+        slot.sequence = m_recording;
+        slot.sequenceFrame = m_recording ? m_sequenceFrame++ : 0;
+        m_stats.readbacks++;
+    }
+
+    void FrameCapture::resolve(Slot& slot)
+    {
+        GLenum status = glClientWaitSync(slot.fence, 0, 0);
+        if(status == GL_TIMEOUT_EXPIRED)
+        {
+            //the GPU is more than RingSize - 1 frames behind
+            m_stats.stalls++;
+            status = glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+        }
+        glDeleteSync(slot.fence);
+        slot.fence = nullptr;
+
+        std::string screenshot = std::move(slot.screenshot);
+        slot.screenshot.clear();
+        if(status == GL_WAIT_FAILED || status == GL_TIMEOUT_EXPIRED)
+        {
+            SPACE_ENGINE_ERROR("FrameCapture: the readback of a frame didn't complete");
+            return;
+        }
+
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        Job job;
+        job.width = slot.width;
+        job.height = slot.height;
+        job.pixels = takeBuffer(static_cast<size_t>(slot.size));
+
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+        const void* pData = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, slot.size, GL_MAP_READ_BIT);
+        if(pData)
+        {
+            std::memcpy(job.pixels.data(), pData, job.pixels.size());
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        GL_CHECK_ERRORS();
+        m_stats.lastResolveMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        if(!pData)
+        {
+            SPACE_ENGINE_ERROR("FrameCapture: can't map a readback buffer");
+            return;
+        }
+
+        if(!screenshot.empty())
+        {
+            Job png = {.type = EJob::Png, .path = screenshot, .pixels = takeBuffer(job.pixels.size()), .width = job.width, .height = job.height};
+            std::memcpy(png.pixels.data(), job.pixels.data(), job.pixels.size());
+            if(push(std::move(png)))
+            {
+                SPACE_ENGINE_INFO("FrameCapture: screenshot in {}", screenshot);
+            }
+            else m_stats.dropped++;
+        }
+
+        if(slot.sequence)
+        {
+            if(m_format == ECaptureFormat::Y4M)
+                job.type = EJob::VideoFrame;
+            else
+            {
+                char name[32];
+                std::snprintf(name, sizeof(name), "frame_%06llu.png", static_cast<unsigned long long>(slot.sequenceFrame));
+                job.type = EJob::Png;
+                job.path = (std::filesystem::path(m_sequencePath) / name).string();
+            }
+
+            if(!push(std::move(job)))
+                m_stats.dropped++;
+        }
+        else
+        {
+            std::lock_guard<std::mutex> lock(s_mutex);
+            s_pool.push_back(std::move(job.pixels));
+        }
+    }
+
+    void FrameCapture::flush()
+    {
+        for(uint32_t i = 0; i < RingSize; i++)
+        {
+            Slot& slot = m_slots[(m_frame + i) % RingSize];
+            if(slot.fence)
+                resolve(slot);
+        }
+    }
+}
@@ -0,0 +1,1322 @@
+#include "glCapture.h"
+#include "log.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <tuple>
+#include <type_traits>
+
+//every argument is a value, the pointers of the draws and of glVertexAttribPointer are offsets in the bound buffers
+#define SPACE_ENGINE_GL_VALUE_CALLS(X) \
+    X(ActiveTexture) X(AttachShader) X(BindBuffer) X(BindFramebuffer) X(BindRenderbuffer) X(BindTexture) \
+    X(BindVertexArray) X(BlendFunc) X(Clear) X(ClearColor) X(CompileShader) X(CopyBufferSubData) \
+    X(CopyNamedBufferSubData) X(CreateProgram) X(CreateShader) X(DeleteProgram) X(DeleteShader) X(DepthFunc) \
+    X(DepthMask) X(DetachShader) X(Disable) X(DrawArrays) X(DrawArraysInstanced) X(DrawArraysInstancedBaseInstance) \
+    X(DrawElements) X(DrawElementsBaseVertex) X(DrawElementsInstancedBaseVertex) \
+    X(DrawElementsInstancedBaseVertexBaseInstance) X(Enable) X(EnableVertexAttribArray) X(FramebufferRenderbuffer) \
+    X(FramebufferTexture2D) X(GenerateMipmap) X(GenerateTextureMipmap) X(LinkProgram) X(MaxShaderCompilerThreadsKHR) \
+    X(MultiDrawElementsIndirect) X(NamedFramebufferRenderbuffer) X(NamedFramebufferTexture) \
+    X(NamedRenderbufferStorage) X(ProgramParameteri) X(ReadBuffer) X(RenderbufferStorage) X(TexBuffer) \
+    X(TexBufferRange) X(TexParameteri) X(TexStorage2D) X(TextureParameteri) X(TextureStorage2D) X(ValidateProgram) \
+    X(VertexAttribDivisor) X(VertexAttribPointer) X(Viewport)
+
+//value calls whose first argument is a location of the program in use
+#define SPACE_ENGINE_GL_UNIFORM_CALLS(X) \
+    X(Uniform1f) X(Uniform1i) X(Uniform1ui) X(Uniform2f) X(Uniform3f) X(Uniform4f)
+
+//data, arrays, strings and the objects the replay translates
+#define SPACE_ENGINE_GL_CUSTOM_CALLS(X) \
+    X(BindAttribLocation) X(BindFragDataLocation) X(BufferData) X(BufferStorage) X(BufferSubData) X(ClearBufferfv) \
+    X(ClientWaitSync) X(CreateBuffers) X(CreateFramebuffers) X(CreateRenderbuffers) X(CreateTextures) \
+    X(DeleteBuffers) X(DeleteFramebuffers) X(DeleteRenderbuffers) X(DeleteSync) X(DeleteTextures) \
+    X(DeleteVertexArrays) X(DrawBuffers) X(FenceSync) X(GenBuffers) X(GenFramebuffers) X(GenRenderbuffers) \
+    X(GenTextures) X(GenVertexArrays) X(GetSubroutineIndex) X(GetSubroutineUniformLocation) X(GetUniformLocation) \
+    X(MapBufferRange) X(NamedBufferStorage) X(NamedBufferSubData) X(PixelStorei) X(ShaderSource) X(TexImage2D) \
+    X(TexParameteriv) X(TexSubImage2D) X(TextureSubImage2D) X(UniformMatrix3fv) X(UniformMatrix4fv) \
+    X(UniformSubroutinesuiv) X(UnmapBuffer) X(UseProgram)
+
+#define SPACE_ENGINE_GL_CALL_ID(name) name,
+#define SPACE_ENGINE_GL_CALL_NAME(name) "gl" #name,
+
+namespace SpaceEngine
+{
+    enum class GLCall : uint16_t
+    {
+        FrameEnd,
+        //memcpy in a mapped range
+        BufferWrite,
+        SPACE_ENGINE_GL_VALUE_CALLS(SPACE_ENGINE_GL_CALL_ID)
+        SPACE_ENGINE_GL_UNIFORM_CALLS(SPACE_ENGINE_GL_CALL_ID)
+        SPACE_ENGINE_GL_CUSTOM_CALLS(SPACE_ENGINE_GL_CALL_ID)
+        Count
+    };
+
+    static const char* CallNames[] =
+    {
+        "FrameEnd",
+        "BufferWrite",
+        SPACE_ENGINE_GL_VALUE_CALLS(SPACE_ENGINE_GL_CALL_NAME)
+        SPACE_ENGINE_GL_UNIFORM_CALLS(SPACE_ENGINE_GL_CALL_NAME)
+        SPACE_ENGINE_GL_CUSTOM_CALLS(SPACE_ENGINE_GL_CALL_NAME)
+    };
+    static_assert(sizeof(CallNames) / sizeof(CallNames[0]) == static_cast<size_t>(GLCall::Count));
+
+    struct CaptureHeader
+    {
+        char magic[8];
+        uint32_t version;
+        uint32_t width;
+        uint32_t height;
+        uint32_t frames;
+    };
+
+    constexpr char CaptureMagic[8] = {'S', 'E', 'G', 'L', 'C', 'A', 'P', '\0'};
+    constexpr uint32_t CaptureVersion = 3;
+
+    //tightly packed rows but the last, padded to the unpack alignment
+    static size_t imageSize(GLenum format, GLenum type, GLsizei width, GLsizei height, GLint alignment)
+    {
+        if(width <= 0 || height <= 0)
+            return 0;
+
+        size_t components = 4;
+        switch(format)
+        {
+            case GL_RED: case GL_RED_INTEGER: case GL_DEPTH_COMPONENT: case GL_STENCIL_INDEX:
+                components = 1;
+                break;
+            case GL_RG: case GL_RG_INTEGER:
+                components = 2;
+                break;
+            case GL_RGB: case GL_BGR: case GL_RGB_INTEGER:
+                components = 3;
+                break;
+        }
+
+        size_t pixel = 0;
+        switch(type)
+        {
+            case GL_UNSIGNED_BYTE: case GL_BYTE:
+                pixel = components;
+                break;
+            case GL_UNSIGNED_SHORT: case GL_SHORT: case GL_HALF_FLOAT:
+                pixel = components * 2;
+                break;
+            case GL_UNSIGNED_SHORT_5_6_5: case GL_UNSIGNED_SHORT_4_4_4_4: case GL_UNSIGNED_SHORT_5_5_5_1:
+                pixel = 2;
+                break;
+            case GL_UNSIGNED_INT_8_8_8_8: case GL_UNSIGNED_INT_8_8_8_8_REV: case GL_UNSIGNED_INT_2_10_10_10_REV:
+            case GL_UNSIGNED_INT_10F_11F_11F_REV: case GL_UNSIGNED_INT_24_8:
+                pixel = 4;
+                break;
+            default:
+                pixel = components * 4;
+                break;
+        }
+
+        size_t row = static_cast<size_t>(width) * pixel;
+        size_t stride = (row + alignment - 1) / alignment * alignment;
+        return stride * static_cast<size_t>(height - 1) + row;
+    }
+
+    //----------------------------------------------------------------------------------------------------------------//
+    //capture
+
+    bool GLCapture::m_active = false;
+    std::string GLCapture::m_path;
+    uint32_t GLCapture::m_numFrames = 0;
+    uint32_t GLCapture::m_frames = 0;
+
+    namespace
+    {
+        std::vector<uint8_t> s_stream;
+        GLint s_unpackAlignment = 4;
+
+        template<typename T>
+        void write(const T& value)
+        {
+            static_assert(std::is_trivially_copyable_v<T>);
+            const uint8_t* pBytes = reinterpret_cast<const uint8_t*>(&value);
+            s_stream.insert(s_stream.end(), pBytes, pBytes + sizeof(T));
+        }
+
+        //the pointers are offsets or handles, written as 64 bit values
+        template<typename T>
+        void writeValue(T value)
+        {
+            if constexpr(std::is_pointer_v<T>)
+                write<uint64_t>(reinterpret_cast<uintptr_t>(value));
+            else
+                write(value);
+        }
+
+        void writeCall(GLCall call)
+        {
+            write(static_cast<uint16_t>(call));
+        }
+
+        void writeBytes(const void* pData, size_t size)
+        {
+            write<uint64_t>(size);
+            const uint8_t* pBytes = static_cast<const uint8_t*>(pData);
+            s_stream.insert(s_stream.end(), pBytes, pBytes + size);
+        }
+
+        //optional data: the uploads accept null
+        void writeData(const void* pData, size_t size)
+        {
+            write<uint8_t>(pData ? 1 : 0);
+            if(pData)
+                writeBytes(pData, size);
+        }
+
+        void writeString(const char* str)
+        {
+            writeBytes(str, str ? std::strlen(str) : 0);
+        }
+
+        template<GLCall Call, auto* pEntry, typename Proc = std::remove_pointer_t<decltype(pEntry)>>
+        struct ValueHook;
+
+        template<GLCall Call, auto* pEntry, typename R, typename... Args>
+        struct ValueHook<Call, pEntry, R (GLAD_API_PTR*)(Args...)>
+        {
+            inline static R (GLAD_API_PTR* real)(Args...) = nullptr;
+
+            static R GLAD_API_PTR hook(Args... args)
+            {
+                writeCall(Call);
+                (writeValue(args), ...);
+                if constexpr(std::is_void_v<R>)
+                    real(args...);
+                else
+                {
+                    R result = real(args...);
+                    writeValue(result);
+                    return result;
+                }
+            }
+        };
+
+        template<typename Proc>
+        void install(Proc& entry, Proc& real, Proc hook)
+        {
+            //the missing entry points stay null, the engine tests them
+            real = entry;
+            if(entry)
+                entry = hook;
+        }
+
+        template<typename Proc>
+        void uninstall(Proc& entry, Proc& real)
+        {
+            if(real)
+                entry = real;
+            real = nullptr;
+        }
+
+#define SPACE_ENGINE_GL_REAL(name) decltype(glad_gl##name) s_##name = nullptr;
+        SPACE_ENGINE_GL_CUSTOM_CALLS(SPACE_ENGINE_GL_REAL)
+#undef SPACE_ENGINE_GL_REAL
+
+        void GLAD_API_PTR hookBindAttribLocation(GLuint program, GLuint index, const GLchar* name)
+        {
+            writeCall(GLCall::BindAttribLocation);
+            write(program);
+            write(index);
+            writeString(name);
+            s_BindAttribLocation(program, index, name);
+        }
+
+        void GLAD_API_PTR hookBindFragDataLocation(GLuint program, GLuint color, const GLchar* name)
+        {
+            writeCall(GLCall::BindFragDataLocation);
+            write(program);
+            write(color);
+            writeString(name);
+            s_BindFragDataLocation(program, color, name);
+        }
+
+        void GLAD_API_PTR hookBufferData(GLenum target, GLsizeiptr size, const void* data, GLenum usage)
+        {
+            writeCall(GLCall::BufferData);
+            write(target);
+            write(size);
+            writeData(data, static_cast<size_t>(size));
+            write(usage);
+            s_BufferData(target, size, data, usage);
+        }
+
+        void GLAD_API_PTR hookBufferStorage(GLenum target, GLsizeiptr size, const void* data, GLbitfield flags)
+        {
+            writeCall(GLCall::BufferStorage);
+            write(target);
+            write(size);
+            writeData(data, static_cast<size_t>(size));
+            write(flags);
+            s_BufferStorage(target, size, data, flags);
+        }
+
+        void GLAD_API_PTR hookBufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const void* data)
+        {
+            writeCall(GLCall::BufferSubData);
+            write(target);
+            write(offset);
+            write(size);
+            writeData(data, static_cast<size_t>(size));
+            s_BufferSubData(target, offset, size, data);
+        }
+
+        void GLAD_API_PTR hookClearBufferfv(GLenum buffer, GLint drawbuffer, const GLfloat* value)
+        {
+            //a color or a depth
+            size_t count = buffer == GL_COLOR ? 4 : 1;
+            writeCall(GLCall::ClearBufferfv);
+            write(buffer);
+            write(drawbuffer);
+            writeBytes(value, sizeof(GLfloat) * count);
+            s_ClearBufferfv(buffer, drawbuffer, value);
+        }
+
+        GLenum GLAD_API_PTR hookClientWaitSync(GLsync sync, GLbitfield flags, GLuint64 timeout)
+        {
+            writeCall(GLCall::ClientWaitSync);
+            writeValue(sync);
+            write(flags);
+            write(timeout);
+            return s_ClientWaitSync(sync, flags, timeout);
+        }
+
+        template<GLCall Call, typename Proc>
+        void deleteNames(Proc real, GLsizei n, const GLuint* names)
+        {
+            writeCall(Call);
+            writeBytes(names, sizeof(GLuint) * static_cast<size_t>(std::max(n, 0)));
+            real(n, names);
+        }
+
+        void GLAD_API_PTR hookDeleteBuffers(GLsizei n, const GLuint* names) { deleteNames<GLCall::DeleteBuffers>(s_DeleteBuffers, n, names); }
+        void GLAD_API_PTR hookDeleteFramebuffers(GLsizei n, const GLuint* names) { deleteNames<GLCall::DeleteFramebuffers>(s_DeleteFramebuffers, n, names); }
+        void GLAD_API_PTR hookDeleteRenderbuffers(GLsizei n, const GLuint* names) { deleteNames<GLCall::DeleteRenderbuffers>(s_DeleteRenderbuffers, n, names); }
+        void GLAD_API_PTR hookDeleteTextures(GLsizei n, const GLuint* names) { deleteNames<GLCall::DeleteTextures>(s_DeleteTextures, n, names); }
+        void GLAD_API_PTR hookDeleteVertexArrays(GLsizei n, const GLuint* names) { deleteNames<GLCall::DeleteVertexArrays>(s_DeleteVertexArrays, n, names); }
+
+        void GLAD_API_PTR hookDeleteSync(GLsync sync)
+        {
+            writeCall(GLCall::DeleteSync);
+            writeValue(sync);
+            s_DeleteSync(sync);
+        }
+
+        void GLAD_API_PTR hookDrawBuffers(GLsizei n, const GLenum* bufs)
+        {
+            writeCall(GLCall::DrawBuffers);
+            writeBytes(bufs, sizeof(GLenum) * static_cast<size_t>(std::max(n, 0)));
+            s_DrawBuffers(n, bufs);
+        }
+
+        GLsync GLAD_API_PTR hookFenceSync(GLenum condition, GLbitfield flags)
+        {
+            GLsync sync = s_FenceSync(condition, flags);
+            writeCall(GLCall::FenceSync);
+            write(condition);
+            write(flags);
+            writeValue(sync);
+            return sync;
+        }
+
+        //the names are written after the call
+        template<GLCall Call, typename Proc>
+        void genNames(Proc real, GLsizei n, GLuint* names)
+        {
+            real(n, names);
+            writeCall(Call);
+            writeBytes(names, sizeof(GLuint) * static_cast<size_t>(std::max(n, 0)));
+        }
+
+        void GLAD_API_PTR hookGenBuffers(GLsizei n, GLuint* names) { genNames<GLCall::GenBuffers>(s_GenBuffers, n, names); }
+        void GLAD_API_PTR hookGenFramebuffers(GLsizei n, GLuint* names) { genNames<GLCall::GenFramebuffers>(s_GenFramebuffers, n, names); }
+        void GLAD_API_PTR hookGenRenderbuffers(GLsizei n, GLuint* names) { genNames<GLCall::GenRenderbuffers>(s_GenRenderbuffers, n, names); }
+        void GLAD_API_PTR hookGenTextures(GLsizei n, GLuint* names) { genNames<GLCall::GenTextures>(s_GenTextures, n, names); }
+        void GLAD_API_PTR hookGenVertexArrays(GLsizei n, GLuint* names) { genNames<GLCall::GenVertexArrays>(s_GenVertexArrays, n, names); }
+
+        void GLAD_API_PTR hookCreateBuffers(GLsizei n, GLuint* names) { genNames<GLCall::CreateBuffers>(s_CreateBuffers, n, names); }
+        void GLAD_API_PTR hookCreateFramebuffers(GLsizei n, GLuint* names) { genNames<GLCall::CreateFramebuffers>(s_CreateFramebuffers, n, names); }
+        void GLAD_API_PTR hookCreateRenderbuffers(GLsizei n, GLuint* names) { genNames<GLCall::CreateRenderbuffers>(s_CreateRenderbuffers, n, names); }
+
+        void GLAD_API_PTR hookCreateTextures(GLenum target, GLsizei n, GLuint* names)
+        {
+            s_CreateTextures(target, n, names);
+            writeCall(GLCall::CreateTextures);
+            write(target);
+            writeBytes(names, sizeof(GLuint) * static_cast<size_t>(std::max(n, 0)));
+        }
+
+        GLuint GLAD_API_PTR hookGetSubroutineIndex(GLuint program, GLenum shadertype, const GLchar* name)
+        {
+            GLuint index = s_GetSubroutineIndex(program, shadertype, name);
+            writeCall(GLCall::GetSubroutineIndex);
+            write(program);
+            write(shadertype);
+            writeString(name);
+            write(index);
+            return index;
+        }
+
+        GLint GLAD_API_PTR hookGetSubroutineUniformLocation(GLuint program, GLenum shadertype, const GLchar* name)
+        {
+            GLint location = s_GetSubroutineUniformLocation(program, shadertype, name);
+            writeCall(GLCall::GetSubroutineUniformLocation);
+            write(program);
+            write(shadertype);
+            writeString(name);
+            write(location);
+            return location;
+        }
+
+        GLint GLAD_API_PTR hookGetUniformLocation(GLuint program, const GLchar* name)
+        {
+            GLint location = s_GetUniformLocation(program, name);
+            writeCall(GLCall::GetUniformLocation);
+            write(program);
+            writeString(name);
+            write(location);
+            return location;
+        }
+
+        void* GLAD_API_PTR hookMapBufferRange(GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access)
+        {
+            writeCall(GLCall::MapBufferRange);
+            write(target);
+            write(offset);
+            write(length);
+            write(access);
+            return s_MapBufferRange(target, offset, length, access);
+        }
+
+        void GLAD_API_PTR hookNamedBufferStorage(GLuint buffer, GLsizeiptr size, const void* data, GLbitfield flags)
+        {
+            writeCall(GLCall::NamedBufferStorage);
+            write(buffer);
+            write(size);
+            writeData(data, static_cast<size_t>(size));
+            write(flags);
+            s_NamedBufferStorage(buffer, size, data, flags);
+        }
+
+        void GLAD_API_PTR hookNamedBufferSubData(GLuint buffer, GLintptr offset, GLsizeiptr size, const void* data)
+        {
+            writeCall(GLCall::NamedBufferSubData);
+            write(buffer);
+            write(offset);
+            write(size);
+            writeData(data, static_cast<size_t>(size));
+            s_NamedBufferSubData(buffer, offset, size, data);
+        }
+
+        void GLAD_API_PTR hookPixelStorei(GLenum pname, GLint param)
+        {
+            if(pname == GL_UNPACK_ALIGNMENT)
+                s_unpackAlignment = param;
+            writeCall(GLCall::PixelStorei);
+            write(pname);
+            write(param);
+            s_PixelStorei(pname, param);
+        }
+
+        //the strings are joined in one
+        void GLAD_API_PTR hookShaderSource(GLuint shader, GLsizei count, const GLchar* const* string, const GLint* length)
+        {
+            std::string source;
+            for(GLsizei i = 0; i < count; i++)
+            {
+                if(length && length[i] >= 0)
+                    source.append(string[i], static_cast<size_t>(length[i]));
+                else
+                    source.append(string[i]);
+            }
+
+            writeCall(GLCall::ShaderSource);
+            write(shader);
+            writeBytes(source.data(), source.size());
+            s_ShaderSource(shader, count, string, length);
+        }
+
+        void GLAD_API_PTR hookTexImage2D(GLenum target, GLint level, GLint internalformat, GLsizei width, GLsizei height,
+            GLint border, GLenum format, GLenum type, const void* pixels)
+        {
+            writeCall(GLCall::TexImage2D);
+            write(target);
+            write(level);
+            write(internalformat);
+            write(width);
+            write(height);
+            write(border);
+            write(format);
+            write(type);
+            writeData(pixels, imageSize(format, type, width, height, s_unpackAlignment));
+            s_TexImage2D(target, level, internalformat, width, height, border, format, type, pixels);
+        }
+
+        void GLAD_API_PTR hookTexParameteriv(GLenum target, GLenum pname, const GLint* params)
+        {
+            size_t count = pname == GL_TEXTURE_SWIZZLE_RGBA || pname == GL_TEXTURE_BORDER_COLOR ? 4 : 1;
+            writeCall(GLCall::TexParameteriv);
+            write(target);
+            write(pname);
+            writeBytes(params, sizeof(GLint) * count);
+            s_TexParameteriv(target, pname, params);
+        }
+
+        void GLAD_API_PTR hookTexSubImage2D(GLenum target, GLint level, GLint xoffset, GLint yoffset, GLsizei width,
+            GLsizei height, GLenum format, GLenum type, const void* pixels)
+        {
+            writeCall(GLCall::TexSubImage2D);
+            write(target);
+            write(level);
+            write(xoffset);
+            write(yoffset);
+            write(width);
+            write(height);
+            write(format);
+            write(type);
+            writeData(pixels, imageSize(format, type, width, height, s_unpackAlignment));
+            s_TexSubImage2D(target, level, xoffset, yoffset, width, height, format, type, pixels);
+        }
+
+        void GLAD_API_PTR hookTextureSubImage2D(GLuint texture, GLint level, GLint xoffset, GLint yoffset, GLsizei width,
+            GLsizei height, GLenum format, GLenum type, const void* pixels)
+        {
+            writeCall(GLCall::TextureSubImage2D);
+            write(texture);
+            write(level);
+            write(xoffset);
+            write(yoffset);
+            write(width);
+            write(height);
+            write(format);
+            write(type);
+            writeData(pixels, imageSize(format, type, width, height, s_unpackAlignment));
+            s_TextureSubImage2D(texture, level, xoffset, yoffset, width, height, format, type, pixels);
+        }
+
+        void GLAD_API_PTR hookUniformMatrix3fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat* value)
+        {
+            writeCall(GLCall::UniformMatrix3fv);
+            write(location);
+            write(transpose);
+            writeBytes(value, sizeof(GLfloat) * 9 * static_cast<size_t>(std::max(count, 0)));
+            s_UniformMatrix3fv(location, count, transpose, value);
+        }
+
+        void GLAD_API_PTR hookUniformMatrix4fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat* value)
+        {
+            writeCall(GLCall::UniformMatrix4fv);
+            write(location);
+            write(transpose);
+            writeBytes(value, sizeof(GLfloat) * 16 * static_cast<size_t>(std::max(count, 0)));
+            s_UniformMatrix4fv(location, count, transpose, value);
+        }
+
+        void GLAD_API_PTR hookUniformSubroutinesuiv(GLenum shadertype, GLsizei count, const GLuint* indices)
+        {
+            writeCall(GLCall::UniformSubroutinesuiv);
+            write(shadertype);
+            writeBytes(indices, sizeof(GLuint) * static_cast<size_t>(std::max(count, 0)));
+            s_UniformSubroutinesuiv(shadertype, count, indices);
+        }
+
+        GLboolean GLAD_API_PTR hookUnmapBuffer(GLenum target)
+        {
+            writeCall(GLCall::UnmapBuffer);
+            write(target);
+            return s_UnmapBuffer(target);
+        }
+
+        void GLAD_API_PTR hookUseProgram(GLuint program)
+        {
+            writeCall(GLCall::UseProgram);
+            write(program);
+            s_UseProgram(program);
+        }
+
+        void installHooks()
+        {
+#define SPACE_ENGINE_GL_HOOK_VALUE(name) \
+            install(glad_gl##name, ValueHook<GLCall::name, &glad_gl##name>::real, &ValueHook<GLCall::name, &glad_gl##name>::hook);
+#define SPACE_ENGINE_GL_HOOK_CUSTOM(name) install(glad_gl##name, s_##name, &hook##name);
+            SPACE_ENGINE_GL_VALUE_CALLS(SPACE_ENGINE_GL_HOOK_VALUE)
+            SPACE_ENGINE_GL_UNIFORM_CALLS(SPACE_ENGINE_GL_HOOK_VALUE)
+            SPACE_ENGINE_GL_CUSTOM_CALLS(SPACE_ENGINE_GL_HOOK_CUSTOM)
+#undef SPACE_ENGINE_GL_HOOK_VALUE
+#undef SPACE_ENGINE_GL_HOOK_CUSTOM
+        }
+
+        void uninstallHooks()
+        {
+#define SPACE_ENGINE_GL_UNHOOK_VALUE(name) uninstall(glad_gl##name, ValueHook<GLCall::name, &glad_gl##name>::real);
+#define SPACE_ENGINE_GL_UNHOOK_CUSTOM(name) uninstall(glad_gl##name, s_##name);
+            SPACE_ENGINE_GL_VALUE_CALLS(SPACE_ENGINE_GL_UNHOOK_VALUE)
+            SPACE_ENGINE_GL_UNIFORM_CALLS(SPACE_ENGINE_GL_UNHOOK_VALUE)
+            SPACE_ENGINE_GL_CUSTOM_CALLS(SPACE_ENGINE_GL_UNHOOK_CUSTOM)
+#undef SPACE_ENGINE_GL_UNHOOK_VALUE
+#undef SPACE_ENGINE_GL_UNHOOK_CUSTOM
+        }
+    }
+
+    bool GLCapture::begin(const std::string& path, uint32_t numFrames)
+    {
+        if(m_active || !numFrames)
+            return false;
+
+        m_path = path;
+        m_numFrames = numFrames;
+        m_frames = 0;
+        s_stream.clear();
+        s_stream.resize(sizeof(CaptureHeader));
+        glGetIntegerv(GL_UNPACK_ALIGNMENT, &s_unpackAlignment);
+
+        installHooks();
+        m_active = true;
+
+        //the state set before the hooks, issued again through them
+        GLint viewport[4] = {};
+        glGetIntegerv(GL_VIEWPORT, viewport);
+        glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+        for(GLenum cap : {GL_DEPTH_TEST, GL_BLEND, GL_CULL_FACE})
+        {
+            if(glIsEnabled(cap))
+                glEnable(cap);
+            else
+                glDisable(cap);
+        }
+        GLint srcBlend = GL_ONE, dstBlend = GL_ZERO;
+        glGetIntegerv(GL_BLEND_SRC_RGB, &srcBlend);
+        glGetIntegerv(GL_BLEND_DST_RGB, &dstBlend);
+        glBlendFunc(static_cast<GLenum>(srcBlend), static_cast<GLenum>(dstBlend));
+        glPixelStorei(GL_UNPACK_ALIGNMENT, s_unpackAlignment);
+
+        CaptureHeader header = {};
+        std::memcpy(header.magic, CaptureMagic, sizeof(CaptureMagic));
+        header.version = CaptureVersion;
+        header.width = static_cast<uint32_t>(viewport[2]);
+        header.height = static_cast<uint32_t>(viewport[3]);
+        std::memcpy(s_stream.data(), &header, sizeof(header));
+
+        SPACE_ENGINE_INFO("GLCapture: recording {} frames in {}", numFrames, path);
+        GL_CHECK_ERRORS();
+        return true;
+    }
+
+    void GLCapture::endFrame()
+    {
+        if(!m_active)
+            return;
+
+        writeCall(GLCall::FrameEnd);
+        if(++m_frames >= m_numFrames)
+            end();
+    }
+
+    void GLCapture::end()
+    {
+        if(!m_active)
+            return;
+
+        uninstallHooks();
+        m_active = false;
+
+        CaptureHeader header;
+        std::memcpy(&header, s_stream.data(), sizeof(header));
+        header.frames = m_frames;
+        std::memcpy(s_stream.data(), &header, sizeof(header));
+
+        std::ofstream file(m_path, std::ios::binary);
+        if(file)
+            file.write(reinterpret_cast<const char*>(s_stream.data()), static_cast<std::streamsize>(s_stream.size()));
+        if(file)
+        {
+            SPACE_ENGINE_INFO("GLCapture: {} frames, {} KB written in {}", m_frames, s_stream.size() / 1024, m_path);
+        }
+        else
+        {
+            SPACE_ENGINE_ERROR("GLCapture: can't write {}", m_path);
+        }
+
+        s_stream.clear();
+        s_stream.shrink_to_fit();
+    }
+
+    void GLCapture::onBufferWrite(GLuint buffer, GLintptr offset, GLsizeiptr size, const void* pData)
+    {
+        if(!m_active)
+            return;
+
+        writeCall(GLCall::BufferWrite);
+        write(buffer);
+        write(offset);
+        writeBytes(pData, static_cast<size_t>(size));
+    }
+
+    //----------------------------------------------------------------------------------------------------------------//
+    //replay
+
+    struct GLReplay::Calls
+    {
+        using Clock = std::chrono::steady_clock;
+        using ReplayFn = void (*)(GLReplay&);
+
+        template<typename T>
+        static T read(GLReplay& r)
+        {
+            using Stored = std::conditional_t<std::is_pointer_v<T>, uint64_t, T>;
+            Stored value{};
+            if(r.m_cursor + sizeof(Stored) > r.m_data.size())
+            {
+                r.m_error = true;
+                return T{};
+            }
+
+            std::memcpy(&value, &r.m_data[r.m_cursor], sizeof(Stored));
+            r.m_cursor += sizeof(Stored);
+            if constexpr(std::is_pointer_v<T>)
+                return reinterpret_cast<T>(static_cast<uintptr_t>(value));
+            else
+                return value;
+        }
+
+        //points into the capture
+        static const uint8_t* readBytes(GLReplay& r, size_t& size)
+        {
+            size = static_cast<size_t>(read<uint64_t>(r));
+            if(r.m_error || r.m_cursor + size > r.m_data.size())
+            {
+                r.m_error = true;
+                size = 0;
+                return nullptr;
+            }
+
+            const uint8_t* pBytes = r.m_data.data() + r.m_cursor;
+            r.m_cursor += size;
+            return pBytes;
+        }
+
+        static const void* readData(GLReplay& r)
+        {
+            if(!read<uint8_t>(r))
+                return nullptr;
+            size_t size = 0;
+            return readBytes(r, size);
+        }
+
+        static std::string readString(GLReplay& r)
+        {
+            size_t size = 0;
+            const uint8_t* pBytes = readBytes(r, size);
+            return pBytes ? std::string(reinterpret_cast<const char*>(pBytes), size) : std::string();
+        }
+
+        //copied: the capture has no alignment
+        template<typename T>
+        static const T* readArray(GLReplay& r, std::vector<T>& array)
+        {
+            size_t size = 0;
+            const uint8_t* pBytes = readBytes(r, size);
+            array.resize(size / sizeof(T));
+            if(pBytes && !array.empty())
+                std::memcpy(array.data(), pBytes, array.size() * sizeof(T));
+            return array.data();
+        }
+
+        template<typename F>
+        static void timed(GLReplay& r, GLCall call, F&& f)
+        {
+            if(!r.m_timed)
+            {
+                f();
+                return;
+            }
+
+            Clock::time_point start = Clock::now();
+            f();
+            std::chrono::duration<double, std::milli> elapsed = Clock::now() - start;
+            size_t index = static_cast<size_t>(call);
+            r.m_counts[index]++;
+            r.m_callMs[index] += elapsed.count();
+        }
+
+        //program in the high half, then the stage and the captured value
+        static uint64_t key(GLuint program, GLenum stage, uint32_t value)
+        {
+            return (static_cast<uint64_t>(program) << 32) | (static_cast<uint64_t>(stage & 0xFFFF) << 16) | (value & 0xFFFF);
+        }
+
+        static GLint location(GLReplay& r, GLint captured)
+        {
+            if(captured < 0)
+                return captured;
+            auto it = r.m_uniforms.find((static_cast<uint64_t>(r.m_program) << 32) | static_cast<uint32_t>(captured));
+            return it != r.m_uniforms.end() ? it->second : captured;
+        }
+
+        static GLenum bindingOf(GLenum target)
+        {
+            switch(target)
+            {
+                case GL_ARRAY_BUFFER: return GL_ARRAY_BUFFER_BINDING;
+                case GL_ELEMENT_ARRAY_BUFFER: return GL_ELEMENT_ARRAY_BUFFER_BINDING;
+                case GL_DRAW_INDIRECT_BUFFER: return GL_DRAW_INDIRECT_BUFFER_BINDING;
+                case GL_UNIFORM_BUFFER: return GL_UNIFORM_BUFFER_BINDING;
+                case GL_TEXTURE_BUFFER: return GL_TEXTURE_BUFFER_BINDING;
+                case GL_COPY_READ_BUFFER: return GL_COPY_READ_BUFFER_BINDING;
+                case GL_COPY_WRITE_BUFFER: return GL_COPY_WRITE_BUFFER_BINDING;
+                case GL_PIXEL_PACK_BUFFER: return GL_PIXEL_PACK_BUFFER_BINDING;
+                case GL_PIXEL_UNPACK_BUFFER: return GL_PIXEL_UNPACK_BUFFER_BINDING;
+            }
+            return 0;
+        }
+
+        static GLuint boundBuffer(GLenum target)
+        {
+            GLint buffer = 0;
+            GLenum binding = bindingOf(target);
+            if(binding)
+                glGetIntegerv(binding, &buffer);
+            return static_cast<GLuint>(buffer);
+        }
+
+        template<GLCall Call, auto* pEntry, bool Location, typename Proc = std::remove_pointer_t<decltype(pEntry)>>
+        struct Value;
+
+        template<GLCall Call, auto* pEntry, bool Location, typename R, typename... Args>
+        struct Value<Call, pEntry, Location, R (GLAD_API_PTR*)(Args...)>
+        {
+            static void replay(GLReplay& r)
+            {
+                std::tuple<Args...> args{read<Args>(r)...};
+                if constexpr(Location)
+                    std::get<0>(args) = location(r, std::get<0>(args));
+
+                R (GLAD_API_PTR* entry)(Args...) = *pEntry;
+                if(!entry || r.m_error)
+                {
+                    if(!entry)
+                        r.m_skippedCalls++;
+                    if constexpr(!std::is_void_v<R>)
+                        read<R>(r);
+                    return;
+                }
+
+                if constexpr(std::is_void_v<R>)
+                    timed(r, Call, [&]() { std::apply(entry, args); });
+                else
+                {
+                    //created names
+                    R result{};
+                    timed(r, Call, [&]() { result = std::apply(entry, args); });
+                    if(result != read<R>(r))
+                        r.m_nameMismatches++;
+                }
+            }
+        };
+
+        static void frameEnd(GLReplay& r)
+        {
+            timed(r, GLCall::FrameEnd, []() { glFinish(); });
+        }
+
+        static void bufferWrite(GLReplay& r)
+        {
+            GLuint buffer = read<GLuint>(r);
+            GLintptr offset = read<GLintptr>(r);
+            size_t size = 0;
+            const uint8_t* pBytes = readBytes(r, size);
+
+            auto it = r.m_mappings.find(buffer);
+            if(it == r.m_mappings.end() || offset < it->second.offset ||
+                offset + static_cast<GLintptr>(size) > it->second.offset + it->second.length)
+            {
+                r.m_skippedCalls++;
+                return;
+            }
+
+            uint8_t* pDst = it->second.pData + (offset - it->second.offset);
+            timed(r, GLCall::BufferWrite, [&]() { std::memcpy(pDst, pBytes, size); });
+        }
+
+        static void replayBindAttribLocation(GLReplay& r)
+        {
+            GLuint program = read<GLuint>(r);
+            GLuint index = read<GLuint>(r);
+            std::string name = readString(r);
+            timed(r, GLCall::BindAttribLocation, [&]() { glBindAttribLocation(program, index, name.c_str()); });
+        }
+
+        static void replayBindFragDataLocation(GLReplay& r)
+        {
+            GLuint program = read<GLuint>(r);
+            GLuint color = read<GLuint>(r);
+            std::string name = readString(r);
+            timed(r, GLCall::BindFragDataLocation, [&]() { glBindFragDataLocation(program, color, name.c_str()); });
+        }
+
+        static void replayBufferData(GLReplay& r)
+        {
+            GLenum target = read<GLenum>(r);
+            GLsizeiptr size = read<GLsizeiptr>(r);
+            const void* pData = readData(r);
+            GLenum usage = read<GLenum>(r);
+            timed(r, GLCall::BufferData, [&]() { glBufferData(target, size, pData, usage); });
+        }
+
+        static void replayBufferStorage(GLReplay& r)
+        {
+            GLenum target = read<GLenum>(r);
+            GLsizeiptr size = read<GLsizeiptr>(r);
+            const void* pData = readData(r);
+            GLbitfield flags = read<GLbitfield>(r);
+            if(!glBufferStorage)
+            {
+                r.m_skippedCalls++;
+                return;
+            }
+            timed(r, GLCall::BufferStorage, [&]() { glBufferStorage(target, size, pData, flags); });
+        }
+
+        static void replayBufferSubData(GLReplay& r)
+        {
+            GLenum target = read<GLenum>(r);
+            GLintptr offset = read<GLintptr>(r);
+            GLsizeiptr size = read<GLsizeiptr>(r);
+            const void* pData = readData(r);
+            timed(r, GLCall::BufferSubData, [&]() { glBufferSubData(target, offset, size, pData); });
+        }
+
+        static void replayClearBufferfv(GLReplay& r)
+        {
+            GLenum buffer = read<GLenum>(r);
+            GLint drawbuffer = read<GLint>(r);
+            std::vector<GLfloat> values;
+            const GLfloat* pValues = readArray(r, values);
+            timed(r, GLCall::ClearBufferfv, [&]() { glClearBufferfv(buffer, drawbuffer, pValues); });
+        }
+
+        static void replayClientWaitSync(GLReplay& r)
+        {
+            uint64_t captured = read<uint64_t>(r);
+            GLbitfield flags = read<GLbitfield>(r);
+            GLuint64 timeout = read<GLuint64>(r);
+            auto it = r.m_syncs.find(captured);
+            if(it == r.m_syncs.end())
+                return;
+            timed(r, GLCall::ClientWaitSync, [&]() { glClientWaitSync(it->second, flags, timeout); });
+        }
+
+        template<GLCall Call, auto* pEntry>
+        static void replayDelete(GLReplay& r)
+        {
+            std::vector<GLuint> names;
+            const GLuint* pNames = readArray(r, names);
+            timed(r, Call, [&]() { (*pEntry)(static_cast<GLsizei>(names.size()), pNames); });
+        }
+
+        static void replayDeleteBuffers(GLReplay& r)
+        {
+            size_t cursor = r.m_cursor;
+            std::vector<GLuint> names;
+            readArray(r, names);
+            //deleting a buffer unmaps it
+            for(GLuint name : names)
+                r.m_mappings.erase(name);
+            r.m_cursor = cursor;
+            replayDelete<GLCall::DeleteBuffers, &glad_glDeleteBuffers>(r);
+        }
+
+        static void replayDeleteFramebuffers(GLReplay& r) { replayDelete<GLCall::DeleteFramebuffers, &glad_glDeleteFramebuffers>(r); }
+        static void replayDeleteRenderbuffers(GLReplay& r) { replayDelete<GLCall::DeleteRenderbuffers, &glad_glDeleteRenderbuffers>(r); }
+        static void replayDeleteTextures(GLReplay& r) { replayDelete<GLCall::DeleteTextures, &glad_glDeleteTextures>(r); }
+        static void replayDeleteVertexArrays(GLReplay& r) { replayDelete<GLCall::DeleteVertexArrays, &glad_glDeleteVertexArrays>(r); }
+
+        static void replayDeleteSync(GLReplay& r)
+        {
+            auto it = r.m_syncs.find(read<uint64_t>(r));
+            if(it == r.m_syncs.end())
+                return;
+            timed(r, GLCall::DeleteSync, [&]() { glDeleteSync(it->second); });
+            r.m_syncs.erase(it);
+        }
+
+        static void replayDrawBuffers(GLReplay& r)
+        {
+            std::vector<GLenum> bufs;
+            const GLenum* pBufs = readArray(r, bufs);
+            timed(r, GLCall::DrawBuffers, [&]() { glDrawBuffers(static_cast<GLsizei>(bufs.size()), pBufs); });
+        }
+
+        static void replayFenceSync(GLReplay& r)
+        {
+            GLenum condition = read<GLenum>(r);
+            GLbitfield flags = read<GLbitfield>(r);
+            uint64_t captured = read<uint64_t>(r);
+            GLsync sync = nullptr;
+            timed(r, GLCall::FenceSync, [&]() { sync = glFenceSync(condition, flags); });
+            r.m_syncs[captured] = sync;
+        }
+
+        template<GLCall Call, auto* pEntry>
+        static void replayGen(GLReplay& r)
+        {
+            std::vector<GLuint> captured;
+            readArray(r, captured);
+            if(!*pEntry)
+            {
+                r.m_skippedCalls++;
+                return;
+            }
+            std::vector<GLuint> names(captured.size());
+            timed(r, Call, [&]() { (*pEntry)(static_cast<GLsizei>(names.size()), names.data()); });
+            if(names != captured)
+                r.m_nameMismatches++;
+        }
+
+        static void replayGenBuffers(GLReplay& r) { replayGen<GLCall::GenBuffers, &glad_glGenBuffers>(r); }
+        static void replayGenFramebuffers(GLReplay& r) { replayGen<GLCall::GenFramebuffers, &glad_glGenFramebuffers>(r); }
+        static void replayGenRenderbuffers(GLReplay& r) { replayGen<GLCall::GenRenderbuffers, &glad_glGenRenderbuffers>(r); }
+        static void replayGenTextures(GLReplay& r) { replayGen<GLCall::GenTextures, &glad_glGenTextures>(r); }
+        static void replayGenVertexArrays(GLReplay& r) { replayGen<GLCall::GenVertexArrays, &glad_glGenVertexArrays>(r); }
+        static void replayCreateBuffers(GLReplay& r) { replayGen<GLCall::CreateBuffers, &glad_glCreateBuffers>(r); }
+        static void replayCreateFramebuffers(GLReplay& r) { replayGen<GLCall::CreateFramebuffers, &glad_glCreateFramebuffers>(r); }
+        static void replayCreateRenderbuffers(GLReplay& r) { replayGen<GLCall::CreateRenderbuffers, &glad_glCreateRenderbuffers>(r); }
+
+        static void replayCreateTextures(GLReplay& r)
+        {
+            GLenum target = read<GLenum>(r);
+            std::vector<GLuint> captured;
+            readArray(r, captured);
+            if(!glCreateTextures)
+            {
+                r.m_skippedCalls++;
+                return;
+            }
+            std::vector<GLuint> names(captured.size());
+            timed(r, GLCall::CreateTextures, [&]() { glCreateTextures(target, static_cast<GLsizei>(names.size()), names.data()); });
+            if(names != captured)
+                r.m_nameMismatches++;
+        }
+
+        static void replayGetSubroutineIndex(GLReplay& r)
+        {
+            GLuint program = read<GLuint>(r);
+            GLenum stage = read<GLenum>(r);
+            std::string name = readString(r);
+            GLuint captured = read<GLuint>(r);
+            GLuint index = glGetSubroutineIndex(program, stage, name.c_str());
+            r.m_subroutines[key(program, stage, captured)] = index;
+        }
+
+        static void replayGetSubroutineUniformLocation(GLReplay& r)
+        {
+            GLuint program = read<GLuint>(r);
+            GLenum stage = read<GLenum>(r);
+            std::string name = readString(r);
+            GLint captured = read<GLint>(r);
+            GLint location = glGetSubroutineUniformLocation(program, stage, name.c_str());
+            if(captured >= 0)
+                r.m_subroutineUniforms[key(program, stage, static_cast<uint32_t>(captured))] = location;
+        }
+
+        static void replayGetUniformLocation(GLReplay& r)
+        {
+            GLuint program = read<GLuint>(r);
+            std::string name = readString(r);
+            GLint captured = read<GLint>(r);
+            GLint location = glGetUniformLocation(program, name.c_str());
+            if(captured >= 0)
+                r.m_uniforms[(static_cast<uint64_t>(program) << 32) | static_cast<uint32_t>(captured)] = location;
+        }
+
+        static void replayMapBufferRange(GLReplay& r)
+        {
+            GLenum target = read<GLenum>(r);
+            GLintptr offset = read<GLintptr>(r);
+            GLsizeiptr length = read<GLsizeiptr>(r);
+            GLbitfield access = read<GLbitfield>(r);
+            void* pData = nullptr;
+            timed(r, GLCall::MapBufferRange, [&]() { pData = glMapBufferRange(target, offset, length, access); });
+            if(pData)
+                r.m_mappings[boundBuffer(target)] = {static_cast<uint8_t*>(pData), offset, length};
+        }
+
+        static void replayNamedBufferStorage(GLReplay& r)
+        {
+            GLuint buffer = read<GLuint>(r);
+            GLsizeiptr size = read<GLsizeiptr>(r);
+            const void* pData = readData(r);
+            GLbitfield flags = read<GLbitfield>(r);
+            if(!glNamedBufferStorage)
+            {
+                r.m_skippedCalls++;
+                return;
+            }
+            timed(r, GLCall::NamedBufferStorage, [&]() { glNamedBufferStorage(buffer, size, pData, flags); });
+        }
+
+        static void replayNamedBufferSubData(GLReplay& r)
+        {
+            GLuint buffer = read<GLuint>(r);
+            GLintptr offset = read<GLintptr>(r);
+            GLsizeiptr size = read<GLsizeiptr>(r);
+            const void* pData = readData(r);
+            if(!glNamedBufferSubData)
+            {
+                r.m_skippedCalls++;
+                return;
+            }
+            timed(r, GLCall::NamedBufferSubData, [&]() { glNamedBufferSubData(buffer, offset, size, pData); });
+        }
+
+        static void replayPixelStorei(GLReplay& r)
+        {
+            GLenum pname = read<GLenum>(r);
+            GLint param = read<GLint>(r);
+            timed(r, GLCall::PixelStorei, [&]() { glPixelStorei(pname, param); });
+        }
+
+        static void replayShaderSource(GLReplay& r)
+        {
+            GLuint shader = read<GLuint>(r);
+            std::string source = readString(r);
+            const GLchar* pSource = source.c_str();
+            GLint length = static_cast<GLint>(source.size());
+            timed(r, GLCall::ShaderSource, [&]() { glShaderSource(shader, 1, &pSource, &length); });
+        }
+
+        static void replayTexImage2D(GLReplay& r)
+        {
+            GLenum target = read<GLenum>(r);
+            GLint level = read<GLint>(r);
+            GLint internalformat = read<GLint>(r);
+            GLsizei width = read<GLsizei>(r);
+            GLsizei height = read<GLsizei>(r);
+            GLint border = read<GLint>(r);
+            GLenum format = read<GLenum>(r);
+            GLenum type = read<GLenum>(r);
+            const void* pPixels = readData(r);
+            timed(r, GLCall::TexImage2D, [&]()
+            {
+                glTexImage2D(target, level, internalformat, width, height, border, format, type, pPixels);
+            });
+        }
+
+        static void replayTexParameteriv(GLReplay& r)
+        {
+            GLenum target = read<GLenum>(r);
+            GLenum pname = read<GLenum>(r);
+            std::vector<GLint> params;
+            const GLint* pParams = readArray(r, params);
+            timed(r, GLCall::TexParameteriv, [&]() { glTexParameteriv(target, pname, pParams); });
+        }
+
+        static void replayTexSubImage2D(GLReplay& r)
+        {
+            GLenum target = read<GLenum>(r);
+            GLint level = read<GLint>(r);
+            GLint xoffset = read<GLint>(r);
+            GLint yoffset = read<GLint>(r);
+            GLsizei width = read<GLsizei>(r);
+            GLsizei height = read<GLsizei>(r);
+            GLenum format = read<GLenum>(r);
+            GLenum type = read<GLenum>(r);
+            const void* pPixels = readData(r);
+            timed(r, GLCall::TexSubImage2D, [&]()
+            {
+                glTexSubImage2D(target, level, xoffset, yoffset, width, height, format, type, pPixels);
+            });
+        }
+
+        static void replayTextureSubImage2D(GLReplay& r)
+        {
+            GLuint texture = read<GLuint>(r);
+            GLint level = read<GLint>(r);
+            GLint xoffset = read<GLint>(r);
+            GLint yoffset = read<GLint>(r);
+            GLsizei width = read<GLsizei>(r);
+            GLsizei height = read<GLsizei>(r);
+            GLenum format = read<GLenum>(r);
+            GLenum type = read<GLenum>(r);
+            const void* pPixels = readData(r);
+            if(!glTextureSubImage2D)
+            {
+                r.m_skippedCalls++;
+                return;
+            }
+            timed(r, GLCall::TextureSubImage2D, [&]()
+            {
+                glTextureSubImage2D(texture, level, xoffset, yoffset, width, height, format, type, pPixels);
+            });
+        }
+
+        template<GLCall Call, auto* pEntry, size_t Floats>
+        static void replayMatrix(GLReplay& r)
+        {
+            GLint loc = location(r, read<GLint>(r));
+            GLboolean transpose = read<GLboolean>(r);
+            std::vector<GLfloat> values;
+            const GLfloat* pValues = readArray(r, values);
+            timed(r, Call, [&]() { (*pEntry)(loc, static_cast<GLsizei>(values.size() / Floats), transpose, pValues); });
+        }
+
+        static void replayUniformMatrix3fv(GLReplay& r) { replayMatrix<GLCall::UniformMatrix3fv, &glad_glUniformMatrix3fv, 9>(r); }
+        static void replayUniformMatrix4fv(GLReplay& r) { replayMatrix<GLCall::UniformMatrix4fv, &glad_glUniformMatrix4fv, 16>(r); }
+
+        //the position in the array is the subroutine uniform location
+        static void replayUniformSubroutinesuiv(GLReplay& r)
+        {
+            GLenum stage = read<GLenum>(r);
+            std::vector<GLuint> captured;
+            readArray(r, captured);
+            std::vector<GLuint> indices(captured.size(), 0);
+            for(size_t i = 0; i < captured.size(); i++)
+            {
+                auto loc = r.m_subroutineUniforms.find(key(r.m_program, stage, static_cast<uint32_t>(i)));
+                auto index = r.m_subroutines.find(key(r.m_program, stage, captured[i]));
+                size_t slot = loc != r.m_subroutineUniforms.end() ? static_cast<size_t>(loc->second) : i;
+                if(slot < indices.size())
+                    indices[slot] = index != r.m_subroutines.end() ? index->second : captured[i];
+            }
+            timed(r, GLCall::UniformSubroutinesuiv, [&]()
+            {
+                glUniformSubroutinesuiv(stage, static_cast<GLsizei>(indices.size()), indices.data());
+            });
+        }
+
+        static void replayUnmapBuffer(GLReplay& r)
+        {
+            GLenum target = read<GLenum>(r);
+            r.m_mappings.erase(boundBuffer(target));
+            timed(r, GLCall::UnmapBuffer, [&]() { glUnmapBuffer(target); });
+        }
+
+        static void replayUseProgram(GLReplay& r)
+        {
+            r.m_program = read<GLuint>(r);
+            timed(r, GLCall::UseProgram, [&]() { glUseProgram(r.m_program); });
+        }
+
+        //same order of GLCall
+        static const ReplayFn* table()
+        {
+#define SPACE_ENGINE_GL_REPLAY_VALUE(name) &Value<GLCall::name, &glad_gl##name, false>::replay,
+#define SPACE_ENGINE_GL_REPLAY_UNIFORM(name) &Value<GLCall::name, &glad_gl##name, true>::replay,
+#define SPACE_ENGINE_GL_REPLAY_CUSTOM(name) &replay##name,
+            static const ReplayFn functions[] =
+            {
+                &frameEnd,
+                &bufferWrite,
+                SPACE_ENGINE_GL_VALUE_CALLS(SPACE_ENGINE_GL_REPLAY_VALUE)
+                SPACE_ENGINE_GL_UNIFORM_CALLS(SPACE_ENGINE_GL_REPLAY_UNIFORM)
+                SPACE_ENGINE_GL_CUSTOM_CALLS(SPACE_ENGINE_GL_REPLAY_CUSTOM)
+            };
+            static_assert(sizeof(functions) / sizeof(functions[0]) == static_cast<size_t>(GLCall::Count));
+#undef SPACE_ENGINE_GL_REPLAY_VALUE
+#undef SPACE_ENGINE_GL_REPLAY_UNIFORM
+#undef SPACE_ENGINE_GL_REPLAY_CUSTOM
+            return functions;
+        }
+    };
+
+    bool GLReplay::load(const std::string& path)
+    {
+        std::ifstream file(path, std::ios::binary | std::ios::ate);
+        if(!file)
+        {
+            SPACE_ENGINE_ERROR("GLReplay: can't open {}", path);
+            return false;
+        }
+
+        m_data.resize(static_cast<size_t>(file.tellg()));
+        file.seekg(0);
+        file.read(reinterpret_cast<char*>(m_data.data()), static_cast<std::streamsize>(m_data.size()));
+
+        CaptureHeader header;
+        if(!file || m_data.size() < sizeof(header))
+        {
+            SPACE_ENGINE_ERROR("GLReplay: {} is truncated", path);
+            return false;
+        }
+
+        std::memcpy(&header, m_data.data(), sizeof(header));
+        if(std::memcmp(header.magic, CaptureMagic, sizeof(CaptureMagic)) != 0 || header.version != CaptureVersion)
+        {
+            SPACE_ENGINE_ERROR("GLReplay: {} is not a capture of this version", path);
+            return false;
+        }
+
+        m_width = static_cast<int>(header.width);
+        m_height = static_cast<int>(header.height);
+        m_frames = header.frames;
+        return true;
+    }
+
+    bool GLReplay::run(uint32_t warmupFrames)
+    {
+        const Calls::ReplayFn* pTable = Calls::table();
+        const size_t numCalls = static_cast<size_t>(GLCall::Count);
+        m_cursor = sizeof(CaptureHeader);
+        m_error = false;
+        m_program = 0;
+        m_uniforms.clear();
+        m_subroutines.clear();
+        m_subroutineUniforms.clear();
+        m_syncs.clear();
+        m_mappings.clear();
+        m_counts.assign(numCalls, 0);
+        m_callMs.assign(numCalls, 0.0);
+        m_frameMs.clear();
+        m_nameMismatches = 0;
+        m_skippedCalls = 0;
+
+        uint32_t frame = 0;
+        m_timed = warmupFrames == 0;
+        Calls::Clock::time_point frameStart = Calls::Clock::now();
+        while(m_cursor < m_data.size() && !m_error)
+        {
+            uint16_t call = Calls::read<uint16_t>(*this);
+            if(call >= numCalls)
+            {
+                m_error = true;
+                break;
+            }
+
+            pTable[call](*this);
+
+            if(call == static_cast<uint16_t>(GLCall::FrameEnd))
+            {
+                Calls::Clock::time_point now = Calls::Clock::now();
+                if(m_timed)
+                    m_frameMs.push_back(std::chrono::duration<double, std::milli>(now - frameStart).count());
+                frameStart = now;
+                m_timed = ++frame >= warmupFrames;
+            }
+        }
+
+        if(m_error)
+            SPACE_ENGINE_ERROR("GLReplay: corrupted capture at byte {}", m_cursor);
+        return !m_error;
+    }
+
+    std::vector<GLReplayCallStats> GLReplay::getCallStats() const
+    {
+        std::vector<GLReplayCallStats> stats;
+        for(size_t i = 0; i < m_counts.size(); i++)
+        {
+            if(m_counts[i])
+                stats.push_back({CallNames[i], m_counts[i], m_callMs[i]});
+        }
+
+        std::sort(stats.begin(), stats.end(), [](const GLReplayCallStats& a, const GLReplayCallStats& b) { return a.ms > b.ms; });
+        return stats;
+    }
+}
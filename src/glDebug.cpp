@@ -0,0 +1,100 @@
+#include "glDebug.h"
+#include "log.h"
+
+namespace SpaceEngine
+{
+    static const char* sourceString(GLenum source)
+    {
+        switch(source)
+        {
+            case GL_DEBUG_SOURCE_API: return "API";
+            case GL_DEBUG_SOURCE_WINDOW_SYSTEM: return "window system";
+            case GL_DEBUG_SOURCE_SHADER_COMPILER: return "shader compiler";
+            case GL_DEBUG_SOURCE_THIRD_PARTY: return "third party";
+            case GL_DEBUG_SOURCE_APPLICATION: return "application";
+            default: return "other";
+        }
+    }
+
+    static const char* typeString(GLenum type)
+    {
+        switch(type)
+        {
+            case GL_DEBUG_TYPE_ERROR: return "error";
+            case GL_DEBUG_TYPE_DEPRECATED_BEHAVIOR: return "deprecated";
+            case GL_DEBUG_TYPE_UNDEFINED_BEHAVIOR: return "undefined behavior";
+            case GL_DEBUG_TYPE_PORTABILITY: return "portability";
+            case GL_DEBUG_TYPE_PERFORMANCE: return "performance";
+            case GL_DEBUG_TYPE_MARKER: return "marker";
+            default: return "other";
+        }
+    }
+
+    bool GLDebug::init()
+    {
+#ifdef SPACE_ENGINE_DEBUG_CONFIG
+        //entry points of GL 4.3 or of KHR_debug
+        if(!glDebugMessageCallback || !glDebugMessageControl)
+        {
+            SPACE_ENGINE_WARN("GLDebug: KHR_debug not supported, the GL errors are polled");
+            return false;
+        }
+
+        GLint flags = 0;
+        glGetIntegerv(GL_CONTEXT_FLAGS, &flags);
+        if(!(flags & GL_CONTEXT_FLAG_DEBUG_BIT))
+            SPACE_ENGINE_WARN("GLDebug: not a debug context, the driver can skip some messages");
+
+        glEnable(GL_DEBUG_OUTPUT);
+        glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+        glDebugMessageCallback(&GLDebug::callback, nullptr);
+        //the notifications are the allocations and the usage hints of every buffer
+        glDebugMessageControl(GL_DONT_CARE, GL_DONT_CARE, GL_DONT_CARE, 0, nullptr, GL_TRUE);
+        glDebugMessageControl(GL_DONT_CARE, GL_DONT_CARE, GL_DEBUG_SEVERITY_NOTIFICATION, 0, nullptr, GL_FALSE);
+
+        m_active = true;
+        SPACE_ENGINE_INFO("GLDebug: debug output on");
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    void GLDebug::label(GLenum identifier, GLuint name, const std::string& label)
+    {
+#ifdef SPACE_ENGINE_DEBUG_CONFIG
+        if(m_active && glObjectLabel && name)
+            glObjectLabel(identifier, name, static_cast<GLsizei>(label.size()), label.c_str());
+#else
+        (void)identifier;
+        (void)name;
+        (void)label;
+#endif
+    }
+
+    void GLAD_API_PTR GLDebug::callback(GLenum source, GLenum type, GLuint id, GLenum severity,
+        GLsizei length, const GLchar* message, const void* userParam)
+    {
+        //the release builds log nothing
+        (void)source;
+        (void)type;
+        (void)id;
+        (void)severity;
+        (void)length;
+        (void)message;
+        (void)userParam;
+
+        if(type == GL_DEBUG_TYPE_ERROR || severity == GL_DEBUG_SEVERITY_HIGH)
+        {
+            SPACE_ENGINE_ERROR("GL {} {} ({}): {}", sourceString(source), typeString(type), id, message);
+        }
+        else if(severity == GL_DEBUG_SEVERITY_MEDIUM)
+        {
+            SPACE_ENGINE_WARN("GL {} {} ({}): {}", sourceString(source), typeString(type), id, message);
+        }
+        else
+        {
+            SPACE_ENGINE_DEBUG("GL {} {} ({}): {}", sourceString(source), typeString(type), id, message);
+        }
+    }
+}
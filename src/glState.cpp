@@ -0,0 +1,242 @@
+#include "glState.h"
+#include "log.h"
+
+namespace SpaceEngine
+{
+    GLuint GLStateCache::m_program = GLStateCache::InvalidHandle;
+    GLuint GLStateCache::m_vao = GLStateCache::InvalidHandle;
+    GLuint GLStateCache::m_fbo = GLStateCache::InvalidHandle;
+    std::unordered_map<GLuint, uint8_t> GLStateCache::m_drawBuffers;
+    int8_t GLStateCache::m_caps[GLStateCache::NUM_CAPS] = {-1, -1, -1};
+    GLenum GLStateCache::m_blendSrc = GLStateCache::InvalidEnum;
+    GLenum GLStateCache::m_blendDst = GLStateCache::InvalidEnum;
+    GLenum GLStateCache::m_depthFunc = GLStateCache::InvalidEnum;
+    int8_t GLStateCache::m_depthMask = -1;
+    GLuint GLStateCache::m_textures[GLStateCache::MaxTextureUnits][GLStateCache::NUM_TEX_TARGETS];
+    GLuint GLStateCache::m_activeUnit = GLStateCache::InvalidHandle;
+    GLStateStats GLStateCache::m_stats;
+    GLStateStats GLStateCache::m_lastFrameStats;
+    uint64_t GLStateCache::m_frame = 0;
+
+    void GLStateCache::bindPipeline(const PipelineState& pso)
+    {
+        if(pso.program)
+            useProgram(pso.program);
+
+        enable(GL_BLEND, pso.blend);
+        if(pso.blend)
+            blendFunc(pso.blendSrc, pso.blendDst);
+
+        enable(GL_DEPTH_TEST, pso.depthTest);
+        if(pso.depthTest)
+            depthFunc(pso.depthFunc);
+        depthMask(pso.depthWrite);
+
+        enable(GL_CULL_FACE, pso.cullFace);
+
+        if(pso.drawBuffers)
+            drawBuffers(pso.drawBuffers);
+    }
+
+    void GLStateCache::useProgram(GLuint program)
+    {
+        if(changed(m_program != program))
+        {
+            glUseProgram(program);
+            m_program = program;
+        }
+    }
+
+    void GLStateCache::bindVertexArray(GLuint vao)
+    {
+        if(changed(m_vao != vao))
+        {
+            glBindVertexArray(vao);
+            m_vao = vao;
+        }
+    }
+
+    void GLStateCache::bindFramebuffer(GLuint fbo)
+    {
+        if(changed(m_fbo != fbo))
+        {
+            glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+            m_fbo = fbo;
+        }
+    }
+
+    void GLStateCache::drawBuffers(uint8_t numBuffers)
+    {
+        //the default framebuffer has only the back buffer
+        if(m_fbo == 0 || m_fbo == InvalidHandle)
+            return;
+
+        auto it = m_drawBuffers.find(m_fbo);
+
+        if(changed(it == m_drawBuffers.end() || it->second != numBuffers))
+        {
+            GLenum attachments[8];
+            numBuffers = numBuffers > 8 ? 8 : numBuffers;
+
+            for(uint8_t i = 0; i < numBuffers; i++)
+                attachments[i] = GL_COLOR_ATTACHMENT0 + i;
+
+            glDrawBuffers(static_cast<GLsizei>(numBuffers), attachments);
+            m_drawBuffers[m_fbo] = numBuffers;
+        }
+    }
+
+    void GLStateCache::enable(GLenum cap, bool flag)
+    {
+        int index;
+
+        switch(cap)
+        {
+            case GL_BLEND: index = BLEND; break;
+            case GL_DEPTH_TEST: index = DEPTH_TEST; break;
+            case GL_CULL_FACE: index = CULL_FACE; break;
+            default:
+                //not tracked
+                flag ? glEnable(cap) : glDisable(cap);
+                m_stats.issued++;
+                return;
+        }
+
+        if(changed(m_caps[index] != static_cast<int8_t>(flag)))
+        {
+            flag ? glEnable(cap) : glDisable(cap);
+            m_caps[index] = static_cast<int8_t>(flag);
+        }
+    }
+
+    void GLStateCache::blendFunc(GLenum src, GLenum dst)
+    {
+        if(changed(m_blendSrc != src || m_blendDst != dst))
+        {
+            glBlendFunc(src, dst);
+            m_blendSrc = src;
+            m_blendDst = dst;
+        }
+    }
+
+    void GLStateCache::depthFunc(GLenum func)
+    {
+        if(changed(m_depthFunc != func))
+        {
+            glDepthFunc(func);
+            m_depthFunc = func;
+        }
+    }
+
+    void GLStateCache::depthMask(bool flag)
+    {
+        if(changed(m_depthMask != static_cast<int8_t>(flag)))
+        {
+            glDepthMask(flag ? GL_TRUE : GL_FALSE);
+            m_depthMask = static_cast<int8_t>(flag);
+        }
+    }
+
+    void GLStateCache::bindTexture(GLuint unit, GLenum target, GLuint texture)
+    {
+        int index;
+
+        switch(target)
+        {
+            case GL_TEXTURE_2D: index = TEX_2D; break;
+            case GL_TEXTURE_CUBE_MAP: index = TEX_CUBE_MAP; break;
+            case GL_TEXTURE_BUFFER: index = TEX_BUFFER; break;
+            default: index = -1; break;
+        }
+
+        bool tracked = index >= 0 && unit < MaxTextureUnits;
+
+        if(changed(!tracked || m_textures[unit][index] != texture))
+        {
+            if(m_activeUnit != unit)
+            {
+                glActiveTexture(GL_TEXTURE0 + unit);
+                m_activeUnit = unit;
+            }
+
+            glBindTexture(target, texture);
+            m_stats.textureBinds++;
+
+            if(tracked)
+                m_textures[unit][index] = texture;
+        }
+    }
+
+    void GLStateCache::onDeleteProgram(GLuint program)
+    {
+        //GL unbinds a deleted object only at the next glUseProgram, force it
+        if(m_program == program)
+            m_program = InvalidHandle;
+    }
+
+    void GLStateCache::onDeleteVertexArray(GLuint vao)
+    {
+        //deleting the bound VAO reverts the binding to 0
+        if(m_vao == vao)
+            m_vao = 0;
+    }
+
+    void GLStateCache::onDeleteFramebuffer(GLuint fbo)
+    {
+        if(m_fbo == fbo)
+            m_fbo = 0;
+
+        m_drawBuffers.erase(fbo);
+    }
+
+    void GLStateCache::onDeleteTexture(GLuint texture)
+    {
+        //the deleted texture is unbound from every unit of the context
+        for(GLuint unit = 0; unit < MaxTextureUnits; unit++)
+        {
+            for(int i = 0; i < NUM_TEX_TARGETS; i++)
+            {
+                if(m_textures[unit][i] == texture)
+                    m_textures[unit][i] = 0;
+            }
+        }
+    }
+
+    void GLStateCache::invalidate()
+    {
+        m_program = InvalidHandle;
+        m_vao = InvalidHandle;
+        m_fbo = InvalidHandle;
+        m_drawBuffers.clear();
+
+        for(int i = 0; i < NUM_CAPS; i++)
+            m_caps[i] = -1;
+
+        m_blendSrc = InvalidEnum;
+        m_blendDst = InvalidEnum;
+        m_depthFunc = InvalidEnum;
+        m_depthMask = -1;
+
+        for(GLuint unit = 0; unit < MaxTextureUnits; unit++)
+        {
+            for(int i = 0; i < NUM_TEX_TARGETS; i++)
+                m_textures[unit][i] = InvalidHandle;
+        }
+        m_activeUnit = InvalidHandle;
+    }
+
+    void GLStateCache::newFrame()
+    {
+        m_lastFrameStats = m_stats;
+        m_stats = GLStateStats();
+
+        //every ~10 seconds at 60 fps
+        if(!(m_frame++ % 600))
+        {
+            SPACE_ENGINE_DEBUG("GLStateCache - state calls issued: {}, redundant skipped: {}, texture binds: {}",
+                m_lastFrameStats.issued,
+                m_lastFrameStats.skipped,
+                m_lastFrameStats.textureBinds);
+        }
+    }
+}
@@ -0,0 +1,220 @@
+#include "gpuProfiler.h"
+#include "log.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace SpaceEngine
+{
+    //section that didn't get its queries, the pool of the frame is full
+    constexpr uint32_t DroppedScope = 0xFFFFFFFF;
+
+    bool GPUProfiler::m_supported = false;
+    bool GPUProfiler::m_inFrame = false;
+    uint64_t GPUProfiler::m_frameIndex = 0;
+    uint64_t GPUProfiler::m_resolvedFrames = 0;
+    uint32_t GPUProfiler::m_droppedFrames = 0;
+    GPUProfiler::FrameSlot GPUProfiler::m_slots[GPUProfiler::FramesInFlight];
+    std::vector<uint32_t> GPUProfiler::m_openScopes;
+    std::vector<GPUTimerStats> GPUProfiler::m_stats;
+    std::vector<GPUProfiler::SectionHistory> GPUProfiler::m_history;
+
+    void GPUProfiler::init()
+    {
+        if(m_supported)
+            return;
+
+        GLint bits = 0;
+        glGetQueryiv(GL_TIMESTAMP, GL_QUERY_COUNTER_BITS, &bits);
+        if(!bits)
+        {
+            SPACE_ENGINE_WARN("GPUProfiler: timestamp queries not supported, the GPU times are not available");
+            return;
+        }
+
+        for(FrameSlot& slot : m_slots)
+        {
+            glGenQueries(MaxScopesPerFrame * 2, slot.queries);
+            slot.scopes.reserve(MaxScopesPerFrame);
+        }
+
+        m_supported = true;
+        findOrAddSection("frame");
+        GL_CHECK_ERRORS();
+    }
+
+    void GPUProfiler::shutdown()
+    {
+        if(!m_supported)
+            return;
+
+        for(FrameSlot& slot : m_slots)
+        {
+            glDeleteQueries(MaxScopesPerFrame * 2, slot.queries);
+            std::memset(slot.queries, 0, sizeof(slot.queries));
+            slot.usedQueries = 0;
+            slot.scopes.clear();
+            slot.pending = false;
+        }
+
+        m_openScopes.clear();
+        m_stats.clear();
+        m_history.clear();
+        m_supported = false;
+        m_inFrame = false;
+    }
+
+    void GPUProfiler::beginFrame()
+    {
+        if(!m_supported)
+            return;
+
+        FrameSlot& slot = m_slots[m_frameIndex % FramesInFlight];
+
+        //the slot was recorded FramesInFlight frames ago
+        if(slot.pending)
+            resolve(slot);
+
+        slot.usedQueries = 0;
+        slot.scopes.clear();
+        slot.pending = false;
+        m_openScopes.clear();
+        m_inFrame = true;
+
+        begin("frame");
+    }
+
+    void GPUProfiler::endFrame()
+    {
+        if(!m_inFrame)
+            return;
+
+        if(m_openScopes.size() > 1)
+            SPACE_ENGINE_WARN("GPUProfiler: {} sections not closed at the end of the frame", m_openScopes.size() - 1);
+
+        while(!m_openScopes.empty())
+            end();
+
+        FrameSlot& slot = m_slots[m_frameIndex % FramesInFlight];
+        slot.numSections = static_cast<uint32_t>(m_stats.size());
+        slot.pending = slot.usedQueries > 0;
+        m_frameIndex++;
+        m_inFrame = false;
+    }
+
+    void GPUProfiler::begin(const char* name)
+    {
+        if(!m_inFrame)
+            return;
+
+        FrameSlot& slot = m_slots[m_frameIndex % FramesInFlight];
+        if(slot.usedQueries + 2 > MaxScopesPerFrame * 2)
+        {
+            m_openScopes.push_back(DroppedScope);
+            return;
+        }
+
+        Scope scope;
+        scope.section = findOrAddSection(name);
+        scope.beginQuery = slot.usedQueries++;
+        scope.endQuery = slot.usedQueries++;
+
+        glQueryCounter(slot.queries[scope.beginQuery], GL_TIMESTAMP);
+        m_openScopes.push_back(static_cast<uint32_t>(slot.scopes.size()));
+        slot.scopes.push_back(scope);
+    }
+
+    void GPUProfiler::end()
+    {
+        if(!m_inFrame || m_openScopes.empty())
+            return;
+
+        uint32_t index = m_openScopes.back();
+        m_openScopes.pop_back();
+        if(index == DroppedScope)
+            return;
+
+        FrameSlot& slot = m_slots[m_frameIndex % FramesInFlight];
+        glQueryCounter(slot.queries[slot.scopes[index].endQuery], GL_TIMESTAMP);
+    }
+
+    const GPUTimerStats* GPUProfiler::findStats(const std::string& name)
+    {
+        for(const GPUTimerStats& stats : m_stats)
+        {
+            if(stats.name == name)
+                return &stats;
+        }
+
+        return nullptr;
+    }
+
+    uint32_t GPUProfiler::findOrAddSection(const char* name)
+    {
+        for(uint32_t i = 0; i < m_stats.size(); i++)
+        {
+            if(m_stats[i].name == name)
+                return i;
+        }
+
+        GPUTimerStats stats;
+        stats.name = name;
+        m_stats.push_back(stats);
+        m_history.emplace_back();
+
+        return static_cast<uint32_t>(m_stats.size() - 1);
+    }
+
+    void GPUProfiler::resolve(FrameSlot& slot)
+    {
+        //never wait the GPU: a frame still in flight is dropped
+        for(uint32_t i = 0; i < slot.usedQueries; i++)
+        {
+            GLuint available = GL_FALSE;
+            glGetQueryObjectuiv(slot.queries[i], GL_QUERY_RESULT_AVAILABLE, &available);
+            if(!available)
+            {
+                m_droppedFrames++;
+                return;
+            }
+        }
+
+        std::vector<double> frameMs(slot.numSections, 0.0);
+
+        for(const Scope& scope : slot.scopes)
+        {
+            GLuint64 t0 = 0;
+            GLuint64 t1 = 0;
+            glGetQueryObjectui64v(slot.queries[scope.beginQuery], GL_QUERY_RESULT, &t0);
+            glGetQueryObjectui64v(slot.queries[scope.endQuery], GL_QUERY_RESULT, &t1);
+
+            if(t1 > t0 && scope.section < slot.numSections)
+                frameMs[scope.section] += static_cast<double>(t1 - t0) * 1e-6;
+        }
+
+        //a section missing in the frame counts 0 ms
+        for(uint32_t s = 0; s < slot.numSections; s++)
+        {
+            SectionHistory& history = m_history[s];
+            history.samples[history.head] = static_cast<float>(frameMs[s]);
+            history.head = (history.head + 1) % HistorySize;
+            history.count = std::min(history.count + 1, HistorySize);
+
+            float sum = 0.f;
+            float max = 0.f;
+            for(uint32_t i = 0; i < history.count; i++)
+            {
+                sum += history.samples[i];
+                max = std::max(max, history.samples[i]);
+            }
+
+            GPUTimerStats& stats = m_stats[s];
+            stats.lastMs = static_cast<float>(frameMs[s]);
+            stats.avgMs = sum / static_cast<float>(history.count);
+            stats.maxMs = max;
+        }
+
+        m_resolvedFrames++;
+        GL_CHECK_ERRORS();
+    }
+}
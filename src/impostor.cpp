@@ -0,0 +1,224 @@
+#include "impostor.h"
+#include "mesh.h"
+#include "material.h"
+#include "texture.h"
+#include "glState.h"
+#include "glDebug.h"
+#include "log.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace SpaceEngine
+{
+    std::unordered_map<const Mesh*, ImpostorAtlas> ImpostorManager::m_atlases;
+    float ImpostorManager::m_distance = 40.f;
+    float ImpostorManager::m_fadeRange = 10.f;
+
+    //the bake writes without blending: the clears give coverage 0 around the mesh
+    static const PipelineState BakePSO = {.blend = false, .depthTest = true, .cullFace = true};
+
+    Vector3 ImpostorManager::octDecode(Vector2 uv)
+    {
+        Vector2 f = uv * 2.f - 1.f;
+        Vector3 n = Vector3(f.x, 1.f - std::fabs(f.x) - std::fabs(f.y), f.y);
+        float t = std::max(-n.y, 0.f);
+        n.x += n.x >= 0.f ? -t : t;
+        n.z += n.z >= 0.f ? -t : t;
+        return glm::normalize(n);
+    }
+
+    const ImpostorAtlas* ImpostorManager::bake(Mesh* pMesh)
+    {
+        if(!pMesh)
+            return nullptr;
+
+        auto it = m_atlases.find(pMesh);
+        if(it != m_atlases.end())
+            return &it->second;
+
+        ImpostorAtlas atlas;
+        atlas.center = pMesh->getBoundsCenter();
+        atlas.radius = pMesh->getBoundsRadius();
+        if(atlas.radius <= 0.f)
+        {
+            SPACE_ENGINE_WARN("Impostor: empty mesh, no atlas");
+            return nullptr;
+        }
+
+        //programs of the submeshes, the materials without the PBR program keep only the mesh
+        const int numSubMeshes = pMesh->getNumSubMesh();
+        std::vector<ShaderProgram*> bakePrograms(numSubMeshes, nullptr);
+        bool firstMaterial = true;
+        for(int i = 0; i < numSubMeshes; i++)
+        {
+            PBRMaterial* pMat = dynamic_cast<PBRMaterial*>(pMesh->getMaterialBySubMeshIndex(i));
+            if(!pMat || !pMat->getShader())
+                continue;
+
+            bakePrograms[i] = pMat->getVariant("IMPOSTOR_BAKE");
+            pMat->pFadeShader = pMat->getVariant("IMPOSTOR_FADE");
+            if(firstMaterial)
+            {
+                auto readProp = [pMat](const char* name, float& value)
+                {
+                    auto prop = pMat->props.find(name);
+                    if(prop != pMat->props.end())
+                    {
+                        if(const float* pVal = std::get_if<float>(&prop->second))
+                            value = *pVal;
+                    }
+                };
+                readProp("metalness_val", atlas.metalness);
+                readProp("roughness_val", atlas.roughness);
+                readProp("ambient_occlusion_val", atlas.ambientOcclusion);
+                firstMaterial = false;
+            }
+        }
+
+        if(firstMaterial)
+        {
+            SPACE_ENGINE_WARN("Impostor: no PBR material, no atlas");
+            return nullptr;
+        }
+
+        atlas.albedo = TextureManager::createStorage2D(GL_RGBA8, MipLevels, AtlasSize, AtlasSize);
+        atlas.normalDepth = TextureManager::createStorage2D(GL_RGBA16F, MipLevels, AtlasSize, AtlasSize);
+        GLDebug::label(GL_TEXTURE, atlas.albedo, "impostor albedo");
+        GLDebug::label(GL_TEXTURE, atlas.normalDepth, "impostor normal depth");
+        for(GLuint texture : {atlas.albedo, atlas.normalDepth})
+        {
+            TextureManager::setParameter2D(texture, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+            TextureManager::setParameter2D(texture, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+            TextureManager::setParameter2D(texture, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+            TextureManager::setParameter2D(texture, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        }
+        GLStateCache::bindTexture(0, GL_TEXTURE_2D, 0);
+
+        //the bake runs between the frames, the state of the frame is put back at the end
+        const GLuint lastFramebuffer = GLStateCache::getBoundFramebuffer();
+        GLint lastViewport[4];
+        glGetIntegerv(GL_VIEWPORT, lastViewport);
+
+        GLuint depth = 0;
+        GLuint fbo = 0;
+        if(GLStateCache::hasDirectStateAccess())
+        {
+            glCreateRenderbuffers(1, &depth);
+            glNamedRenderbufferStorage(depth, GL_DEPTH_COMPONENT24, AtlasSize, AtlasSize);
+            glCreateFramebuffers(1, &fbo);
+            glNamedFramebufferTexture(fbo, GL_COLOR_ATTACHMENT0, atlas.albedo, 0);
+            glNamedFramebufferTexture(fbo, GL_COLOR_ATTACHMENT1, atlas.normalDepth, 0);
+            glNamedFramebufferRenderbuffer(fbo, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depth);
+            GL_CHECK_NAMED_FRAMEBUFFER_STATUS(fbo);
+        }
+        else
+        {
+            glGenRenderbuffers(1, &depth);
+            glBindRenderbuffer(GL_RENDERBUFFER, depth);
+            glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, AtlasSize, AtlasSize);
+            glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+            glGenFramebuffers(1, &fbo);
+            GLStateCache::bindFramebuffer(fbo);
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, atlas.albedo, 0);
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, atlas.normalDepth, 0);
+            glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depth);
+            GL_CHECK_FRAMEBUFFER_STATUS();
+        }
+        GLDebug::label(GL_RENDERBUFFER, depth, "impostor depth");
+        GLDebug::label(GL_FRAMEBUFFER, fbo, "impostor bake");
+
+        GLStateCache::bindFramebuffer(fbo);
+        GLStateCache::drawBuffers(2);
+        GLStateCache::bindPipeline(BakePSO);
+        glViewport(0, 0, AtlasSize, AtlasSize);
+        const GLfloat clearColor[4] = {0.f, 0.f, 0.f, 0.f};
+        const GLfloat clearDepth = 1.f;
+        glClearBufferfv(GL_COLOR, 0, clearColor);
+        glClearBufferfv(GL_COLOR, 1, clearColor);
+        glClearBufferfv(GL_DEPTH, 0, &clearDepth);
+
+        GeometryArena::bindVAO();
+        //the sphere fills the frame, the depth runs from its front to its back
+        const float r = atlas.radius;
+        const Matrix4 projection = glm::ortho(-r, r, -r, r, r, 3.f * r);
+        for(uint32_t j = 0; j < GridSize; j++)
+        {
+            for(uint32_t i = 0; i < GridSize; i++)
+            {
+                glViewport(i * FrameSize, j * FrameSize, FrameSize, FrameSize);
+                Vector3 dir = octDecode(Vector2(i, j) / static_cast<float>(GridSize - 1));
+                //same basis of frameUV in pbr.vs
+                Vector3 up = std::fabs(dir.y) > 0.999f ? Vector3(0.f, 0.f, 1.f) : Vector3(0.f, 1.f, 0.f);
+                Matrix4 view = glm::lookAt(atlas.center + dir * 2.f * r, atlas.center, up);
+
+                for(int sub = 0; sub < numSubMeshes; sub++)
+                {
+                    ShaderProgram* pProgram = bakePrograms[sub];
+                    if(!pProgram)
+                        continue;
+
+                    pProgram->use();
+                    pProgram->setUniform("view", view);
+                    pProgram->setUniform("projection", projection);
+                    pMesh->getMaterialBySubMeshIndex(sub)->bindingPropsToProgram(*pProgram);
+
+                    DrawElementsIndirectCommand cmd = pMesh->getDrawCommand(sub, 0);
+                    glDrawElementsBaseVertex(GL_TRIANGLES, cmd.count, GL_UNSIGNED_INT,
+                        reinterpret_cast<const void*>(sizeof(GLuint) * cmd.firstIndex), cmd.baseVertex);
+                }
+            }
+        }
+        GL_CHECK_ERRORS();
+
+        GLStateCache::bindFramebuffer(lastFramebuffer);
+        glViewport(lastViewport[0], lastViewport[1], lastViewport[2], lastViewport[3]);
+        GLStateCache::onDeleteFramebuffer(fbo);
+        glDeleteFramebuffers(1, &fbo);
+        glDeleteRenderbuffers(1, &depth);
+
+        //the coverage of the far frames is averaged by the mips, the colors stay premultiplied
+        TextureManager::generateMipmap2D(atlas.albedo);
+        TextureManager::generateMipmap2D(atlas.normalDepth);
+        GLStateCache::bindTexture(0, GL_TEXTURE_2D, 0);
+        GL_CHECK_ERRORS();
+
+        SPACE_ENGINE_INFO("Impostor: baked {} frames of {}x{}", GridSize * GridSize, FrameSize, FrameSize);
+        return &(m_atlases[pMesh] = atlas);
+    }
+
+    const ImpostorAtlas* ImpostorManager::find(const Mesh* pMesh)
+    {
+        auto it = m_atlases.find(pMesh);
+        return it != m_atlases.end() ? &it->second : nullptr;
+    }
+
+    void ImpostorManager::destroy()
+    {
+        for(auto& [pMesh, atlas] : m_atlases)
+        {
+            GLStateCache::onDeleteTexture(atlas.albedo);
+            GLStateCache::onDeleteTexture(atlas.normalDepth);
+            glDeleteTextures(1, &atlas.albedo);
+            glDeleteTextures(1, &atlas.normalDepth);
+        }
+        m_atlases.clear();
+    }
+
+    void ImpostorManager::setDistance(float distance, float fadeRange)
+    {
+        m_distance = std::max(distance, 0.f);
+        m_fadeRange = std::clamp(fadeRange, 0.f, m_distance);
+    }
+
+    float ImpostorManager::getMeshFade(const Mesh* pMesh, float distance)
+    {
+        if(distance <= m_distance - m_fadeRange || !find(pMesh))
+            return 1.f;
+        if(distance >= m_distance)
+            return 0.f;
+
+        return (m_distance - distance) / m_fadeRange;
+    }
+}
@@ -0,0 +1,318 @@
+#include "lightClusters.h"
+#include "glState.h"
+#include "glDebug.h"
+#include "log.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace SpaceEngine
+{
+    //uniforms of the global lights, built once
+    static const char* GlobalLightUniforms[LightClusters::MaxGlobalLights][4] =
+    {
+        {"lights[0].pos", "lights[0].color", "lights[0].dir", "lights[0].type"},
+        {"lights[1].pos", "lights[1].color", "lights[1].dir", "lights[1].type"},
+        {"lights[2].pos", "lights[2].color", "lights[2].dir", "lights[2].type"},
+        {"lights[3].pos", "lights[3].color", "lights[3].dir", "lights[3].type"},
+    };
+
+    //lights, grid, indices
+    static constexpr GLenum BufferFormats[3] = {GL_RGBA32F, GL_RG32UI, GL_R32UI};
+    static constexpr GLuint BufferUnits[3] = {LightClusters::LightsTexUnit, LightClusters::GridTexUnit, LightClusters::IndicesTexUnit};
+    static const char* BufferLabels[3] = {"cluster lights", "cluster grid", "cluster indices"};
+    //an empty buffer can't back a texture
+    static constexpr GLsizeiptr MinBufferSize = 16;
+
+    void LightClusters::init()
+    {
+        glGenTextures(3, m_textures);
+        if(glTexBufferRange)
+        {
+            //the lights at the limit and as many indices as the grid entries
+            m_stream.init(GL_TEXTURE_BUFFER, static_cast<GLsizeiptr>(sizeof(Vector4) * MaxLocalLights * 2 +
+                sizeof(uint32_t) * NumClusters * 4), "cluster lists");
+            glGetIntegerv(GL_TEXTURE_BUFFER_OFFSET_ALIGNMENT, &m_offsetAlignment);
+            m_offsetAlignment = std::max(m_offsetAlignment, 1);
+        }
+        else glGenBuffers(3, m_buffers);
+
+        for(int i = 0; i < 3; i++)
+        {
+            GLStateCache::bindTexture(BufferUnits[i], GL_TEXTURE_BUFFER, m_textures[i]);
+            GLDebug::label(GL_TEXTURE, m_textures[i], BufferLabels[i]);
+            if(!m_buffers[i])
+                continue;
+
+            glBindBuffer(GL_TEXTURE_BUFFER, m_buffers[i]);
+            glBufferData(GL_TEXTURE_BUFFER, MinBufferSize, nullptr, GL_STREAM_DRAW);
+            glTexBuffer(GL_TEXTURE_BUFFER, BufferFormats[i], m_buffers[i]);
+            GLDebug::label(GL_BUFFER, m_buffers[i], BufferLabels[i]);
+        }
+        glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+        m_grid.assign(NumClusters * 2, 0);
+        GL_CHECK_ERRORS();
+    }
+
+    void LightClusters::destroy()
+    {
+        for(int i = 0; i < 3; i++)
+        {
+            if(m_textures[i])
+                GLStateCache::onDeleteTexture(m_textures[i]);
+        }
+
+        glDeleteTextures(3, m_textures);
+        if(m_buffers[0])
+            glDeleteBuffers(3, m_buffers);
+        m_stream.destroy();
+        for(int i = 0; i < 3; i++)
+        {
+            m_textures[i] = 0;
+            m_buffers[i] = 0;
+        }
+    }
+
+    float LightClusters::getRange(const Light& light)
+    {
+        if(light.range > 0.f)
+            return light.range;
+
+        //color / d^2 = MinRadiance
+        float intensity = std::max(light.color.r, std::max(light.color.g, light.color.b));
+        return std::sqrt(std::max(intensity, 0.f) / MinRadiance);
+    }
+
+    int LightClusters::getSlice(float viewDepth) const
+    {
+        if(viewDepth <= m_near)
+            return 0;
+
+        int slice = static_cast<int>(std::log(viewDepth / m_near) * m_sliceScale);
+        return std::clamp(slice, 0, static_cast<int>(GridZ) - 1);
+    }
+
+    int LightClusters::getCluster(int tileX, int tileY, float viewDepth) const
+    {
+        if(tileX < 0 || tileY < 0 || tileX >= static_cast<int>(GridX) || tileY >= static_cast<int>(GridY))
+            return -1;
+
+        return (getSlice(viewDepth) * GridY + tileY) * GridX + tileX;
+    }
+
+    bool LightClusters::computeBounds(const CameraView& view, const Light& light, ClusterBounds& bounds) const
+    {
+        Vector3 c = Vector3(view.view * Vector4(light.pos, 1.f));
+        float r = getRange(light);
+
+        //the view looks along -z
+        float depthMin = -(c.z + r);
+        float depthMax = -(c.z - r);
+        if(depthMax < m_near || depthMin > m_far)
+            return false;
+        depthMin = std::max(depthMin, m_near);
+        depthMax = std::min(depthMax, m_far);
+
+        //screen rectangle of the box around the sphere, cut by the near and far planes:
+        //its corners are in front of the camera and their projection contains the sphere
+        float minX = 1.f, minY = 1.f, maxX = -1.f, maxY = -1.f;
+        for(int i = 0; i < 8; i++)
+        {
+            Vector4 corner = {c.x + (i & 1 ? r : -r), c.y + (i & 2 ? r : -r), -(i & 4 ? depthMax : depthMin), 1.f};
+            Vector4 clip = view.projection * corner;
+            float x = clip.x / clip.w;
+            float y = clip.y / clip.w;
+            minX = std::min(minX, x);
+            minY = std::min(minY, y);
+            maxX = std::max(maxX, x);
+            maxY = std::max(maxY, y);
+        }
+
+        if(maxX < -1.f || minX > 1.f || maxY < -1.f || minY > 1.f)
+            return false;
+
+        auto toTile = [](float ndc, uint32_t tiles)
+        {
+            return std::clamp(static_cast<int>((ndc * 0.5f + 0.5f) * static_cast<float>(tiles)), 0, static_cast<int>(tiles) - 1);
+        };
+
+        bounds = {toTile(minX, GridX), toTile(maxX, GridX), toTile(minY, GridY), toTile(maxY, GridY),
+            getSlice(depthMin), getSlice(depthMax)};
+        return true;
+    }
+
+    void LightClusters::build(const CameraView& view, const std::vector<Light*>& lights)
+    {
+        m_stats = LightClusterStats();
+        m_global.clear();
+        m_local.clear();
+
+        for(const Light* pLight : lights)
+        {
+            if(!pLight)
+                continue;
+
+            bool local = pLight->type == static_cast<int>(ELightType::POINT_LIGHT);
+            std::vector<const Light*>& list = local ? m_local : m_global;
+            if(list.size() < (local ? MaxLocalLights : MaxGlobalLights))
+                list.push_back(pLight);
+            else
+                m_stats.dropped++;
+        }
+
+        //depth range of the projection
+        const Matrix4& p = view.projection;
+        if(p[2][3] != 0.f)
+        {
+            m_near = p[3][2] / (p[2][2] - 1.f);
+            m_far = p[3][2] / (p[2][2] + 1.f);
+        }
+        else
+        {
+            m_near = (p[3][2] + 1.f) / p[2][2];
+            m_far = (p[3][2] - 1.f) / p[2][2];
+        }
+        //the slices are logarithmic, the orthographic views can start at 0
+        m_near = std::max(m_near, 0.01f);
+        m_far = std::max(m_far, m_near * 2.f);
+        m_sliceScale = static_cast<float>(GridZ) / std::log(m_far / m_near);
+
+        const size_t numLocal = m_local.size();
+        m_grid.assign(NumClusters * 2, 0);
+        m_bounds.resize(numLocal);
+        m_lightData.resize(numLocal * 2);
+
+        //counts
+        for(size_t i = 0; i < numLocal; i++)
+        {
+            const Light& light = *m_local[i];
+            m_lightData[i * 2] = Vector4(light.pos, getRange(light));
+            m_lightData[i * 2 + 1] = Vector4(light.color, 0.f);
+
+            ClusterBounds& b = m_bounds[i];
+            if(!computeBounds(view, light, b))
+            {
+                b = {0, -1, 0, -1, 0, -1};
+                continue;
+            }
+
+            for(int z = b.z0; z <= b.z1; z++)
+                for(int y = b.y0; y <= b.y1; y++)
+                    for(int x = b.x0; x <= b.x1; x++)
+                        m_grid[((z * GridY + y) * GridX + x) * 2 + 1]++;
+        }
+
+        //offsets, the counts are rebuilt by the fill
+        uint32_t offset = 0;
+        for(uint32_t c = 0; c < NumClusters; c++)
+        {
+            uint32_t count = m_grid[c * 2 + 1];
+            m_stats.maxPerCluster = std::max(m_stats.maxPerCluster, count);
+            m_grid[c * 2] = offset;
+            m_grid[c * 2 + 1] = 0;
+            offset += count;
+        }
+        m_indices.resize(offset);
+
+        for(size_t i = 0; i < numLocal; i++)
+        {
+            const ClusterBounds& b = m_bounds[i];
+            for(int z = b.z0; z <= b.z1; z++)
+            {
+                for(int y = b.y0; y <= b.y1; y++)
+                {
+                    for(int x = b.x0; x <= b.x1; x++)
+                    {
+                        uint32_t* pCluster = &m_grid[((z * GridY + y) * GridX + x) * 2];
+                        m_indices[pCluster[0] + pCluster[1]++] = static_cast<uint32_t>(i);
+                    }
+                }
+            }
+        }
+
+        m_stats.localLights = static_cast<uint32_t>(numLocal);
+        m_stats.globalLights = static_cast<uint32_t>(m_global.size());
+        m_stats.indices = offset;
+    }
+
+    void LightClusters::upload()
+    {
+        const void* pData[3] = {m_lightData.data(), m_grid.data(), m_indices.data()};
+        const GLsizeiptr sizes[3] =
+        {
+            static_cast<GLsizeiptr>(m_lightData.size() * sizeof(Vector4)),
+            static_cast<GLsizeiptr>(m_grid.size() * sizeof(uint32_t)),
+            static_cast<GLsizeiptr>(m_indices.size() * sizeof(uint32_t))
+        };
+
+        if(!glTexBufferRange)
+        {
+            //orphaned every frame, the textures keep pointing the buffer names
+            for(int i = 0; i < 3; i++)
+            {
+                glBindBuffer(GL_TEXTURE_BUFFER, m_buffers[i]);
+                glBufferData(GL_TEXTURE_BUFFER, std::max(sizes[i], MinBufferSize), nullptr, GL_STREAM_DRAW);
+                if(sizes[i])
+                    glBufferSubData(GL_TEXTURE_BUFFER, 0, sizes[i], pData[i]);
+            }
+            glBindBuffer(GL_TEXTURE_BUFFER, 0);
+            GL_CHECK_ERRORS();
+            return;
+        }
+
+        //an empty range can't back a texture
+        static const uint32_t Empty[MinBufferSize / sizeof(uint32_t)] = {};
+        m_stream.beginFrame();
+        GLuint buffer = 0;
+        GLintptr offsets[3];
+        GLsizeiptr ranges[3];
+        //the ring can grow in the middle of the lists, they are written again in the new buffer
+        do
+        {
+            buffer = m_stream.getBuffer();
+            for(int i = 0; i < 3; i++)
+            {
+                ranges[i] = sizes[i] ? sizes[i] : MinBufferSize;
+                offsets[i] = m_stream.upload(sizes[i] ? pData[i] : Empty, ranges[i], m_offsetAlignment);
+            }
+        }
+        while(buffer != m_stream.getBuffer());
+
+        for(int i = 0; i < 3; i++)
+        {
+            GLStateCache::bindTexture(BufferUnits[i], GL_TEXTURE_BUFFER, m_textures[i]);
+            glTexBufferRange(GL_TEXTURE_BUFFER, BufferFormats[i], buffer, offsets[i], ranges[i]);
+        }
+        GL_CHECK_ERRORS();
+    }
+
+    void LightClusters::endFrame()
+    {
+        m_stream.endFrame();
+    }
+
+    void LightClusters::bind(ShaderProgram& shader, int targetWidth, int targetHeight) const
+    {
+        shader.setUniform("numLights", static_cast<int>(m_global.size()));
+        for(size_t i = 0; i < m_global.size(); i++)
+        {
+            shader.setUniform(GlobalLightUniforms[i][0], m_global[i]->pos);
+            shader.setUniform(GlobalLightUniforms[i][1], m_global[i]->color);
+            shader.setUniform(GlobalLightUniforms[i][2], m_global[i]->dir);
+            shader.setUniform(GlobalLightUniforms[i][3], m_global[i]->type);
+        }
+
+        //clusters per pixel of the target
+        shader.setUniform("clusterScale", Vector2(static_cast<float>(GridX) / static_cast<float>(std::max(targetWidth, 1)),
+            static_cast<float>(GridY) / static_cast<float>(std::max(targetHeight, 1))));
+        shader.setUniform("clusterNear", m_near);
+        shader.setUniform("clusterSliceScale", m_sliceScale);
+        shader.setSampler("clusterLights", LightsTexUnit);
+        shader.setSampler("clusterGrid", GridTexUnit);
+        shader.setSampler("clusterIndices", IndicesTexUnit);
+
+        for(int i = 0; i < 3; i++)
+            GLStateCache::bindTexture(BufferUnits[i], GL_TEXTURE_BUFFER, m_textures[i]);
+    }
+}
@@ -4,6 +4,8 @@
 
 #include <iostream>
 #include <filesystem>
+#include <cstdlib>
+#include <string>
 
 #ifdef __APPLE__
 #include <mach-o/dyld.h>
@@ -52,7 +54,19 @@ int main()
 
     try
     {
-        SpaceEngine::App app;
+        //SPACESHIP_GL_CAPTURE=<file> records the GL calls of the first SPACESHIP_GL_CAPTURE_FRAMES frames (300)
+        SpaceEngine::AppConfig config;
+        if(const char* capturePath = std::getenv("SPACESHIP_GL_CAPTURE"))
+        {
+            const char* captureFrames = std::getenv("SPACESHIP_GL_CAPTURE_FRAMES");
+            config.capturePath = capturePath;
+            config.captureFrames = captureFrames ? static_cast<uint32_t>(std::strtoul(captureFrames, nullptr, 10)) : 300;
+        }
+        //SPACESHIP_FRAME_CAPTURE=<file.y4m or directory> records every frame, F12 takes a screenshot
+        if(const char* frameCapturePath = std::getenv("SPACESHIP_FRAME_CAPTURE"))
+            config.frameCapturePath = frameCapturePath;
+
+        SpaceEngine::App app(config);
         app.Run();
     }
     catch (const std::exception &e)
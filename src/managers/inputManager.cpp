@@ -146,10 +146,14 @@ namespace SpaceEngine
         keys[SPACE_ENGINE_KEY_BUTTON_SPACE]=false;
         keys[SPACE_ENGINE_KEY_BUTTON_BACKSPACE]=false;
         keys[SPACE_ENGINE_KEY_BUTTON_ESCAPE]=false;
+        keys[SPACE_ENGINE_KEY_BUTTON_F3]=false;
+        keys[SPACE_ENGINE_KEY_BUTTON_F12]=false;
         keysLast[SPACE_ENGINE_KEY_BUTTON_ENTER]=false;
         keysLast[SPACE_ENGINE_KEY_BUTTON_SPACE]=false;
         keysLast[SPACE_ENGINE_KEY_BUTTON_BACKSPACE]=false;
         keysLast[SPACE_ENGINE_KEY_BUTTON_ESCAPE]=false;
+        keysLast[SPACE_ENGINE_KEY_BUTTON_F3]=false;
+        keysLast[SPACE_ENGINE_KEY_BUTTON_F12]=false;
     }
 
     bool Keyboard::key(int id)
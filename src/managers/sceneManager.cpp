@@ -30,7 +30,8 @@ namespace SpaceEngine
         }
     }
 
-    void SceneManager::GatherRenderables(std::vector<RenderObject>& worldRenderables, 
+    void SceneManager::GatherRenderables(const CameraView* pView,
+                std::vector<RenderObject>& worldRenderables, 
                 std::vector<UIRenderObject>& uiRenderables, 
                 std::vector<TextRenderObject>& textRenderables,
                 std::vector<ScreenRenderObject>& screenRenderables)
@@ -39,15 +40,19 @@ namespace SpaceEngine
         uiRenderables.clear();
         textRenderables.clear();
         screenRenderables.clear();
+        m_cullStats = CullStats();
 
         for(Scene* pScene: m_vecScenes)
         {
             if(pScene->isActive())
             {
-                pScene->gatherRenderables(worldRenderables, 
+                pScene->gatherRenderables(pView,
+                    worldRenderables, 
                     uiRenderables, 
                     textRenderables,
                     screenRenderables);
+                m_cullStats.tested += pScene->getCullStats().tested;
+                m_cullStats.culled += pScene->getCullStats().culled;
             }
         }
     }
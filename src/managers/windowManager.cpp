@@ -1,5 +1,6 @@
 #include "windowManager.h"
 #include "log.h"
+#include "glDebug.h"
 #include "sceneManager.h"
 
 namespace SpaceEngine
@@ -16,6 +17,8 @@ namespace SpaceEngine
     GLFWwindow* WindowManager::window = nullptr;
     bool WindowManager::fullScreenState = false;
     GLFWmonitor* WindowManager::monitor = nullptr;
+    uint32_t WindowManager::resolutionGeneration = 0;
+    bool WindowManager::headless = false;
 
     void WindowManager::Initialize()
     {
@@ -59,10 +62,36 @@ namespace SpaceEngine
     bool WindowManager::setUpGLFW()
     {
         SPACE_ENGINE_TRACE("App - set up GLFW");
-        glfwInit();
+        bool surfaceless = false;
+        if(!glfwInit())
+        {
+            //no display (CI machine): null platform with a software context
+            if(!headless || !glfwPlatformSupported(GLFW_PLATFORM_NULL))
+            {
+                SPACE_ENGINE_ERROR("Failed to initialize GLFW");
+                return false;
+            }
+
+            glfwInitHint(GLFW_PLATFORM, GLFW_PLATFORM_NULL);
+            if(!glfwInit())
+            {
+                SPACE_ENGINE_ERROR("Failed to initialize GLFW, null platform");
+                return false;
+            }
+            surfaceless = true;
+        }
         glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
         glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 0);
         glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+#ifdef SPACE_ENGINE_DEBUG_CONFIG
+        glfwWindowHint(GLFW_OPENGL_DEBUG_CONTEXT, GLFW_TRUE);
+#endif
+        if(headless)
+        {
+            glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+            if(surfaceless)
+                glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_OSMESA_CONTEXT_API);
+        }
 
         window = glfwCreateWindow(width, height, "Spaceship", NULL, NULL);
         if(window == nullptr)
@@ -79,6 +108,7 @@ namespace SpaceEngine
             SPACE_ENGINE_ERROR("Failed to initilize OpenGL Context");
             return false;
         }
+        GLDebug::init();
         
         //setup window
         glfwSetWindowSizeLimits(window, SPACE_ENGINE_MIN_RES_W, SPACE_ENGINE_MIN_RES_H, GLFW_DONT_CARE, GLFW_DONT_CARE);
@@ -97,7 +127,7 @@ namespace SpaceEngine
         //set the OpenGL framebuffer
         glEnable(GL_BLEND);
         glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-        SPACE_ENGINE_INFO("WindowManager - GLFW setup done");
+        SPACE_ENGINE_INFO("WindowManager - GLFW setup done{}", headless ? ", headless" : "");
         return true;
     }
 
@@ -126,6 +156,8 @@ namespace SpaceEngine
             glfwSetWindowMonitor(window, monitor, 0, 0, mode->width, mode->height, mode->refreshRate);
             fullScreenState = true;
         }
+
+        resolutionGeneration++;
     }
 
     void WindowManager::Shutdown()
@@ -178,6 +210,7 @@ namespace SpaceEngine
                 static_cast<float>(width),
                 static_cast<float>(height),
                 0.0f);
+            WindowManager::resolutionGeneration++;
             Scene* pScene = SceneManager::GetActiveScene();
             
             if(pScene)pScene->notifyChangeRes();
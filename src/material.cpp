@@ -65,8 +65,14 @@ namespace SpaceEngine
             exit(-1);
         }
 
+        bindingPropsToProgram(*pShader);
+        bindSubroutines();
+    }
+
+    void BaseMaterial::bindingPropsToProgram(ShaderProgram& program)
+    {
         //SPACE_ENGINE_DEBUG("Binding properties material to shader");
-        std::vector<std::tuple<const std::string, GLenum>> uniformsShader = pShader->getPairUniformNameLocation();
+        std::vector<std::tuple<const std::string, GLenum>> uniformsShader = program.getPairUniformNameLocation();
         GL_CHECK_ERRORS();
         
         for(const auto& [name, type] : uniformsShader)
@@ -77,7 +83,7 @@ namespace SpaceEngine
                 {
                     if(compareTypeGL(val, type))
                     {
-                        pShader->setUniform(name.c_str(), val);
+                        program.setUniform(name.c_str(), val);
                         GL_CHECK_ERRORS();
                     }
                 }, props[name]);
@@ -86,15 +92,16 @@ namespace SpaceEngine
             {
                 if(texs[name])
                 {
+                    //the units are fixed when the texture is added, the binds of the textures
+                    //already on their unit are skipped by the state cache
                     texs[name]->bind();
-                    pShader->setUniform(name.c_str(), texs[name]->getTexUnitIndex());
+                    program.setSampler(name.c_str(), texs[name]->getTexUnitIndex());
                     GL_CHECK_ERRORS();
                 }
                 //else {SPACE_ENGINE_WARN("Material: {}, Name uniform texture:{} no texture", this->name, name);}
             }
         }
         GL_CHECK_ERRORS();
-        bindSubroutines();
     }
 
     void BaseMaterial::bindSubroutines()
@@ -119,6 +126,16 @@ namespace SpaceEngine
         return pShader;
     }
 
+    bool BaseMaterial::isTranslucent() const
+    {
+        auto it = props.find("albedo_color_val");
+        if(it == props.end())
+            return false;
+
+        const Vector4* pColor = std::get_if<Vector4>(&it->second);
+        return pColor && pColor->w < 1.f;
+    }
+
     int BaseMaterial::addTexture(const std::string& nameTex, Texture* pTex)
     {
         auto pos = texs.find(nameTex);
@@ -134,7 +151,7 @@ namespace SpaceEngine
         else
         {
             SPACE_ENGINE_WARN("Material: {}, overwrite Texture: {}", name, nameTex);
-            pTex->setTexUnitHandle(pos->second->getTexUnitIndex());
+            pTex->setTexUnitHandle(pos->second->getTexUnitHandle());
             texs[nameTex] = pTex;
             return 2;
         }
@@ -198,26 +215,33 @@ namespace SpaceEngine
     //------------PBR Material-------------//
     //-------------------------------------//
 
-    void PBRMaterial::bindSubroutines()
+    void PBRMaterial::selectVariant()
     {
-        if(texs["albedo_tex"] != nullptr)
-            pShader->setSubroutinesUniform("getAlbedoFromTex", "albedoMode");
-        else pShader->setSubroutinesUniform("getAlbedoFromVal", "albedoMode");
-        if(texs["metalness_tex"] != nullptr)
-            pShader->setSubroutinesUniform("getMetalnessFromTex", "metalnessMode");
-        else pShader->setSubroutinesUniform("getMetalnessFromVal", "metalnessMode");
-        if(texs["roughness_tex"] != nullptr)
-            pShader->setSubroutinesUniform("getRoughnessFromTex", "roughnessMode");
-        else pShader->setSubroutinesUniform("getRoughnessFromVal", "roughnessMode");
-        if(texs["normal_map_tex"] != nullptr)
-            pShader->setSubroutinesUniform("getNormalsFromTex", "normalsMode");
-        else pShader->setSubroutinesUniform("getNormalsFromVal", "normalsMode");
-        if(texs["ambient_occlusion_tex"] != nullptr)
-            pShader->setSubroutinesUniform("getAOFromTex", "AOMode");
-        else pShader->setSubroutinesUniform("getAOFromVal", "AOMode");
-
-        pShader->bindSubroutines();
-        GL_CHECK_ERRORS();
+        pShader = getVariant(nullptr);
+    }
+
+    ShaderProgram* PBRMaterial::getVariant(const char* extraDefine)
+    {
+        //texture -> define of pbr.fs that reads it
+        static const std::pair<const char*, const char*> texDefines[] =
+        {
+            {"albedo_tex", "HAS_ALBEDO_TEX"},
+            {"metalness_tex", "HAS_METALNESS_TEX"},
+            {"roughness_tex", "HAS_ROUGHNESS_TEX"},
+            {"normal_map_tex", "HAS_NORMAL_MAP"},
+            {"ambient_occlusion_tex", "HAS_AO_TEX"}
+        };
+
+        std::vector<std::string> defines;
+        for(const auto& [tex, define] : texDefines)
+        {
+            if(texs[tex] != nullptr)
+                defines.push_back(define);
+        }
+        if(extraDefine)
+            defines.push_back(extraDefine);
+
+        return ShaderManager::getVariant("pbr", defines);
     }
 
 
@@ -236,6 +260,17 @@ namespace SpaceEngine
         subroutines["uiTextureHover"] = {flag, "uiTextureMode"};
     }
 
+    bool UIButtonMaterial::isHovered()
+    {
+        return subroutines["uiTextureHover"].active;
+    }
+
+    Texture* UIButtonMaterial::getHoverTexture()
+    {
+        auto it = texs.find("ui_hover_tex");
+        return it != texs.end() ? it->second : nullptr;
+    }
+
     //-------------------------------------//
     //----------MaterialManager------------//
     //-------------------------------------//
@@ -8,6 +8,8 @@
 
 #include "utils/utils.h"
 #include "texture.h"
+#include "glState.h"
+#include "glDebug.h"
 
 #define ARRAY_SIZE_IN_ELEMENTS(a) (sizeof(a) / sizeof(a[0]))
 #define ASSIMP_LOAD_FLAGS (aiProcess_Triangulate | aiProcess_GenSmoothNormals | \
@@ -16,6 +18,11 @@
 #define POSITION_LOCATION 0
 #define TEX_COORD_LOCATION 1
 #define NORMAL_LOCATION 2
+//mat4 in 4 locations + mat3 in 3 locations
+#define INSTANCE_MODEL_LOCATION 3
+#define INSTANCE_NORMAL_LOCATION 7
+//w of the first column of the normal matrix
+#define INSTANCE_FADE_LOCATION 10
 
 namespace SpaceEngine
 {
@@ -46,28 +53,25 @@ namespace SpaceEngine
             0, 1, 2,
             0, 3, 1};
 
+    //smaller sub meshes are drawn at full detail
+    constexpr uint32_t MinLodIndices = 3 * 64;
+
 
     //---------------------------------------------//
     //-------------------Mesh----------------------//
     //---------------------------------------------//
     void Mesh::clear()
     {
-        if (buffers[0] != 0)
-        {
-            glDeleteBuffers(ARRAY_SIZE_IN_ELEMENTS(buffers), buffers);
-        }
-
-        if (VAO != 0)
+        if (numVertices || numIndices)
         {
-            glDeleteVertexArrays(1, &VAO);
-            VAO = 0;
+            GeometryArena::free(baseVertex, numVertices, firstIndex, numIndices);
+            numVertices = numIndices = 0;
         }
     }
 
     void Mesh::bindVAO()
     {
-        SPACE_ENGINE_ASSERT(VAO, "VAO is not allocated");
-        glBindVertexArray(VAO);
+        GeometryArena::bindVAO();
     }
 
     int Mesh::getNumSubMesh()
@@ -175,16 +179,12 @@ namespace SpaceEngine
         {
             Mesh *pMesh = new Mesh();
             pTMPMesh = pMesh;
-            // VAO
-            glGenVertexArrays(1, &pTMPMesh->VAO);
-            glBindVertexArray(pTMPMesh->VAO);
-            glGenBuffers(ARRAY_SIZE_IN_ELEMENTS(pTMPMesh->buffers), pTMPMesh->buffers);
 
             Assimp::Importer importer;
             std::string fullPath(MESHES_PATH + fileName);
             const aiScene *pScene = importer.ReadFile(fullPath.c_str(), ASSIMP_LOAD_FLAGS);
             pTMPMesh->name = name;
-            auto glError = glGetError();
+            GL_CHECK_ERRORS();
 
             if (pScene)
             {
@@ -218,6 +218,7 @@ namespace SpaceEngine
         reserveSpace(numVertices, numIndices);
 
         initAllMeshes(pScene);
+        buildLods();
 
         if (!initMaterials(pScene, fileName))
         {
@@ -234,12 +235,12 @@ namespace SpaceEngine
         for (unsigned int i = 0; i < pTMPMesh->subMeshes.size(); i++)
         {
             pTMPMesh->subMeshes[i].materialIndex = pScene->mMeshes[i]->mMaterialIndex;
-            pTMPMesh->subMeshes[i].numIndices = pScene->mMeshes[i]->mNumFaces * 3;
+            pTMPMesh->subMeshes[i].lods[0].numIndices = pScene->mMeshes[i]->mNumFaces * 3;
             pTMPMesh->subMeshes[i].baseVertex = numVertices;
-            pTMPMesh->subMeshes[i].baseIndex = numIndices;
+            pTMPMesh->subMeshes[i].lods[0].baseIndex = numIndices;
 
             numVertices += pScene->mMeshes[i]->mNumVertices;
-            numIndices += pTMPMesh->subMeshes[i].numIndices;
+            numIndices += pTMPMesh->subMeshes[i].lods[0].numIndices;
         }
     }
 
@@ -305,6 +306,46 @@ namespace SpaceEngine
         }
     }
 
+    void MeshManager::buildLods()
+    {
+        std::vector<Mesh::MeshEntry>& subMeshes = pTMPMesh->subMeshes;
+        std::vector<Mesh::Vertex>& vertices = pTMPMesh->vertices;
+        std::vector<uint32_t>& indices = pTMPMesh->indices;
+        const float radius = pTMPMesh->getBoundsRadius();
+
+        for (size_t i = 0; i < subMeshes.size(); i++)
+        {
+            Mesh::MeshEntry& entry = subMeshes[i];
+            const Mesh::MeshEntry::Lod& full = entry.lods[0];
+            uint32_t numVertices = (i + 1 < subMeshes.size() ? subMeshes[i + 1].baseVertex : static_cast<uint32_t>(vertices.size())) - entry.baseVertex;
+            //every LOD is simplified from the imported triangles, the quadrics of the LOD 0 are the most accurate
+            std::vector<uint32_t> source(indices.begin() + full.baseIndex, indices.begin() + full.baseIndex + full.numIndices);
+
+            for (uint32_t lod = 1; lod < Mesh::MaxLods; lod++)
+            {
+                uint32_t target = (full.numIndices >> lod) / 3 * 3;
+                if (target < MinLodIndices)
+                    break;
+
+                float error = 0.f;
+                std::vector<uint32_t> lodIndices = simplifyMesh(&vertices[entry.baseVertex], numVertices, source,
+                    target, radius * Mesh::LodError[lod - 1], &error);
+                //the error bound or the seams stopped the collapses, the LOD would draw almost the same triangles
+                if (lodIndices.size() * 10 > entry.lods[lod - 1].numIndices * 9)
+                    break;
+
+                entry.lods[lod].baseIndex = static_cast<uint32_t>(indices.size());
+                entry.lods[lod].numIndices = static_cast<uint32_t>(lodIndices.size());
+                entry.numLods = lod + 1;
+                indices.insert(indices.end(), lodIndices.begin(), lodIndices.end());
+                SPACE_ENGINE_DEBUG("Mesh {} sub mesh {}: LOD {} {} -> {} triangles, error {}", pTMPMesh->name, i, lod,
+                    full.numIndices / 3, lodIndices.size() / 3, error);
+            }
+
+            pTMPMesh->numLods = std::max(pTMPMesh->numLods, entry.numLods);
+        }
+    }
+
     bool MeshManager::initMaterials(const aiScene *pScene, const std::string &fileName)
     {
         std::string dir = TEXTURES_PATH + pTMPMesh->name;
@@ -315,17 +356,19 @@ namespace SpaceEngine
         for (unsigned int i = 0; i < pScene->mNumMaterials; i++)
         {
             const aiMaterial *pMaterial = pScene->mMaterials[i];
-            BaseMaterial *pbrMat = MaterialManager::createMaterial<PBRMaterial>(pTMPMesh->name + std::to_string(i));
-            pbrMat->pShader = ShaderManager::findShaderProgram("pbr"); // TODO: make the biding
+            PBRMaterial *pbrMat = MaterialManager::createMaterial<PBRMaterial>(pTMPMesh->name + std::to_string(i));
+
+            pTMPMesh->materials[i] = pbrMat;
+            loadTextures(dir, pMaterial, pScene, i);
+            loadColors(pMaterial, i);
+
+            //the program depends on the textures found
+            pbrMat->selectVariant();
             if (!pbrMat->pShader)
             {
                 SPACE_ENGINE_FATAL("Shader pbr not compiled")
                 exit(-1);
             }
-
-            pTMPMesh->materials[i] = std::move(pbrMat);
-            loadTextures(dir, pMaterial, pScene, i);
-            loadColors(pMaterial, i);
         }
 
         return true;
@@ -333,21 +376,21 @@ namespace SpaceEngine
 
     void MeshManager::loadTextures(const std::string &dir, const aiMaterial *pMaterial, const aiScene *pScene, int index)
     {
-        auto glError = glGetError();
+        GL_CHECK_ERRORS();
         loadDiffuseTexture(dir, pMaterial, pScene, index); // diffuse and albedo are the same
-        glError = glGetError();
+        GL_CHECK_ERRORS();
         // loadSpecularTexture(dir, pMaterial, pScene, index);
         loadNormalsTexture(dir, pMaterial, pScene, index);
-        glError = glGetError();
+        GL_CHECK_ERRORS();
 
         // PBR
         // loadAlbedoTexture(dir, pMaterial, pScene, index);
         loadMetalnessTexture(dir, pMaterial, pScene, index);
-        glError = glGetError();
+        GL_CHECK_ERRORS();
         loadRoughnessTexture(dir, pMaterial, pScene, index);
-        glError = glGetError();
+        GL_CHECK_ERRORS();
         loadAmbientOcclusionTexture(dir, pMaterial, pScene, index);
-        glError = glGetError();
+        GL_CHECK_ERRORS();
     }
 
     void MeshManager::loadDiffuseTexture(const std::string &dir, const aiMaterial *pMaterial, const aiScene *pScene, int materialIndex)
@@ -611,36 +654,292 @@ namespace SpaceEngine
 
     void Mesh::populateBuffers()
     {
-        glBindBuffer(GL_ARRAY_BUFFER, buffers[VERTEX_BUFFER]);
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffers[INDEX_BUFFER]);
+        if (vertices.empty() || indices.empty())
+            return;
 
-        glBufferData(GL_ARRAY_BUFFER, sizeof(vertices[0]) * vertices.size(), &vertices[0], GL_STATIC_DRAW);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices[0]) * indices.size(), &indices[0], GL_STATIC_DRAW);
+        GeometryArena::allocate(vertices, indices, baseVertex, firstIndex);
+        numVertices = static_cast<uint32_t>(vertices.size());
+        numIndices = static_cast<uint32_t>(indices.size());
 
-        size_t NumFloats = 0;
+        //the data lives on the GPU
+        vertices = std::vector<Vertex>();
+        indices = std::vector<uint32_t>();
+    }
 
-        glEnableVertexAttribArray(POSITION_LOCATION);
-        glVertexAttribPointer(POSITION_LOCATION, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (const void *)(NumFloats * sizeof(float)));
-        NumFloats += 3;
+    void Mesh::drawSubMesh(unsigned int idSubMesh, uint32_t lod)
+    {
+        DrawElementsIndirectCommand cmd = getDrawCommand(idSubMesh, lod);
+        glDrawElementsBaseVertex(GL_TRIANGLES,
+                                 cmd.count,
+                                 GL_UNSIGNED_INT,
+                                 (void *)(sizeof(unsigned int) * cmd.firstIndex),
+                                 cmd.baseVertex);
+    }
 
-        glEnableVertexAttribArray(TEX_COORD_LOCATION);
-        glVertexAttribPointer(TEX_COORD_LOCATION, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (const void *)(NumFloats * sizeof(float)));
-        NumFloats += 2;
+    DrawElementsIndirectCommand Mesh::getDrawCommand(unsigned int idSubMesh, uint32_t lod) const
+    {
+        const MeshEntry& entry = subMeshes[idSubMesh];
+        const MeshEntry::Lod& range = entry.lods[std::min(lod, entry.numLods - 1)];
+
+        return {.count = range.numIndices,
+                .instanceCount = 1,
+                .firstIndex = firstIndex + range.baseIndex,
+                .baseVertex = static_cast<GLint>(baseVertex + entry.baseVertex),
+                .baseInstance = 0};
+    }
+
+    uint32_t Mesh::selectLod(float coverage, uint32_t current) const
+    {
+        uint32_t lod = 0;
+        while (lod + 1 < numLods && coverage < LodCoverage[lod])
+            lod++;
+
+        //inside the band around the threshold of the current LOD the object keeps it
+        current = std::min(current, numLods - 1);
+        if (lod > current && coverage > LodCoverage[current] * (1.f - LodHysteresis))
+            return current;
+        if (lod < current && coverage < LodCoverage[current - 1] * (1.f + LodHysteresis))
+            return current;
+
+        return lod;
+    }
+
+    //------------------------------------------//
+    //--------------RangeAllocator--------------//
+    //------------------------------------------//
 
+    void RangeAllocator::reset(uint32_t capacity)
+    {
+        m_free.clear();
+        m_capacity = capacity;
+        if (capacity)
+            m_free.push_back({0, capacity});
+    }
+
+    bool RangeAllocator::allocate(uint32_t count, uint32_t& offset)
+    {
+        for (auto it = m_free.begin(); it != m_free.end(); ++it)
+        {
+            if (it->count < count)
+                continue;
+
+            offset = it->offset;
+            it->offset += count;
+            it->count -= count;
+            if (!it->count)
+                m_free.erase(it);
+
+            return true;
+        }
+
+        return false;
+    }
+
+    void RangeAllocator::free(uint32_t offset, uint32_t count)
+    {
+        if (!count)
+            return;
+
+        auto it = std::lower_bound(m_free.begin(), m_free.end(), offset,
+            [](const Range& range, uint32_t value) { return range.offset < value; });
+        it = m_free.insert(it, {offset, count});
+
+        //merge with the next and the previous one
+        if (it + 1 != m_free.end() && it->offset + it->count == (it + 1)->offset)
+        {
+            it->count += (it + 1)->count;
+            m_free.erase(it + 1);
+        }
+
+        if (it != m_free.begin() && (it - 1)->offset + (it - 1)->count == it->offset)
+        {
+            (it - 1)->count += it->count;
+            m_free.erase(it);
+        }
+    }
+
+    void RangeAllocator::grow(uint32_t capacity)
+    {
+        if (capacity <= m_capacity)
+            return;
+
+        uint32_t oldCapacity = m_capacity;
+        m_capacity = capacity;
+        free(oldCapacity, capacity - oldCapacity);
+    }
+
+    //------------------------------------------//
+    //--------------GeometryArena---------------//
+    //------------------------------------------//
+
+    GLuint GeometryArena::m_VAO = 0;
+    GLuint GeometryArena::m_vertexBuffer = 0;
+    GLuint GeometryArena::m_indexBuffer = 0;
+    RangeAllocator GeometryArena::m_vertices;
+    RangeAllocator GeometryArena::m_indices;
+
+    void GeometryArena::init()
+    {
+        glGenVertexArrays(1, &m_VAO);
+        m_vertexBuffer = createBuffer(sizeof(MeshVertex) * InitialVertices, "arena vertices");
+        m_indexBuffer = createBuffer(sizeof(uint32_t) * InitialIndices, "arena indices");
+
+        m_vertices.reset(InitialVertices);
+        m_indices.reset(InitialIndices);
+        bindVertexAttribs();
+        GL_CHECK_ERRORS();
+    }
+
+    void GeometryArena::bindVertexAttribs()
+    {
+        GLStateCache::bindVertexArray(m_VAO);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_indexBuffer);
+        glBindBuffer(GL_ARRAY_BUFFER, m_vertexBuffer);
+
+        glEnableVertexAttribArray(POSITION_LOCATION);
+        glVertexAttribPointer(POSITION_LOCATION, 3, GL_FLOAT, GL_FALSE, sizeof(MeshVertex), (const void *)offsetof(MeshVertex, position));
+        glEnableVertexAttribArray(TEX_COORD_LOCATION);
+        glVertexAttribPointer(TEX_COORD_LOCATION, 2, GL_FLOAT, GL_FALSE, sizeof(MeshVertex), (const void *)offsetof(MeshVertex, texCoords));
         glEnableVertexAttribArray(NORMAL_LOCATION);
-        glVertexAttribPointer(NORMAL_LOCATION, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (const void *)(NumFloats * sizeof(float)));
+        glVertexAttribPointer(NORMAL_LOCATION, 3, GL_FLOAT, GL_FALSE, sizeof(MeshVertex), (const void *)offsetof(MeshVertex, normal));
+
+        //the instanced attributes are enabled when they get a buffer
+        for (GLuint i = 0; i < 4; i++)
+            glVertexAttribDivisor(INSTANCE_MODEL_LOCATION + i, 1);
+        for (GLuint i = 0; i < 3; i++)
+            glVertexAttribDivisor(INSTANCE_NORMAL_LOCATION + i, 1);
+        glVertexAttribDivisor(INSTANCE_FADE_LOCATION, 1);
+
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
     }
 
-    void Mesh::drawSubMesh(unsigned int idSubMesh)
+    GLuint GeometryArena::createBuffer(GLsizeiptr size, const char* label)
     {
-        glDrawElementsBaseVertex(GL_TRIANGLES,
-                                 subMeshes[idSubMesh].numIndices,
-                                 GL_UNSIGNED_INT,
-                                 (void *)(sizeof(unsigned int) * (subMeshes[idSubMesh].baseIndex)),
-                                 subMeshes[idSubMesh].baseVertex);
+        //immutable: the meshes are written with the sub data uploads, a growth copies in a new buffer
+        GLuint buffer = 0;
+        if (GLStateCache::hasDirectStateAccess())
+        {
+            glCreateBuffers(1, &buffer);
+            glNamedBufferStorage(buffer, size, nullptr, GL_DYNAMIC_STORAGE_BIT);
+        }
+        else
+        {
+            glGenBuffers(1, &buffer);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+            if (glBufferStorage)
+                glBufferStorage(GL_COPY_WRITE_BUFFER, size, nullptr, GL_DYNAMIC_STORAGE_BIT);
+            else
+                glBufferData(GL_COPY_WRITE_BUFFER, size, nullptr, GL_STATIC_DRAW);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        }
+
+        GLDebug::label(GL_BUFFER, buffer, label);
+        return buffer;
+    }
+
+    void GeometryArena::growBuffer(GLuint& buffer, GLsizeiptr oldSize, GLsizeiptr newSize, const char* label)
+    {
+        GLuint newBuffer = createBuffer(newSize, label);
+        if (GLStateCache::hasDirectStateAccess())
+            glCopyNamedBufferSubData(buffer, newBuffer, 0, 0, oldSize);
+        else
+        {
+            glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, newBuffer);
+            glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, oldSize);
+            glBindBuffer(GL_COPY_READ_BUFFER, 0);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        }
+
+        glDeleteBuffers(1, &buffer);
+        buffer = newBuffer;
+    }
+
+    void GeometryArena::allocate(const std::vector<MeshVertex>& vertices, const std::vector<uint32_t>& indices,
+        uint32_t& baseVertex, uint32_t& firstIndex)
+    {
+        if (!m_VAO)
+            init();
+
+        const uint32_t numVertices = static_cast<uint32_t>(vertices.size());
+        const uint32_t numIndices = static_cast<uint32_t>(indices.size());
+        bool grown = false;
+
+        while (!m_vertices.allocate(numVertices, baseVertex))
+        {
+            uint32_t capacity = m_vertices.getCapacity();
+            growBuffer(m_vertexBuffer, sizeof(MeshVertex) * capacity, sizeof(MeshVertex) * capacity * 2, "arena vertices");
+            m_vertices.grow(capacity * 2);
+            grown = true;
+        }
+
+        while (!m_indices.allocate(numIndices, firstIndex))
+        {
+            uint32_t capacity = m_indices.getCapacity();
+            growBuffer(m_indexBuffer, sizeof(uint32_t) * capacity, sizeof(uint32_t) * capacity * 2, "arena indices");
+            m_indices.grow(capacity * 2);
+            grown = true;
+        }
+
+        if (grown)
+        {
+            SPACE_ENGINE_INFO("GeometryArena grown to {} vertices, {} indices", m_vertices.getCapacity(), m_indices.getCapacity());
+            bindVertexAttribs();
+        }
+
+        if (GLStateCache::hasDirectStateAccess())
+        {
+            glNamedBufferSubData(m_vertexBuffer, sizeof(MeshVertex) * baseVertex, sizeof(MeshVertex) * numVertices, vertices.data());
+            glNamedBufferSubData(m_indexBuffer, sizeof(uint32_t) * firstIndex, sizeof(uint32_t) * numIndices, indices.data());
+        }
+        else
+        {
+            //the copy target doesn't touch the element buffer of the bound vertex array
+            glBindBuffer(GL_COPY_WRITE_BUFFER, m_vertexBuffer);
+            glBufferSubData(GL_COPY_WRITE_BUFFER, sizeof(MeshVertex) * baseVertex, sizeof(MeshVertex) * numVertices, vertices.data());
+            glBindBuffer(GL_COPY_WRITE_BUFFER, m_indexBuffer);
+            glBufferSubData(GL_COPY_WRITE_BUFFER, sizeof(uint32_t) * firstIndex, sizeof(uint32_t) * numIndices, indices.data());
+            glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        }
+        GL_CHECK_ERRORS();
+    }
+
+    void GeometryArena::free(uint32_t baseVertex, uint32_t numVertices, uint32_t firstIndex, uint32_t numIndices)
+    {
+        m_vertices.free(baseVertex, numVertices);
+        m_indices.free(firstIndex, numIndices);
+    }
+
+    void GeometryArena::bindVAO()
+    {
+        if (!m_VAO)
+            init();
 
-        // Make sure the VAO is not changed from the outside
-        glBindVertexArray(0);
+        GLStateCache::bindVertexArray(m_VAO);
+    }
+
+    void GeometryArena::setInstanceBuffer(GLuint buffer, GLintptr offset)
+    {
+        GLStateCache::bindVertexArray(m_VAO);
+        glBindBuffer(GL_ARRAY_BUFFER, buffer);
+
+        for (GLuint i = 0; i < 4; i++)
+        {
+            glEnableVertexAttribArray(INSTANCE_MODEL_LOCATION + i);
+            glVertexAttribPointer(INSTANCE_MODEL_LOCATION + i, 4, GL_FLOAT, GL_FALSE, sizeof(MeshInstance),
+                (const void *)(offset + offsetof(MeshInstance, model) + sizeof(Vector4) * i));
+        }
+        for (GLuint i = 0; i < 3; i++)
+        {
+            glEnableVertexAttribArray(INSTANCE_NORMAL_LOCATION + i);
+            glVertexAttribPointer(INSTANCE_NORMAL_LOCATION + i, 3, GL_FLOAT, GL_FALSE, sizeof(MeshInstance),
+                (const void *)(offset + offsetof(MeshInstance, normalMatrix) + sizeof(Vector4) * i));
+        }
+        glEnableVertexAttribArray(INSTANCE_FADE_LOCATION);
+        glVertexAttribPointer(INSTANCE_FADE_LOCATION, 1, GL_FLOAT, GL_FALSE, sizeof(MeshInstance),
+            (const void *)(offset + offsetof(MeshInstance, normalMatrix) + sizeof(float) * 3));
+
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
     }
 
     //------------------------------------------//
@@ -650,8 +949,16 @@ namespace SpaceEngine
     UIMesh::UIMesh()
     {
         glGenVertexArrays(1, &VAO);
-        glBindVertexArray(VAO);
-        glGenBuffers(2, buffers);
+        GLStateCache::bindVertexArray(VAO);
+        //the quad never changes: immutable storage with DSA, filled in populateBuffers in GL 4.0
+        if (GLStateCache::hasDirectStateAccess())
+        {
+            glCreateBuffers(2, buffers);
+            glNamedBufferStorage(buffers[0], sizeof(UIQuad), UIQuad, 0);
+            glNamedBufferStorage(buffers[1], sizeof(UIindices), UIindices, 0);
+        }
+        else
+            glGenBuffers(2, buffers);
         populateBuffers();
     }
 
@@ -660,8 +967,11 @@ namespace SpaceEngine
         glBindBuffer(GL_ARRAY_BUFFER, buffers[0]);         // ok
         glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffers[1]); // ok
 
-        glBufferData(GL_ARRAY_BUFFER, sizeof(UIQuad), UIQuad, GL_STATIC_DRAW);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(UIindices), UIindices, GL_STATIC_DRAW);
+        if (!GLStateCache::hasDirectStateAccess())
+        {
+            glBufferData(GL_ARRAY_BUFFER, sizeof(UIQuad), UIQuad, GL_STATIC_DRAW);
+            glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(UIindices), UIindices, GL_STATIC_DRAW);
+        }
 
         size_t NumFloats = 0;
 
@@ -680,13 +990,11 @@ namespace SpaceEngine
                        GL_UNSIGNED_INT,
                        0);
         GL_CHECK_ERRORS();
-        // Make sure the VAO is not changed from the outside
-        glBindVertexArray(0);
     }
 
     void UIMesh::bindVAO()
     {
-        glBindVertexArray(VAO);
+        GLStateCache::bindVertexArray(VAO);
     }
 
     //------------------------------------------//
@@ -729,39 +1037,97 @@ namespace SpaceEngine
     //---------------------------------------------//
     //-------------------TextMesh------------------//
     //---------------------------------------------//
+    StreamBuffer TextMesh::stream;
+    uint32_t TextMesh::numMeshes = 0;
+
     TextMesh::TextMesh()
     {
+        if (!numMeshes++)
+        {
+            //room for ~1000 changed characters a frame, it grows when needed
+            stream.init(GL_COPY_READ_BUFFER, sizeof(float) * 4 * 6 * 1024, "text quads");
+        }
+
         glGenVertexArrays(1, &VAO);
-        glBindVertexArray(VAO);
+        GLStateCache::bindVertexArray(VAO);
         glGenBuffers(1, &buffer);
         populateBuffers();
     }
 
+    TextMesh::~TextMesh()
+    {
+        glDeleteBuffers(1, &buffer);
+        GLStateCache::onDeleteVertexArray(VAO);
+        glDeleteVertexArrays(1, &VAO);
+
+        if (!--numMeshes)
+            stream.destroy();
+    }
+
     void TextMesh::populateBuffers()
     {
+        //room for 64 characters, it grows in subData
+        m_capacity = sizeof(float) * 4 * 6 * 64;
         glBindBuffer(GL_ARRAY_BUFFER, buffer);
-        glBufferData(GL_ARRAY_BUFFER, sizeof(float) * 6 * 4, nullptr, GL_DYNAMIC_DRAW);
+        glBufferData(GL_ARRAY_BUFFER, m_capacity, nullptr, GL_DYNAMIC_DRAW);
         glEnableVertexAttribArray(0);
         glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(float), 0);
         glBindBuffer(GL_ARRAY_BUFFER, 0);
-        glBindVertexArray(0);
+        GLDebug::label(GL_BUFFER, buffer, "text");
+    }
+
+    void TextMesh::beginFrame()
+    {
+        stream.beginFrame();
+    }
+
+    void TextMesh::endFrame()
+    {
+        stream.endFrame();
     }
 
     void TextMesh::draw()
     {
-        glDrawArrays(GL_TRIANGLES, 0, 6);
+        if (m_numVertices)
+            glDrawArrays(GL_TRIANGLES, 0, m_numVertices);
     }
 
     void TextMesh::bindVAO()
     {
-        glBindVertexArray(VAO);
+        GLStateCache::bindVertexArray(VAO);
     }
 
-    void TextMesh::subData(const std::array<std::array<float, 4>, 6>& vertices)
+    void TextMesh::subData(const std::vector<std::array<float, 4>>& vertices)
     {
-        glBindBuffer(GL_ARRAY_BUFFER, buffer);
-        glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(float)*4*6, vertices.data());
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        constexpr GLsizeiptr stride = sizeof(vertices[0]);
+        GLsizeiptr size = stride * static_cast<GLsizeiptr>(vertices.size());
+        m_numVertices = static_cast<GLsizei>(vertices.size());
+
+        if (!size)
+            return;
+
+        //a bigger store orphans the old one, the draws of the previous frames keep reading it
+        if (m_capacity < size)
+        {
+            while (m_capacity < size)
+                m_capacity *= 2;
+            glBindBuffer(GL_ARRAY_BUFFER, buffer);
+            glBufferData(GL_ARRAY_BUFFER, m_capacity, nullptr, GL_DYNAMIC_DRAW);
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+        }
+
+        //the copy is ordered after the draws still reading the buffer, the CPU never waits them
+        GLintptr offset = stream.upload(vertices.data(), size, stride);
+        if (GLStateCache::hasDirectStateAccess())
+            glCopyNamedBufferSubData(stream.getBuffer(), buffer, offset, 0, size);
+        else
+        {
+            glBindBuffer(GL_COPY_READ_BUFFER, stream.getBuffer());
+            glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+            glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, offset, 0, size);
+            glBindBuffer(GL_COPY_READ_BUFFER, 0);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        }
         GL_CHECK_ERRORS();
     }
 
@@ -770,7 +1136,12 @@ namespace SpaceEngine
     //---------------------------------------------//
     TextMeshRenderer::TextMeshRenderer()
     {
-        pMesh = MeshManager::getTextMesh();
+        pMesh = new TextMesh();
+    }
+
+    TextMeshRenderer::~TextMeshRenderer()
+    {
+        delete pMesh;
     }
 
 
@@ -803,8 +1174,16 @@ namespace SpaceEngine
     PlaneMesh::PlaneMesh()
     {
         glGenVertexArrays(1, &VAO);
-        glBindVertexArray(VAO);
-        glGenBuffers(2, buffers);
+        GLStateCache::bindVertexArray(VAO);
+        //the quad never changes: immutable storage with DSA, filled in populateBuffers in GL 4.0
+        if (GLStateCache::hasDirectStateAccess())
+        {
+            glCreateBuffers(2, buffers);
+            glNamedBufferStorage(buffers[0], sizeof(plane), plane, 0);
+            glNamedBufferStorage(buffers[1], sizeof(UIindices), UIindices, 0);
+        }
+        else
+            glGenBuffers(2, buffers);
         populateBuffers();
     }
     void PlaneMesh::draw()
@@ -814,20 +1193,21 @@ namespace SpaceEngine
                        GL_UNSIGNED_INT,
                        0);
         GL_CHECK_ERRORS();
-        // Make sure the VAO is not changed from the outside
-        glBindVertexArray(0);
     }
     void PlaneMesh::bindVAO()
     {
-        glBindVertexArray(VAO);
+        GLStateCache::bindVertexArray(VAO);
     }
     void PlaneMesh::populateBuffers()
     {
         glBindBuffer(GL_ARRAY_BUFFER, buffers[0]);        
         glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffers[1]);
 
-        glBufferData(GL_ARRAY_BUFFER, sizeof(plane), plane, GL_STATIC_DRAW);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(UIindices), UIindices, GL_STATIC_DRAW);
+        if (!GLStateCache::hasDirectStateAccess())
+        {
+            glBufferData(GL_ARRAY_BUFFER, sizeof(plane), plane, GL_STATIC_DRAW);
+            glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(UIindices), UIindices, GL_STATIC_DRAW);
+        }
 
         size_t NumFloats = 0;
 
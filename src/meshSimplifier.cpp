@@ -0,0 +1,257 @@
+#include "mesh.h"
+
+#include <algorithm>
+#include <cmath>
+#include <queue>
+#include <unordered_map>
+
+namespace SpaceEngine
+{
+    namespace
+    {
+        //sum of the squared distances from planes, weighted by the area of their triangles:
+        //the symmetric 4x4 matrix is kept as its upper triangle
+        struct Quadric
+        {
+            double a00 = 0.0, a01 = 0.0, a02 = 0.0, a03 = 0.0;
+            double a11 = 0.0, a12 = 0.0, a13 = 0.0;
+            double a22 = 0.0, a23 = 0.0;
+            double a33 = 0.0;
+            double weight = 0.0;
+
+            //plane ax + by + cz + d = 0 with a unit normal
+            void addPlane(double a, double b, double c, double d, double w)
+            {
+                a00 += w * a * a; a01 += w * a * b; a02 += w * a * c; a03 += w * a * d;
+                a11 += w * b * b; a12 += w * b * c; a13 += w * b * d;
+                a22 += w * c * c; a23 += w * c * d;
+                a33 += w * d * d;
+                weight += w;
+            }
+
+            void add(const Quadric& q)
+            {
+                a00 += q.a00; a01 += q.a01; a02 += q.a02; a03 += q.a03;
+                a11 += q.a11; a12 += q.a12; a13 += q.a13;
+                a22 += q.a22; a23 += q.a23;
+                a33 += q.a33;
+                weight += q.weight;
+            }
+
+            //mean squared distance of p from the planes
+            double error(const Vector3& p) const
+            {
+                const double x = p.x, y = p.y, z = p.z;
+                double e = a00 * x * x + 2.0 * (a01 * x * y + a02 * x * z + a03 * x)
+                         + a11 * y * y + 2.0 * (a12 * y * z + a13 * y)
+                         + a22 * z * z + 2.0 * a23 * z
+                         + a33;
+                return weight > 0.0 ? std::max(e, 0.0) / weight : 0.0;
+            }
+        };
+
+        struct Collapse
+        {
+            double error;
+            uint32_t from;
+            uint32_t to;
+            //versions of the quadrics the error was computed with
+            uint32_t fromVersion;
+            uint32_t toVersion;
+
+            bool operator>(const Collapse& other) const { return error > other.error; }
+        };
+
+        inline uint64_t edgeKey(uint32_t a, uint32_t b)
+        {
+            return a < b ? (uint64_t(a) << 32) | b : (uint64_t(b) << 32) | a;
+        }
+
+        inline Vector3 triangleNormal(const Vector3& p0, const Vector3& p1, const Vector3& p2)
+        {
+            return glm::cross(p1 - p0, p2 - p0);
+        }
+    }
+
+    std::vector<uint32_t> simplifyMesh(const MeshVertex* pVertices, uint32_t numVertices, const std::vector<uint32_t>& indices,
+        uint32_t targetIndices, float maxError, float* pResultError)
+    {
+        if (pResultError)
+            *pResultError = 0.f;
+
+        const uint32_t numTriangles = static_cast<uint32_t>(indices.size() / 3);
+        std::vector<uint32_t> triangles(indices.begin(), indices.begin() + numTriangles * 3);
+        std::vector<uint8_t> removed(numTriangles, 0);
+        std::vector<std::vector<uint32_t>> vertexTriangles(numVertices);
+        std::vector<Quadric> quadrics(numVertices);
+        std::vector<uint32_t> versions(numVertices, 0);
+        std::vector<uint8_t> locked(numVertices, 0);
+        std::vector<uint8_t> collapsed(numVertices, 0);
+
+        //the UV seams are split in different vertices by the importer, their edges are borders of the index topology
+        std::unordered_map<uint64_t, uint32_t> edgeUses;
+        edgeUses.reserve(triangles.size());
+        for (uint32_t t = 0; t < numTriangles; t++)
+        {
+            const uint32_t* tri = &triangles[t * 3];
+            for (int e = 0; e < 3; e++)
+            {
+                vertexTriangles[tri[e]].push_back(t);
+                edgeUses[edgeKey(tri[e], tri[(e + 1) % 3])]++;
+            }
+
+            Vector3 n = triangleNormal(pVertices[tri[0]].position, pVertices[tri[1]].position, pVertices[tri[2]].position);
+            double area2 = glm::length(n);
+            if (area2 <= 0.0)
+                continue;
+
+            n /= static_cast<float>(area2);
+            double d = -glm::dot(n, pVertices[tri[0]].position);
+            for (int v = 0; v < 3; v++)
+                quadrics[tri[v]].addPlane(n.x, n.y, n.z, d, area2 * 0.5);
+        }
+
+        //borders and non manifold edges
+        for (const auto& [key, uses] : edgeUses)
+        {
+            if (uses != 2)
+            {
+                locked[static_cast<uint32_t>(key >> 32)] = 1;
+                locked[static_cast<uint32_t>(key & 0xFFFFFFFF)] = 1;
+            }
+        }
+
+        std::priority_queue<Collapse, std::vector<Collapse>, std::greater<Collapse>> queue;
+        auto pushCollapse = [&](uint32_t from, uint32_t to)
+        {
+            if (locked[from])
+                return;
+
+            Quadric q = quadrics[from];
+            q.add(quadrics[to]);
+            queue.push({q.error(pVertices[to].position), from, to, versions[from], versions[to]});
+        };
+
+        for (const auto& [key, uses] : edgeUses)
+        {
+            uint32_t a = static_cast<uint32_t>(key >> 32);
+            uint32_t b = static_cast<uint32_t>(key & 0xFFFFFFFF);
+            pushCollapse(a, b);
+            pushCollapse(b, a);
+        }
+
+        const double maxError2 = static_cast<double>(maxError) * maxError;
+        double resultError = 0.0;
+        uint32_t liveTriangles = numTriangles;
+
+        while (liveTriangles * 3 > targetIndices && !queue.empty())
+        {
+            Collapse collapse = queue.top();
+            queue.pop();
+
+            if (collapsed[collapse.from] || collapsed[collapse.to])
+                continue;
+
+            //one of the two moved since the push
+            if (collapse.fromVersion != versions[collapse.from] || collapse.toVersion != versions[collapse.to])
+            {
+                pushCollapse(collapse.from, collapse.to);
+                continue;
+            }
+
+            if (collapse.error > maxError2)
+                break;
+
+            //the edge has to be still there and the triangles around from must not flip
+            bool adjacent = false;
+            bool flips = false;
+            const Vector3& target = pVertices[collapse.to].position;
+            for (uint32_t t : vertexTriangles[collapse.from])
+            {
+                if (removed[t])
+                    continue;
+
+                const uint32_t* tri = &triangles[t * 3];
+                if (tri[0] == collapse.to || tri[1] == collapse.to || tri[2] == collapse.to)
+                {
+                    adjacent = true;
+                    continue;
+                }
+
+                Vector3 p[3];
+                Vector3 moved[3];
+                for (int v = 0; v < 3; v++)
+                {
+                    p[v] = pVertices[tri[v]].position;
+                    moved[v] = tri[v] == collapse.from ? target : p[v];
+                }
+
+                if (glm::dot(triangleNormal(p[0], p[1], p[2]), triangleNormal(moved[0], moved[1], moved[2])) <= 0.f)
+                {
+                    flips = true;
+                    break;
+                }
+            }
+
+            if (!adjacent || flips)
+                continue;
+
+            //the triangles on the edge disappear, the others move on to
+            for (uint32_t t : vertexTriangles[collapse.from])
+            {
+                if (removed[t])
+                    continue;
+
+                uint32_t* tri = &triangles[t * 3];
+                if (tri[0] == collapse.to || tri[1] == collapse.to || tri[2] == collapse.to)
+                {
+                    removed[t] = 1;
+                    liveTriangles--;
+                    continue;
+                }
+
+                for (int v = 0; v < 3; v++)
+                {
+                    if (tri[v] == collapse.from)
+                        tri[v] = collapse.to;
+                }
+                vertexTriangles[collapse.to].push_back(t);
+            }
+
+            collapsed[collapse.from] = 1;
+            vertexTriangles[collapse.from].clear();
+            quadrics[collapse.to].add(quadrics[collapse.from]);
+            versions[collapse.to]++;
+            resultError = std::max(resultError, collapse.error);
+
+            for (uint32_t t : vertexTriangles[collapse.to])
+            {
+                if (removed[t])
+                    continue;
+
+                const uint32_t* tri = &triangles[t * 3];
+                for (int v = 0; v < 3; v++)
+                {
+                    if (tri[v] != collapse.to)
+                    {
+                        pushCollapse(tri[v], collapse.to);
+                        pushCollapse(collapse.to, tri[v]);
+                    }
+                }
+            }
+        }
+
+        std::vector<uint32_t> result;
+        result.reserve(liveTriangles * 3);
+        for (uint32_t t = 0; t < numTriangles; t++)
+        {
+            if (!removed[t])
+                result.insert(result.end(), triangles.begin() + t * 3, triangles.begin() + t * 3 + 3);
+        }
+
+        if (pResultError)
+            *pResultError = static_cast<float>(std::sqrt(resultError));
+
+        return result;
+    }
+}
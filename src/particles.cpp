@@ -0,0 +1,370 @@
+#include "particles.h"
+#include "log.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #define SPACE_ENGINE_SSE 1
+    #include <emmintrin.h>
+#else
+    #define SPACE_ENGINE_SSE 0
+#endif
+
+namespace SpaceEngine
+{
+    //------------------------------------------------------//
+    //---------------------ParticlePool---------------------//
+    //------------------------------------------------------//
+    void ParticlePool::init(uint32_t capacity)
+    {
+        for(std::vector<float>* pArray : {&posX, &posY, &posZ, &velX, &velY, &velZ, &age, &life, &drag})
+            pArray->assign(capacity, 0.f);
+        style.assign(capacity, 0);
+        m_count = 0;
+    }
+
+    bool ParticlePool::emit(const Vector3& pos, const Vector3& vel, float lifeTime, float dragFactor, uint16_t idStyle)
+    {
+        if(m_count >= getCapacity())
+            return false;
+
+        const uint32_t i = m_count++;
+        posX[i] = pos.x;
+        posY[i] = pos.y;
+        posZ[i] = pos.z;
+        velX[i] = vel.x;
+        velY[i] = vel.y;
+        velZ[i] = vel.z;
+        age[i] = 0.f;
+        life[i] = lifeTime;
+        drag[i] = dragFactor;
+        style[i] = idStyle;
+        return true;
+    }
+
+    uint32_t ParticlePool::simulate(float dt)
+    {
+        uint32_t i = 0;
+
+        #if SPACE_ENGINE_SSE
+        const __m128 step = _mm_set1_ps(dt);
+        const __m128 one = _mm_set1_ps(1.f);
+        const __m128 zero = _mm_setzero_ps();
+        for(; i + 4 <= m_count; i += 4)
+        {
+            //linear drag, clamped so the particles don't go backwards
+            __m128 damp = _mm_max_ps(_mm_sub_ps(one, _mm_mul_ps(_mm_loadu_ps(&drag[i]), step)), zero);
+            __m128 vx = _mm_mul_ps(_mm_loadu_ps(&velX[i]), damp);
+            __m128 vy = _mm_mul_ps(_mm_loadu_ps(&velY[i]), damp);
+            __m128 vz = _mm_mul_ps(_mm_loadu_ps(&velZ[i]), damp);
+            _mm_storeu_ps(&velX[i], vx);
+            _mm_storeu_ps(&velY[i], vy);
+            _mm_storeu_ps(&velZ[i], vz);
+            _mm_storeu_ps(&posX[i], _mm_add_ps(_mm_loadu_ps(&posX[i]), _mm_mul_ps(vx, step)));
+            _mm_storeu_ps(&posY[i], _mm_add_ps(_mm_loadu_ps(&posY[i]), _mm_mul_ps(vy, step)));
+            _mm_storeu_ps(&posZ[i], _mm_add_ps(_mm_loadu_ps(&posZ[i]), _mm_mul_ps(vz, step)));
+            _mm_storeu_ps(&age[i], _mm_add_ps(_mm_loadu_ps(&age[i]), step));
+        }
+        #endif
+
+        for(; i < m_count; i++)
+        {
+            float damp = std::max(1.f - drag[i] * dt, 0.f);
+            velX[i] *= damp;
+            velY[i] *= damp;
+            velZ[i] *= damp;
+            posX[i] += velX[i] * dt;
+            posY[i] += velY[i] * dt;
+            posZ[i] += velZ[i] * dt;
+            age[i] += dt;
+        }
+
+        //the last particle takes the place of the dead one
+        uint32_t dead = 0;
+        for(i = 0; i < m_count;)
+        {
+            if(age[i] < life[i])
+            {
+                i++;
+                continue;
+            }
+
+            const uint32_t last = --m_count;
+            posX[i] = posX[last];
+            posY[i] = posY[last];
+            posZ[i] = posZ[last];
+            velX[i] = velX[last];
+            velY[i] = velY[last];
+            velZ[i] = velZ[last];
+            age[i] = age[last];
+            life[i] = life[last];
+            drag[i] = drag[last];
+            style[i] = style[last];
+            dead++;
+        }
+
+        return dead;
+    }
+
+    //------------------------------------------------------//
+    //--------------------ParticleSystem--------------------//
+    //------------------------------------------------------//
+    ParticlePool ParticleSystem::m_pool;
+    std::vector<ParticleEmitter*> ParticleSystem::m_emitters;
+    std::vector<ParticleSystem::ParticleStyle> ParticleSystem::m_styles;
+    std::vector<ParticleMaterial*> ParticleSystem::m_materials;
+    std::vector<ParticleInstance> ParticleSystem::m_instances;
+    std::vector<ParticleBatch> ParticleSystem::m_batches;
+    uint32_t ParticleSystem::m_budget = ParticleSystem::DefaultBudget;
+    ParticleStats ParticleSystem::m_stats;
+    ParticleStats ParticleSystem::m_lastStats;
+    uint32_t ParticleSystem::m_random = 1;
+
+    //used by the descriptors without a material
+    static ParticleMaterial DefaultMaterial;
+
+    void ParticleSystem::init(uint32_t capacity)
+    {
+        m_pool.init(capacity);
+        m_budget = std::min(DefaultBudget, capacity);
+        m_instances.reserve(capacity);
+        m_stats = ParticleStats();
+        m_lastStats = ParticleStats();
+        //same effects at every run
+        m_random = 0x9E3779B9u;
+    }
+
+    void ParticleSystem::shutdown()
+    {
+        for(ParticleEmitter* pEmitter : m_emitters)
+            delete pEmitter;
+        m_emitters.clear();
+        m_styles.clear();
+        m_materials.clear();
+        m_pool.init(0);
+        clear();
+    }
+
+    void ParticleSystem::clear()
+    {
+        m_pool.clear();
+        m_instances.clear();
+        m_batches.clear();
+    }
+
+    void ParticleSystem::setBudget(uint32_t budget)
+    {
+        m_budget = std::min(budget, m_pool.getCapacity());
+    }
+
+    float ParticleSystem::random()
+    {
+        m_random ^= m_random << 13;
+        m_random ^= m_random >> 17;
+        m_random ^= m_random << 5;
+        //24 bits of mantissa
+        return static_cast<float>(m_random >> 8) * (1.f / 16777216.f);
+    }
+
+    uint16_t ParticleSystem::findStyle(const ParticleEmitterDesc& desc)
+    {
+        ParticleMaterial* pMaterial = desc.pMaterial ? desc.pMaterial : &DefaultMaterial;
+        auto itMat = std::find(m_materials.begin(), m_materials.end(), pMaterial);
+        if(itMat == m_materials.end())
+        {
+            if(m_materials.size() < MaxMaterials)
+            {
+                m_materials.push_back(pMaterial);
+                itMat = m_materials.end() - 1;
+            }
+            else
+            {
+                SPACE_ENGINE_WARN("ParticleSystem: more than {} materials, the first one is used", MaxMaterials);
+                itMat = m_materials.begin();
+            }
+        }
+        const uint8_t material = static_cast<uint8_t>(itMat - m_materials.begin());
+
+        for(size_t i = 0; i < m_styles.size(); i++)
+        {
+            const ParticleStyle& style = m_styles[i];
+            if(style.material == material && style.startSize == desc.startSize && style.endSize == desc.endSize &&
+               style.startColor == desc.startColor && style.endColor == desc.endColor)
+                return static_cast<uint16_t>(i);
+        }
+
+        if(m_styles.size() >= MaxStyles)
+        {
+            SPACE_ENGINE_WARN("ParticleSystem: more than {} styles, the first one is used", MaxStyles);
+            return 0;
+        }
+
+        m_styles.push_back({desc.startSize, desc.endSize, desc.startColor, desc.endColor, material});
+        return static_cast<uint16_t>(m_styles.size() - 1);
+    }
+
+    ParticleEmitter* ParticleSystem::createEmitter(const ParticleEmitterDesc& desc, Transform* pTransform)
+    {
+        if(!pTransform)
+        {
+            SPACE_ENGINE_ERROR("ParticleSystem: emitter without a transform");
+            return nullptr;
+        }
+
+        ParticleEmitter* pEmitter = new ParticleEmitter();
+        pEmitter->m_desc = desc;
+        pEmitter->m_pTransform = pTransform;
+        pEmitter->m_style = findStyle(desc);
+        m_emitters.push_back(pEmitter);
+        return pEmitter;
+    }
+
+    void ParticleSystem::destroyEmitter(ParticleEmitter* pEmitter)
+    {
+        if(!pEmitter)
+            return;
+
+        //after shutdown the emitters are already deleted
+        auto it = std::find(m_emitters.begin(), m_emitters.end(), pEmitter);
+        if(it != m_emitters.end())
+        {
+            m_emitters.erase(it);
+            delete pEmitter;
+        }
+    }
+
+    //columns x, y and the direction
+    static Matrix3 coneBasis(const Vector3& direction)
+    {
+        Vector3 dir = glm::normalize(direction);
+        Vector3 up = std::abs(dir.y) < 0.99f ? Vector3(0.f, 1.f, 0.f) : Vector3(1.f, 0.f, 0.f);
+        Vector3 x = glm::normalize(glm::cross(up, dir));
+        return Matrix3(x, glm::cross(dir, x), dir);
+    }
+
+    void ParticleSystem::burst(const ParticleEmitterDesc& desc, const Vector3& pos, uint32_t count)
+    {
+        spawn(desc, findStyle(desc), pos + desc.offset, coneBasis(desc.direction), count);
+    }
+
+    void ParticleSystem::spawn(const ParticleEmitterDesc& desc, uint16_t style, const Vector3& pos, const Matrix3& basis, uint32_t count)
+    {
+        const float cosSpread = std::cos(Math::radians(std::clamp(desc.spread, 0.f, 180.f)));
+
+        for(uint32_t n = 0; n < count; n++)
+        {
+            if(m_pool.getCount() >= m_budget)
+            {
+                m_stats.dropped += count - n;
+                return;
+            }
+
+            //uniform on the spherical cap around the direction
+            float cosTheta = 1.f - random() * (1.f - cosSpread);
+            float sinTheta = std::sqrt(std::max(1.f - cosTheta * cosTheta, 0.f));
+            float phi = 6.2831853f * random();
+            Vector3 dir = basis * Vector3(sinTheta * std::cos(phi), sinTheta * std::sin(phi), cosTheta);
+
+            float speed = desc.minSpeed + (desc.maxSpeed - desc.minSpeed) * random();
+            //a zero life would divide by zero in the instance build
+            float life = std::max(desc.minLife + (desc.maxLife - desc.minLife) * random(), 0.001f);
+            m_pool.emit(pos, dir * speed, life, desc.drag, style);
+            m_stats.spawned++;
+        }
+    }
+
+    void ParticleSystem::update(float dt)
+    {
+        for(ParticleEmitter* pEmitter : m_emitters)
+        {
+            const ParticleEmitterDesc& desc = pEmitter->m_desc;
+            if(!pEmitter->m_active || desc.rate <= 0.f)
+                continue;
+
+            pEmitter->m_pending += desc.rate * dt;
+            uint32_t count = static_cast<uint32_t>(pEmitter->m_pending);
+            if(!count)
+                continue;
+            pEmitter->m_pending -= static_cast<float>(count);
+
+            Matrix4 world = pEmitter->m_pTransform->getWorldMatrix();
+            Vector3 pos = Vector3(world * Vector4(desc.offset, 1.f));
+            spawn(desc, pEmitter->m_style, pos, coneBasis(Matrix3(world) * desc.direction), count);
+        }
+
+        m_stats.died = m_pool.simulate(dt);
+        m_stats.alive = m_pool.getCount();
+        buildInstances();
+
+        //the bursts of the next frame are counted from here
+        m_lastStats = m_stats;
+        m_stats = ParticleStats();
+    }
+
+    void ParticleSystem::buildInstances()
+    {
+        const uint32_t count = m_pool.getCount();
+        m_instances.resize(count);
+        m_batches.clear();
+
+        //counting sort by material
+        uint32_t offsets[MaxMaterials] = {};
+        for(uint32_t i = 0; i < count; i++)
+            offsets[m_styles[m_pool.style[i]].material]++;
+
+        uint32_t first = 0;
+        for(uint32_t m = 0; m < MaxMaterials; m++)
+        {
+            uint32_t num = offsets[m];
+            offsets[m] = first;
+            if(num)
+                m_batches.push_back({m_materials[m], first, num});
+            first += num;
+        }
+
+        for(uint32_t i = 0; i < count; i++)
+        {
+            const ParticleStyle& style = m_styles[m_pool.style[i]];
+            float t = m_pool.age[i] / m_pool.life[i];
+
+            ParticleInstance& instance = m_instances[offsets[style.material]++];
+            instance.posSize = Vector4(m_pool.posX[i], m_pool.posY[i], m_pool.posZ[i],
+                style.startSize + (style.endSize - style.startSize) * t);
+            instance.color = style.startColor + (style.endColor - style.startColor) * t;
+        }
+    }
+
+    //------------------------------------------------------//
+    //-------------------ParticleEffects--------------------//
+    //------------------------------------------------------//
+    namespace ParticleEffects
+    {
+        //small and hot, most of it goes in the bloom
+        static ParticleMaterial SparkMaterial = {.bloom = 1.f};
+        //soft glow of the trails
+        static ParticleMaterial GlowMaterial = {.bloom = 0.5f};
+
+        ParticleEmitterDesc explosion(const Vector4& color)
+        {
+            return {.pMaterial = &SparkMaterial, .minLife = 0.4f, .maxLife = 0.9f, .minSpeed = 4.f, .maxSpeed = 12.f,
+                .spread = 180.f, .drag = 2.f, .startSize = 0.35f, .endSize = 0.05f,
+                .startColor = color, .endColor = Vector4(Vector3(color) * 0.2f, 0.f)};
+        }
+
+        ParticleEmitterDesc engineTrail(const Vector4& color)
+        {
+            //behind the ship, the ships look along +z in their own space
+            return {.pMaterial = &GlowMaterial, .rate = 60.f, .minLife = 0.2f, .maxLife = 0.35f, .minSpeed = 4.f, .maxSpeed = 6.f,
+                .direction = {0.f, 0.f, -1.f}, .spread = 8.f, .offset = {0.f, 0.f, -1.f}, .startSize = 0.25f, .endSize = 0.02f,
+                .startColor = color, .endColor = Vector4(Vector3(color) * 0.5f, 0.f)};
+        }
+
+        ParticleEmitterDesc pickup(const Vector4& color)
+        {
+            return {.pMaterial = &GlowMaterial, .minLife = 0.5f, .maxLife = 0.8f, .minSpeed = 2.f, .maxSpeed = 4.f,
+                .spread = 180.f, .drag = 1.f, .startSize = 0.3f, .endSize = 0.f,
+                .startColor = color, .endColor = Vector4(Vector3(color), 0.f)};
+        }
+    }
+}
@@ -88,6 +88,8 @@ namespace SpaceEngine {
                         break;
                 }
 
+                ParticleSystem::burst(ParticleEffects::pickup(PickupColors[static_cast<int>(m_type)]),
+                    m_pTransform->getWorldPosition(), PickupParticles);
                 pScene->requestDestroy(this);
             }
         }
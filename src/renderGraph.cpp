@@ -0,0 +1,404 @@
+#include "renderGraph.h"
+#include "glState.h"
+#include "glDebug.h"
+#include "texture.h"
+#include "log.h"
+#include "utils/utils.h"
+
+#include <algorithm>
+
+namespace SpaceEngine
+{
+    RenderGraph::~RenderGraph()
+    {
+        reset();
+    }
+
+    RGResource RenderGraph::createTexture(const std::string& name, const RGTextureDesc& desc)
+    {
+        VirtualTexture vt;
+        vt.name = name;
+        vt.desc = desc;
+        m_textures.push_back(vt);
+        m_compiled = false;
+
+        return static_cast<RGResource>(m_textures.size() - 1);
+    }
+
+    RGResource RenderGraph::importTexture(const std::string& name, GLuint texture, int width, int height)
+    {
+        VirtualTexture vt;
+        vt.name = name;
+        vt.imported = true;
+        vt.importedTexture = texture;
+        vt.importedWidth = width;
+        vt.importedHeight = height;
+        m_textures.push_back(vt);
+        m_compiled = false;
+
+        return static_cast<RGResource>(m_textures.size() - 1);
+    }
+
+    uint32_t RenderGraph::addPass(const std::string& name,
+        std::initializer_list<RGResource> reads,
+        std::initializer_list<RGResource> writes,
+        std::function<void()> execute)
+    {
+        Pass pass;
+        pass.name = name;
+        pass.reads = reads;
+        pass.writes = writes;
+        pass.execute = std::move(execute);
+        m_passes.push_back(std::move(pass));
+        m_compiled = false;
+
+        return static_cast<uint32_t>(m_passes.size() - 1);
+    }
+
+    void RenderGraph::compile()
+    {
+        release();
+        m_physical.clear();
+
+        for(VirtualTexture& vt : m_textures)
+        {
+            vt.firstPass = -1;
+            vt.physical = -1;
+            vt.sampled = false;
+        }
+
+        //targets used and sampled
+        for(int i = 0; i < static_cast<int>(m_passes.size()); i++)
+        {
+            auto touch = [&](RGResource r)
+            {
+                if(r >= m_textures.size())
+                {
+                    SPACE_ENGINE_FATAL("RenderGraph: pass {} uses an unknown resource", m_passes[i].name);
+                    exit(-1);
+                }
+
+                VirtualTexture& vt = m_textures[r];
+                if(vt.firstPass < 0)
+                    vt.firstPass = i;
+            };
+
+            for(RGResource r : m_passes[i].reads)
+            {
+                touch(r);
+                m_textures[r].sampled = true;
+            }
+            for(RGResource r : m_passes[i].writes) touch(r);
+        }
+
+        //one GL target per transient target: the bloom chain reads the bright pass and every level
+        //has its own size, no two targets with the same description have disjoint lifetimes
+        for(VirtualTexture& vt : m_textures)
+        {
+            if(vt.imported || vt.firstPass < 0)
+                continue;
+
+            PhysicalTexture pt;
+            pt.desc = vt.desc;
+            //a depth nobody samples is only tested: a renderbuffer, the driver keeps it in its own layout
+            pt.renderbuffer = isDepthFormat(vt.desc.format) && !vt.sampled;
+            pt.name = vt.name;
+            m_physical.push_back(pt);
+            vt.physical = static_cast<int>(m_physical.size() - 1);
+        }
+
+        for(Pass& pass : m_passes)
+        {
+            if(pass.writes.empty() || pass.fbo)
+                continue;
+
+            if(GLStateCache::hasDirectStateAccess())
+                glCreateFramebuffers(1, &pass.fbo);
+            else
+                glGenFramebuffers(1, &pass.fbo);
+        }
+
+        allocate();
+        m_compiled = true;
+
+        SPACE_ENGINE_DEBUG("RenderGraph - passes: {}, transient targets: {}, {} KB",
+            m_passes.size(), m_physical.size(), m_allocatedBytes / 1024);
+    }
+
+    void RenderGraph::execute()
+    {
+        if(!m_compiled)
+            compile();
+
+        for(Pass& pass : m_passes)
+        {
+            if(pass.fbo)
+            {
+                GLStateCache::bindFramebuffer(pass.fbo);
+                glViewport(0, 0, pass.width, pass.height);
+            }
+            else
+            {
+                GLStateCache::bindFramebuffer(m_outputFbo);
+                //old targets are stretched on the window until the resize is applied
+                glViewport(0, 0, m_outputWidth, m_outputHeight);
+            }
+
+            pass.execute();
+        }
+    }
+
+    void RenderGraph::reset()
+    {
+        release();
+
+        for(Pass& pass : m_passes)
+        {
+            if(pass.fbo)
+            {
+                GLStateCache::onDeleteFramebuffer(pass.fbo);
+                glDeleteFramebuffers(1, &pass.fbo);
+            }
+        }
+
+        m_passes.clear();
+        m_textures.clear();
+        m_physical.clear();
+        m_compiled = false;
+    }
+
+    void RenderGraph::setSize(int width, int height)
+    {
+        m_resizePending = false;
+        m_outputWidth = width;
+        m_outputHeight = height;
+
+        if(width == m_width && height == m_height)
+            return;
+
+        m_width = width;
+        m_height = height;
+
+        if(m_compiled)
+        {
+            release();
+            allocate();
+        }
+    }
+
+    void RenderGraph::requestResize(int width, int height)
+    {
+        //minimized window, keep the targets
+        if(width <= 0 || height <= 0)
+            return;
+
+        m_outputWidth = width;
+        m_outputHeight = height;
+        m_pendingWidth = width;
+        m_pendingHeight = height;
+        m_resizePending = true;
+        m_lastResizeRequest = std::chrono::steady_clock::now();
+    }
+
+    void RenderGraph::update()
+    {
+        if(m_resizePending && std::chrono::steady_clock::now() - m_lastResizeRequest >= ResizeDelay)
+        {
+            SPACE_ENGINE_DEBUG("RenderGraph - resize settled w{} h{}", m_pendingWidth, m_pendingHeight);
+            setSize(m_pendingWidth, m_pendingHeight);
+        }
+    }
+
+    void RenderGraph::setRenderScale(float scale)
+    {
+        scale = std::clamp(scale, 0.1f, 1.f);
+        if(scale == m_renderScale)
+            return;
+
+        m_renderScale = scale;
+
+        if(m_compiled)
+        {
+            release();
+            allocate();
+        }
+    }
+
+    int RenderGraph::getRenderWidth() const
+    {
+        return std::max(1, static_cast<int>(m_width * m_renderScale + 0.5f));
+    }
+
+    int RenderGraph::getRenderHeight() const
+    {
+        return std::max(1, static_cast<int>(m_height * m_renderScale + 0.5f));
+    }
+
+    GLuint RenderGraph::getTexture(RGResource resource) const
+    {
+        if(resource >= m_textures.size())
+            return 0;
+
+        const VirtualTexture& vt = m_textures[resource];
+        if(vt.imported)
+            return vt.importedTexture;
+
+        if(vt.physical < 0 || m_physical[vt.physical].renderbuffer)
+            return 0;
+        return m_physical[vt.physical].texture;
+    }
+
+    void RenderGraph::targetSize(const VirtualTexture& vt, int& width, int& height) const
+    {
+        if(vt.imported)
+        {
+            width = vt.importedWidth;
+            height = vt.importedHeight;
+            return;
+        }
+
+        width = std::max(1, getRenderWidth() >> vt.desc.downscale);
+        height = std::max(1, getRenderHeight() >> vt.desc.downscale);
+    }
+
+    void RenderGraph::allocate()
+    {
+        if(!m_width || !m_height)
+            return;
+
+        m_allocatedBytes = 0;
+        const bool dsa = GLStateCache::hasDirectStateAccess();
+
+        for(PhysicalTexture& pt : m_physical)
+        {
+            pt.width = std::max(1, getRenderWidth() >> pt.desc.downscale);
+            pt.height = std::max(1, getRenderHeight() >> pt.desc.downscale);
+
+            //immutable: a resize releases the targets and allocates them again
+            if(pt.renderbuffer && dsa)
+            {
+                glCreateRenderbuffers(1, &pt.texture);
+                glNamedRenderbufferStorage(pt.texture, pt.desc.format, pt.width, pt.height);
+            }
+            else if(pt.renderbuffer)
+            {
+                glGenRenderbuffers(1, &pt.texture);
+                glBindRenderbuffer(GL_RENDERBUFFER, pt.texture);
+                glRenderbufferStorage(GL_RENDERBUFFER, pt.desc.format, pt.width, pt.height);
+            }
+            else
+            {
+                pt.texture = TextureManager::createStorage2D(pt.desc.format, 1, pt.width, pt.height);
+                TextureManager::setParameter2D(pt.texture, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+                TextureManager::setParameter2D(pt.texture, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+                TextureManager::setParameter2D(pt.texture, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+                TextureManager::setParameter2D(pt.texture, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+            }
+
+            GLDebug::label(pt.renderbuffer ? GL_RENDERBUFFER : GL_TEXTURE, pt.texture, pt.name);
+
+            m_allocatedBytes += static_cast<size_t>(pt.width) * pt.height * bytesPerPixel(pt.desc.format);
+        }
+
+        GLStateCache::bindTexture(0, GL_TEXTURE_2D, 0);
+        if(!dsa)
+            glBindRenderbuffer(GL_RENDERBUFFER, 0);
+        GL_CHECK_ERRORS();
+
+        buildFramebuffers();
+    }
+
+    void RenderGraph::release()
+    {
+        for(PhysicalTexture& pt : m_physical)
+        {
+            if(pt.texture && pt.renderbuffer)
+            {
+                glDeleteRenderbuffers(1, &pt.texture);
+                pt.texture = 0;
+            }
+            else if(pt.texture)
+            {
+                //the names are recycled by the next allocation
+                GLStateCache::onDeleteTexture(pt.texture);
+                glDeleteTextures(1, &pt.texture);
+                pt.texture = 0;
+            }
+        }
+
+        m_allocatedBytes = 0;
+    }
+
+    void RenderGraph::buildFramebuffers()
+    {
+        const bool dsa = GLStateCache::hasDirectStateAccess();
+
+        for(Pass& pass : m_passes)
+        {
+            if(!pass.fbo)
+                continue;
+
+            if(!dsa)
+                GLStateCache::bindFramebuffer(pass.fbo);
+            GLDebug::label(GL_FRAMEBUFFER, pass.fbo, pass.name);
+            uint8_t numColors = 0;
+
+            for(RGResource r : pass.writes)
+            {
+                const VirtualTexture& vt = m_textures[r];
+                GLenum attachment = isDepthFormat(vt.desc.format) ?
+                    GL_DEPTH_ATTACHMENT :
+                    GL_COLOR_ATTACHMENT0 + numColors++;
+
+                const bool renderbuffer = !vt.imported && m_physical[vt.physical].renderbuffer;
+                if(renderbuffer && dsa)
+                    glNamedFramebufferRenderbuffer(pass.fbo, attachment, GL_RENDERBUFFER, m_physical[vt.physical].texture);
+                else if(renderbuffer)
+                    glFramebufferRenderbuffer(GL_FRAMEBUFFER, attachment, GL_RENDERBUFFER, m_physical[vt.physical].texture);
+                else if(dsa)
+                    glNamedFramebufferTexture(pass.fbo, attachment, getTexture(r), 0);
+                else
+                    glFramebufferTexture2D(GL_FRAMEBUFFER, attachment, GL_TEXTURE_2D, getTexture(r), 0);
+                //all the attachments of a pass have the same size
+                targetSize(vt, pass.width, pass.height);
+            }
+
+            //the draw buffer of a new framebuffer is already the color attachment 0,
+            //the pipelines set it through the cache
+            if(dsa)
+            {
+                GL_CHECK_NAMED_FRAMEBUFFER_STATUS(pass.fbo);
+                continue;
+            }
+
+            if(numColors)
+                GLStateCache::drawBuffers(1);
+            GL_CHECK_FRAMEBUFFER_STATUS();
+        }
+
+        if(!dsa)
+            GLStateCache::bindFramebuffer(0);
+    }
+
+    size_t RenderGraph::bytesPerPixel(GLenum format)
+    {
+        switch(format)
+        {
+            case GL_RGBA16F: return 8;
+            case GL_RGBA32F: return 16;
+            case GL_RGB16F: return 6;
+            case GL_R11F_G11F_B10F: return 4;
+            case GL_RGBA8: return 4;
+            case GL_DEPTH_COMPONENT24: return 4;
+            case GL_DEPTH_COMPONENT32F: return 4;
+            default: return 4;
+        }
+    }
+
+    bool RenderGraph::isDepthFormat(GLenum format)
+    {
+        return format == GL_DEPTH_COMPONENT16 ||
+               format == GL_DEPTH_COMPONENT24 ||
+               format == GL_DEPTH_COMPONENT32F;
+    }
+}
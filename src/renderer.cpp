@@ -1,6 +1,12 @@
 #include "renderer.h"
 #include "shader.h"
 #include "windowManager.h"
+#include "glDebug.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <functional>
 #include <string>
 
 namespace SpaceEngine
@@ -15,14 +21,14 @@ namespace SpaceEngine
         glEnable(GL_BLEND);
         glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
-                if(rParams.pSkybox)
+                if(rParams.pSkybox && rParams.view)
         {
             GL_CHECK_ERRORS();
             ShaderProgram* pShaderSkybox = rParams.pSkybox->pShader;
-            Matrix4 viewNoTransl = Matrix4(Matrix3(rParams.cam->getViewMatrix()));
+            Matrix4 viewNoTransl = Matrix4(Matrix3(rParams.view->view));
             pShaderSkybox->use();
             pShaderSkybox->setUniform("view", viewNoTransl);
-            pShaderSkybox->setUniform("projection", rParams.cam->getProjectionMatrix());
+            pShaderSkybox->setUniform("projection", rParams.view->projection);
             pShaderSkybox->setUniform("skybox", 0);
             // disegna la skybox come se fosse lontanissima
             glDepthFunc(GL_LEQUAL);
@@ -35,10 +41,9 @@ namespace SpaceEngine
             glEnable(GL_CULL_FACE);
             glDepthFunc(GL_LESS);
             GL_CHECK_ERRORS();
-            glUseProgram(0);
         }
 
-        if(rParams.cam)
+        if(rParams.view)
         {
             for(const auto& renderObj : rParams.renderables)
             {
@@ -57,8 +62,8 @@ namespace SpaceEngine
                         renderObj.mesh->getMaterialBySubMeshIndex(idSubMesh)->bindingPropsToShader();
                         //set matrices
                         shader->setUniform("model", renderObj.modelMatrix);
-                        shader->setUniform("view", rParams.cam->getViewMatrix());
-                        shader->setUniform("projection", rParams.cam->getProjectionMatrix());
+                        shader->setUniform("view", rParams.view->view);
+                        shader->setUniform("projection", rParams.view->projection);
                         //lights bind
                         if(shader->isPresentUniform("lights[0].pos") && rParams.lights.size())
                         {
@@ -85,14 +90,14 @@ namespace SpaceEngine
 
                         //call the draw for the mesh
                         renderObj.mesh->bindVAO();
-                        renderObj.mesh->drawSubMesh(idSubMesh);
+                        renderObj.mesh->drawSubMesh(idSubMesh, renderObj.lod);
                         GL_CHECK_ERRORS();
                     }
-                    glUseProgram(0);
                 }    
             }
         }
-
+        //the legacy path changes the state behind the cache
+        GLStateCache::invalidate();
     }
 
     void UIRenderer::render(const std::vector<UIRenderObject>& uiRenderables)
@@ -118,10 +123,10 @@ namespace SpaceEngine
             ui.pUIMesh->bindVAO();
             ui.pUIMesh->draw();
             GL_CHECK_ERRORS();
-            glUseProgram(0);
         }
         glDisable(GL_BLEND);
         glEnable(GL_DEPTH_TEST);
+        GLStateCache::invalidate();
     }
 
     void TextRenderer::render(const std::vector<TextRenderObject>& textRenderables)
@@ -129,6 +134,7 @@ namespace SpaceEngine
         glDisable(GL_DEPTH_TEST);
         glDisable(GL_CULL_FACE);
         glEnable(GL_BLEND);
+        TextMesh::beginFrame();
         for(TextRenderObject textRendObj : textRenderables)
         {
             TextMaterial* pMat = textRendObj.pText->pTextMeshRend->getMaterial();
@@ -141,39 +147,21 @@ namespace SpaceEngine
                 pMat->bindingPropsToShader();
                 pShader->setUniform("projection", WindowManager::sceenProjMatrix);
                 pShader->setUniform("text_tex", 0);
-                std::string string = textRendObj.pText->getString();
-                Transform2D& transf = *textRendObj.pText->pTransf;
-                //resolution adaption
-                float resScale = 1.f;
-                float offsetX = 0.f;
-                Vector2 finalOffset = {0.f, 0.f}; 
-                Vector2 finalPos = {transf.pos.x, transf.pos.y};
-
-                Utils::applyRatioScreenRes(transf.anchor, transf.pos, resScale, finalOffset, finalPos);
-                transf.setDirty(false);
-                
-                
-                offsetX = finalPos.x;
-                pMesh->bindVAO();
+                //the quads are rebuilt only when the text changes
+                textRendObj.pText->updateLayout();
 
-                for(auto c = string.begin(); c != string.end(); ++c)
-                {
-                    GL_CHECK_ERRORS();
-                    std::array<std::array<float, 4>, 6> data = pMat->bindCharacter(*c, offsetX, resScale, finalPos, transf);
-                    pMesh->subData(data);
-                    GL_CHECK_ERRORS();
-                    pMesh->draw();
-                    GL_CHECK_ERRORS();
-                }
-                glBindVertexArray(0);
-                glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+                pMat->bindAtlas();
+                pMesh->bindVAO();
+                pMesh->draw();
+                GL_CHECK_ERRORS();
             }
         }
+        TextMesh::endFrame();
         
         glDisable(GL_BLEND);
         glEnable(GL_DEPTH_TEST);
         glEnable(GL_CULL_FACE);
-        glUseProgram(0);
+        GLStateCache::invalidate();
     }
 
     void ScreenRenderer::render(const std::vector<ScreenRenderObject>& screenRenderables)
@@ -198,7 +186,6 @@ namespace SpaceEngine
             screenR.pPlaneMesh->bindVAO();
             screenR.pPlaneMesh->draw();
             GL_CHECK_ERRORS();
-        glUseProgram(0);
         }
     }
 
@@ -206,22 +193,35 @@ namespace SpaceEngine
     //---------------------RenderBuffer---------------------//    
     //------------------------------------------------------//
 
-    RenderBuffer::RenderBuffer(GLenum target, GLenum attachment)
+    RenderBuffer::RenderBuffer(GLenum target, GLenum attachment, GLuint frameBuffer)
     {
-        init(target, attachment);
+        init(target, attachment, frameBuffer);
     }
     
-    void RenderBuffer::init(GLenum target, GLenum attachment)
+    void RenderBuffer::init(GLenum target, GLenum attachment, GLuint frameBuffer)
     {
         m_target = target;
         m_attachment = attachment;
+        //now we support only the GL_DEPTH_ATTACHMENT and GL_FRAMEBUFFER target
+        if(attachment != GL_DEPTH_COMPONENT)
+        {
+            SPACE_ENGINE_ERROR("now we support only the GL_DEPTH_ATTACHMENT and GL_FRAMEBUFFER target");
+            return;
+        }
+
+        if(GLStateCache::hasDirectStateAccess())
+        {
+            glCreateRenderbuffers(1, &m_renderBufferObj);
+            glNamedRenderbufferStorage(m_renderBufferObj, attachment, WindowManager::width, WindowManager::height);
+            glNamedFramebufferRenderbuffer(frameBuffer, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, m_renderBufferObj);
+            return;
+        }
+
         glGenRenderbuffers(1, &m_renderBufferObj);
         glBindRenderbuffer(GL_RENDERBUFFER, m_renderBufferObj);
         glRenderbufferStorage(GL_RENDERBUFFER, attachment, WindowManager::width, WindowManager::height);
-        //now we support only the GL_DEPTH_ATTACHMENT and GL_FRAMEBUFFER target
-        if(attachment == GL_DEPTH_COMPONENT)
-            glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, m_renderBufferObj);
-        else SPACE_ENGINE_ERROR("now we support only the GL_DEPTH_ATTACHMENT and GL_FRAMEBUFFER target");
+        GLStateCache::bindFramebuffer(frameBuffer);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, m_renderBufferObj);
     }
 
     //------------------------------------------------------//    
@@ -241,7 +241,10 @@ namespace SpaceEngine
     
     void FrameBuffer::init()
     {
-        glGenFramebuffers(1, &m_frameBufferObj);
+        if(GLStateCache::hasDirectStateAccess())
+            glCreateFramebuffers(1, &m_frameBufferObj);
+        else
+            glGenFramebuffers(1, &m_frameBufferObj);
     }
 
     
@@ -259,12 +262,14 @@ namespace SpaceEngine
         std::string name = "ColorBuffer"+std::to_string(m_vecColorBuffers.size());
         Texture* pColorBuffer = TextureManager::genTexture(GL_TEXTURE_2D, params, name);
         GL_CHECK_ERRORS();
-        //unbind??
-        glFramebufferTexture2D(GL_FRAMEBUFFER, 
-            GL_COLOR_ATTACHMENT0 + static_cast<GLuint>(m_vecColorBuffers.size()), 
-            GL_TEXTURE_2D, 
-            pColorBuffer->getTexture(), 
-            0);
+        const GLenum attachment = GL_COLOR_ATTACHMENT0 + static_cast<GLuint>(m_vecColorBuffers.size());
+        if(GLStateCache::hasDirectStateAccess())
+            glNamedFramebufferTexture(m_frameBufferObj, attachment, pColorBuffer->getTexture(), 0);
+        else
+        {
+            bindFrameBuffer();
+            glFramebufferTexture2D(GL_FRAMEBUFFER, attachment, GL_TEXTURE_2D, pColorBuffer->getTexture(), 0);
+        }
         GL_CHECK_ERRORS();
         m_vecColorBuffers.push_back(pColorBuffer);
     }
@@ -277,24 +282,22 @@ namespace SpaceEngine
 
     void FrameBuffer::addRenderBuffer()
     {
-        m_pRenderBuffer = new RenderBuffer(GL_FRAMEBUFFER, GL_DEPTH_COMPONENT);
+        m_pRenderBuffer = new RenderBuffer(GL_FRAMEBUFFER, GL_DEPTH_COMPONENT, m_frameBufferObj);
     }
 
     void FrameBuffer::drawBuffers(uint8_t numBuffers)
     {
-        std::vector<uint32_t> attachments;
-        
-        for(int i = 0; i < static_cast<int>(numBuffers) && i < m_vecColorBuffers.size(); i++)
-        {
-           attachments.push_back(GL_COLOR_ATTACHMENT0 + i); 
-        }
+        if(numBuffers > m_vecColorBuffers.size())
+            numBuffers = static_cast<uint8_t>(m_vecColorBuffers.size());
 
-        glDrawBuffers(static_cast<GLsizei>(numBuffers), attachments.data());
+        //the draw buffers are stored in the framebuffer object
+        bindFrameBuffer();
+        GLStateCache::drawBuffers(numBuffers);
     }
 
     int FrameBuffer::destroyColorAndDepth()
     {
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        unbindFrameBuffer();
 
         for(Texture* pTex : m_vecColorBuffers)
         {
@@ -307,6 +310,7 @@ namespace SpaceEngine
         {
             glDeleteRenderbuffers(1, &m_pRenderBuffer->m_renderBufferObj);
             delete m_pRenderBuffer;
+            m_pRenderBuffer = nullptr;
         }
         return 1;
     }
@@ -328,6 +332,138 @@ namespace SpaceEngine
     }
 
 
+    //------------------------------------------------------//    
+    //-------------------------Bloom------------------------//    
+    //------------------------------------------------------//
+
+    void Bloom::init()
+    {
+        m_pDownsampleShader = ShaderManager::findShaderProgram("bloomDownsample");
+        m_pUpsampleShader = ShaderManager::findShaderProgram("bloomUpsample");
+
+        if(!m_pDownsampleShader || !m_pUpsampleShader)
+        {
+            SPACE_ENGINE_FATAL("Bloom shaders not found");
+            exit(-1);
+        }
+
+        m_pDownsampleShader->use();
+        m_pDownsampleShader->setUniform("srcTex", static_cast<int>(SrcTexUnit));
+        m_downsamplePSO.program = m_pDownsampleShader->getHandle();
+        m_pUpsampleShader->use();
+        m_pUpsampleShader->setUniform("srcTex", static_cast<int>(SrcTexUnit));
+        m_upsamplePSO.program = m_pUpsampleShader->getHandle();
+    }
+
+    RGResource Bloom::addPasses(RenderGraph& graph, RGResource brightPass)
+    {
+        RGResource mips[MaxMips];
+
+        for(uint8_t i = 0; i < m_mipCount; i++)
+        {
+            mips[i] = graph.createTexture("bloom_mip" + std::to_string(i),
+                {.format = m_format, .downscale = static_cast<uint8_t>(i + 1)});
+        }
+
+        //downsample: bright pass -> half -> quarter -> ...
+        for(uint8_t i = 0; i < m_mipCount; i++)
+        {
+            RGResource src = i ? mips[i - 1] : brightPass;
+
+            graph.addPass("bloom_down" + std::to_string(i), {src}, {mips[i]}, [this, &graph, src]()
+            {
+                if(!m_enabled) return;
+
+                //the levels are summed in one section
+                GPUProfileScope scope("bloom");
+                GLStateCache::bindPipeline(m_downsamplePSO);
+                GLStateCache::bindTexture(SrcTexUnit, GL_TEXTURE_2D, graph.getTexture(src));
+                PlaneMesh* pPlaneMesh = MeshManager::getPlaneMesh();
+                pPlaneMesh->bindVAO();
+                pPlaneMesh->draw();
+            });
+        }
+
+        //upsample: every level is blurred and added to the bigger one
+        for(int i = m_mipCount - 1; i > 0; i--)
+        {
+            RGResource src = mips[i];
+
+            graph.addPass("bloom_up" + std::to_string(i), {src}, {mips[i - 1]}, [this, &graph, src]()
+            {
+                if(!m_enabled) return;
+
+                GPUProfileScope scope("bloom");
+                GLStateCache::bindPipeline(m_upsamplePSO);
+                m_pUpsampleShader->setUniform("filterRadius", m_filterRadius);
+                GLStateCache::bindTexture(SrcTexUnit, GL_TEXTURE_2D, graph.getTexture(src));
+                PlaneMesh* pPlaneMesh = MeshManager::getPlaneMesh();
+                pPlaneMesh->bindVAO();
+                pPlaneMesh->draw();
+            });
+        }
+
+        return mips[0];
+    }
+
+    //------------------------------------------------------//    
+    //------------------DynamicResolution-------------------//    
+    //------------------------------------------------------//
+
+    bool DynamicResolution::addFrameTime(float ms)
+    {
+        if(m_skip)
+        {
+            m_skip--;
+            return false;
+        }
+
+        m_samples[m_count++] = ms;
+        if(m_count < HistorySize)
+            return false;
+
+        float avg = 0.f;
+        for(float sample : m_samples)
+            avg += sample;
+        avg /= static_cast<float>(HistorySize);
+        m_count = 0;
+
+        const uint32_t oldLevel = m_level;
+        const float scale = getScale();
+
+        if(avg > m_targetMs)
+        {
+            //the cost follows the pixels, the square of the scale
+            float fit = scale * std::sqrt(m_targetMs / avg);
+            float level = std::floor((fit - MinScale) / ScaleStep + 1e-3f);
+            m_level = level <= 0.f ? 0 : std::min(static_cast<uint32_t>(level), m_level - 1);
+        }
+        else if(m_level + 1 < NumLevels)
+        {
+            float bigger = scaleOf(m_level + 1);
+            if(avg * (bigger * bigger) / (scale * scale) < m_targetMs * GrowHeadroom)
+                m_level++;
+        }
+
+        if(m_level == oldLevel)
+            return false;
+
+        restartHistory();
+        return true;
+    }
+
+    void DynamicResolution::reset()
+    {
+        m_level = NumLevels - 1;
+        restartHistory();
+    }
+
+    void DynamicResolution::restartHistory()
+    {
+        m_count = 0;
+        m_skip = SettleFrames;
+    }
+
     //------------------------------------------------------//    
     //---------------------RendererV2-----------------------//    
     //------------------------------------------------------//
@@ -335,10 +471,65 @@ namespace SpaceEngine
     bool RendererV2::m_preprocessing = false;
     bool RendererV2::m_bloomVFX = false;
     bool RendererV2::m_debug = false;
-    FrameBuffer RendererV2::m_HDRFrameBuffer;
-    FrameBuffer RendererV2::m_BloomFrameBuffers[2];
+    RendererV2::FrameLists RendererV2::m_frame;
+    RenderGraph RendererV2::m_graph;
+    RGResource RendererV2::m_hdrColor = RGInvalidResource;
+    RGResource RendererV2::m_hdrBright = RGInvalidResource;
+    RGResource RendererV2::m_hdrDepth = RGInvalidResource;
+    RGResource RendererV2::m_bloomResult = RGInvalidResource;
+    Bloom RendererV2::m_bloom;
+    HDRFormats RendererV2::m_hdrFormats;
+    bool RendererV2::m_graphBloom = false;
+    uint8_t RendererV2::m_sceneColorTargets = 1;
     ShaderProgram* RendererV2::m_pHDRShader = nullptr;
-    ShaderProgram* RendererV2::m_pBloomShader = nullptr;
+    //screen shaders write the depth like the meshes
+    PipelineState RendererV2::m_screenPSO = {.blend = false, .depthTest = true, .cullFace = true};
+    PipelineState RendererV2::m_meshPSO = {.blend = true, .depthTest = true, .cullFace = true};
+    //draw the skybox as if it were very far away
+    PipelineState RendererV2::m_skyboxPSO = {.blend = true, .depthTest = true, .depthFunc = GL_LEQUAL, .cullFace = false};
+    PipelineState RendererV2::m_uiPSO = {.blend = true, .depthTest = false, .cullFace = false};
+    PipelineState RendererV2::m_textPSO = {.blend = true, .depthTest = false, .cullFace = false};
+    //fullscreen pass, the program is set in Initialize
+    PipelineState RendererV2::m_hdrPSO = {.blend = false, .depthTest = false, .cullFace = false};
+    UIBatcher RendererV2::m_uiBatcher;
+    std::vector<RendererV2::MeshDraw> RendererV2::m_meshDraws;
+    std::vector<MeshInstance> RendererV2::m_meshInstances;
+    std::vector<DrawElementsIndirectCommand> RendererV2::m_meshCommands;
+    StreamBuffer RendererV2::m_instanceStream;
+    StreamBuffer RendererV2::m_indirectStream;
+    uint32_t RendererV2::m_meshDrawCalls = 0;
+    uint64_t RendererV2::m_meshIndices = 0;
+    ShaderProgram* RendererV2::m_pParticleShader = nullptr;
+    //additive, the particles are tested against the depth of the meshes but don't write it
+    PipelineState RendererV2::m_particlePSO = {.blend = true, .blendSrc = GL_ONE, .blendDst = GL_ONE,
+        .depthTest = true, .depthWrite = false, .cullFace = false};
+    GLuint RendererV2::m_particleVAO = 0;
+    StreamBuffer RendererV2::m_particleStream;
+    GLuint RendererV2::m_particleStreamBuffer = 0;
+    uint32_t RendererV2::m_particleDrawCalls = 0;
+    ShaderProgram* RendererV2::m_pImpostorShader = nullptr;
+    //the impostors write the depth of the surface in the atlas, the quads face the camera
+    PipelineState RendererV2::m_impostorPSO = {.blend = false, .depthTest = true, .cullFace = false};
+    GLuint RendererV2::m_impostorVAO = 0;
+    StreamBuffer RendererV2::m_impostorStream;
+    GLuint RendererV2::m_impostorStreamBuffer = 0;
+    std::vector<RendererV2::ImpostorDraw> RendererV2::m_impostorDraws;
+    std::vector<ImpostorInstance> RendererV2::m_impostorInstances;
+    uint32_t RendererV2::m_impostorDrawCalls = 0;
+    LightClusters RendererV2::m_lightClusters;
+    bool RendererV2::m_profilerOverlay = false;
+    uint32_t RendererV2::m_overlayFrame = 0;
+    std::vector<Text*> RendererV2::m_overlayLines;
+    std::vector<TextRenderObject> RendererV2::m_textDraws;
+    bool RendererV2::m_dynamicResolution = false;
+    DynamicResolution RendererV2::m_resolutionController;
+    uint64_t RendererV2::m_resolvedFrame = 0;
+    float RendererV2::m_upscaleSharpness = 0.5f;
+    GLuint RendererV2::m_offscreenFBO = 0;
+    GLuint RendererV2::m_offscreenColor = 0;
+    GLuint RendererV2::m_offscreenDepth = 0;
+    GLsizei RendererV2::m_offscreenWidth = 0;
+    GLsizei RendererV2::m_offscreenHeight = 0;
 
     void RendererV2::Initialize()
     {
@@ -346,98 +537,236 @@ namespace SpaceEngine
         {
             m_pHDRShader = ShaderManager::findShaderProgram("hdr"); 
             m_pHDRShader->use();
-            m_pHDRShader->setUniform("scene", 0);
-            m_pHDRShader->setUniform("highlight", 1);
+            m_pHDRShader->setUniform("scene", static_cast<int>(SceneTexUnit));
+            m_pHDRShader->setUniform("highlight", static_cast<int>(HighlightTexUnit));
             m_pHDRShader->setUniform("exposure", 1.5f);
+            m_hdrPSO.program = m_pHDRShader->getHandle();
 
             GL_CHECK_ERRORS();
 
-            //enable HDR range for rendering
-            m_HDRFrameBuffer.init();
+            //postprocessing: bloom vfx
+            m_bloom.init();
+            //HDR targets and passes
+            m_graph.setSize(WindowManager::width, WindowManager::height);
+            buildGraph();
             GL_CHECK_ERRORS();
-            m_HDRFrameBuffer.bindFrameBuffer();
-            m_HDRFrameBuffer.addColorBuffer();
-            m_HDRFrameBuffer.addColorBuffer();
-            m_HDRFrameBuffer.addColorBuffer();
-            GL_CHECK_ERRORS();
-            //attach depth info
-            m_HDRFrameBuffer.addRenderBuffer();
-            //use the color attachments for rendering
-            m_HDRFrameBuffer.drawBuffers(1);
+
+            m_uiBatcher.init();
+            //room for 256 draws a frame, the rings grow when needed
+            m_instanceStream.init(GL_ARRAY_BUFFER, sizeof(MeshInstance) * 256, "instances");
+            m_indirectStream.init(GL_DRAW_INDIRECT_BUFFER, sizeof(DrawElementsIndirectCommand) * 256, "indirect draws");
+            //particles: instanced quads, no vertex buffer
+            m_pParticleShader = ShaderManager::findShaderProgram("particle");
+            m_particlePSO.program = m_pParticleShader->getHandle();
+            glGenVertexArrays(1, &m_particleVAO);
+            m_particleStream.init(GL_ARRAY_BUFFER, sizeof(ParticleInstance) * 1024, "particles");
+            bindParticleStream(0);
+            //impostors: instanced quads like the particles, shaded by the pbr program
+            m_pImpostorShader = ShaderManager::getVariant("pbr", {"IMPOSTOR"});
+            m_impostorPSO.program = m_pImpostorShader->getHandle();
+            glGenVertexArrays(1, &m_impostorVAO);
+            m_impostorStream.init(GL_ARRAY_BUFFER, sizeof(ImpostorInstance) * 256, "impostors");
+            bindImpostorStream(0);
+            m_lightClusters.init();
+            GPUProfiler::init();
+        }
+
+    }
+
+    void RendererV2::Shutdown()
+    {
+        for(Text* pText : m_overlayLines)
+            delete pText;
+        m_overlayLines.clear();
+
+        setOffscreen(false);
+        GPUProfiler::shutdown();
+        m_uiBatcher.destroy();
+        m_instanceStream.destroy();
+        m_indirectStream.destroy();
+        m_particleStream.destroy();
+        GLStateCache::onDeleteVertexArray(m_particleVAO);
+        glDeleteVertexArrays(1, &m_particleVAO);
+        m_particleVAO = 0;
+        m_particleStreamBuffer = 0;
+        m_impostorStream.destroy();
+        GLStateCache::onDeleteVertexArray(m_impostorVAO);
+        glDeleteVertexArrays(1, &m_impostorVAO);
+        m_impostorVAO = 0;
+        m_impostorStreamBuffer = 0;
+        ImpostorManager::destroy();
+        m_lightClusters.destroy();
+        m_graph.reset();
+    }
+
+    void RendererV2::buildGraph()
+    {
+        m_graph.reset();
+        m_graphBloom = m_bloomVFX;
+        m_sceneColorTargets = m_graphBloom ? MaxSceneColorTargets : 1;
+        m_bloom.setFormat(m_hdrFormats.bloom);
+
+        //the depth is only tested: a renderbuffer of the graph
+        m_hdrColor = m_graph.createTexture("hdr_color", {.format = m_hdrFormats.color});
+        m_hdrBright = m_graphBloom ? m_graph.createTexture("hdr_bright", {.format = m_hdrFormats.bright}) : RGInvalidResource;
+        m_hdrDepth = m_graph.createTexture("hdr_depth", {.format = m_hdrFormats.depth});
+
+        //render the scene into floating point framebuffer
+        auto drawScene = []()
+        {
+            //glClear is affected by the depth mask
+            GLStateCache::depthMask(true);
+            glClearColor(0.f, 0.f, 0.f, 1.f);
+            GLStateCache::drawBuffers(m_sceneColorTargets);
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            GLStateCache::drawBuffers(1);
             GL_CHECK_ERRORS();
-            GL_CHECK_FRAMEBUFFER_STATUS();
-            m_HDRFrameBuffer.unbindFrameBuffer();
 
-            //postprocessing buffers: bloom vfx
-            if(!m_pBloomShader)
+            if(m_frame.pScreen)
+            {
+                GPUProfileScope scope("screen");
+                drawScreen(*m_frame.pScreen);
+            }
+            //the skybox section is opened inside
+            if(m_frame.pParams) drawMeshes(*m_frame.pParams);
+            if(m_frame.pParams && m_frame.pParams->view)
             {
-                m_pBloomShader = ShaderManager::findShaderProgram("bloomVFX");
+                GPUProfileScope scope("particles");
+                drawParticles(*m_frame.pParams->view);
+            }
+        };
 
-                //double buffer
-                for(int i = 0; i < 2; i++)
-                {
-                    //enable HDR range for rendering
-                    m_BloomFrameBuffers[i].init();
-                    m_BloomFrameBuffers[i].bindFrameBuffer();
-                    GL_CHECK_ERRORS();
-                    m_BloomFrameBuffers[i].addColorBuffer();
-                    GL_CHECK_ERRORS();
-                    GL_CHECK_FRAMEBUFFER_STATUS();
+        //tone mapping on the default framebuffer, UI and text are drawn on top at the window resolution
+        auto drawOutput = []()
+        {
+            {
+                GPUProfileScope scope("tonemap");
+                composite();
+            }
+            if(m_frame.pUI)
+            {
+                GPUProfileScope scope("ui");
+                drawUI(*m_frame.pUI);
+            }
+            //the overlay lines go with the text of the frame: the text ring advances once a frame
+            m_textDraws.clear();
+            if(m_frame.pText)
+                m_textDraws.insert(m_textDraws.end(), m_frame.pText->begin(), m_frame.pText->end());
+            appendProfilerOverlay(m_textDraws);
+            if(!m_textDraws.empty())
+            {
+                GPUProfileScope scope("text");
+                drawText(m_textDraws);
+            }
+        };
 
-                }
+        if(m_graphBloom)
+        {
+            m_graph.addPass("scene", {}, {m_hdrColor, m_hdrBright, m_hdrDepth}, drawScene);
+            m_bloomResult = m_bloom.addPasses(m_graph, m_hdrBright);
+            m_graph.addPass("hdr", {m_hdrColor, m_hdrBright, m_bloomResult}, {}, drawOutput);
+        }
+        else
+        {
+            m_graph.addPass("scene", {}, {m_hdrColor, m_hdrDepth}, drawScene);
+            m_bloomResult = RGInvalidResource;
+            m_graph.addPass("hdr", {m_hdrColor}, {}, drawOutput);
+        }
 
-                m_pBloomShader->use();
-                m_pBloomShader->setUniform("BlurTex", 0);
-                GL_CHECK_ERRORS();
+        m_graph.compile();
+    }
 
-                ////sample the gauss filter
-                //float weights[10], sum, sigma2 = 9.f;
-//
-                //weights[0] = Math::gauss(0, sigma2);
-                //sum = weights[0];
-//
-                //for(int i = 1; i < 10; i++)
-                //{
-                //    weights[i] = Math::gauss(float(i), sigma2);
-                //    sum += 2 * weights[i]; 
-                //}
-//
-                ////normalize weights and set the uniform
-                //for(int i = 0; i < 10; i++)
-                //{
-                //    std::string strWeight = "Weight[" + std::to_string(i) + "]"; 
-                //    float val = weights[i] / sum;
-                //    m_pBloomShader->setUniform(strWeight.c_str(), val);
-                //}
-                //GL_CHECK_ERRORS();
-                glUseProgram(0);
-            }
+    void RendererV2::setBloomMipCount(uint8_t count)
+    {
+        m_bloom.setMipCount(count);
+        //the chain changes shape
+        if(m_pHDRShader)
+            buildGraph();
+    }
+
+    void RendererV2::setBloomFilterRadius(float radius)
+    {
+        m_bloom.setFilterRadius(radius);
+    }
+
+    void RendererV2::setHDRFormats(const HDRFormats& formats)
+    {
+        m_hdrFormats = formats;
+        if(m_pHDRShader)
+            buildGraph();
+    }
+
+    void RendererV2::setDynamicResolution(bool flag, float targetMs)
+    {
+        if(flag && !GPUProfiler::isSupported())
+        {
+            SPACE_ENGINE_WARN("RendererV2: no GPU timers, the dynamic resolution stays off");
+            return;
         }
 
+        m_dynamicResolution = flag;
+        m_resolutionController.setTargetFrameTime(targetMs);
+        m_resolutionController.reset();
+        m_resolvedFrame = GPUProfiler::getResolvedFrames();
+        m_graph.setRenderScale(m_resolutionController.getScale());
     }
 
-    void RendererV2::Shutdown()
+    void RendererV2::setRenderScale(float scale)
     {
+        m_dynamicResolution = false;
+        m_graph.setRenderScale(scale);
+    }
 
+    void RendererV2::updateRenderScale()
+    {
+        //one sample per GPU frame read back
+        if(!m_dynamicResolution || GPUProfiler::getResolvedFrames() == m_resolvedFrame)
+            return;
+
+        m_resolvedFrame = GPUProfiler::getResolvedFrames();
+        const GPUTimerStats* pFrame = GPUProfiler::findStats("frame");
+        if(pFrame && m_resolutionController.addFrameTime(pFrame->lastMs))
+        {
+            SPACE_ENGINE_DEBUG("RendererV2 - render scale {} (GPU frame {} ms)", m_resolutionController.getScale(), pFrame->avgMs);
+            m_graph.setRenderScale(m_resolutionController.getScale());
+        }
     }
 
     void RendererV2::clear()
     {
-        //clear screen
-        glClearColor(0.f, 0.f, 0.f, 1.f);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-        
-        //render the scene into floating point framebuffer
-        m_HDRFrameBuffer.bindFrameBuffer();
-        m_HDRFrameBuffer.drawBuffers(3);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-        m_HDRFrameBuffer.drawBuffers(1);
-        GL_CHECK_ERRORS();
+        m_frame = FrameLists();
+        //apply a settled resize before the targets are used
+        m_graph.update();
+        GPUProfiler::beginFrame();
+        //the frames read back by the profiler pick the scale of the targets
+        updateRenderScale();
     }
 
-    //screen shaders render
     void RendererV2::render(const std::vector<ScreenRenderObject>& screenRenderables)
     {
+        m_frame.pScreen = &screenRenderables;
+    }
+
+    void RendererV2::render(const RendererParams& rParams)
+    {
+        m_frame.pParams = &rParams;
+    }
+
+    void RendererV2::render(const std::vector<UIRenderObject>& uiRenderables)
+    {
+        m_frame.pUI = &uiRenderables;
+    }
+
+    void RendererV2::render(const std::vector<TextRenderObject>& textRenderables)
+    {
+        m_frame.pText = &textRenderables;
+    }
+
+    //screen shaders render
+    void RendererV2::drawScreen(const std::vector<ScreenRenderObject>& screenRenderables)
+    {
+        GLStateCache::bindPipeline(m_screenPSO);
+
         for (const auto& screenR : screenRenderables)
         {
             if (!screenR.pPlaneMesh || !screenR.pMaterial) continue;
@@ -448,116 +777,397 @@ namespace SpaceEngine
             {
                 shader->use();
                 screenR.pMaterial->bindingPropsToShader();
-                shader->setUniform("res", Vector2{WindowManager::width, WindowManager::height});
+                //size of the targets, it differs from the window with a render scale or while a resize is pending
+                shader->setUniform("res", Vector2{m_graph.getRenderWidth(), m_graph.getRenderHeight()});
             }
 
             //draw
             screenR.pPlaneMesh->bindVAO();
             screenR.pPlaneMesh->draw();
             GL_CHECK_ERRORS();
-            glUseProgram(0);
         }
     }
     
     //mesh render
-    void RendererV2::render(const RendererParams& rParams)
+    void RendererV2::drawMeshes(const RendererParams& rParams)
     {
-        glEnable(GL_BLEND);
-        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-
-        if(rParams.cam)
+        GPUProfiler::begin("pbr");
+        GLStateCache::bindPipeline(m_meshPSO);
+        m_meshDrawCalls = 0;
+        m_meshIndices = 0;
+        m_impostorDrawCalls = 0;
+        m_impostorDraws.clear();
+        m_impostorInstances.clear();
+
+        if(rParams.view)
         {
+            m_meshDraws.clear();
             for(const auto& renderObj : rParams.renderables)
             {
                 if(!renderObj.mesh ) continue;
 
+                //in the fade band both are drawn, with complementary dithers
+                const ImpostorAtlas* pAtlas = renderObj.meshFade < 1.f ? ImpostorManager::find(renderObj.mesh) : nullptr;
+                if(pAtlas)
+                {
+                    m_impostorDraws.push_back({pAtlas, &renderObj});
+                    if(renderObj.meshFade <= 0.f)
+                        continue;
+                }
+
                 for(int idSubMesh = 0, nSubMesh = renderObj.mesh->getNumSubMesh();  idSubMesh < nSubMesh; idSubMesh++)
                 {
-                    GL_CHECK_ERRORS();
-                    //get shader
-                    ShaderProgram* shader = renderObj.mesh->getMaterialBySubMeshIndex(idSubMesh)->getShader();
-                    if(shader)
-                    {
-                        m_HDRFrameBuffer.drawBuffers(shader->getMRTBuffers());
-                        shader->use();
-                        GL_CHECK_ERRORS();
-                        //bind material
-                        renderObj.mesh->getMaterialBySubMeshIndex(idSubMesh)->bindingPropsToShader();
-                        //set matrices
-                        shader->setUniform("model", renderObj.modelMatrix);
-                        shader->setUniform("view", rParams.cam->getViewMatrix());
-                        shader->setUniform("projection", rParams.cam->getProjectionMatrix());
-                        //lights bind
-                        if(shader->isPresentUniform("lights[0].pos") && rParams.lights.size())
-                        {
-                            shader->setUniform("normalMatrix", Math::transpose(Math::inverse(Matrix3(renderObj.modelMatrix))));
-                            GL_CHECK_ERRORS();
-                            
+                    BaseMaterial* pMat = renderObj.mesh->getMaterialBySubMeshIndex(idSubMesh);
+                    if(!pMat || !pMat->getShader())
+                        continue;
 
-                            for(int i = 0; i < rParams.lights.size(); i++)
-                            {
-                                std::string strLight = "lights[" + std::to_string(i) + "].pos"; 
-                                shader->setUniform(strLight.c_str(), rParams.lights[i]->pos);
-                                GL_CHECK_ERRORS();
-                                strLight = "lights[" + std::to_string(i) + "].color"; 
-                                shader->setUniform(strLight.c_str(), rParams.lights[i]->color);
-                                GL_CHECK_ERRORS();
-                                strLight = "lights[" + std::to_string(i) + "].dir"; 
-                                shader->setUniform(strLight.c_str(), rParams.lights[i]->dir);
-                                GL_CHECK_ERRORS();
-                                strLight = "lights[" + std::to_string(i) + "].type"; 
-                                shader->setUniform(strLight.c_str(), rParams.lights[i]->type);
-                                GL_CHECK_ERRORS();
-                            }
-                        }
+                    ShaderProgram* pShader = pAtlas && pMat->pFadeShader ? pMat->pFadeShader : pMat->getShader();
+                    m_meshDraws.push_back({pShader, pMat, &renderObj, static_cast<uint32_t>(idSubMesh)});
+                }
+            }
 
-                        //call the draw for the mesh
-                        renderObj.mesh->bindVAO();
-                        renderObj.mesh->drawSubMesh(idSubMesh);
-                        GL_CHECK_ERRORS();
-                    }
-                    glUseProgram(0);
-                }    
+            //the blended draws go after the opaque ones in the order of the scene, the blend
+            //doesn't commute; the opaque draws overwrite and are grouped by program and material
+            auto firstBlended = std::stable_partition(m_meshDraws.begin(), m_meshDraws.end(), [](const MeshDraw& draw)
+            {
+                return !draw.pMaterial->isTranslucent();
+            });
+            std::stable_sort(m_meshDraws.begin(), firstBlended, [](const MeshDraw& a, const MeshDraw& b)
+            {
+                if(a.pShader != b.pShader)
+                    return std::less<ShaderProgram*>()(a.pShader, b.pShader);
+                return std::less<BaseMaterial*>()(a.pMaterial, b.pMaterial);
+            });
+
+            const size_t numDraws = m_meshDraws.size();
+            m_meshInstances.resize(numDraws);
+            m_meshCommands.resize(numDraws);
+
+            for(size_t i = 0; i < numDraws; i++)
+            {
+                const MeshDraw& draw = m_meshDraws[i];
+                const Matrix4& model = draw.pObj->modelMatrix;
+                Matrix3 normalMatrix = Math::transpose(Math::inverse(Matrix3(model)));
+
+                MeshInstance& instance = m_meshInstances[i];
+                instance.model = model;
+                for(int c = 0; c < 3; c++)
+                    instance.normalMatrix[c] = Vector4(normalMatrix[c], 0.f);
+                instance.normalMatrix[0].w = draw.pObj->meshFade;
+
+                m_meshCommands[i] = draw.pObj->mesh->getDrawCommand(draw.subMesh, draw.pObj->lod);
+                m_meshCommands[i].baseInstance = static_cast<GLuint>(i);
+                m_meshIndices += m_meshCommands[i].count;
+            }
+
+            m_instanceStream.beginFrame();
+            m_indirectStream.beginFrame();
+            GLintptr instanceOffset = m_instanceStream.upload(m_meshInstances.data(),
+                static_cast<GLsizeiptr>(sizeof(MeshInstance) * numDraws), sizeof(MeshInstance));
+            GLintptr commandOffset = 0;
+            if(glMultiDrawElementsIndirect)
+            {
+                commandOffset = m_indirectStream.upload(m_meshCommands.data(),
+                    static_cast<GLsizeiptr>(sizeof(DrawElementsIndirectCommand) * numDraws), sizeof(DrawElementsIndirectCommand));
+                glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_indirectStream.getBuffer());
             }
-            m_HDRFrameBuffer.drawBuffers(1);
+
+            //all the meshes share the vertex array, the base instance picks the instance of the draw
+            GeometryArena::setInstanceBuffer(m_instanceStream.getBuffer(), instanceOffset);
+            GeometryArena::bindVAO();
+
+            m_lightClusters.build(*rParams.view, rParams.lights);
+            m_lightClusters.upload();
+
+            ShaderProgram* pLastShader = nullptr;
+            for(size_t first = 0; first < numDraws;)
+            {
+                const MeshDraw& batch = m_meshDraws[first];
+                size_t last = first + 1;
+                while(last < numDraws && m_meshDraws[last].pShader == batch.pShader && m_meshDraws[last].pMaterial == batch.pMaterial)
+                    last++;
+
+                ShaderProgram* shader = batch.pShader;
+                GL_CHECK_ERRORS();
+                if(shader != pLastShader)
+                {
+                    GLStateCache::drawBuffers(std::min(shader->getMRTBuffers(), m_sceneColorTargets));
+                    shader->use();
+                    GL_CHECK_ERRORS();
+                    //set matrices
+                    shader->setUniform("view", rParams.view->view);
+                    shader->setUniform("projection", rParams.view->projection);
+                    shader->setUniform("camPos", rParams.view->pos);
+                    //global lights and light clusters
+                    if(shader->isPresentUniform("numLights"))
+                        m_lightClusters.bind(*shader, m_graph.getRenderWidth(), m_graph.getRenderHeight());
+                    pLastShader = shader;
+                }
+
+                //bind material, the fade program isn't the program of the material
+                if(batch.pShader == batch.pMaterial->getShader())
+                    batch.pMaterial->bindingPropsToShader();
+                else batch.pMaterial->bindingPropsToProgram(*batch.pShader);
+                submitMeshBatch(commandOffset, instanceOffset, first, last - first);
+                GL_CHECK_ERRORS();
+                first = last;
+            }
+
+            if(glMultiDrawElementsIndirect)
+                glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+            m_instanceStream.endFrame();
+            m_indirectStream.endFrame();
+            drawImpostors(*rParams.view);
+            m_lightClusters.endFrame();
+            GLStateCache::drawBuffers(1);
         }
-        if(rParams.pSkybox)
+        GPUProfiler::end();
+
+        if(rParams.pSkybox && rParams.view)
         {
+            GPUProfileScope scope("skybox");
             GL_CHECK_ERRORS();
             ShaderProgram* pShaderSkybox = rParams.pSkybox->pShader;
-            Matrix4 viewNoTransl = Matrix4(Matrix3(rParams.cam->getViewMatrix()));
+            Matrix4 viewNoTransl = Matrix4(Matrix3(rParams.view->view));
             pShaderSkybox->use();
             pShaderSkybox->setUniform("view", viewNoTransl);
-            pShaderSkybox->setUniform("projection", rParams.cam->getProjectionMatrix());
+            pShaderSkybox->setUniform("projection", rParams.view->projection);
             pShaderSkybox->setUniform("skybox", 0);
-            // disegna la skybox come se fosse lontanissima
-            glDepthFunc(GL_LEQUAL);
-            glDisable(GL_CULL_FACE);
+            GLStateCache::bindPipeline(m_skyboxPSO);
 
             rParams.pSkybox->bindTex();
             rParams.pSkybox->bindVAO();
             rParams.pSkybox->draw();
-
-            glEnable(GL_CULL_FACE);
-            glDepthFunc(GL_LESS);
             GL_CHECK_ERRORS();
-            glUseProgram(0);
         }
     }
     
-    //UI render
-    void RendererV2::render(const std::vector<UIRenderObject>& uiRenderables)
+    void RendererV2::submitMeshBatch(GLintptr commandOffset, GLintptr instanceOffset, size_t first, size_t count)
     {
-        glDisable(GL_DEPTH_TEST);
-        glEnable(GL_BLEND);
-        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-        glDisable(GL_CULL_FACE);
+        constexpr GLsizei stride = sizeof(DrawElementsIndirectCommand);
+
+        if(glMultiDrawElementsIndirect)
+        {
+            glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT,
+                reinterpret_cast<const void*>(commandOffset + stride * first), static_cast<GLsizei>(count), stride);
+            m_meshDrawCalls++;
+            return;
+        }
+
+        //GL 4.0: one draw per command
+        for(size_t i = first; i < first + count; i++)
+        {
+            const DrawElementsIndirectCommand& cmd = m_meshCommands[i];
+            const void* pIndices = reinterpret_cast<const void*>(sizeof(GLuint) * cmd.firstIndex);
+
+            if(glDrawElementsInstancedBaseVertexBaseInstance)
+            {
+                glDrawElementsInstancedBaseVertexBaseInstance(GL_TRIANGLES, cmd.count, GL_UNSIGNED_INT, pIndices,
+                    1, cmd.baseVertex, cmd.baseInstance);
+            }
+            else
+            {
+                //no base instance, the instanced attributes point the instance of the draw
+                GeometryArena::setInstanceBuffer(m_instanceStream.getBuffer(), instanceOffset + sizeof(MeshInstance) * cmd.baseInstance);
+                glDrawElementsInstancedBaseVertex(GL_TRIANGLES, cmd.count, GL_UNSIGNED_INT, pIndices, 1, cmd.baseVertex);
+            }
+            m_meshDrawCalls++;
+        }
+    }
+
+    void RendererV2::bindImpostorStream(GLintptr offset)
+    {
+        constexpr GLsizei stride = sizeof(ImpostorInstance);
+
+        GLStateCache::bindVertexArray(m_impostorVAO);
+        glBindBuffer(GL_ARRAY_BUFFER, m_impostorStream.getBuffer());
+        glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, stride, (const void*)(offset + offsetof(ImpostorInstance, centerRadius)));
+        glEnableVertexAttribArray(0);
+        glVertexAttribDivisor(0, 1);
+        for(GLuint i = 0; i < 3; i++)
+        {
+            glVertexAttribPointer(1 + i, 4, GL_FLOAT, GL_FALSE, stride,
+                (const void*)(offset + offsetof(ImpostorInstance, rotation) + sizeof(Vector4) * i));
+            glEnableVertexAttribArray(1 + i);
+            glVertexAttribDivisor(1 + i, 1);
+        }
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        m_impostorStreamBuffer = m_impostorStream.getBuffer();
+        GL_CHECK_ERRORS();
+    }
+
+    void RendererV2::drawImpostors(const CameraView& view)
+    {
+        if(m_impostorDraws.empty())
+            return;
+
+        //the atlas changes only between the batches
+        std::stable_sort(m_impostorDraws.begin(), m_impostorDraws.end(), [](const ImpostorDraw& a, const ImpostorDraw& b)
+        {
+            return std::less<const ImpostorAtlas*>()(a.pAtlas, b.pAtlas);
+        });
+
+        const size_t numDraws = m_impostorDraws.size();
+        m_impostorInstances.resize(numDraws);
+        for(size_t i = 0; i < numDraws; i++)
+        {
+            const ImpostorDraw& draw = m_impostorDraws[i];
+            const Matrix4& model = draw.pObj->modelMatrix;
+            //the rotation without the scale, the sphere takes the biggest axis scale like the culling
+            Vector3 axes[3];
+            float scale = 0.f;
+            for(int c = 0; c < 3; c++)
+            {
+                float length = glm::length(Vector3(model[c]));
+                axes[c] = length > 0.f ? Vector3(model[c]) / length : Vector3(0.f);
+                scale = std::max(scale, length);
+            }
+
+            ImpostorInstance& instance = m_impostorInstances[i];
+            instance.centerRadius = Vector4(Vector3(model * Vector4(draw.pAtlas->center, 1.f)), draw.pAtlas->radius * scale);
+            for(int c = 0; c < 3; c++)
+                instance.rotation[c] = Vector4(axes[c], 0.f);
+            instance.rotation[0].w = draw.pObj->meshFade;
+        }
+
+        constexpr GLsizeiptr stride = sizeof(ImpostorInstance);
+        m_impostorStream.beginFrame();
+        GLintptr offset = m_impostorStream.upload(m_impostorInstances.data(), stride * static_cast<GLsizeiptr>(numDraws), stride);
+        if(m_impostorStream.getBuffer() != m_impostorStreamBuffer)
+            bindImpostorStream(0);
+
+        ShaderProgram* shader = m_pImpostorShader;
+        GLStateCache::bindPipeline(m_impostorPSO);
+        GLStateCache::drawBuffers(std::min(shader->getMRTBuffers(), m_sceneColorTargets));
+        GLStateCache::bindVertexArray(m_impostorVAO);
+        shader->use();
+        shader->setUniform("view", view.view);
+        shader->setUniform("projection", view.projection);
+        shader->setUniform("camPos", view.pos);
+        shader->setUniform("impostorGrid", static_cast<float>(ImpostorManager::GridSize));
+        shader->setUniform("albedo_color_val", Vector4(1.f));
+        shader->setSampler("impostor_albedo", ImpostorManager::AlbedoTexUnit);
+        shader->setSampler("impostor_normal_depth", ImpostorManager::NormalDepthTexUnit);
+        m_lightClusters.bind(*shader, m_graph.getRenderWidth(), m_graph.getRenderHeight());
+
+        for(size_t first = 0; first < numDraws;)
+        {
+            const ImpostorAtlas* pAtlas = m_impostorDraws[first].pAtlas;
+            size_t last = first + 1;
+            while(last < numDraws && m_impostorDraws[last].pAtlas == pAtlas)
+                last++;
+
+            GLStateCache::bindTexture(ImpostorManager::AlbedoTexUnit, GL_TEXTURE_2D, pAtlas->albedo);
+            GLStateCache::bindTexture(ImpostorManager::NormalDepthTexUnit, GL_TEXTURE_2D, pAtlas->normalDepth);
+            shader->setUniform("metallic_val", pAtlas->metalness);
+            shader->setUniform("roughness_val", pAtlas->roughness);
+            shader->setUniform("ambient_occlusion_val", pAtlas->ambientOcclusion);
+
+            //the offset is aligned to the instance size
+            GLuint baseInstance = static_cast<GLuint>(offset / stride + first);
+            GLsizei count = static_cast<GLsizei>(last - first);
+            if(glDrawArraysInstancedBaseInstance)
+            {
+                glDrawArraysInstancedBaseInstance(GL_TRIANGLE_STRIP, 0, 4, count, baseInstance);
+            }
+            else
+            {
+                //GL 4.0: the attributes point the first instance of the batch
+                bindImpostorStream(stride * baseInstance);
+                glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, count);
+            }
+            m_impostorDrawCalls++;
+            first = last;
+        }
+
+        if(!glDrawArraysInstancedBaseInstance)
+            bindImpostorStream(0);
+        m_impostorStream.endFrame();
+        GL_CHECK_ERRORS();
+    }
+
+    void RendererV2::bindParticleStream(GLintptr offset)
+    {
+        constexpr GLsizei stride = sizeof(ParticleInstance);
+
+        GLStateCache::bindVertexArray(m_particleVAO);
+        glBindBuffer(GL_ARRAY_BUFFER, m_particleStream.getBuffer());
+        glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, stride, (const void*)(offset + offsetof(ParticleInstance, posSize)));
+        glEnableVertexAttribArray(0);
+        glVertexAttribDivisor(0, 1);
+        glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, stride, (const void*)(offset + offsetof(ParticleInstance, color)));
+        glEnableVertexAttribArray(1);
+        glVertexAttribDivisor(1, 1);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        m_particleStreamBuffer = m_particleStream.getBuffer();
+        GL_CHECK_ERRORS();
+    }
+
+    void RendererV2::drawParticles(const CameraView& view)
+    {
+        m_particleDrawCalls = 0;
+        const std::vector<ParticleInstance>& instances = ParticleSystem::getInstances();
+        if(instances.empty())
+            return;
+
+        constexpr GLsizeiptr stride = sizeof(ParticleInstance);
+        m_particleStream.beginFrame();
+        GLintptr offset = m_particleStream.upload(instances.data(), stride * static_cast<GLsizeiptr>(instances.size()), stride);
+        if(m_particleStream.getBuffer() != m_particleStreamBuffer)
+            bindParticleStream(0);
+
+        GLStateCache::bindPipeline(m_particlePSO);
+        GLStateCache::drawBuffers(m_sceneColorTargets);
+        GLStateCache::bindVertexArray(m_particleVAO);
+        m_pParticleShader->use();
+        m_pParticleShader->setUniform("view", view.view);
+        m_pParticleShader->setUniform("projection", view.projection);
+        m_pParticleShader->setSampler("sprite_tex", 0);
+
+        for(const ParticleBatch& batch : ParticleSystem::getBatches())
+        {
+            Texture* pTex = batch.pMaterial->pTexture;
+            m_pParticleShader->setUniform("useTexture", pTex != nullptr);
+            m_pParticleShader->setUniform("bloom", batch.pMaterial->bloom);
+            if(pTex)
+                GLStateCache::bindTexture(0, GL_TEXTURE_2D, pTex->getTexture());
+
+            //the offset is aligned to the instance size
+            GLuint baseInstance = static_cast<GLuint>(offset / stride) + batch.first;
+            if(glDrawArraysInstancedBaseInstance)
+            {
+                glDrawArraysInstancedBaseInstance(GL_TRIANGLE_STRIP, 0, 4, static_cast<GLsizei>(batch.count), baseInstance);
+            }
+            else
+            {
+                //GL 4.0: the attributes point the first instance of the batch
+                bindParticleStream(stride * baseInstance);
+                glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, static_cast<GLsizei>(batch.count));
+            }
+            m_particleDrawCalls++;
+        }
 
+        if(!glDrawArraysInstancedBaseInstance)
+            bindParticleStream(0);
+        m_particleStream.endFrame();
+        GLStateCache::drawBuffers(1);
+        GL_CHECK_ERRORS();
+    }
+
+    //UI render
+    void RendererV2::drawUI(const std::vector<UIRenderObject>& uiRenderables)
+    {
+        GLStateCache::bindPipeline(m_uiPSO);
+        m_uiBatcher.begin();
 
         for (const auto& ui : uiRenderables)
         {
             if (!ui.pUIMesh || !ui.pMaterial) continue;
 
+            if (m_uiBatcher.submit(ui)) continue;
+
+            //custom shader, keep the painter order and draw it on its own
+            m_uiBatcher.flush();
             ShaderProgram* shader = ui.pMaterial->getShader();
             GL_CHECK_ERRORS();
             if (shader)
@@ -572,20 +1182,17 @@ namespace SpaceEngine
             ui.pUIMesh->bindVAO();
             ui.pUIMesh->draw();
             GL_CHECK_ERRORS();
-            glUseProgram(0);
         }
 
-        glDisable(GL_BLEND);
-        glEnable(GL_DEPTH_TEST);
-        glEnable(GL_CULL_FACE);
-
+        m_uiBatcher.flush();
     }
     
     //Text render
-    void RendererV2::render(const std::vector<TextRenderObject>& textRenderables)
+    void RendererV2::drawText(const std::vector<TextRenderObject>& textRenderables)
     {
-        glDisable(GL_DEPTH_TEST);
-        glEnable(GL_BLEND);
+        GLStateCache::bindPipeline(m_textPSO);
+        TextMesh::beginFrame();
+
         for(TextRenderObject textRendObj : textRenderables)
         {
             TextMaterial* pMat = textRendObj.pText->pTextMeshRend->getMaterial();
@@ -598,104 +1205,206 @@ namespace SpaceEngine
                 pMat->bindingPropsToShader();
                 pShader->setUniform("projection", WindowManager::sceenProjMatrix);
                 pShader->setUniform("text_tex", 0);
-                std::string string = textRendObj.pText->getString();
-                Transform2D& transf = *textRendObj.pText->pTransf;
-                //resolution adaption
-                float resScale = 1.f;
-                float offsetX = 0.f;
-                Vector2 finalOffset = {0.f, 0.f}; 
-                Vector2 finalPos = {transf.pos.x, transf.pos.y};
-
-                Utils::applyRatioScreenRes(transf.anchor, transf.pos, resScale, finalOffset, finalPos);
-                transf.setDirty(false);
-                
-                
-                offsetX = finalPos.x;
-                pMesh->bindVAO();
+                //the quads are rebuilt only when the text changes
+                textRendObj.pText->updateLayout();
 
-                for(auto c = string.begin(); c != string.end(); ++c)
-                {
-                    GL_CHECK_ERRORS();
-                    std::array<std::array<float, 4>, 6> data = pMat->bindCharacter(*c, offsetX, resScale, finalPos, transf);
-                    pMesh->subData(data);
-                    GL_CHECK_ERRORS();
-                    pMesh->draw();
-                    GL_CHECK_ERRORS();
-                }
-                glBindVertexArray(0);
-                glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+                pMat->bindAtlas();
+                pMesh->bindVAO();
+                pMesh->draw();
+                GL_CHECK_ERRORS();
             }
         }
-        
-        glDisable(GL_BLEND);
-        glEnable(GL_DEPTH_TEST);
-        glUseProgram(0);
+
+        //the quads of the frame are read by the draws above
+        TextMesh::endFrame();
     }
 
     void RendererV2::postprocessing(bool bloomVFX)
     {
-        m_HDRFrameBuffer.unbindFrameBuffer();
-        PlaneMesh* pPlaneMesh = MeshManager::getPlaneMesh();
-        bool horizontal = true;
-        
-        #if 1
-        if(bloomVFX && m_pBloomShader)
-        {
-            uint32_t amount = 10; //apply 5 times the 2D gaussian filter
-            
-            //apply the gaussian filter on the scene render buffer
-            m_BloomFrameBuffers[1].bindFrameBuffer();
-            m_pBloomShader->use();
-            m_pBloomShader->setUniform("horizontal", horizontal);
-            glActiveTexture(GL_TEXTURE0);
-            glBindTexture(GL_TEXTURE_2D, m_HDRFrameBuffer.getColorBuffer(1));
-            pPlaneMesh->bindVAO();
-            pPlaneMesh->draw();
-            horizontal = !horizontal;
-
-            for(uint32_t i = 1; i < amount; i++)
-            {
-                m_pBloomShader->use();
-                m_BloomFrameBuffers[horizontal].bindFrameBuffer();
-                m_pBloomShader->setUniform("horizontal", horizontal);
-                glActiveTexture(GL_TEXTURE0);
-                glBindTexture(GL_TEXTURE_2D, m_BloomFrameBuffers[!horizontal].getColorBuffer(0));
-                pPlaneMesh->bindVAO();
-                pPlaneMesh->draw();
-                horizontal = !horizontal;
-            }
+        m_bloomVFX = bloomVFX;
+        m_bloom.setEnabled(bloomVFX);
+        if(m_bloomVFX != m_graphBloom)
+            buildGraph();
+        m_graph.execute();
+        GPUProfiler::endFrame();
+        GL_CHECK_ERRORS();
+    }
 
-            m_BloomFrameBuffers[horizontal].unbindFrameBuffer();
-        }
-        glUseProgram(0);
-        #endif
-        //blending 
+    void RendererV2::composite()
+    {
+        GLStateCache::depthMask(true);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-        m_pHDRShader->use();
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, m_HDRFrameBuffer.getColorBuffer(0));
-        glActiveTexture(GL_TEXTURE1);
-        if(bloomVFX)
-            glBindTexture(GL_TEXTURE_2D, m_BloomFrameBuffers[horizontal ^ 1].getColorBuffer(0));
-        else glBindTexture(GL_TEXTURE_2D, m_HDRFrameBuffer.getColorBuffer(2));
+        GLStateCache::bindPipeline(m_hdrPSO);
+        //the bilinear filter upscales the scene, the sharpening gives back the edges
+        m_pHDRShader->setUniform("sharpness", m_graph.getRenderScale() < 1.f ? m_upscaleSharpness : 0.f);
+        //own units, the binds are skipped until the graph reallocates the targets
+        GLStateCache::bindTexture(SceneTexUnit, GL_TEXTURE_2D, m_graph.getTexture(m_hdrColor));
+        if(m_graphBloom)
+        {
+            GLStateCache::bindTexture(HighlightTexUnit, GL_TEXTURE_2D, m_graph.getTexture(m_bloomResult));
+            m_pHDRShader->setUniform("bloomIntensity", m_bloom.getIntensityScale());
+        }
+        else
+        {
+            //no bright pass without bloom, the unit without texture reads black
+            GLStateCache::bindTexture(HighlightTexUnit, GL_TEXTURE_2D, 0);
+            m_pHDRShader->setUniform("bloomIntensity", 0.f);
+        }
         GL_CHECK_ERRORS();
         
+        PlaneMesh* pPlaneMesh = MeshManager::getPlaneMesh();
         pPlaneMesh->bindVAO();
         pPlaneMesh->draw();
-        glUseProgram(0);
     }
 
     void RendererV2::resizeBuffers(int width, int height)
     {
-        m_HDRFrameBuffer.resize(width, height, 3, true);
-        m_HDRFrameBuffer.bindFrameBuffer();
-        m_HDRFrameBuffer.drawBuffers(1);
-        m_HDRFrameBuffer.unbindFrameBuffer();
+        m_graph.requestResize(width, height);
+    }
 
-        for(int i = 0; i < 2; i++)
-            m_BloomFrameBuffers[i].resize(width, height, 1, false);
-        
+    void RendererV2::setOffscreen(bool flag)
+    {
+        if(m_offscreenFBO)
+        {
+            GLStateCache::onDeleteFramebuffer(m_offscreenFBO);
+            glDeleteFramebuffers(1, &m_offscreenFBO);
+            GLStateCache::onDeleteTexture(m_offscreenColor);
+            glDeleteTextures(1, &m_offscreenColor);
+            glDeleteRenderbuffers(1, &m_offscreenDepth);
+            m_offscreenFBO = m_offscreenColor = m_offscreenDepth = 0;
+            m_offscreenWidth = m_offscreenHeight = 0;
+        }
+
+        if(flag)
+        {
+            const GLsizei width = WindowManager::width;
+            const GLsizei height = WindowManager::height;
+            m_offscreenWidth = width;
+            m_offscreenHeight = height;
+            m_offscreenColor = TextureManager::createStorage2D(GL_RGBA8, 1, width, height);
+            GLDebug::label(GL_TEXTURE, m_offscreenColor, "offscreen color");
+            TextureManager::setParameter2D(m_offscreenColor, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+            TextureManager::setParameter2D(m_offscreenColor, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+            GLStateCache::bindTexture(0, GL_TEXTURE_2D, 0);
+
+            //the composite clears the depth like on the window
+            if(GLStateCache::hasDirectStateAccess())
+            {
+                glCreateRenderbuffers(1, &m_offscreenDepth);
+                glNamedRenderbufferStorage(m_offscreenDepth, GL_DEPTH_COMPONENT24, width, height);
+                //the draw buffer of a new framebuffer is already the color attachment 0
+                glCreateFramebuffers(1, &m_offscreenFBO);
+                glNamedFramebufferTexture(m_offscreenFBO, GL_COLOR_ATTACHMENT0, m_offscreenColor, 0);
+                glNamedFramebufferRenderbuffer(m_offscreenFBO, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, m_offscreenDepth);
+                GL_CHECK_NAMED_FRAMEBUFFER_STATUS(m_offscreenFBO);
+            }
+            else
+            {
+                glGenRenderbuffers(1, &m_offscreenDepth);
+                glBindRenderbuffer(GL_RENDERBUFFER, m_offscreenDepth);
+                glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+                glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+                glGenFramebuffers(1, &m_offscreenFBO);
+                GLStateCache::bindFramebuffer(m_offscreenFBO);
+                glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_offscreenColor, 0);
+                glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, m_offscreenDepth);
+                GLStateCache::drawBuffers(1);
+                GL_CHECK_FRAMEBUFFER_STATUS();
+                GLStateCache::bindFramebuffer(0);
+            }
+            GLDebug::label(GL_RENDERBUFFER, m_offscreenDepth, "offscreen depth");
+            GLDebug::label(GL_FRAMEBUFFER, m_offscreenFBO, "offscreen");
+            GL_CHECK_ERRORS();
+        }
+
+        m_graph.setOutputFramebuffer(m_offscreenFBO);
+    }
+
+    void RendererV2::getOutputSize(int& width, int& height)
+    {
+        width = m_offscreenFBO ? m_offscreenWidth : m_graph.getOutputWidth();
+        height = m_offscreenFBO ? m_offscreenHeight : m_graph.getOutputHeight();
+    }
+
+    bool RendererV2::readFrame(std::vector<uint8_t>& pixels, int& width, int& height)
+    {
+        getOutputSize(width, height);
+        if(width <= 0 || height <= 0)
+            return false;
+
+        const size_t rowSize = static_cast<size_t>(width) * 4;
+        std::vector<uint8_t> bottomUp(rowSize * height);
+
+        GLStateCache::bindFramebuffer(m_offscreenFBO);
+        if(!m_offscreenFBO)
+            glReadBuffer(GL_BACK);
+        glPixelStorei(GL_PACK_ALIGNMENT, 1);
+        glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, bottomUp.data());
+        glPixelStorei(GL_PACK_ALIGNMENT, 4);
         GL_CHECK_ERRORS();
+
+        //GL rows start from the bottom
+        pixels.resize(bottomUp.size());
+        for(int y = 0; y < height; y++)
+            std::memcpy(&pixels[y * rowSize], &bottomUp[(height - 1 - y) * rowSize], rowSize);
+
+        return true;
+    }
+
+    void RendererV2::setProfilerOverlay(bool flag)
+    {
+        if(flag && !GPUProfiler::isSupported())
+        {
+            SPACE_ENGINE_WARN("RendererV2: no GPU timers, the profiler overlay stays off");
+            return;
+        }
+
+        m_profilerOverlay = flag;
+        //refresh the strings at the next frame
+        m_overlayFrame = 0;
+    }
+
+    void RendererV2::appendProfilerOverlay(std::vector<TextRenderObject>& textRenderables)
+    {
+        if(!m_profilerOverlay)
+            return;
+
+        const std::vector<GPUTimerStats>& stats = GPUProfiler::getStats();
+
+        if(m_overlayLines.size() < stats.size())
+        {
+            if(!FontLoader::getFont("Orbitron-Regular"))
+            {
+                SPACE_ENGINE_WARN("RendererV2: the profiler overlay needs the Orbitron-Regular font");
+                m_profilerOverlay = false;
+                return;
+            }
+
+            TextMaterial* pMat = MaterialManager::createMaterial<TextMaterial>("ProfilerOverlayMat", "Orbitron-Regular");
+            pMat->addProperty("color_val", Vector3{1.f, 1.f, 0.f});
+            //one line per section, top left corner
+            while(m_overlayLines.size() < stats.size())
+            {
+                float y = 40.f + 30.f * static_cast<float>(m_overlayLines.size());
+                m_overlayLines.push_back(new Text({0.f, 0.f}, {20.f, y}, {0.5f, 0.5f}, pMat));
+            }
+            m_overlayFrame = 0;
+        }
+
+        if(!(m_overlayFrame++ % OverlayRefreshFrames))
+        {
+            char line[96];
+            for(size_t i = 0; i < stats.size(); i++)
+            {
+                std::snprintf(line, sizeof(line), "%-8s avg %6.3f ms  max %6.3f ms",
+                    stats[i].name.c_str(), stats[i].avgMs, stats[i].maxMs);
+                m_overlayLines[i]->setString(line);
+            }
+        }
+
+        for(size_t i = 0; i < stats.size(); i++)
+            textRenderables.push_back({m_overlayLines[i]});
     }
 
 
@@ -9,6 +9,10 @@
 #include "gameObject.h"
 #include "powerUp.h"
 #include "app.h"
+#include "impostor.h"
+
+#include <algorithm>
+#include <limits>
 
 namespace SpaceEngine
 {
@@ -114,28 +118,76 @@ namespace SpaceEngine
             );
     }
 
-    void Scene::gatherRenderables(std::vector<RenderObject>& worldRenderables,
+    void Scene::gatherRenderables(const CameraView* pView,
+            std::vector<RenderObject>& worldRenderables,
             std::vector<UIRenderObject>& uiRenderables,
             std::vector<TextRenderObject>& textRenderables,
             std::vector<ScreenRenderObject>& screenRenderables)
     {
+        size_t first = worldRenderables.size();
+        m_cullX.clear();
+        m_cullY.clear();
+        m_cullZ.clear();
+        m_cullR.clear();
+
         for (auto& gameObj : gameObjects)
         {
             // --- World objects ---
             
             if (Mesh* mesh = gameObj->getComponent<Mesh>(); mesh)
             {
-                
-                for(int i = 0, nSubMeshes = mesh->getNumSubMesh(); i < nSubMeshes; ++i)
+                //the renderer draws all the submeshes of the mesh
+                RenderObject renderObj;
+                renderObj.mesh = mesh;
+                Transform* trasf = gameObj->getComponent<Transform>();
+                renderObj.modelMatrix = trasf->getWorldMatrix();
+
+                if(pView)
                 {
-                    RenderObject renderObj;
-                    renderObj.mesh = mesh;
-                    Transform* trasf = gameObj->getComponent<Transform>();
-                    renderObj.modelMatrix = trasf->getWorldMatrix();
-                    worldRenderables.push_back(renderObj);
+                    //world bounding sphere, the radius is scaled by the biggest axis scale
+                    const Matrix4& m = renderObj.modelMatrix;
+                    Vector3 c = Vector3(m * Vector4(mesh->getBoundsCenter(), 1.f));
+                    float scale = std::max(glm::length(Vector3(m[0])), 
+                        std::max(glm::length(Vector3(m[1])), glm::length(Vector3(m[2]))));
+                    float radius = mesh->getBoundsRadius() * scale;
+
+                    m_cullX.push_back(c.x);
+                    m_cullY.push_back(c.y);
+                    m_cullZ.push_back(c.z);
+                    m_cullR.push_back(radius);
+
+                    //radius on the screen as a fraction of the half height, the camera inside the sphere gets the LOD 0
+                    float distance = glm::length(c - pView->pos);
+                    float coverage = distance > radius ? radius * pView->projection[1][1] / distance : std::numeric_limits<float>::max();
+                    gameObj->lod = static_cast<uint8_t>(mesh->selectLod(coverage, gameObj->lod));
+                    renderObj.lod = gameObj->lod;
+                    renderObj.meshFade = ImpostorManager::getMeshFade(mesh, distance);
                 }
+
+                worldRenderables.push_back(renderObj);
             }
         }
+
+        m_cullStats = CullStats();
+
+        if(pView && m_cullX.size())
+        {
+            uint32_t count = static_cast<uint32_t>(m_cullX.size());
+            m_cullVisible.resize(count);
+            cullSpheres(*pView, m_cullX.data(), m_cullY.data(), m_cullZ.data(), m_cullR.data(), count, m_cullVisible.data());
+
+            //compact the visible objects
+            size_t last = first;
+            for(uint32_t i = 0; i < count; i++)
+            {
+                if(m_cullVisible[i])
+                    worldRenderables[last++] = worldRenderables[first + i];
+            }
+            worldRenderables.resize(last);
+
+            m_cullStats.tested = count;
+            m_cullStats.culled = count - static_cast<uint32_t>(last - first);
+        }
         
         // --- UI objects ---
         for(UILayout* pLayout : m_vecUILayouts)
@@ -266,9 +318,6 @@ namespace SpaceEngine
         m_powerupTimer = 0.0f;
 
         setPostprocessing(true);
-
-        glEnable(GL_BLEND); 
-        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
     }
 
     void SpaceScene::ResetHealthIcons()
@@ -379,6 +428,8 @@ namespace SpaceEngine
         m_enemyTimer = 0.0f;
         m_powerupTimer = 0.0f;
 
+        //the effects of the last game
+        ParticleSystem::clear();
         if (m_pPlayer )m_pPlayer->Reset();
         if(pScoreSys) pScoreSys->Reset(); 
         ResetHealthIcons();
@@ -535,6 +586,8 @@ namespace SpaceEngine
 
             if (isEnemy || isAsteroid || isEnemyBullet)
             {
+                if (isEnemy) static_cast<EnemyShip*>(obj)->Explode();
+                else if (isAsteroid) static_cast<Asteroid*>(obj)->Explode();
                 requestDestroy(obj);
                 if (pScoreSys) pScoreSys->onNotify(*obj, 50); 
             }
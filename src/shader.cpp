@@ -1,11 +1,17 @@
 #include "shader.h"
 #include "log.h"
+#include "glState.h"
+#include "glCapture.h"
+#include "glDebug.h"
 #include "utils/utils.h"
 
+#include <algorithm>
+#include <cstring>
 #include <fstream>
 #include <sstream>
 #include <filesystem>
 #include <sys/stat.h>
+#include <type_traits>
 #include <vector>
 #include <map> 
 
@@ -54,12 +60,105 @@ namespace SpaceEngine
     }
 
 
+    //file of a linked program: header, driver binary, reflection tables
+    namespace ProgramCache
+    {
+        constexpr uint32_t Magic = 0x42505345; //"ESPB"
+        //bump it when the layout of the file changes
+        constexpr uint32_t Version = 1;
+        //corrupted file guards
+        constexpr uint32_t MaxBinarySize = 64 * 1024 * 1024;
+        constexpr uint32_t MaxEntries = 4096;
+
+        constexpr uint64_t FNVOffset = 14695981039346656037ull;
+        constexpr uint64_t FNVPrime = 1099511628211ull;
+
+        inline uint64_t hash(const void* data, size_t size, uint64_t seed = FNVOffset)
+        {
+            const uint8_t* bytes = static_cast<const uint8_t*>(data);
+            uint64_t h = seed;
+            for(size_t i = 0; i < size; i++)
+            {
+                h ^= bytes[i];
+                h *= FNVPrime;
+            }
+            return h;
+        }
+
+        inline uint64_t hash(const std::string& str, uint64_t seed = FNVOffset)
+        {
+            //the separator keeps "ab"+"c" and "a"+"bc" apart
+            return hash(str.c_str(), str.size() + 1, seed);
+        }
+
+        template<typename T>
+        inline void write(std::ostream& out, const T& value)
+        {
+            static_assert(std::is_trivially_copyable_v<T>);
+            out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+        }
+
+        inline void write(std::ostream& out, const std::string& str)
+        {
+            write(out, static_cast<uint32_t>(str.size()));
+            out.write(str.data(), str.size());
+        }
+
+        template<typename T>
+        inline void write(std::ostream& out, const std::unordered_map<std::string, T>& table)
+        {
+            write(out, static_cast<uint32_t>(table.size()));
+            for(const auto& [name, value] : table)
+            {
+                write(out, name);
+                write(out, value);
+            }
+        }
+
+        template<typename T>
+        inline bool read(std::istream& in, T& value)
+        {
+            static_assert(std::is_trivially_copyable_v<T>);
+            in.read(reinterpret_cast<char*>(&value), sizeof(T));
+            return static_cast<bool>(in);
+        }
+
+        inline bool read(std::istream& in, std::string& str)
+        {
+            uint32_t size = 0;
+            if(!read(in, size) || size > MaxEntries)
+                return false;
+            str.resize(size);
+            in.read(str.data(), size);
+            return static_cast<bool>(in);
+        }
+
+        template<typename T>
+        inline bool read(std::istream& in, std::unordered_map<std::string, T>& table)
+        {
+            uint32_t count = 0;
+            if(!read(in, count) || count > MaxEntries)
+                return false;
+
+            for(uint32_t i = 0; i < count; i++)
+            {
+                std::string name;
+                T value;
+                if(!read(in, name) || !read(in, value))
+                    return false;
+                table[name] = value;
+            }
+            return true;
+        }
+    }
+
     ShaderProgram::ShaderProgram() : handle(0), linked(false) {}
 
     ShaderProgram::~ShaderProgram() {
         if (handle == 0) return;
     	detachAndDeleteShaderObjects();
         // Delete the program
+        GLStateCache::onDeleteProgram(handle);
         glDeleteProgram(handle);
     }
 
@@ -164,12 +263,38 @@ namespace SpaceEngine
 
         GLuint shaderHandle = glCreateShader(type);
 
-        const char *c_code = source.c_str();
+        //the #version must stay the first statement
+        std::string code = source;
+        if(!definesPreamble.empty())
+        {
+            size_t version = code.find("#version");
+            size_t lineEnd = version == string::npos ? string::npos : code.find('\n', version);
+            code.insert(lineEnd == string::npos ? 0 : lineEnd + 1, definesPreamble);
+        }
+
+        const char *c_code = code.c_str();
         glShaderSource(shaderHandle, 1, &c_code, NULL);
 
         // Compile the shader
         glCompileShader(shaderHandle);
 
+        if(type == Type::VERTEX)
+        {
+            isVSComp = true;    
+        }
+
+        if(type == Type::FRAGMENT)
+        {
+            isFSComp = true;
+        }
+
+        //the errors are read with the link status
+        if(deferred)
+        {
+            glAttachShader(handle, shaderHandle);
+            return 1;
+        }
+
         // Check for errors
         int result;
         glGetShaderiv(shaderHandle, GL_COMPILE_STATUS, &result);
@@ -200,21 +325,11 @@ namespace SpaceEngine
             glAttachShader(handle, shaderHandle);
         }
 
-        if(type == Type::VERTEX)
-        {
-            isVSComp = true;    
-        }
-
-        if(type == Type::FRAGMENT)
-        {
-            isFSComp = true;
-        }
-
         return 1;
     }
 
     int ShaderProgram::link() {
-        if (linked) return 1;
+        if (linked || pending) return 1;
         if (handle <= 0)
         {
             SPACE_ENGINE_ERROR("Program has not been compiled.");
@@ -230,10 +345,21 @@ namespace SpaceEngine
             SPACE_ENGINE_WARN("Warning: no Fragment shader were compiled");
         }
 
+        //the binary can be saved in the cache
+        if(glProgramParameteri)
+            glProgramParameteri(handle, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
         glLinkProgram(handle);
+        SPACE_ENGINE_DEBUG("Linking shader");
+        pending = true;
+
+        return deferred ? 1 : finishLink();
+    }
+
+    int ShaderProgram::finishLink()
+    {
+        pending = false;
     	int status = 0;
     	std::string errString;
-        SPACE_ENGINE_DEBUG("Linking shader");
     	glGetProgramiv(handle, GL_LINK_STATUS, &status);
     	if (GL_FALSE == status) {
     		// Store log and return false
@@ -246,6 +372,23 @@ namespace SpaceEngine
     			glGetProgramInfoLog(handle, length, &written, &log[0]);
     			errString += log;
     		}
+
+            //the compile statuses were not read
+            GLint numShaders = 0;
+            glGetProgramiv(handle, GL_ATTACHED_SHADERS, &numShaders);
+            std::vector<GLuint> shaderNames(numShaders);
+            glGetAttachedShaders(handle, numShaders, NULL, shaderNames.data());
+            for (GLuint shader : shaderNames) {
+                GLint compiled = GL_TRUE;
+                glGetShaderiv(shader, GL_COMPILE_STATUS, &compiled);
+                glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &length);
+                if (GL_FALSE == compiled && length > 0) {
+                    std::string log(length, ' ');
+                    int written = 0;
+                    glGetShaderInfoLog(shader, length, &written, &log[0]);
+                    errString += "Shader compilation failed:\n" + log;
+                }
+            }
     	}
     	else {
     		reflectUniforms();
@@ -254,6 +397,9 @@ namespace SpaceEngine
     
     	detachAndDeleteShaderObjects();
 
+        if(linked && !cachePath.empty() && !saveBinary(cachePath, cacheHash))
+            SPACE_ENGINE_WARN("Program binary {} not written", cachePath);
+
     	if( GL_FALSE == status ) 
         {
             SPACE_ENGINE_ERROR(errString);
@@ -262,12 +408,178 @@ namespace SpaceEngine
         return 1;
     }
 
+    bool ShaderProgram::isReady()
+    {
+        if(!pending)
+            return true;
+
+        GLint done = GL_FALSE;
+        glGetProgramiv(handle, GL_COMPLETION_STATUS_KHR, &done);
+        if(GL_FALSE == done)
+            return false;
+
+        finishLink();
+        return true;
+    }
+
+    void ShaderProgram::setBinaryCache(const std::string& path, uint64_t sourceHash)
+    {
+        cachePath = path;
+        cacheHash = sourceHash;
+    }
+
+    void ShaderProgram::setDefines(const std::vector<std::string>& defines)
+    {
+        definesPreamble.clear();
+        for(const std::string& define : defines)
+            definesPreamble += "#define " + define + "\n";
+    }
+
+    bool ShaderProgram::loadBinary(const std::string& path, uint64_t sourceHash)
+    {
+        std::ifstream file(path, ios::binary);
+        if(!file)
+            return false;
+
+        uint32_t magic = 0;
+        uint32_t version = 0;
+        uint64_t hash = 0;
+        if(!ProgramCache::read(file, magic) || !ProgramCache::read(file, version) || !ProgramCache::read(file, hash) ||
+            magic != ProgramCache::Magic || version != ProgramCache::Version || hash != sourceHash)
+        {
+            SPACE_ENGINE_DEBUG("Program binary {} is stale", path);
+            return false;
+        }
+
+        GLenum format = 0;
+        uint32_t size = 0;
+        if(!ProgramCache::read(file, format) || !ProgramCache::read(file, size) || !size || size > ProgramCache::MaxBinarySize)
+            return false;
+        std::vector<char> binary(size);
+        file.read(binary.data(), size);
+
+        //reflection of the program that wrote the binary
+        uint8_t stages = 0;
+        uint32_t numUniforms = 0;
+        std::unordered_map<std::string, UniformInfo> uniforms;
+        std::unordered_map<std::string, GLuint> vsSubroutines;
+        std::unordered_map<std::string, GLuint> fsSubroutines;
+        std::unordered_map<std::string, GLint> vsSubroutineUniforms;
+        std::unordered_map<std::string, GLint> fsSubroutineUniforms;
+        uint32_t numVSSubroutineUniforms = 0;
+        uint32_t numFSSubroutineUniforms = 0;
+
+        bool ok = static_cast<bool>(file) && ProgramCache::read(file, stages) && ProgramCache::read(file, numUniforms) &&
+            numUniforms <= ProgramCache::MaxEntries;
+        for(uint32_t i = 0; ok && i < numUniforms; i++)
+        {
+            std::string name;
+            UniformInfo info;
+            ok = ProgramCache::read(file, name) && ProgramCache::read(file, info.location) &&
+                ProgramCache::read(file, info.type) && ProgramCache::read(file, info.size);
+            uniforms[name] = info;
+        }
+        ok = ok && ProgramCache::read(file, vsSubroutines) && ProgramCache::read(file, fsSubroutines) &&
+            ProgramCache::read(file, vsSubroutineUniforms) && ProgramCache::read(file, fsSubroutineUniforms) &&
+            ProgramCache::read(file, numVSSubroutineUniforms) && ProgramCache::read(file, numFSSubroutineUniforms) &&
+            numVSSubroutineUniforms <= ProgramCache::MaxEntries && numFSSubroutineUniforms <= ProgramCache::MaxEntries;
+        if(!ok)
+        {
+            SPACE_ENGINE_WARN("Program binary {} is corrupted", path);
+            return false;
+        }
+
+        if(handle <= 0)
+            handle = glCreateProgram();
+
+        glProgramBinary(handle, format, binary.data(), static_cast<GLsizei>(size));
+        GLint status = GL_FALSE;
+        glGetProgramiv(handle, GL_LINK_STATUS, &status);
+        if(GL_FALSE == status)
+        {
+            //new driver: the sources are compiled again on a clean program
+            SPACE_ENGINE_DEBUG("Program binary {} rejected by the driver", path);
+            GLStateCache::onDeleteProgram(handle);
+            glDeleteProgram(handle);
+            handle = 0;
+            return false;
+        }
+
+        uniformsInfo = std::move(uniforms);
+        vsSubroutinesInfo = std::move(vsSubroutines);
+        fsSubroutinesInfo = std::move(fsSubroutines);
+        subroutineUniformsInfo[Type::VERTEX] = std::move(vsSubroutineUniforms);
+        subroutineUniformsInfo[Type::FRAGMENT] = std::move(fsSubroutineUniforms);
+        vsIdxSubRoutUniform.assign(numVSSubroutineUniforms, 0);
+        fsIdxSubRoutUniform.assign(numFSSubroutineUniforms, 0);
+        isVSComp = stages & 1;
+        isFSComp = stages & 2;
+        linked = true;
+
+        return true;
+    }
+
+    bool ShaderProgram::saveBinary(const std::string& path, uint64_t sourceHash)
+    {
+        if(!linked)
+            return false;
+
+        GLint size = 0;
+        glGetProgramiv(handle, GL_PROGRAM_BINARY_LENGTH, &size);
+        if(size <= 0)
+            return false;
+
+        std::vector<char> binary(size);
+        GLenum format = 0;
+        glGetProgramBinary(handle, size, nullptr, &format, binary.data());
+        GL_CHECK_ERRORS();
+
+        //a run that stops while writing never leaves a truncated binary
+        const std::string tmpPath = path + ".tmp";
+        {
+            std::ofstream file(tmpPath, ios::binary | ios::trunc);
+            if(!file)
+                return false;
+
+            ProgramCache::write(file, ProgramCache::Magic);
+            ProgramCache::write(file, ProgramCache::Version);
+            ProgramCache::write(file, sourceHash);
+            ProgramCache::write(file, format);
+            ProgramCache::write(file, static_cast<uint32_t>(size));
+            file.write(binary.data(), size);
+
+            ProgramCache::write(file, static_cast<uint8_t>((isVSComp ? 1 : 0) | (isFSComp ? 2 : 0)));
+            ProgramCache::write(file, static_cast<uint32_t>(uniformsInfo.size()));
+            for(const auto& [name, info] : uniformsInfo)
+            {
+                ProgramCache::write(file, name);
+                ProgramCache::write(file, info.location);
+                ProgramCache::write(file, info.type);
+                ProgramCache::write(file, info.size);
+            }
+            ProgramCache::write(file, vsSubroutinesInfo);
+            ProgramCache::write(file, fsSubroutinesInfo);
+            ProgramCache::write(file, subroutineUniformsInfo[Type::VERTEX]);
+            ProgramCache::write(file, subroutineUniformsInfo[Type::FRAGMENT]);
+            ProgramCache::write(file, static_cast<uint32_t>(vsIdxSubRoutUniform.size()));
+            ProgramCache::write(file, static_cast<uint32_t>(fsIdxSubRoutUniform.size()));
+
+            if(!file)
+                return false;
+        }
+
+        std::error_code error;
+        std::filesystem::rename(tmpPath, path, error);
+        return !error;
+    }
+
     int ShaderProgram::use() {
+        resolve();
         if (handle <= 0 || (!linked)){
             SPACE_ENGINE_DEBUG("Shader has not been linked");
             return 0;
         }
-        glUseProgram(handle);
+        GLStateCache::useProgram(handle);
         return 1;
     }
     
@@ -276,6 +588,7 @@ namespace SpaceEngine
     }
     
     bool ShaderProgram::isLinked() {
+        resolve();
         return linked;
     }
     
@@ -335,6 +648,19 @@ namespace SpaceEngine
         int loc = getUniformLocation(name);
         glUniform1i(loc, val);
     }
+
+    void ShaderProgram::setSampler(const char *name, GLint unit) {
+        GLint loc = getUniformLocation(name);
+        if (loc < 0)
+            return;
+
+        auto pos = samplerUnits.find(loc);
+        if (pos != samplerUnits.end() && pos->second == unit)
+            return;
+
+        glUniform1i(loc, unit);
+        samplerUnits[loc] = unit;
+    }
     
     void ShaderProgram::printActiveUniforms() {
         GLint nUniforms, size, location, maxLen;
@@ -418,7 +744,7 @@ namespace SpaceEngine
                                    GL_ACTIVE_SUBROUTINE_MAX_LENGTH,
                                    &len);
         char* name = new char[len];
-        auto flag = glGetError();
+        GL_CHECK_ERRORS();
         
         //fill the map 
         for (int i = 0; i < numSubRoutines; ++i) 
@@ -432,7 +758,7 @@ namespace SpaceEngine
                                        len,
                                        &written,
                                        name);
-            flag = glGetError();
+            GL_CHECK_ERRORS();
             GLuint loc = glGetSubroutineIndex( handle,
                                                shType,
                                                name);
@@ -448,7 +774,7 @@ namespace SpaceEngine
                             GL_ACTIVE_SUBROUTINE_UNIFORM_MAX_LENGTH,
                             &len);
         name = new char[len];
-        flag = glGetError();
+        GL_CHECK_ERRORS();
 
         //get the number of subroutines uniform
         if(shType == Type::VERTEX)
@@ -458,7 +784,7 @@ namespace SpaceEngine
             glGetProgramStageiv(handle, Type::VERTEX,
                     GL_ACTIVE_SUBROUTINE_UNIFORM_LOCATIONS,
                     &numLocs);
-            auto flag = glGetError();
+            GL_CHECK_ERRORS();
             
             for(int i = 0; i < numLocs; i++)
             {
@@ -486,7 +812,7 @@ namespace SpaceEngine
             glGetProgramStageiv(handle, Type::FRAGMENT,
                     GL_ACTIVE_SUBROUTINE_UNIFORM_LOCATIONS,
                     &numLocs);
-            auto flag = glGetError();
+            GL_CHECK_ERRORS();
             for(int i = 0; i < numLocs; i++)
             {
                 GLsizei written;
@@ -511,6 +837,7 @@ namespace SpaceEngine
 
     void ShaderProgram::setSubroutinesUniform(const char *name, const std::string& type)
     {
+        resolve();
         //search on vs
         auto pos = vsSubroutinesInfo.find(name);
 
@@ -553,6 +880,7 @@ namespace SpaceEngine
 
     void ShaderProgram::bindSubroutines()
     {
+        resolve();
         GL_CHECK_ERRORS();
         if(vsIdxSubRoutUniform.size() > 0){
             glUniformSubroutinesuiv(GL_VERTEX_SHADER, static_cast<GLsizei>(vsIdxSubRoutUniform.size()), vsIdxSubRoutUniform.data());
@@ -605,6 +933,7 @@ namespace SpaceEngine
 
     int ShaderProgram::isPresentUniform(const char *name)
     {
+        resolve();
 	    if (uniformsInfo.find(name) == uniformsInfo.end()) 
         {
 	    	return 0;
@@ -699,8 +1028,58 @@ namespace SpaceEngine
     }
     //ShaderManager
     std::unordered_map<std::string, ShaderProgram*> ShaderManager::shadersMap;
+    bool ShaderManager::binaryCache = false;
+    uint32_t ShaderManager::cacheHits = 0;
+    bool ShaderManager::parallelCompile = false;
+    uint64_t ShaderManager::driverHash = 0;
+
+    uint64_t ShaderManager::sourceHash(const std::vector<std::filesystem::path>& files)
+    {
+        uint64_t h = driverHash;
+
+        for(const std::filesystem::path& path : files)
+        {
+            ifstream inFile(path, ios::in | ios::binary);
+            std::stringstream code;
+            code << inFile.rdbuf();
+            h = ProgramCache::hash(path.filename().string(), h);
+            h = ProgramCache::hash(code.str(), h);
+        }
+
+        return h;
+    }
 
     ShaderProgram* ShaderManager::createShaderProgram(const std::string nameFile)
+    {
+        ShaderProgram* pSP = compileProgram(nameFile, nameFile, {});
+        if(pSP)
+            pSP->link();
+
+        return pSP;
+    }
+
+    ShaderProgram* ShaderManager::getVariant(const std::string& nameFile, std::vector<std::string> defines)
+    {
+        //the same set in any order is the same program
+        std::sort(defines.begin(), defines.end());
+        std::string key = nameFile;
+        for(const std::string& define : defines)
+            key += "+" + define;
+
+        auto pos = shadersMap.find(key);
+        if(pos != shadersMap.end())
+            return pos->second;
+
+        SPACE_ENGINE_DEBUG("Shader variant: {}", key);
+        ShaderProgram* pSP = compileProgram(nameFile, key, defines);
+        if(pSP)
+            pSP->link();
+
+        return pSP;
+    }
+
+    ShaderProgram* ShaderManager::compileProgram(const std::string& nameFile, const std::string& key,
+        const std::vector<std::string>& defines)
     {
         ShaderProgram* pSP = new ShaderProgram();
         std::vector<std::filesystem::path> shaderFiles;
@@ -729,15 +1108,35 @@ namespace SpaceEngine
             return nullptr;
         }
 
-        
-        for(const std::filesystem::path& path : shaderFiles)
+        //same hash whatever the order of the directory
+        std::sort(shaderFiles.begin(), shaderFiles.end());
+        uint64_t hash = binaryCache ? sourceHash(shaderFiles) : 0;
+        for(const std::string& define : defines)
+            hash = ProgramCache::hash(define, hash);
+        const std::string cachePath = std::string(SHADER_CACHE_PATH) + key + ".bin";
+
+        if(binaryCache && pSP->loadBinary(cachePath, hash))
+        {
+            SPACE_ENGINE_DEBUG("Shader {} linked from the binary cache", key);
+            cacheHits++;
+        }
+        else
         {
-            // FIX: path.string() per evitare problemi
-            pSP->compileShader(path.string().c_str());
+            pSP->setDeferred(parallelCompile);
+            pSP->setDefines(defines);
+            if(binaryCache)
+                pSP->setBinaryCache(cachePath, hash);
+
+            for(const std::filesystem::path& path : shaderFiles)
+            {
+                // FIX: path.string() per evitare problemi
+                pSP->compileShader(path.string().c_str());
+            }
         }
-        pSP->link();
 
-        shadersMap[nameFile] = pSP;
+        if(pSP->getHandle() > 0)
+            GLDebug::label(GL_PROGRAM, static_cast<GLuint>(pSP->getHandle()), key);
+        shadersMap[key] = pSP;
         
         return pSP;
     }
@@ -759,29 +1158,78 @@ namespace SpaceEngine
     void ShaderManager::Initialize()
     {
         GL_CHECK_ERRORS();
-        createShaderProgram("simple");
-        GL_CHECK_ERRORS();
-        createShaderProgram("ui");
-        GL_CHECK_ERRORS();
-        createShaderProgram("uiButton");
-        GL_CHECK_ERRORS();
-        ShaderProgram* pSimpleTex = createShaderProgram("simpleTex");
-        pSimpleTex->setMRTBuffers(2);
-        GL_CHECK_ERRORS();
-        createShaderProgram("pbr");
-        GL_CHECK_ERRORS();
-        createShaderProgram("skybox");
-        GL_CHECK_ERRORS();        
-        createShaderProgram("glyphs");
-        GL_CHECK_ERRORS();
-        createShaderProgram("powerup");
-        GL_CHECK_ERRORS();
-        createShaderProgram("space");
+        //the binaries are valid only for the driver that wrote them
+        GLint numFormats = 0;
+        if(glGetProgramBinary && glProgramBinary)
+            glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &numFormats);
+        std::error_code error;
+        if(numFormats > 0)
+            std::filesystem::create_directories(SHADER_CACHE_PATH, error);
+        //a capture builds the programs from the sources: it must replay on other drivers
+        binaryCache = numFormats > 0 && !error && !GLCapture::isActive();
+        cacheHits = 0;
+        driverHash = ProgramCache::hash(&ProgramCache::Version, sizeof(ProgramCache::Version));
+        for(GLenum name : {GL_VENDOR, GL_RENDERER, GL_VERSION, GL_SHADING_LANGUAGE_VERSION})
+        {
+            const char* str = reinterpret_cast<const char*>(glGetString(name));
+            driverHash = ProgramCache::hash(std::string(str ? str : ""), driverHash);
+        }
+        if(!binaryCache)
+            SPACE_ENGINE_INFO("Program binaries not supported, the shaders are compiled at every start");
         GL_CHECK_ERRORS();
-        createShaderProgram("hdr");
+
+        //KHR_parallel_shader_compile: the driver compiles and links on its own threads
+        parallelCompile = glMaxShaderCompilerThreadsKHR != nullptr;
+        if(parallelCompile)
+            glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+
+        const char* programs[] = {"simple", "ui", "uiButton", "uiBatch", "simpleTex", "pbr", "skybox",
+            "glyphs", "powerup", "space", "hdr", "bloomDownsample", "bloomUpsample", "particle"};
+
+        if(parallelCompile)
+        {
+            //every compile is submitted before the first link and no status is read here:
+            //a program is finished by Update or when it's used the first time
+            std::vector<ShaderProgram*> compiled;
+            for(const char* name : programs)
+                compiled.push_back(compileProgram(name, name, {}));
+            for(ShaderProgram* pSP : compiled)
+            {
+                if(pSP) pSP->link();
+            }
+            SPACE_ENGINE_INFO("Shaders: {} programs submitted, {} from the binary cache", compiled.size(), cacheHits);
+        }
+        else
+        {
+            for(const char* name : programs)
+                createShaderProgram(name);
+        }
         GL_CHECK_ERRORS();
-        createShaderProgram("bloomVFX");
-        GL_CHECK_ERRORS(); 
+
+        ShaderProgram* pSimpleTex = findShaderProgram("simpleTex");
+        if(pSimpleTex)
+            pSimpleTex->setMRTBuffers(2);
+    }
+
+    void ShaderManager::Update()
+    {
+        if(!parallelCompile)
+            return;
+
+        for(auto& [name, pSP] : shadersMap)
+            pSP->isReady();
+    }
+
+    uint32_t ShaderManager::getPendingPrograms()
+    {
+        uint32_t pending = 0;
+        for(auto& [name, pSP] : shadersMap)
+        {
+            if(!pSP->isReady())
+                pending++;
+        }
+
+        return pending;
     }
 
     void ShaderManager::Shutdown()
@@ -793,6 +1241,7 @@ namespace SpaceEngine
 
     std::vector<std::tuple<const std::string, GLenum>> ShaderProgram::getPairUniformNameLocation()
     {
+        resolve();
         std::vector<std::tuple<const std::string, GLenum>> listUniform;
 
         for( const auto& [key, value] : uniformsInfo)
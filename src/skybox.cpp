@@ -1,6 +1,7 @@
 #include "skybox.h"
 #include "log.h"
 #include "texture.h"
+#include "glState.h"
 
 namespace SpaceEngine
 {
@@ -35,14 +36,22 @@ namespace SpaceEngine
     }
     void Skybox::init()
     {
-        auto flag = glGetError();
+        GL_CHECK_ERRORS();
         // Setup del cubo geometrico (VAO/VBO)
         glGenVertexArrays(1, &VAO);
-        glGenBuffers(1, &VBO);
+        //the cube never changes: immutable storage with DSA
+        if (GLStateCache::hasDirectStateAccess())
+        {
+            glCreateBuffers(1, &VBO);
+            glNamedBufferStorage(VBO, sizeof(skyboxVertices), &skyboxVertices, 0);
+        }
+        else
+            glGenBuffers(1, &VBO);
         
-        glBindVertexArray(VAO);
+        GLStateCache::bindVertexArray(VAO);
         glBindBuffer(GL_ARRAY_BUFFER, VBO);
-        glBufferData(GL_ARRAY_BUFFER, sizeof(skyboxVertices), &skyboxVertices, GL_STATIC_DRAW);
+        if (!GLStateCache::hasDirectStateAccess())
+            glBufferData(GL_ARRAY_BUFFER, sizeof(skyboxVertices), &skyboxVertices, GL_STATIC_DRAW);
         
         glEnableVertexAttribArray(0);
         glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
@@ -59,10 +68,7 @@ namespace SpaceEngine
         pCubeMapTex->bind();
         pShader->use();
         pShader->setUniform("skybox", 0);
-        flag = glGetError();
-        
-        glBindVertexArray(0);
-        glUseProgram(0);
+        GL_CHECK_ERRORS();
     }
 
     ShaderProgram* Skybox::getShader()
@@ -72,17 +78,16 @@ namespace SpaceEngine
 
     void Skybox::bindVAO()
     {
-        glBindVertexArray(VAO);
+        GLStateCache::bindVertexArray(VAO);
     }
 
     void Skybox::draw()
     {
-        glActiveTexture(GL_TEXTURE0); 
+        //the cube map target of the unit 0 is used only by the skybox, it stays bound between the frames
         if (pCubeMapTex) {
             pCubeMapTex->bind();
         }
 
         glDrawArrays(GL_TRIANGLES, 0, 36);
-        glBindVertexArray(0);
     }
 }
\ No newline at end of file
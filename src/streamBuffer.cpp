@@ -0,0 +1,181 @@
+#include "streamBuffer.h"
+#include "log.h"
+#include "glCapture.h"
+#include "glDebug.h"
+
+#include <cstring>
+
+namespace SpaceEngine
+{
+    //1 ms steps, only when the GPU is FramesInFlight frames behind
+    constexpr GLuint64 FenceWaitNs = 1000000;
+
+    void StreamBuffer::init(GLenum target, GLsizeiptr frameSize, const char* label)
+    {
+        m_target = target;
+        m_label = label;
+        allocate(frameSize);
+    }
+
+    void StreamBuffer::destroy()
+    {
+        release();
+        m_frameSize = 0;
+        m_segment = 0;
+        m_head = 0;
+    }
+
+    void StreamBuffer::allocate(GLsizeiptr frameSize)
+    {
+        //the new name is taken before the old one is freed: a different name tells the users to point the new buffer
+        GLuint buffer = 0;
+        glGenBuffers(1, &buffer);
+        release();
+        m_buffer = buffer;
+        m_frameSize = frameSize;
+        const GLsizeiptr size = m_frameSize * FramesInFlight;
+
+        glBindBuffer(m_target, m_buffer);
+
+        if(glBufferStorage)
+        {
+            const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+            glBufferStorage(m_target, size, nullptr, flags);
+            m_pMapped = static_cast<uint8_t*>(glMapBufferRange(m_target, 0, size, flags));
+            if(!m_pMapped)
+                SPACE_ENGINE_WARN("StreamBuffer: persistent mapping failed, the ranges are mapped on every upload");
+        }
+
+        if(!m_pMapped)
+        {
+            //the storage of glBufferStorage is immutable, start again
+            if(glBufferStorage)
+            {
+                glGenBuffers(1, &buffer);
+                glBindBuffer(m_target, buffer);
+                glDeleteBuffers(1, &m_buffer);
+                m_buffer = buffer;
+            }
+            glBufferData(m_target, size, nullptr, GL_STREAM_DRAW);
+        }
+
+        GLDebug::label(GL_BUFFER, m_buffer, m_label);
+        glBindBuffer(m_target, 0);
+        m_head = 0;
+        GL_CHECK_ERRORS();
+    }
+
+    void StreamBuffer::release()
+    {
+        for(GLsync& fence : m_fences)
+        {
+            if(fence)
+            {
+                glDeleteSync(fence);
+                fence = nullptr;
+            }
+        }
+
+        if(m_buffer)
+        {
+            //deleting the buffer unmaps it, the GPU keeps the storage alive until the pending draws end
+            glDeleteBuffers(1, &m_buffer);
+            m_buffer = 0;
+        }
+
+        m_pMapped = nullptr;
+    }
+
+    void StreamBuffer::beginFrame()
+    {
+        if(!m_buffer)
+            return;
+
+        m_segment = (m_segment + 1) % FramesInFlight;
+        m_head = 0;
+
+        GLsync& fence = m_fences[m_segment];
+        if(!fence)
+            return;
+
+        GLenum result = glClientWaitSync(fence, 0, 0);
+        if(result == GL_TIMEOUT_EXPIRED)
+        {
+            m_stalls++;
+            do
+            {
+                result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, FenceWaitNs);
+            }
+            while(result == GL_TIMEOUT_EXPIRED);
+        }
+
+        if(result == GL_WAIT_FAILED)
+            SPACE_ENGINE_ERROR("StreamBuffer: fence wait failed");
+
+        glDeleteSync(fence);
+        fence = nullptr;
+    }
+
+    void StreamBuffer::endFrame()
+    {
+        if(!m_buffer || !m_head)
+            return;
+
+        //the last fence covers the commands of the previous ones
+        GLsync& fence = m_fences[m_segment];
+        if(fence)
+            glDeleteSync(fence);
+        fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+
+    GLintptr StreamBuffer::upload(const void* pData, GLsizeiptr size, GLsizeiptr alignment)
+    {
+        if(!m_buffer || size <= 0)
+            return 0;
+
+        GLsizeiptr base = m_frameSize * m_segment;
+        GLsizeiptr offset = (base + m_head + alignment - 1) / alignment * alignment;
+
+        if(offset + size > base + m_frameSize)
+        {
+            //the draws already recorded keep reading the old buffer
+            GLsizeiptr frameSize = m_frameSize * 2;
+            while(frameSize < size + alignment)
+                frameSize *= 2;
+
+            SPACE_ENGINE_INFO("StreamBuffer: ring grown to {} bytes per frame", frameSize);
+            uint32_t segment = m_segment;
+            allocate(frameSize);
+            m_segment = segment;
+
+            base = m_frameSize * m_segment;
+            offset = (base + alignment - 1) / alignment * alignment;
+        }
+
+        if(m_pMapped)
+        {
+            std::memcpy(m_pMapped + offset, pData, static_cast<size_t>(size));
+            if(GLCapture::isActive())
+                GLCapture::onBufferWrite(m_buffer, offset, size, pData);
+        }
+        else
+        {
+            //the fences guarantee that the GPU doesn't read the range
+            glBindBuffer(m_target, m_buffer);
+            void* pDst = glMapBufferRange(m_target, offset, size,
+                GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+            if(pDst)
+            {
+                std::memcpy(pDst, pData, static_cast<size_t>(size));
+                if(GLCapture::isActive())
+                    GLCapture::onBufferWrite(m_buffer, offset, size, pData);
+                glUnmapBuffer(m_target);
+            }
+            else SPACE_ENGINE_ERROR("StreamBuffer: range not mapped");
+            glBindBuffer(m_target, 0);
+        }
+
+        m_head = offset + size - base;
+        return offset;
+    }
+}
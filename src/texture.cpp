@@ -2,14 +2,19 @@
 #include "utils/stb_image.h"
 #include "utils/utils.h"
 #include "log.h"
+#include "glState.h"
+#include "glDebug.h"
 #include "font.h"
 #include "managers/windowManager.h"
 
 #include <ft2build.h>
 #include FT_FREETYPE_H
 
+#include <algorithm>
 #include <array>
+#include <cstring>
 #include <string_view>
+#include <vector>
 
 constexpr std::size_t N_CUBEMAP_TEX = 6;
 
@@ -47,8 +52,7 @@ namespace SpaceEngine
 
     void Texture::bindInternal(GLenum textureUnit) const
     {
-        glActiveTexture(textureUnit);
-        glBindTexture(textureTarget, textureObj);
+        GLStateCache::bindTexture(textureUnit - GL_TEXTURE0, textureTarget, textureObj);
     }
 
     //------------------------------------------------------//    
@@ -76,7 +80,8 @@ namespace SpaceEngine
 
         Texture *pTex = new Texture(GL_TEXTURE_CUBE_MAP);
         glGenTextures(1, &pTex->textureObj); // Genera l'ID della texture
-        glBindTexture(GL_TEXTURE_CUBE_MAP, pTex->textureObj);
+        GLStateCache::bindTexture(0, GL_TEXTURE_CUBE_MAP, pTex->textureObj);
+        GLDebug::label(GL_TEXTURE, pTex->textureObj, nameDir);
 
         SPACE_ENGINE_INFO("Loading cubemap texture");
         constexpr std::array<const char *, N_CUBEMAP_TEX> faces = {
@@ -103,7 +108,7 @@ namespace SpaceEngine
                 // Sommando 'i', accediamo a destra, sinistra, sopra
                 glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i,
                              0, GL_RGB, pTex->imageWidth, pTex->imageHeight, 0, format, GL_UNSIGNED_BYTE, data);
-                auto flag = glGetError();
+                GL_CHECK_ERRORS();
                 stbi_image_free(data);
             }
             else
@@ -200,56 +205,63 @@ namespace SpaceEngine
 
     void TextureManager::loadInternal(Texture *pTex, const void *pImageData, bool isSRGB)
     {
-        glGenTextures(1, &(pTex->textureObj));
-        glBindTexture(pTex->textureTarget, pTex->textureObj);
+        if (pTex->textureTarget != GL_TEXTURE_2D)
+        {
+            SPACE_ENGINE_FATAL("Support for texture target {} is not implemented\n", pTex->textureTarget);
+            exit(1);
+        }
 
         GLenum internalFormat = GL_NONE;
+        GLenum format = GL_NONE;
 
-        if (pTex->textureTarget == GL_TEXTURE_2D)
+        switch (pTex->imageBPP)
         {
-            switch (pTex->imageBPP)
-            {
-            case 1:
-            {
-                glTexImage2D(pTex->textureTarget, 0, GL_RED, pTex->imageWidth, pTex->imageHeight, 0, GL_RED, GL_UNSIGNED_BYTE, pImageData);
-                GLint SwizzleMask[] = {GL_RED, GL_RED, GL_RED, GL_RED};
-                glTexParameteriv(pTex->textureTarget, GL_TEXTURE_SWIZZLE_RGBA, SwizzleMask);
-            }
+        case 1:
+            internalFormat = GL_R8;
+            format = GL_RED;
             break;
 
-            case 2:
-                glTexImage2D(pTex->textureTarget, 0, GL_RG, pTex->imageWidth, pTex->imageHeight, 0, GL_RG, GL_UNSIGNED_BYTE, pImageData);
-                break;
+        case 2:
+            internalFormat = GL_RG8;
+            format = GL_RG;
+            break;
 
-            case 3:
-                internalFormat = isSRGB ? GL_SRGB8 : GL_RGB8;
-                glTexImage2D(pTex->textureTarget, 0, internalFormat, pTex->imageWidth, pTex->imageHeight, 0, GL_RGB, GL_UNSIGNED_BYTE, pImageData);
-                break;
+        case 3:
+            internalFormat = isSRGB ? GL_SRGB8 : GL_RGB8;
+            format = GL_RGB;
+            break;
 
-            case 4:
-                internalFormat = isSRGB ? GL_SRGB8_ALPHA8 : GL_RGBA8;
-                glTexImage2D(pTex->textureTarget, 0, internalFormat, pTex->imageWidth, pTex->imageHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, pImageData);
-                break;
+        case 4:
+            internalFormat = isSRGB ? GL_SRGB8_ALPHA8 : GL_RGBA8;
+            format = GL_RGBA;
+            break;
 
-            default:
-                SPACE_ENGINE_FATAL("Support for BPP {} is not implemented\n", pTex->imageBPP);
-            }
+        default:
+            SPACE_ENGINE_FATAL("Support for BPP {} is not implemented\n", pTex->imageBPP);
+            return;
         }
-        else
+
+        pTex->textureObj = createStorage2D(internalFormat, numMipLevels(pTex->imageWidth, pTex->imageHeight),
+            pTex->imageWidth, pTex->imageHeight);
+        GLDebug::label(GL_TEXTURE, pTex->textureObj, pTex->fileName);
+        upload2D(pTex->textureObj, pTex->imageWidth, pTex->imageHeight, format, GL_UNSIGNED_BYTE, pImageData);
+
+        //grey scale: the red channel everywhere
+        if (pTex->imageBPP == 1)
         {
-            SPACE_ENGINE_FATAL("Support for texture target {} is not implemented\n", pTex->textureTarget);
-            exit(1);
+            setParameter2D(pTex->textureObj, GL_TEXTURE_SWIZZLE_G, GL_RED);
+            setParameter2D(pTex->textureObj, GL_TEXTURE_SWIZZLE_B, GL_RED);
+            setParameter2D(pTex->textureObj, GL_TEXTURE_SWIZZLE_A, GL_RED);
         }
 
-        glTexParameteri(pTex->textureTarget, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-        glTexParameteri(pTex->textureTarget, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        glTexParameteri(pTex->textureTarget, GL_TEXTURE_BASE_LEVEL, 0);
-        glTexParameteri(pTex->textureTarget, GL_TEXTURE_WRAP_S, GL_REPEAT);
-        glTexParameteri(pTex->textureTarget, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        setParameter2D(pTex->textureObj, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        setParameter2D(pTex->textureObj, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        setParameter2D(pTex->textureObj, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        setParameter2D(pTex->textureObj, GL_TEXTURE_WRAP_T, GL_REPEAT);
 
-        glGenerateMipmap(pTex->textureTarget);
+        generateMipmap2D(pTex->textureObj);
 
-        glBindTexture(pTex->textureTarget, 0);
+        GLStateCache::bindTexture(0, pTex->textureTarget, 0);
     }
 
     std::map<char, Character> TextureManager::loadFontChars(const std::string &nameFont)
@@ -263,45 +275,107 @@ namespace SpaceEngine
         FT_CHECK(FT_New_Face(ft, fullPath.c_str(), 0, &face));
         FT_CHECK(FT_Set_Pixel_Sizes(face, 0, 48));
 
-        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        struct GlyphBitmap
+        {
+            std::vector<unsigned char> pixels;
+            int width = 0;
+            int height = 0;
+            int x = 0;
+            int y = 0;
+        };
+
+        std::array<GlyphBitmap, 128> glyphs;
         std::map<char, Character> mapChars;
+        //shelf packing: glyphs are placed left to right, a new row starts when the width is full
+        constexpr int AtlasWidth = 512;
+        constexpr int Padding = 1; //avoid bleeding with the linear filter
+        int penX = Padding;
+        int penY = Padding;
+        int rowHeight = 0;
+
         // load first 128 characters of ASCII
         for (unsigned char c = 0; c < 128; c++)
         {
             FT_CHECK(FT_Load_Char(face, c, FT_LOAD_RENDER));
+            const FT_Bitmap &bitmap = face->glyph->bitmap;
+            GlyphBitmap &glyph = glyphs[c];
+            glyph.width = static_cast<int>(bitmap.width);
+            glyph.height = static_cast<int>(bitmap.rows);
+
+            for (int row = 0; row < glyph.height; row++)
+            {
+                const unsigned char *pRow = bitmap.buffer + row * bitmap.pitch;
+                glyph.pixels.insert(glyph.pixels.end(), pRow, pRow + glyph.width);
+            }
+
+            if (penX + glyph.width + Padding > AtlasWidth)
+            {
+                penX = Padding;
+                penY += rowHeight + Padding;
+                rowHeight = 0;
+            }
+
+            glyph.x = penX;
+            glyph.y = penY;
+            penX += glyph.width + Padding;
+            rowHeight = std::max(rowHeight, glyph.height);
 
-            // generate texture
-            Texture *pTex = new Texture(GL_TEXTURE_2D);
-            pTex->setTexUnitHandle(GL_TEXTURE0);
-            pTex->fileName = Utils::getFileNameNoExt(nameFont)+ "_" + static_cast<char>(c);
-            glGenTextures(1, &pTex->textureObj);
-            glBindTexture(pTex->textureTarget, pTex->textureObj);
-            glTexImage2D(GL_TEXTURE_2D,
-                         0,
-                         GL_RED,
-                         face->glyph->bitmap.width,
-                         face->glyph->bitmap.rows,
-                         0,
-                         GL_RED,
-                         GL_UNSIGNED_BYTE,
-                         face->glyph->bitmap.buffer);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-            insert(pTex->fileName, pTex);
-            mapChars[c] = Character{pTex,
+            mapChars[c] = Character{nullptr,
             Vector2i(face->glyph->bitmap.width, face->glyph->bitmap.rows),
             Vector2i(face->glyph->bitmap_left, face->glyph->bitmap_top),
             static_cast<unsigned int>(face->glyph->advance.x)};
         }
-        //glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
-        glBindTexture(GL_TEXTURE_2D, 0);
 
         FT_Done_Face(face);
         FT_Done_FreeType(ft);
 
+        //power of two height
+        int atlasHeight = 1;
+        while (atlasHeight < penY + rowHeight + Padding)
+            atlasHeight <<= 1;
+
+        std::vector<unsigned char> atlas(AtlasWidth * atlasHeight, 0);
+
+        for (unsigned char c = 0; c < 128; c++)
+        {
+            const GlyphBitmap &glyph = glyphs[c];
+
+            for (int row = 0; row < glyph.height; row++)
+            {
+                std::memcpy(&atlas[(glyph.y + row) * AtlasWidth + glyph.x],
+                            &glyph.pixels[row * glyph.width],
+                            glyph.width);
+            }
+
+            Character &ch = mapChars[c];
+            ch.uvMin = Vector2(glyph.x / static_cast<float>(AtlasWidth), glyph.y / static_cast<float>(atlasHeight));
+            ch.uvMax = Vector2((glyph.x + glyph.width) / static_cast<float>(AtlasWidth), (glyph.y + glyph.height) / static_cast<float>(atlasHeight));
+        }
+
+        // generate the atlas texture, one for all the characters
+        Texture *pTex = new Texture(GL_TEXTURE_2D);
+        pTex->setTexUnitHandle(GL_TEXTURE0);
+        pTex->fileName = Utils::getFileNameNoExt(nameFont) + "_atlas";
+        pTex->imageWidth = AtlasWidth;
+        pTex->imageHeight = atlasHeight;
+        pTex->imageBPP = 1;
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        pTex->textureObj = createStorage2D(GL_R8, 1, AtlasWidth, atlasHeight);
+        GLDebug::label(GL_TEXTURE, pTex->textureObj, pTex->fileName);
+        upload2D(pTex->textureObj, AtlasWidth, atlasHeight, GL_RED, GL_UNSIGNED_BYTE, atlas.data());
+        setParameter2D(pTex->textureObj, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        setParameter2D(pTex->textureObj, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        setParameter2D(pTex->textureObj, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        setParameter2D(pTex->textureObj, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        GLStateCache::bindTexture(0, GL_TEXTURE_2D, 0);
+
+        insert(pTex->fileName, pTex);
+
+        for (auto &[c, ch] : mapChars)
+            ch.pTex = pTex;
+
+        SPACE_ENGINE_DEBUG("Font atlas {}: {}x{}", pTex->fileName, AtlasWidth, atlasHeight);
+
         return mapChars;
     }
 
@@ -317,36 +391,118 @@ namespace SpaceEngine
     
     Texture *TextureManager::genTexture(const GLenum textureTarget, TexSetParams params, std::string &texName)
     {
+        if (textureTarget != GL_TEXTURE_2D)
+        {
+            SPACE_ENGINE_FATAL("Support for texture target {} is not implemented\n", textureTarget);
+            exit(1);
+        }
+
         Texture* tex = new Texture(textureTarget);
-        
-        glGenTextures(1, &(tex->textureObj));
-        glBindTexture(textureTarget, tex->textureObj);
-
-        glTexImage2D(textureTarget, 
-            params.level, 
-            params.internalformat, 
-            params.width, 
-            params.height, 
-            params.border, 
-            params.format, 
-            params.type, 
-            params.data);
-
-        
+        tex->imageWidth = params.width;
+        tex->imageHeight = params.height;
+
+        //one level, the level and the border of the params are always 0
+        tex->textureObj = createStorage2D(params.internalformat, 1, params.width, params.height);
+        GLDebug::label(GL_TEXTURE, tex->textureObj, texName);
+        if (params.data)
+            upload2D(tex->textureObj, params.width, params.height, params.format, params.type, params.data);
+
         //for now is default setting change it in future
-        glTexParameteri(textureTarget, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        glTexParameteri(textureTarget, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        glTexParameteri(textureTarget, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-        glTexParameteri(textureTarget, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        setParameter2D(tex->textureObj, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        setParameter2D(tex->textureObj, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        setParameter2D(tex->textureObj, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        setParameter2D(tex->textureObj, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
         insert(texName, tex);
 
         return tex;
     }
 
+    static bool isDepthFormat(GLenum internalFormat)
+    {
+        return internalFormat == GL_DEPTH_COMPONENT16 || internalFormat == GL_DEPTH_COMPONENT24 ||
+            internalFormat == GL_DEPTH_COMPONENT32 || internalFormat == GL_DEPTH_COMPONENT32F;
+    }
+
+    GLuint TextureManager::createStorage2D(GLenum internalFormat, GLsizei levels, GLsizei width, GLsizei height)
+    {
+        GLuint texture = 0;
+        if (GLStateCache::hasDirectStateAccess())
+        {
+            glCreateTextures(GL_TEXTURE_2D, 1, &texture);
+            glTextureStorage2D(texture, levels, internalFormat, width, height);
+            return texture;
+        }
+
+        glGenTextures(1, &texture);
+        GLStateCache::bindTexture(0, GL_TEXTURE_2D, texture);
+        if (glTexStorage2D)
+        {
+            glTexStorage2D(GL_TEXTURE_2D, levels, internalFormat, width, height);
+            return texture;
+        }
+
+        //mutable storage with the levels of glTexStorage2D, the others are out of the range
+        const bool depth = isDepthFormat(internalFormat);
+        for (GLsizei level = 0; level < levels; level++)
+        {
+            glTexImage2D(GL_TEXTURE_2D, level, internalFormat, std::max(1, width >> level), std::max(1, height >> level), 0,
+                depth ? GL_DEPTH_COMPONENT : GL_RGBA,
+                depth ? GL_FLOAT : GL_UNSIGNED_BYTE,
+                nullptr);
+        }
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levels - 1);
+        return texture;
+    }
+
+    void TextureManager::upload2D(GLuint texture, GLsizei width, GLsizei height, GLenum format, GLenum type, const void *pData)
+    {
+        if (GLStateCache::hasDirectStateAccess())
+        {
+            glTextureSubImage2D(texture, 0, 0, 0, width, height, format, type, pData);
+            return;
+        }
+
+        GLStateCache::bindTexture(0, GL_TEXTURE_2D, texture);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, format, type, pData);
+    }
+
+    void TextureManager::setParameter2D(GLuint texture, GLenum pname, GLint value)
+    {
+        if (GLStateCache::hasDirectStateAccess())
+        {
+            glTextureParameteri(texture, pname, value);
+            return;
+        }
+
+        GLStateCache::bindTexture(0, GL_TEXTURE_2D, texture);
+        glTexParameteri(GL_TEXTURE_2D, pname, value);
+    }
+
+    void TextureManager::generateMipmap2D(GLuint texture)
+    {
+        if (GLStateCache::hasDirectStateAccess())
+        {
+            glGenerateTextureMipmap(texture);
+            return;
+        }
+
+        GLStateCache::bindTexture(0, GL_TEXTURE_2D, texture);
+        glGenerateMipmap(GL_TEXTURE_2D);
+    }
+
+    GLsizei TextureManager::numMipLevels(GLsizei width, GLsizei height)
+    {
+        GLsizei levels = 1;
+        for (GLsizei size = std::max(width, height); size > 1; size >>= 1)
+            levels++;
+        return levels;
+    }
+
     int TextureManager::destroyTex(Texture* pTex)
     {
         if(pTex)
         {
+            GLStateCache::onDeleteTexture(pTex->textureObj);
             glDeleteTextures(1, &pTex->textureObj);
             texMap.erase(pTex->fileName);
             delete pTex;
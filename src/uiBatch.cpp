@@ -0,0 +1,257 @@
+#include "uiBatch.h"
+#include "renderer.h"
+#include "glState.h"
+#include "log.h"
+#include "windowManager.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <variant>
+
+namespace SpaceEngine
+{
+    //------------------------------------------------------//
+    //------------------------UIAtlas-----------------------//
+    //------------------------------------------------------//
+
+    void UIAtlas::init()
+    {
+        m_texture = TextureManager::createStorage2D(GL_RGBA8, 1, AtlasSize, AtlasSize);
+        TextureManager::setParameter2D(m_texture, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        TextureManager::setParameter2D(m_texture, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        TextureManager::setParameter2D(m_texture, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        TextureManager::setParameter2D(m_texture, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        GLStateCache::bindTexture(0, GL_TEXTURE_2D, 0);
+        GL_CHECK_ERRORS();
+    }
+
+    void UIAtlas::destroy()
+    {
+        GLStateCache::onDeleteTexture(m_texture);
+        glDeleteTextures(1, &m_texture);
+        m_texture = 0;
+        m_regions.clear();
+        m_penX = m_penY = m_shelfHeight = 0;
+    }
+
+    UIAtlasRegion UIAtlas::getRegion(Texture* pTex)
+    {
+        auto it = m_regions.find(pTex);
+        if(it != m_regions.end())
+            return it->second;
+
+        UIAtlasRegion region;
+        if(!insert(pTex, region))
+        {
+            //not packable, sample the whole texture
+            region.texture = pTex->getTexture();
+            region.uvMin = {0.f, 0.f};
+            region.uvMax = {1.f, 1.f};
+        }
+
+        m_regions[pTex] = region;
+        return region;
+    }
+
+    bool UIAtlas::insert(Texture* pTex, UIAtlasRegion& region)
+    {
+        int w = 0;
+        int h = 0;
+        pTex->getImageSize(w, h);
+
+        if(!m_texture || w <= 0 || h <= 0 || w > MaxSubTexSize || h > MaxSubTexSize)
+            return false;
+
+        GLStateCache::bindTexture(0, GL_TEXTURE_2D, pTex->getTexture());
+
+        //the one and two channels textures use a swizzle that glGetTexImage ignores
+        GLint internalFormat = 0;
+        glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_INTERNAL_FORMAT, &internalFormat);
+        if(internalFormat != GL_RGBA8 && internalFormat != GL_RGB8)
+        {
+            GLStateCache::bindTexture(0, GL_TEXTURE_2D, 0);
+            return false;
+        }
+
+        //new shelf
+        if(m_penX + w + Padding > AtlasSize)
+        {
+            m_penX = 0;
+            m_penY += m_shelfHeight;
+            m_shelfHeight = 0;
+        }
+
+        if(m_penY + h + Padding > AtlasSize)
+        {
+            GLStateCache::bindTexture(0, GL_TEXTURE_2D, 0);
+            SPACE_ENGINE_WARN("UIAtlas full, the texture is drawn on its own: {}x{}", w, h);
+            return false;
+        }
+
+        //done once per texture, when the UI is loaded
+        std::vector<unsigned char> pixels(static_cast<size_t>(w) * h * 4);
+        glPixelStorei(GL_PACK_ALIGNMENT, 1);
+        glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        if(GLStateCache::hasDirectStateAccess())
+            glTextureSubImage2D(m_texture, 0, m_penX, m_penY, w, h, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+        else
+        {
+            GLStateCache::bindTexture(0, GL_TEXTURE_2D, m_texture);
+            glTexSubImage2D(GL_TEXTURE_2D, 0, m_penX, m_penY, w, h, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+        }
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        GLStateCache::bindTexture(0, GL_TEXTURE_2D, 0);
+        GL_CHECK_ERRORS();
+
+        //half texel inset, the linear filter doesn't read the neighbours
+        const float invSize = 1.f / static_cast<float>(AtlasSize);
+        region.texture = m_texture;
+        region.uvMin = {(m_penX + 0.5f) * invSize, (m_penY + 0.5f) * invSize};
+        region.uvMax = {(m_penX + w - 0.5f) * invSize, (m_penY + h - 0.5f) * invSize};
+
+        m_penX += w + Padding;
+        m_shelfHeight = std::max(m_shelfHeight, h + Padding);
+
+        return true;
+    }
+
+    //------------------------------------------------------//
+    //-----------------------UIBatcher----------------------//
+    //------------------------------------------------------//
+
+    void UIBatcher::init()
+    {
+        m_pShader = ShaderManager::findShaderProgram("uiBatch");
+        m_pUIShader = ShaderManager::findShaderProgram("ui");
+        m_pUIButtonShader = ShaderManager::findShaderProgram("uiButton");
+
+        m_atlas.init();
+
+        glGenVertexArrays(1, &m_VAO);
+        //room for 64 quads a frame, the ring grows when needed
+        m_stream.init(GL_ARRAY_BUFFER, sizeof(UIVertex) * 6 * 64, "ui quads");
+        bindStream();
+    }
+
+    void UIBatcher::bindStream()
+    {
+        GLStateCache::bindVertexArray(m_VAO);
+        glBindBuffer(GL_ARRAY_BUFFER, m_stream.getBuffer());
+
+        glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(UIVertex), (const void*)offsetof(UIVertex, pos));
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(UIVertex), (const void*)offsetof(UIVertex, uv));
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, sizeof(UIVertex), (const void*)offsetof(UIVertex, color));
+        glEnableVertexAttribArray(2);
+        glVertexAttribPointer(3, 1, GL_FLOAT, GL_FALSE, sizeof(UIVertex), (const void*)offsetof(UIVertex, hover));
+        glEnableVertexAttribArray(3);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        m_streamBuffer = m_stream.getBuffer();
+        GL_CHECK_ERRORS();
+    }
+
+    void UIBatcher::destroy()
+    {
+        m_atlas.destroy();
+        m_stream.destroy();
+        GLStateCache::onDeleteVertexArray(m_VAO);
+        glDeleteVertexArrays(1, &m_VAO);
+        m_streamBuffer = 0;
+        m_VAO = 0;
+    }
+
+    void UIBatcher::begin()
+    {
+        m_vertices.clear();
+        m_batches.clear();
+        m_drawCalls = 0;
+        m_stream.beginFrame();
+    }
+
+    bool UIBatcher::submit(const UIRenderObject& uiRendObj)
+    {
+        UIMaterial* pMat = uiRendObj.pMaterial;
+        ShaderProgram* pShader = pMat->getShader();
+
+        if(!m_pShader || !uiRendObj.pRect || (pShader != m_pUIShader && pShader != m_pUIButtonShader))
+            return false;
+
+        Texture* pTex = pMat->getTexture("ui_tex");
+        if(!pTex)
+            return false;
+
+        //the uiButton subroutines become a per vertex flag
+        float hover = 0.f;
+        if(pShader == m_pUIButtonShader)
+        {
+            if(UIButtonMaterial* pButtonMat = dynamic_cast<UIButtonMaterial*>(pMat); pButtonMat && pButtonMat->isHovered())
+            {
+                hover = 1.f;
+                if(Texture* pHoverTex = pButtonMat->getHoverTexture())
+                    pTex = pHoverTex;
+            }
+        }
+
+        Vector4 color = {1.f, 1.f, 1.f, 1.f};
+        if(auto it = pMat->props.find("color_val"); it != pMat->props.end())
+        {
+            if(const Vector4* pColor = std::get_if<Vector4>(&it->second))
+                color = *pColor;
+        }
+
+        UIAtlasRegion region = m_atlas.getRegion(pTex);
+
+        if(m_batches.empty() || m_batches.back().texture != region.texture)
+            m_batches.push_back({region.texture, static_cast<GLint>(m_vertices.size()), 0});
+
+        const Rect& r = *uiRendObj.pRect;
+        const Vector2 p0 = r.pos;
+        const Vector2 p1 = r.pos + r.size;
+        const Vector2& uv0 = region.uvMin;
+        const Vector2& uv1 = region.uvMax;
+
+        //same winding of the UIMesh quad
+        m_vertices.push_back({{p0.x, p0.y}, {uv0.x, uv0.y}, color, hover});
+        m_vertices.push_back({{p1.x, p1.y}, {uv1.x, uv1.y}, color, hover});
+        m_vertices.push_back({{p0.x, p1.y}, {uv0.x, uv1.y}, color, hover});
+        m_vertices.push_back({{p0.x, p0.y}, {uv0.x, uv0.y}, color, hover});
+        m_vertices.push_back({{p1.x, p0.y}, {uv1.x, uv0.y}, color, hover});
+        m_vertices.push_back({{p1.x, p1.y}, {uv1.x, uv1.y}, color, hover});
+
+        m_batches.back().count += 6;
+
+        return true;
+    }
+
+    void UIBatcher::flush()
+    {
+        if(m_vertices.empty())
+            return;
+
+        //no driver copy and no wait: the segment of the frame is free
+        GLintptr offset = m_stream.upload(m_vertices.data(), m_vertices.size() * sizeof(UIVertex), sizeof(UIVertex));
+        GLint baseVertex = static_cast<GLint>(offset / static_cast<GLintptr>(sizeof(UIVertex)));
+        if(m_streamBuffer != m_stream.getBuffer())
+            bindStream();
+        GLStateCache::bindVertexArray(m_VAO);
+
+        m_pShader->use();
+        m_pShader->setUniform("projection", WindowManager::sceenProjMatrix);
+        m_pShader->setUniform("ui_tex", 0);
+
+        for(const UIBatch& batch : m_batches)
+        {
+            GLStateCache::bindTexture(0, GL_TEXTURE_2D, batch.texture);
+            glDrawArrays(GL_TRIANGLES, baseVertex + batch.first, batch.count);
+            m_drawCalls++;
+        }
+
+        m_stream.endFrame();
+        GL_CHECK_ERRORS();
+        m_vertices.clear();
+        m_batches.clear();
+    }
+}
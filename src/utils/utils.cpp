@@ -5,6 +5,7 @@
 #define NOMINMAX
 #include <Windows.h>
 #include <algorithm>
+#include <cstdio>
 #include <vector>
 
 // Rimosso: #include <filesystem> non serve più
@@ -196,6 +197,105 @@ namespace SpaceEngine
         return a + b;
     }
 
+    //-------------------------------------------------//
+    //-----------------------PNG-----------------------//
+    //-------------------------------------------------//
+
+    static uint32_t crc32(const uint8_t* data, size_t size, uint32_t crc = 0)
+    {
+        static uint32_t table[256] = {};
+        if(!table[1])
+        {
+            for(uint32_t n = 0; n < 256; n++)
+            {
+                uint32_t c = n;
+                for(int k = 0; k < 8; k++)
+                    c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+                table[n] = c;
+            }
+        }
+
+        crc = ~crc;
+        for(size_t i = 0; i < size; i++)
+            crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+        return ~crc;
+    }
+
+    static void putBE32(std::vector<uint8_t>& out, uint32_t value)
+    {
+        out.push_back(static_cast<uint8_t>(value >> 24));
+        out.push_back(static_cast<uint8_t>(value >> 16));
+        out.push_back(static_cast<uint8_t>(value >> 8));
+        out.push_back(static_cast<uint8_t>(value));
+    }
+
+    static void putChunk(std::vector<uint8_t>& out, const char* type, const std::vector<uint8_t>& data)
+    {
+        putBE32(out, static_cast<uint32_t>(data.size()));
+        size_t start = out.size();
+        out.insert(out.end(), type, type + 4);
+        out.insert(out.end(), data.begin(), data.end());
+        putBE32(out, crc32(&out[start], out.size() - start));
+    }
+
+    bool Utils::writePNG(const std::string& path, int width, int height, const std::vector<uint8_t>& rgba)
+    {
+        const size_t rowSize = static_cast<size_t>(width) * 4;
+        if(width <= 0 || height <= 0 || rgba.size() < rowSize * height)
+            return false;
+
+        //scanlines with the filter byte 0
+        std::vector<uint8_t> raw;
+        raw.reserve((rowSize + 1) * height);
+        for(int y = 0; y < height; y++)
+        {
+            raw.push_back(0);
+            raw.insert(raw.end(), rgba.begin() + y * rowSize, rgba.begin() + (y + 1) * rowSize);
+        }
+
+        //zlib stream of stored deflate blocks
+        std::vector<uint8_t> zlib = {0x78, 0x01};
+        const size_t MaxBlock = 0xFFFF;
+        for(size_t pos = 0; pos < raw.size() || pos == 0; pos += MaxBlock)
+        {
+            uint16_t len = static_cast<uint16_t>(std::min(MaxBlock, raw.size() - pos));
+            zlib.push_back(pos + len >= raw.size() ? 1 : 0);
+            zlib.push_back(static_cast<uint8_t>(len));
+            zlib.push_back(static_cast<uint8_t>(len >> 8));
+            zlib.push_back(static_cast<uint8_t>(~len));
+            zlib.push_back(static_cast<uint8_t>(~len >> 8));
+            zlib.insert(zlib.end(), raw.begin() + pos, raw.begin() + pos + len);
+        }
+
+        uint32_t a = 1, b = 0;
+        for(uint8_t v : raw)
+        {
+            a = (a + v) % 65521;
+            b = (b + a) % 65521;
+        }
+        putBE32(zlib, (b << 16) | a);
+
+        std::vector<uint8_t> header;
+        putBE32(header, static_cast<uint32_t>(width));
+        putBE32(header, static_cast<uint32_t>(height));
+        //8 bit RGBA, no interlace
+        header.insert(header.end(), {8, 6, 0, 0, 0});
+
+        std::vector<uint8_t> png = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+        putChunk(png, "IHDR", header);
+        putChunk(png, "IDAT", zlib);
+        putChunk(png, "IEND", {});
+
+        FILE* pFile = fopen(path.c_str(), "wb");
+        if(!pFile)
+            return false;
+
+        size_t written = fwrite(png.data(), 1, png.size(), pFile);
+        fclose(pFile);
+
+        return written == png.size();
+    }
+
     //-------------------------------------------------//
     //-----------------------PRNG----------------------//
     //-------------------------------------------------//
@@ -0,0 +1,160 @@
+#include "log.h"
+#include "managers/logManager.h"
+#include "managers/windowManager.h"
+#include "shader.h"
+#include "mesh.h"
+#include "renderer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+//the mip chain bloom must look like the old 10 passes gaussian ping-pong
+constexpr int Size = 256;
+constexpr float Tolerance = 0.03f; //rmse / peak
+
+static std::vector<float> makeBrightPass()
+{
+    std::vector<float> pixels(Size * Size * 4, 0.f);
+
+    for(int y = 0; y < Size; y++)
+    {
+        for(int x = 0; x < Size; x++)
+        {
+            float v = 0.f;
+            //small hot spot, thin bar and a wide disc
+            if((x - 60) * (x - 60) + (y - 70) * (y - 70) < 9) v = 4.f;
+            if(x > 120 && x < 124 && y > 40 && y < 200) v = 2.f;
+            if((x - 190) * (x - 190) + (y - 180) * (y - 180) < 400) v = 1.5f;
+
+            float* p = &pixels[(y * Size + x) * 4];
+            p[0] = p[1] = p[2] = v;
+            p[3] = 1.f;
+        }
+    }
+
+    return pixels;
+}
+
+static std::vector<float> readRed(GLuint tex, int w, int h)
+{
+    std::vector<float> rgba(w * h * 4);
+    glBindTexture(GL_TEXTURE_2D, tex);
+    glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_FLOAT, rgba.data());
+
+    std::vector<float> red(w * h);
+    for(int i = 0; i < w * h; i++)
+        red[i] = rgba[i * 4];
+
+    return red;
+}
+
+//bilinear, clamp to edge, like the hdr pass sampling the half resolution bloom
+static float sample(const std::vector<float>& img, int w, int h, float u, float v)
+{
+    float x = u * w - 0.5f;
+    float y = v * h - 0.5f;
+    int x0 = static_cast<int>(std::floor(x));
+    int y0 = static_cast<int>(std::floor(y));
+    float fx = x - x0;
+    float fy = y - y0;
+    auto at = [&](int px, int py)
+    {
+        px = std::clamp(px, 0, w - 1);
+        py = std::clamp(py, 0, h - 1);
+        return img[py * w + px];
+    };
+
+    return at(x0, y0) * (1.f - fx) * (1.f - fy) + at(x0 + 1, y0) * fx * (1.f - fy) +
+           at(x0, y0 + 1) * (1.f - fx) * fy + at(x0 + 1, y0 + 1) * fx * fy;
+}
+
+int main()
+{
+    SpaceEngine::LogManager logManager{};
+    SpaceEngine::WindowManager winManager{};
+    SpaceEngine::ShaderManager shManager{};
+    logManager.Initialize();
+    SpaceEngine::WindowManager::headless = true;
+    winManager.Initialize();
+    shManager.Initialize();
+    SPACE_ENGINE_DEBUG("Test the bloom: mip chain against the gaussian ping-pong");
+
+    std::vector<float> brightPixels = makeBrightPass();
+    GLuint srcTex = 0;
+    glGenTextures(1, &srcTex);
+    glBindTexture(GL_TEXTURE_2D, srcTex);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, Size, Size, 0, GL_RGBA, GL_FLOAT, brightPixels.data());
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    SpaceEngine::PlaneMesh* pPlaneMesh = SpaceEngine::MeshManager::getPlaneMesh();
+
+    //reference: the old postprocessing
+    SpaceEngine::ShaderProgram* pGaussShader = SpaceEngine::ShaderManager::createShaderProgram("bloomVFX");
+    SPACE_ENGINE_ASSERT(pGaussShader, "null pointer shader");
+    SpaceEngine::FrameBuffer pingPong[2];
+    for(int i = 0; i < 2; i++)
+    {
+        pingPong[i].init();
+        pingPong[i].resize(Size, Size, 1, false);
+    }
+
+    SpaceEngine::GLStateCache::bindPipeline({.program = static_cast<GLuint>(pGaussShader->getHandle()),
+        .blend = false, .depthTest = false, .cullFace = false});
+    pGaussShader->setUniform("BlurTex", 0);
+    glViewport(0, 0, Size, Size);
+    glActiveTexture(GL_TEXTURE0);
+    pPlaneMesh->bindVAO();
+
+    bool horizontal = true;
+    for(int i = 0; i < 10; i++)
+    {
+        pingPong[horizontal].bindFrameBuffer();
+        pGaussShader->setUniform("horizontal", horizontal);
+        glBindTexture(GL_TEXTURE_2D, i ? static_cast<GLuint>(pingPong[!horizontal].getColorBuffer(0)) : srcTex);
+        pPlaneMesh->draw();
+        horizontal = !horizontal;
+    }
+    pingPong[0].unbindFrameBuffer();
+    std::vector<float> reference = readRed(static_cast<GLuint>(pingPong[!horizontal].getColorBuffer(0)), Size, Size);
+
+    //mip chain
+    SpaceEngine::RenderGraph graph;
+    graph.setSize(Size, Size);
+    SpaceEngine::RGResource brightPass = graph.importTexture("bright_pass", srcTex, Size, Size);
+    SpaceEngine::Bloom bloom;
+    bloom.init();
+    SpaceEngine::RGResource bloomResult = bloom.addPasses(graph, brightPass);
+    graph.compile();
+    graph.execute();
+    SpaceEngine::GLStateCache::bindFramebuffer(0);
+    std::vector<float> chain = readRed(graph.getTexture(bloomResult), Size / 2, Size / 2);
+    GL_CHECK_ERRORS();
+
+    float peak = *std::max_element(reference.begin(), reference.end());
+    double err = 0.0;
+    for(int y = 0; y < Size; y++)
+    {
+        for(int x = 0; x < Size; x++)
+        {
+            float v = sample(chain, Size / 2, Size / 2, (x + 0.5f) / Size, (y + 0.5f) / Size) * bloom.getIntensityScale();
+            double d = v - reference[y * Size + x];
+            err += d * d;
+        }
+    }
+    float rmse = static_cast<float>(std::sqrt(err / (Size * Size))) / peak;
+
+    SPACE_ENGINE_INFO("Bloom mips: {}, radius: {}, rmse/peak: {}", bloom.getMipCount(), bloom.getFilterRadius(), rmse);
+    SPACE_ENGINE_ASSERT(rmse < Tolerance, "bloom doesn't match the gaussian reference");
+    SPACE_ENGINE_INFO("Test done");
+
+    glDeleteTextures(1, &srcTex);
+    shManager.Shutdown();
+    winManager.Shutdown();
+    logManager.Shutdown();
+
+    return 0;
+}
@@ -0,0 +1,68 @@
+#include "log.h"
+#include "managers/logManager.h"
+#include "renderer.h"
+
+#include <cmath>
+
+//the controller must settle on the biggest scale that fits the target without oscillating,
+//and go back to the full scale when the load drops
+constexpr float TargetMs = 14.f;
+constexpr int Frames = 600;
+
+//GPU frame: fixed cost plus the cost of the pixels
+static float frameTime(float scale, float fixedMs, float pixelsMs)
+{
+    return fixedMs + pixelsMs * scale * scale;
+}
+
+//frames run with the load, returns the scale changes in the last half
+static int run(SpaceEngine::DynamicResolution& controller, float fixedMs, float pixelsMs)
+{
+    int changes = 0;
+    for(int frame = 0; frame < Frames; frame++)
+    {
+        if(controller.addFrameTime(frameTime(controller.getScale(), fixedMs, pixelsMs)) && frame >= Frames / 2)
+            changes++;
+    }
+
+    return changes;
+}
+
+int main()
+{
+    SpaceEngine::LogManager logManager{};
+    logManager.Initialize();
+    SPACE_ENGINE_DEBUG("Test the dynamic resolution controller");
+
+    SpaceEngine::DynamicResolution controller;
+    controller.setTargetFrameTime(TargetMs);
+    SPACE_ENGINE_ASSERT(std::abs(controller.getScale() - 1.f) < 1e-3f, "the controller doesn't start at full scale");
+
+    //light load: full scale
+    int changes = run(controller, 2.f, 8.f);
+    SPACE_ENGINE_INFO("light load: scale {}", controller.getScale());
+    SPACE_ENGINE_ASSERT(std::abs(controller.getScale() - 1.f) < 1e-3f && !changes, "the scale dropped under the target");
+
+    //heavy load: 2 + 24 * s^2 fits in 14 ms at s <= 0.707
+    changes = run(controller, 2.f, 24.f);
+    float heavyScale = controller.getScale();
+    SPACE_ENGINE_INFO("heavy load: scale {}, changes {}", heavyScale, changes);
+    SPACE_ENGINE_ASSERT(frameTime(heavyScale, 2.f, 24.f) <= TargetMs, "the frame doesn't fit the target");
+    SPACE_ENGINE_ASSERT(heavyScale >= 0.6f - 1e-3f, "the scale is lower than needed");
+    SPACE_ENGINE_ASSERT(!changes, "the scale oscillates");
+
+    //over the minimum: the scale stops at 50%
+    run(controller, 10.f, 40.f);
+    SPACE_ENGINE_INFO("overload: scale {}", controller.getScale());
+    SPACE_ENGINE_ASSERT(std::abs(controller.getScale() - SpaceEngine::DynamicResolution::MinScale) < 1e-3f, "the scale isn't at the minimum");
+
+    //the load drops: back to full scale
+    run(controller, 2.f, 8.f);
+    SPACE_ENGINE_INFO("load dropped: scale {}", controller.getScale());
+    SPACE_ENGINE_ASSERT(std::abs(controller.getScale() - 1.f) < 1e-3f, "the scale didn't grow back");
+
+    SPACE_ENGINE_INFO("Test done");
+    logManager.Shutdown();
+
+    return 0;
+}
@@ -0,0 +1,80 @@
+#include "app.h"
+#include "log.h"
+#include "frameCapture.h"
+#include "utils/stb_image.h"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+//the frames read back through the ring must be the frames drawn: a screenshot is compared with
+//a synchronous read of the same frame, the stream must hold every frame not dropped
+constexpr uint32_t Frames = 40;
+constexpr uint32_t ScreenshotFrame = 10;
+constexpr uint32_t Fps = 30;
+
+int main()
+{
+    std::filesystem::path dir = std::filesystem::temp_directory_path() / "spaceship_frame_capture";
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+    const std::string videoPath = (dir / "frames.y4m").string();
+    const std::string screenshotPath = (dir / "screenshot.png").string();
+
+    SpaceEngine::App app({.headless = true, .seed = 1234, .frameCapturePath = videoPath, .frameCaptureFps = Fps});
+    SPACE_ENGINE_DEBUG("Test the frame capture");
+    SPACE_ENGINE_ASSERT(SpaceEngine::FrameCapture::isRecording(), "the sequence didn't start");
+    SpaceEngine::SceneManager::SwitchScene("SpaceScene");
+
+    std::vector<uint8_t> reference;
+    int width = 0;
+    int height = 0;
+    for(uint32_t i = 0; i < Frames; i++)
+    {
+        if(i == ScreenshotFrame)
+            SpaceEngine::FrameCapture::screenshot(screenshotPath);
+        app.Frame(SpaceEngine::App::fixed_dt);
+        if(i == ScreenshotFrame)
+            SpaceEngine::RendererV2::readFrame(reference, width, height);
+    }
+
+    //the ring and the queue are written
+    SpaceEngine::FrameCapture::shutdown();
+    const SpaceEngine::FrameCaptureStats& stats = SpaceEngine::FrameCapture::getStats();
+    SPACE_ENGINE_INFO("{} frames read back, {} written, {} dropped, {} stalls, {:.3f} ms to resolve",
+        stats.readbacks, SpaceEngine::FrameCapture::getWrittenFrames(), stats.dropped, stats.stalls, stats.lastResolveMs);
+    SPACE_ENGINE_ASSERT(stats.readbacks == Frames, "a frame wasn't read back");
+    SPACE_ENGINE_ASSERT(SpaceEngine::FrameCapture::getWrittenFrames() + stats.dropped == Frames + 1, "frames lost by the worker");
+
+    //stream: header + FRAME and the 3 planes of every frame
+    std::ifstream video(videoPath, std::ios::binary);
+    std::string header;
+    std::getline(video, header);
+    std::string expected = "YUV4MPEG2 W" + std::to_string(width) + " H" + std::to_string(height) + " F" + std::to_string(Fps) + ":1 Ip A1:1 C444";
+    SPACE_ENGINE_ASSERT(header == expected, "wrong Y4M header");
+
+    const uintmax_t frameBytes = 6 + 3 * static_cast<uintmax_t>(width) * height;
+    const uintmax_t streamBytes = std::filesystem::file_size(videoPath) - header.size() - 1;
+    SPACE_ENGINE_ASSERT(streamBytes % frameBytes == 0, "truncated frame in the stream");
+    const uintmax_t videoFrames = streamBytes / frameBytes;
+    SPACE_ENGINE_INFO("{} frames in {}", videoFrames, videoPath);
+    SPACE_ENGINE_ASSERT(videoFrames <= Frames && videoFrames + stats.dropped >= Frames, "frames missing in the stream");
+
+    //the screenshot is dropped only with a full queue
+    if(std::filesystem::exists(screenshotPath))
+    {
+        int w = 0, h = 0, bpp = 0;
+        unsigned char* pPixels = stbi_load(screenshotPath.c_str(), &w, &h, &bpp, 4);
+        SPACE_ENGINE_ASSERT(pPixels && w == width && h == height, "wrong screenshot size");
+        SPACE_ENGINE_ASSERT(std::memcmp(pPixels, reference.data(), reference.size()) == 0, "the screenshot isn't the frame drawn");
+        stbi_image_free(pPixels);
+    }
+    else SPACE_ENGINE_ASSERT(stats.dropped, "screenshot missing");
+
+    std::filesystem::remove_all(dir);
+    SPACE_ENGINE_INFO("Test done");
+
+    return 0;
+}
@@ -0,0 +1,202 @@
+#include "app.h"
+#include "log.h"
+#include "utils/stb_image.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <string>
+#include <vector>
+
+//deterministic frames of the scenes rendered offscreen and compared with the stored references:
+//run with --record on the reference machine to write the golden images
+constexpr uint32_t Seed = 1234;
+//pixels farther than a just noticeable difference
+constexpr float PixelDeltaE = 6.f;
+constexpr float MaxDifferentPixels = 0.0025f;
+constexpr float MaxMeanDeltaE = 1.5f;
+
+struct Shot
+{
+    const char* scene;
+    const char* golden;
+    int frames;
+};
+
+constexpr Shot Shots[] =
+{
+    {"TitleScreen", "title_screen", 30},
+    //the spawner runs 3 seconds
+    {"SpaceScene", "space_scene", 90},
+    {"GameOverScene", "game_over", 30},
+};
+
+static float toLinear(float c)
+{
+    return c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+}
+
+static float labF(float t)
+{
+    return t > 0.008856f ? std::cbrt(t) : 7.787f * t + 16.f / 116.f;
+}
+
+//sRGB -> CIELAB, D65
+static void toLab(const float* rgb, float* lab)
+{
+    float r = toLinear(rgb[0]);
+    float g = toLinear(rgb[1]);
+    float b = toLinear(rgb[2]);
+    float x = labF((0.4124f * r + 0.3576f * g + 0.1805f * b) / 0.95047f);
+    float y = labF(0.2126f * r + 0.7152f * g + 0.0722f * b);
+    float z = labF((0.0193f * r + 0.1192f * g + 0.9505f * b) / 1.08883f);
+    lab[0] = 116.f * y - 16.f;
+    lab[1] = 500.f * (x - y);
+    lab[2] = 200.f * (y - z);
+}
+
+//3x3 box filter, the rasterization differences on the edges are not visible
+static std::vector<float> blurToLab(const uint8_t* rgba, int w, int h)
+{
+    std::vector<float> lab(static_cast<size_t>(w) * h * 3);
+
+    for(int y = 0; y < h; y++)
+    {
+        for(int x = 0; x < w; x++)
+        {
+            float rgb[3] = {0.f, 0.f, 0.f};
+            int n = 0;
+            for(int dy = -1; dy <= 1; dy++)
+            {
+                for(int dx = -1; dx <= 1; dx++)
+                {
+                    int sx = x + dx;
+                    int sy = y + dy;
+                    if(sx < 0 || sy < 0 || sx >= w || sy >= h) continue;
+                    const uint8_t* p = &rgba[(sy * w + sx) * 4];
+                    rgb[0] += p[0];
+                    rgb[1] += p[1];
+                    rgb[2] += p[2];
+                    n++;
+                }
+            }
+
+            for(float& c : rgb)
+                c /= 255.f * n;
+            toLab(rgb, &lab[(y * w + x) * 3]);
+        }
+    }
+
+    return lab;
+}
+
+static bool compare(const std::string& name, const std::vector<uint8_t>& frame, int w, int h)
+{
+    std::string goldenPath = std::string(GOLDEN_PATH) + name + ".png";
+    int gw = 0;
+    int gh = 0;
+    int channels = 0;
+    stbi_set_flip_vertically_on_load(false);
+    uint8_t* pGolden = stbi_load(goldenPath.c_str(), &gw, &gh, &channels, 4);
+
+    //a missing reference is a failure: the goldens are written only by --record
+    if(!pGolden)
+    {
+        SPACE_ENGINE_ERROR("Golden {} missing, record it with --record", goldenPath);
+        SpaceEngine::Utils::writePNG(name + "_actual.png", w, h, frame);
+        return false;
+    }
+
+    bool pass = gw == w && gh == h;
+    if(!pass)
+        SPACE_ENGINE_ERROR("{}: size {}x{}, golden {}x{}", name, w, h, gw, gh);
+
+    if(pass)
+    {
+        std::vector<float> a = blurToLab(frame.data(), w, h);
+        std::vector<float> b = blurToLab(pGolden, w, h);
+        std::vector<uint8_t> diff(frame.size(), 255);
+        size_t different = 0;
+        double sum = 0.0;
+
+        for(size_t i = 0; i < static_cast<size_t>(w) * h; i++)
+        {
+            float dl = a[i * 3] - b[i * 3];
+            float da = a[i * 3 + 1] - b[i * 3 + 1];
+            float db = a[i * 3 + 2] - b[i * 3 + 2];
+            float deltaE = std::sqrt(dl * dl + da * da + db * db);
+            sum += deltaE;
+
+            uint8_t v = static_cast<uint8_t>(std::min(255.f, deltaE * 10.f));
+            diff[i * 4] = v;
+            diff[i * 4 + 1] = diff[i * 4 + 2] = deltaE > PixelDeltaE ? 0 : v;
+            if(deltaE > PixelDeltaE)
+                different++;
+        }
+
+        float fraction = static_cast<float>(different) / static_cast<float>(w * h);
+        float mean = static_cast<float>(sum / (static_cast<double>(w) * h));
+        pass = fraction <= MaxDifferentPixels && mean <= MaxMeanDeltaE;
+        SPACE_ENGINE_INFO("{}: different pixels {}%, mean deltaE {}", name, fraction * 100.f, mean);
+
+        if(!pass)
+            SpaceEngine::Utils::writePNG(name + "_diff.png", w, h, diff);
+    }
+
+    if(!pass)
+        SpaceEngine::Utils::writePNG(name + "_actual.png", w, h, frame);
+
+    stbi_image_free(pGolden);
+    return pass;
+}
+
+int main(int argc, char** argv)
+{
+    bool record = argc > 1 && std::strcmp(argv[1], "--record") == 0;
+
+    SpaceEngine::App app({.headless = true, .seed = Seed});
+    SPACE_ENGINE_DEBUG("Test the golden images{}", record ? ", recording" : "");
+
+    int failures = 0;
+    for(const Shot& shot : Shots)
+    {
+        //every shot starts from the same random sequence
+        srand(Seed);
+        SpaceEngine::PRNG::setSeed(Seed);
+        SpaceEngine::SceneManager::SwitchScene(shot.scene);
+
+        for(int i = 0; i < shot.frames; i++)
+            app.Frame(SpaceEngine::App::fixed_dt);
+
+        std::vector<uint8_t> frame;
+        int w = 0;
+        int h = 0;
+        if(!SpaceEngine::RendererV2::readFrame(frame, w, h))
+        {
+            SPACE_ENGINE_ERROR("{}: frame not read", shot.scene);
+            failures++;
+            continue;
+        }
+
+        if(record)
+        {
+            std::string path = std::string(GOLDEN_PATH) + shot.golden + ".png";
+            if(!SpaceEngine::Utils::writePNG(path, w, h, frame))
+            {
+                SPACE_ENGINE_ERROR("{} not written", path);
+                failures++;
+            }
+            else SPACE_ENGINE_INFO("Recorded {}", path);
+        }
+        else if(!compare(shot.golden, frame, w, h))
+        {
+            SPACE_ENGINE_ERROR("{} doesn't match the golden image", shot.scene);
+            failures++;
+        }
+    }
+
+    SPACE_ENGINE_ASSERT(!failures, "golden images mismatch");
+    SPACE_ENGINE_INFO("Test done");
+
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,83 @@
+#include "log.h"
+#include "managers/logManager.h"
+#include "managers/windowManager.h"
+#include "shader.h"
+#include "mesh.h"
+#include "glState.h"
+#include "gpuProfiler.h"
+
+//the sections must be read back without waiting the GPU and the heavier one must cost more
+constexpr int Frames = 60;
+constexpr int HeavyDraws = 40;
+
+int main()
+{
+    SpaceEngine::LogManager logManager{};
+    SpaceEngine::WindowManager winManager{};
+    SpaceEngine::ShaderManager shManager{};
+    logManager.Initialize();
+    SpaceEngine::WindowManager::headless = true;
+    winManager.Initialize();
+    shManager.Initialize();
+    SPACE_ENGINE_DEBUG("Test the GPU profiler");
+
+    SpaceEngine::GPUProfiler::init();
+    SPACE_ENGINE_ASSERT(SpaceEngine::GPUProfiler::isSupported(), "timestamp queries not supported");
+
+    SpaceEngine::ShaderProgram* pShader = SpaceEngine::ShaderManager::findShaderProgram("hdr");
+    SPACE_ENGINE_ASSERT(pShader, "Shader not found");
+    SpaceEngine::GLStateCache::bindPipeline({.program = static_cast<GLuint>(pShader->getHandle()),
+        .blend = true, .blendSrc = GL_ONE, .blendDst = GL_ONE, .depthTest = false, .cullFace = false});
+    SpaceEngine::PlaneMesh* pPlaneMesh = SpaceEngine::MeshManager::getPlaneMesh();
+    pPlaneMesh->bindVAO();
+    glViewport(0, 0, SpaceEngine::WindowManager::width, SpaceEngine::WindowManager::height);
+
+    for(int frame = 0; frame < Frames; frame++)
+    {
+        SpaceEngine::GPUProfiler::beginFrame();
+        {
+            SpaceEngine::GPUProfileScope scope("heavy");
+            for(int i = 0; i < HeavyDraws; i++)
+                pPlaneMesh->draw();
+        }
+        //two sections with the same name are summed
+        for(int i = 0; i < 2; i++)
+        {
+            SpaceEngine::GPUProfileScope scope("light");
+            pPlaneMesh->draw();
+        }
+        SpaceEngine::GPUProfiler::endFrame();
+        glFlush();
+    }
+
+    //results of the last frames are still in the ring
+    uint64_t resolved = SpaceEngine::GPUProfiler::getResolvedFrames();
+    uint32_t dropped = SpaceEngine::GPUProfiler::getDroppedFrames();
+    SPACE_ENGINE_INFO("GPU profiler frames resolved: {}, dropped: {}", resolved, dropped);
+    SPACE_ENGINE_ASSERT(resolved + dropped == Frames - SpaceEngine::GPUProfiler::FramesInFlight, "frames lost in the ring");
+    SPACE_ENGINE_ASSERT(resolved > 0, "no frame read back");
+
+    const SpaceEngine::GPUTimerStats* pFrame = SpaceEngine::GPUProfiler::findStats("frame");
+    const SpaceEngine::GPUTimerStats* pHeavy = SpaceEngine::GPUProfiler::findStats("heavy");
+    const SpaceEngine::GPUTimerStats* pLight = SpaceEngine::GPUProfiler::findStats("light");
+    SPACE_ENGINE_ASSERT(pFrame && pHeavy && pLight, "section not found");
+    SPACE_ENGINE_ASSERT(SpaceEngine::GPUProfiler::getStats().size() == 3, "same name sections not merged");
+
+    for(const SpaceEngine::GPUTimerStats& stats : SpaceEngine::GPUProfiler::getStats())
+    {
+        SPACE_ENGINE_INFO("{}: avg {} ms, max {} ms", stats.name, stats.avgMs, stats.maxMs);
+        SPACE_ENGINE_ASSERT(stats.maxMs >= stats.avgMs, "max below the average");
+    }
+
+    SPACE_ENGINE_ASSERT(pHeavy->avgMs > 0.f, "empty timings");
+    SPACE_ENGINE_ASSERT(pHeavy->avgMs > pLight->avgMs, "the heavy section is cheaper than the light one");
+    SPACE_ENGINE_ASSERT(pFrame->avgMs >= pHeavy->avgMs, "nested section longer than the frame");
+    SPACE_ENGINE_INFO("Test done");
+
+    SpaceEngine::GPUProfiler::shutdown();
+    shManager.Shutdown();
+    winManager.Shutdown();
+    logManager.Shutdown();
+
+    return 0;
+}
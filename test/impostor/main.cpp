@@ -0,0 +1,78 @@
+#include "app.h"
+#include "log.h"
+#include "impostor.h"
+#include "mesh.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+//every frame of the atlas must see the asteroid inside the bounding sphere, the far asteroids
+//must be drawn as impostors and the mesh must fade out in the band before the impostor distance
+constexpr uint32_t MaxFrames = 600;
+static const char* AsteroidMeshes[] = {"Asteroid_LowPoly", "Asteroid02", "Asteroid03"};
+
+int main()
+{
+    SpaceEngine::App app({.headless = true, .seed = 1234});
+    SPACE_ENGINE_DEBUG("Test the impostors");
+    SpaceEngine::SceneManager::SwitchScene("SpaceScene");
+
+    using SpaceEngine::ImpostorManager;
+    constexpr uint32_t Size = ImpostorManager::AtlasSize;
+    constexpr uint32_t Frame = ImpostorManager::FrameSize;
+    std::vector<uint8_t> albedo(Size * Size * 4);
+    for(const char* name : AsteroidMeshes)
+    {
+        SpaceEngine::Mesh* pMesh = SpaceEngine::MeshManager::findMesh(name);
+        SPACE_ENGINE_ASSERT(pMesh, "asteroid mesh not loaded");
+        const SpaceEngine::ImpostorAtlas* pAtlas = ImpostorManager::find(pMesh);
+        SPACE_ENGINE_ASSERT(pAtlas && pAtlas->albedo && pAtlas->normalDepth, "atlas not baked");
+
+        SpaceEngine::GLStateCache::bindTexture(0, GL_TEXTURE_2D, pAtlas->albedo);
+        glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_UNSIGNED_BYTE, albedo.data());
+        SpaceEngine::GLStateCache::bindTexture(0, GL_TEXTURE_2D, 0);
+
+        for(uint32_t j = 0; j < ImpostorManager::GridSize; j++)
+        {
+            for(uint32_t i = 0; i < ImpostorManager::GridSize; i++)
+            {
+                //the mesh is in the sphere, the sphere is the circle inscribed in the frame
+                uint32_t covered = 0;
+                for(uint32_t y = 0; y < Frame; y++)
+                    for(uint32_t x = 0; x < Frame; x++)
+                        covered += albedo[((j * Frame + y) * Size + i * Frame + x) * 4 + 3] > 0;
+                const uint8_t corner = albedo[((j * Frame) * Size + i * Frame) * 4 + 3];
+                SPACE_ENGINE_ASSERT(covered > 0, "empty frame in the atlas");
+                SPACE_ENGINE_ASSERT(corner == 0, "the mesh is out of the bounding sphere");
+            }
+        }
+    }
+
+    //fade of the mesh: 1 before the band, 0 past the distance, linear in between
+    ImpostorManager::setDistance(40.f, 10.f);
+    SpaceEngine::Mesh* pAsteroid = SpaceEngine::MeshManager::findMesh(AsteroidMeshes[0]);
+    SPACE_ENGINE_ASSERT(ImpostorManager::getMeshFade(pAsteroid, 20.f) == 1.f, "the near mesh fades");
+    SPACE_ENGINE_ASSERT(std::abs(ImpostorManager::getMeshFade(pAsteroid, 35.f) - 0.5f) < 1e-5f, "wrong fade in the band");
+    SPACE_ENGINE_ASSERT(ImpostorManager::getMeshFade(pAsteroid, 45.f) == 0.f, "the far mesh is drawn");
+    SPACE_ENGINE_ASSERT(ImpostorManager::getMeshFade(nullptr, 45.f) == 1.f, "a mesh without atlas fades");
+
+    //the asteroids spawn far away and come to the camera
+    uint32_t impostorFrames = 0;
+    uint32_t maxInstances = 0;
+    for(uint32_t i = 0; i < MaxFrames; i++)
+    {
+        app.Frame(SpaceEngine::App::fixed_dt);
+        if(SpaceEngine::RendererV2::getImpostorDrawCalls())
+            impostorFrames++;
+        maxInstances = std::max(maxInstances, SpaceEngine::RendererV2::getImpostorInstances());
+    }
+
+    SPACE_ENGINE_INFO("{} frames with impostors, {} impostors at most", impostorFrames, maxInstances);
+    SPACE_ENGINE_ASSERT(impostorFrames > 0, "no impostor drawn");
+    SPACE_ENGINE_ASSERT(SpaceEngine::RendererV2::getImpostorDrawCalls() <= 3, "more than one draw per atlas");
+
+    SPACE_ENGINE_INFO("Test done");
+
+    return 0;
+}
@@ -0,0 +1,107 @@
+#include "log.h"
+#include "managers/logManager.h"
+#include "lightClusters.h"
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+//every light touching a point must be in the list of the cluster of the point,
+//the lights without range must stay out of the clusters
+constexpr uint32_t NumLocalLights = 256;
+constexpr uint32_t NumSamples = 20000;
+constexpr float Near = 0.1f;
+constexpr float Far = 200.f;
+
+int main()
+{
+    SpaceEngine::LogManager logManager{};
+    logManager.Initialize();
+    SPACE_ENGINE_DEBUG("Test the light clusters");
+
+    //camera at the origin looking along -z
+    SpaceEngine::CameraView view;
+    view.view = SpaceEngine::Math::identityMatrix4();
+    view.projection = SpaceEngine::Math::perspectiveMatrix4(60.f, 16.f / 9.f, Near, Far);
+    view.viewProjection = view.projection * view.view;
+    view.pos = {0.f, 0.f, 0.f};
+
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<float> unit(0.f, 1.f);
+    std::vector<SpaceEngine::Light> lightStorage;
+    lightStorage.reserve(NumLocalLights + 5);
+    for(uint32_t i = 0; i < NumLocalLights; i++)
+    {
+        //some behind the camera and past the far plane
+        SpaceEngine::Vector3 pos = {unit(rng) * 160.f - 80.f, unit(rng) * 90.f - 45.f, 20.f - unit(rng) * 240.f};
+        float intensity = 1.f + unit(rng) * 20.f;
+        lightStorage.emplace_back(pos, SpaceEngine::Vector3(intensity, intensity * 0.5f, 0.2f), true);
+        if(i % 3 == 0)
+            lightStorage.back().range = 2.f + unit(rng) * 10.f;
+    }
+    //4 directional + 1 without decay: one over the limit
+    for(uint32_t i = 0; i < 4; i++)
+        lightStorage.emplace_back(SpaceEngine::Vector3(0.f), SpaceEngine::Vector3(1.f), SpaceEngine::Vector3(0.f, -1.f, 0.f));
+    lightStorage.emplace_back(SpaceEngine::Vector3(0.f, 10.f, 0.f), SpaceEngine::Vector3(1.f));
+
+    std::vector<SpaceEngine::Light*> lights;
+    for(SpaceEngine::Light& light : lightStorage)
+        lights.push_back(&light);
+
+    SpaceEngine::LightClusters clusters;
+    clusters.build(view, lights);
+    const SpaceEngine::LightClusterStats& stats = clusters.getStats();
+    SPACE_ENGINE_INFO("clusters: {} local, {} global, {} dropped, {} indices, {} max per cluster",
+        stats.localLights, stats.globalLights, stats.dropped, stats.indices, stats.maxPerCluster);
+    SPACE_ENGINE_ASSERT(stats.localLights == NumLocalLights && stats.globalLights == 4 && stats.dropped == 1, "wrong light split");
+    //the culling must cut the lists, a light in every cluster would be NumLocalLights
+    SPACE_ENGINE_ASSERT(stats.maxPerCluster < NumLocalLights, "the lights aren't culled");
+
+    uint32_t total = 0;
+    for(uint32_t c = 0; c < SpaceEngine::LightClusters::NumClusters; c++)
+        total += clusters.getClusterCount(static_cast<int>(c));
+    SPACE_ENGINE_ASSERT(total == stats.indices, "the counts don't cover the indices");
+
+    //brute force on random points of the frustum
+    const std::vector<const SpaceEngine::Light*>& local = clusters.getLocalLights();
+    uint32_t checked = 0;
+    for(uint32_t s = 0; s < NumSamples; s++)
+    {
+        float ndcX = unit(rng) * 2.f - 1.f;
+        float ndcY = unit(rng) * 2.f - 1.f;
+        float depth = Near * std::pow(Far / Near, unit(rng));
+        SpaceEngine::Vector3 viewPos = {ndcX * depth / view.projection[0][0], ndcY * depth / view.projection[1][1], -depth};
+
+        int tileX = static_cast<int>((ndcX * 0.5f + 0.5f) * SpaceEngine::LightClusters::GridX);
+        int tileY = static_cast<int>((ndcY * 0.5f + 0.5f) * SpaceEngine::LightClusters::GridY);
+        int cluster = clusters.getCluster(tileX, tileY, depth);
+        SPACE_ENGINE_ASSERT(cluster >= 0, "point outside the grid");
+
+        const uint32_t* pList = clusters.getClusterLights(cluster);
+        uint32_t count = clusters.getClusterCount(cluster);
+        for(uint32_t i = 0; i < local.size(); i++)
+        {
+            //the view is the identity: the world is the view space
+            if(glm::length(local[i]->pos - viewPos) >= SpaceEngine::LightClusters::getRange(*local[i]))
+                continue;
+
+            bool found = false;
+            for(uint32_t j = 0; j < count && !found; j++)
+                found = pList[j] == i;
+            SPACE_ENGINE_ASSERT(found, "light missing from the cluster of a point it touches");
+            checked++;
+        }
+    }
+    SPACE_ENGINE_INFO("{} light-point pairs checked", checked);
+    SPACE_ENGINE_ASSERT(checked, "no point touched by a light");
+
+    //no local lights: empty lists
+    lights.resize(0);
+    clusters.build(view, lights);
+    SPACE_ENGINE_ASSERT(!clusters.getStats().indices && !clusters.getStats().localLights, "lists left from the last build");
+
+    SPACE_ENGINE_INFO("Test done");
+    logManager.Shutdown();
+
+    return 0;
+}
@@ -2,6 +2,10 @@
 #include "managers/logManager.h"
 #include "shader.h"
 #include "managers/windowManager.h"
+#include "mesh.h"
+
+#include <cmath>
+#include <vector>
 
 
 int main()
@@ -10,6 +14,7 @@ int main()
     SpaceEngine::WindowManager winManager{};
     SpaceEngine::ShaderManager shManager{};
     logManager.Initialize();
+    SpaceEngine::WindowManager::headless = true;
     winManager.Initialize();
     shManager.Initialize();
     SPACE_ENGINE_DEBUG("Test the shaderManager");
@@ -19,6 +24,105 @@ int main()
     SPACE_ENGINE_DEBUG("Test the shader: simpleTex");
     SPACE_ENGINE_ASSERT(SpaceEngine::ShaderManager::createShaderProgram("simpleTex"), "null pointer shader");
     SPACE_ENGINE_ASSERT(SpaceEngine::ShaderManager::findShaderProgram("simpleTex"), "Shader not found");
+
+    SPACE_ENGINE_DEBUG("Test the geometry arena ranges");
+    SpaceEngine::RangeAllocator ranges;
+    ranges.reset(100);
+    uint32_t a = 0, b = 0, c = 0;
+    bool allocated = ranges.allocate(40, a) && ranges.allocate(40, b);
+    SPACE_ENGINE_ASSERT(allocated, "range not allocated");
+    allocated = ranges.allocate(40, c);
+    SPACE_ENGINE_ASSERT(!allocated, "range bigger than the free room");
+    ranges.free(a, 40);
+    allocated = ranges.allocate(30, c);
+    SPACE_ENGINE_ASSERT(allocated && c == a, "free range not reused");
+    ranges.free(c, 30);
+    ranges.free(b, 40);
+    //everything merged again
+    allocated = ranges.allocate(100, c);
+    SPACE_ENGINE_ASSERT(allocated && c == 0, "free ranges not merged");
+    ranges.grow(200);
+    allocated = ranges.allocate(100, c);
+    SPACE_ENGINE_ASSERT(allocated && c == 100, "grown range not used");
+
+    SPACE_ENGINE_DEBUG("Test the geometry arena: the meshes share the buffers, the data survives the growth");
+    std::vector<SpaceEngine::MeshVertex> vertices(SpaceEngine::GeometryArena::InitialVertices / 2 + 1);
+    std::vector<uint32_t> indices = {0, 1, 2};
+    vertices[0].position = {1.f, 2.f, 3.f};
+    uint32_t baseVertex[3] = {};
+    uint32_t firstIndex[3] = {};
+    for(int i = 0; i < 3; i++)
+        SpaceEngine::GeometryArena::allocate(vertices, indices, baseVertex[i], firstIndex[i]);
+    SPACE_ENGINE_ASSERT(baseVertex[1] == baseVertex[0] + vertices.size() && firstIndex[1] == firstIndex[0] + indices.size(), "ranges not packed");
+
+    SpaceEngine::GeometryArena::bindVAO();
+    GLint vertexBuffer = 0;
+    glGetVertexAttribiv(0, GL_VERTEX_ATTRIB_ARRAY_BUFFER_BINDING, &vertexBuffer);
+    SpaceEngine::MeshVertex first;
+    glBindBuffer(GL_COPY_READ_BUFFER, static_cast<GLuint>(vertexBuffer));
+    glGetBufferSubData(GL_COPY_READ_BUFFER, sizeof(SpaceEngine::MeshVertex) * baseVertex[0], sizeof(first), &first);
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    SPACE_ENGINE_ASSERT(first.position == vertices[0].position, "vertices lost growing the arena");
+    GL_CHECK_ERRORS();
+
+    SPACE_ENGINE_DEBUG("Test the LOD simplification: a closed sphere, the triangles are halved within the error");
+    constexpr uint32_t Rings = 32;
+    constexpr uint32_t Segments = 64;
+    std::vector<SpaceEngine::MeshVertex> sphere;
+    std::vector<uint32_t> sphereIndices;
+    sphere.push_back({});
+    sphere.back().position = {0.f, 1.f, 0.f};
+    for(uint32_t r = 1; r < Rings; r++)
+    {
+        float phi = glm::pi<float>() * r / Rings;
+        for(uint32_t s = 0; s < Segments; s++)
+        {
+            float theta = glm::two_pi<float>() * s / Segments;
+            sphere.push_back({});
+            sphere.back().position = {std::sin(phi) * std::cos(theta), std::cos(phi), std::sin(phi) * std::sin(theta)};
+        }
+    }
+    sphere.push_back({});
+    sphere.back().position = {0.f, -1.f, 0.f};
+    const uint32_t bottom = static_cast<uint32_t>(sphere.size() - 1);
+    auto ring = [](uint32_t r, uint32_t s) { return 1 + (r - 1) * Segments + s % Segments; };
+    for(uint32_t s = 0; s < Segments; s++)
+    {
+        sphereIndices.insert(sphereIndices.end(), {0, ring(1, s + 1), ring(1, s)});
+        sphereIndices.insert(sphereIndices.end(), {bottom, ring(Rings - 1, s), ring(Rings - 1, s + 1)});
+        for(uint32_t r = 1; r + 1 < Rings; r++)
+        {
+            sphereIndices.insert(sphereIndices.end(), {ring(r, s), ring(r, s + 1), ring(r + 1, s)});
+            sphereIndices.insert(sphereIndices.end(), {ring(r, s + 1), ring(r + 1, s + 1), ring(r + 1, s)});
+        }
+    }
+
+    const uint32_t sphereVertices = static_cast<uint32_t>(sphere.size());
+    const float maxError = SpaceEngine::Mesh::LodError[0];
+    float error = 0.f;
+    std::vector<uint32_t> lod = SpaceEngine::simplifyMesh(sphere.data(), sphereVertices, sphereIndices,
+        static_cast<uint32_t>(sphereIndices.size() / 2), maxError, &error);
+    SPACE_ENGINE_INFO("{} -> {} triangles, error {}", sphereIndices.size() / 3, lod.size() / 3, error);
+    SPACE_ENGINE_ASSERT(lod.size() % 3 == 0 && lod.size() <= sphereIndices.size() / 2, "triangles not halved");
+    SPACE_ENGINE_ASSERT(error <= maxError, "error over the bound");
+    //the winding of the sphere, every triangle keeps it
+    auto facesOut = [&sphere](uint32_t a, uint32_t b, uint32_t c)
+    {
+        const glm::vec3& p = sphere[a].position;
+        return glm::dot(glm::cross(sphere[b].position - p, sphere[c].position - p), p) > 0.f;
+    };
+    const bool winding = facesOut(sphereIndices[0], sphereIndices[1], sphereIndices[2]);
+    for(size_t i = 0; i < lod.size(); i += 3)
+    {
+        SPACE_ENGINE_ASSERT(lod[i] < sphereVertices && lod[i + 1] < sphereVertices && lod[i + 2] < sphereVertices, "index out of the vertices");
+        SPACE_ENGINE_ASSERT(lod[i] != lod[i + 1] && lod[i + 1] != lod[i + 2] && lod[i] != lod[i + 2], "degenerate triangle");
+        SPACE_ENGINE_ASSERT(facesOut(lod[i], lod[i + 1], lod[i + 2]) == winding, "flipped triangle");
+    }
+
+    //without room for the error nothing collapses
+    lod = SpaceEngine::simplifyMesh(sphere.data(), sphereVertices, sphereIndices, 0, 0.f);
+    SPACE_ENGINE_ASSERT(lod.size() == sphereIndices.size(), "collapse over the bound");
+
     SPACE_ENGINE_INFO("Test done");
     shManager.Shutdown();
     winManager.Shutdown();
@@ -0,0 +1,124 @@
+#include "log.h"
+#include "managers/logManager.h"
+#include "particles.h"
+
+#include <cmath>
+#include <vector>
+
+//the SIMD integration must match the scalar one, the budget must hold under a burst
+//and the instances of a material must be contiguous
+constexpr uint32_t NumParticles = 103; //not a multiple of 4: the scalar tail runs too
+constexpr float Dt = 1.f / 60.f;
+constexpr int Steps = 30;
+
+static bool near(float a, float b)
+{
+    return std::abs(a - b) <= 1e-4f * std::max(1.f, std::abs(b));
+}
+
+int main()
+{
+    SpaceEngine::LogManager logManager{};
+    logManager.Initialize();
+    SPACE_ENGINE_DEBUG("Test the particle pool and system");
+
+    //pool against a scalar reference
+    SpaceEngine::ParticlePool pool;
+    pool.init(128);
+    std::vector<float> px(NumParticles), pz(NumParticles, 0.f), vx(NumParticles), drag(NumParticles), life(NumParticles);
+    for(uint32_t i = 0; i < NumParticles; i++)
+    {
+        px[i] = static_cast<float>(i);
+        vx[i] = 1.f + 0.1f * static_cast<float>(i);
+        drag[i] = 0.5f * static_cast<float>(i % 5);
+        //the odd ones die halfway
+        life[i] = i % 2 ? Dt * Steps * 0.5f : 10.f;
+        pool.emit({px[i], 0.f, 0.f}, {vx[i], 0.f, -vx[i]}, life[i], drag[i], 0);
+    }
+
+    uint32_t dead = 0;
+    for(int step = 0; step < Steps / 2 - 1; step++)
+    {
+        dead += pool.simulate(Dt);
+        for(uint32_t i = 0; i < NumParticles; i++)
+        {
+            vx[i] *= std::max(1.f - drag[i] * Dt, 0.f);
+            px[i] += vx[i] * Dt;
+            pz[i] -= vx[i] * Dt;
+        }
+    }
+    SPACE_ENGINE_ASSERT(!dead && pool.getCount() == NumParticles, "particles dead before their life");
+
+    for(uint32_t i = 0; i < NumParticles; i++)
+    {
+        bool match = near(pool.posX[i], px[i]) && near(pool.posZ[i], pz[i]) && near(pool.velX[i], vx[i]);
+        SPACE_ENGINE_ASSERT(match, "the SIMD integration doesn't match the scalar one");
+    }
+
+    //the odd ones die, the survivors are packed at the front
+    for(int step = 0; step < 2; step++)
+        dead += pool.simulate(Dt);
+    SPACE_ENGINE_INFO("pool: {} alive, {} dead", pool.getCount(), dead);
+    SPACE_ENGINE_ASSERT(dead == NumParticles / 2 && pool.getCount() == NumParticles - dead, "wrong number of dead particles");
+    for(uint32_t i = 0; i < pool.getCount(); i++)
+        SPACE_ENGINE_ASSERT(pool.age[i] < pool.life[i], "dead particle in the live range");
+
+    //system: budget
+    SpaceEngine::ParticleSystem::init(1024);
+    SpaceEngine::ParticleSystem::setBudget(100);
+    SpaceEngine::ParticleMaterial sparks{.bloom = 1.f};
+    SpaceEngine::ParticleMaterial glow{.bloom = 0.5f};
+    SpaceEngine::ParticleEmitterDesc burstDesc{.pMaterial = &sparks, .minLife = 1.f, .maxLife = 2.f,
+        .startColor = {4.f, 1.f, 1.f, 1.f}};
+    SpaceEngine::ParticleSystem::burst(burstDesc, {0.f, 0.f, 0.f}, 150);
+    SpaceEngine::ParticleSystem::update(Dt);
+    const SpaceEngine::ParticleStats& stats = SpaceEngine::ParticleSystem::getStats();
+    SPACE_ENGINE_INFO("burst: {} alive, {} spawned, {} dropped", stats.alive, stats.spawned, stats.dropped);
+    SPACE_ENGINE_ASSERT(stats.alive == 100 && stats.spawned == 100 && stats.dropped == 50, "the budget doesn't hold");
+
+    //emitter attached to a transform, on another material
+    SpaceEngine::ParticleSystem::setBudget(1024);
+    SpaceEngine::Transform transform;
+    transform.setWorldPosition({10.f, 0.f, 0.f});
+    SpaceEngine::ParticleEmitterDesc trailDesc{.pMaterial = &glow, .rate = 60.f, .minLife = 5.f, .maxLife = 5.f,
+        .minSpeed = 0.f, .maxSpeed = 0.f, .startColor = {1.f, 1.f, 4.f, 1.f}};
+    SpaceEngine::ParticleEmitter* pEmitter = SpaceEngine::ParticleSystem::createEmitter(trailDesc, &transform);
+    uint32_t emitted = 0;
+    for(int step = 0; step < Steps; step++)
+    {
+        SpaceEngine::ParticleSystem::update(Dt);
+        emitted += SpaceEngine::ParticleSystem::getStats().spawned;
+    }
+    SPACE_ENGINE_INFO("emitter: {} particles in {} s", emitted, Steps * Dt);
+    SPACE_ENGINE_ASSERT(emitted + 1 >= 30 && emitted <= 30, "wrong emission rate");
+
+    //two materials: two batches, every instance in the batch of its material
+    const std::vector<SpaceEngine::ParticleBatch>& batches = SpaceEngine::ParticleSystem::getBatches();
+    const std::vector<SpaceEngine::ParticleInstance>& instances = SpaceEngine::ParticleSystem::getInstances();
+    SPACE_ENGINE_ASSERT(batches.size() == 2, "one batch per material expected");
+    uint32_t total = 0;
+    for(const SpaceEngine::ParticleBatch& batch : batches)
+    {
+        for(uint32_t i = batch.first; i < batch.first + batch.count; i++)
+        {
+            const SpaceEngine::ParticleInstance& instance = instances[i];
+            bool isGlow = instance.color.b > instance.color.r;
+            SPACE_ENGINE_ASSERT(isGlow == (batch.pMaterial == &glow), "instance in the batch of another material");
+            if(isGlow)
+                SPACE_ENGINE_ASSERT(near(instance.posSize.x, 10.f), "the emitter doesn't follow the transform");
+        }
+        total += batch.count;
+    }
+    SPACE_ENGINE_ASSERT(total == SpaceEngine::ParticleSystem::getStats().alive && total == instances.size(), "batches don't cover the instances");
+
+    //no emission after destroy
+    SpaceEngine::ParticleSystem::destroyEmitter(pEmitter);
+    SpaceEngine::ParticleSystem::update(Dt);
+    SPACE_ENGINE_ASSERT(!SpaceEngine::ParticleSystem::getStats().spawned, "destroyed emitter still emits");
+
+    SpaceEngine::ParticleSystem::shutdown();
+    SPACE_ENGINE_INFO("Test done");
+    logManager.Shutdown();
+
+    return 0;
+}
@@ -10,15 +10,48 @@ int main()
     SpaceEngine::WindowManager winManager{};
     SpaceEngine::ShaderManager shManager{};
     logManager.Initialize();
+    SpaceEngine::WindowManager::headless = true;
     winManager.Initialize();
     shManager.Initialize();
     SPACE_ENGINE_DEBUG("Test the shaderManager");
+    //with the parallel compile the links finish in the background, isLinked waits them
+    SPACE_ENGINE_INFO("Parallel compile: {}, programs still linking: {}",
+        SpaceEngine::ShaderManager::isParallelCompile(), SpaceEngine::ShaderManager::getPendingPrograms());
+    for(const char* name : {"pbr", "hdr", "uiBatch", "bloomUpsample"})
+    {
+        SpaceEngine::ShaderProgram* pProgram = SpaceEngine::ShaderManager::findShaderProgram(name);
+        SPACE_ENGINE_ASSERT(pProgram && pProgram->isLinked(), "program not linked");
+    }
     SPACE_ENGINE_DEBUG("Test the shader: simple");
     SPACE_ENGINE_ASSERT(SpaceEngine::ShaderManager::createShaderProgram("simple"), "null pointer shader");
     SPACE_ENGINE_ASSERT(SpaceEngine::ShaderManager::findShaderProgram("simple"), "Shader not found");
     SPACE_ENGINE_DEBUG("Test the shader: simpleTex");
     SPACE_ENGINE_ASSERT(SpaceEngine::ShaderManager::createShaderProgram("simpleTex"), "null pointer shader");
     SPACE_ENGINE_ASSERT(SpaceEngine::ShaderManager::findShaderProgram("simpleTex"), "Shader not found");
+
+    //permutations: one program per define set, the unused textures are compiled out
+    SPACE_ENGINE_DEBUG("Test the shader variants");
+    SpaceEngine::ShaderProgram* pAlbedoNormal = SpaceEngine::ShaderManager::getVariant("pbr", {"HAS_ALBEDO_TEX", "HAS_NORMAL_MAP"});
+    SPACE_ENGINE_ASSERT(pAlbedoNormal && pAlbedoNormal->isLinked(), "variant not linked");
+    SPACE_ENGINE_ASSERT(pAlbedoNormal == SpaceEngine::ShaderManager::getVariant("pbr", {"HAS_NORMAL_MAP", "HAS_ALBEDO_TEX"}), "variant compiled twice");
+    SPACE_ENGINE_ASSERT(pAlbedoNormal != SpaceEngine::ShaderManager::findShaderProgram("pbr"), "variant without defines");
+    SPACE_ENGINE_ASSERT(pAlbedoNormal->isPresentUniform("albedo_tex") && !pAlbedoNormal->isPresentUniform("roughness_tex"), "wrong variant code");
+    SPACE_ENGINE_ASSERT(!SpaceEngine::ShaderManager::findShaderProgram("pbr")->isPresentUniform("albedo_tex"), "texture read without define");
+
+    //warm start: every program comes from the binary cache with the same uniforms
+    if(SpaceEngine::ShaderManager::isBinaryCacheSupported())
+    {
+        SPACE_ENGINE_DEBUG("Test the binary cache");
+        size_t numUniforms = SpaceEngine::ShaderManager::findShaderProgram("pbr")->getPairUniformNameLocation().size();
+        shManager.Shutdown();
+        shManager.Initialize();
+        SPACE_ENGINE_INFO("Programs from the binary cache: {}", SpaceEngine::ShaderManager::getCacheHits());
+        SPACE_ENGINE_ASSERT(SpaceEngine::ShaderManager::getCacheHits() > 0, "no program from the binary cache");
+        SpaceEngine::ShaderProgram* pPBR = SpaceEngine::ShaderManager::findShaderProgram("pbr");
+        SPACE_ENGINE_ASSERT(pPBR && pPBR->isLinked(), "cached program not linked");
+        SPACE_ENGINE_ASSERT(pPBR->getPairUniformNameLocation().size() == numUniforms, "uniforms lost in the cache");
+        SPACE_ENGINE_ASSERT(pPBR->isPresentUniform("projection"), "uniform not found in the cached program");
+    }
     SPACE_ENGINE_INFO("Test done");
     shManager.Shutdown();
     winManager.Shutdown();
@@ -0,0 +1,70 @@
+#include "log.h"
+#include "managers/logManager.h"
+#include "managers/windowManager.h"
+#include "streamBuffer.h"
+
+#include <vector>
+
+//the uploads of the last frames must survive until their segment comes back and the ring must grow
+constexpr int Frames = 30;
+constexpr GLsizeiptr FrameSize = 1024;
+//not a power of two, like the UI vertices
+constexpr GLsizeiptr Stride = 36;
+
+int main()
+{
+    SpaceEngine::LogManager logManager{};
+    SpaceEngine::WindowManager winManager{};
+    logManager.Initialize();
+    SpaceEngine::WindowManager::headless = true;
+    winManager.Initialize();
+    SPACE_ENGINE_DEBUG("Test the streaming ring");
+
+    SpaceEngine::StreamBuffer stream;
+    stream.init(GL_ARRAY_BUFFER, FrameSize, "test stream");
+    SPACE_ENGINE_INFO("Stream buffer persistent: {}", stream.isPersistent());
+
+    std::vector<GLintptr> offsets;
+    std::vector<uint8_t> data(Stride * 5);
+
+    for(int frame = 0; frame < Frames; frame++)
+    {
+        stream.beginFrame();
+        for(int i = 0; i < 3; i++)
+        {
+            for(size_t b = 0; b < data.size(); b++)
+                data[b] = static_cast<uint8_t>(frame * 3 + i + b);
+
+            GLintptr offset = stream.upload(data.data(), static_cast<GLsizeiptr>(data.size()), Stride);
+            SPACE_ENGINE_ASSERT(offset % Stride == 0, "offset not aligned to the stride");
+            offsets.push_back(offset);
+        }
+        stream.endFrame();
+    }
+
+    //the last frame is still in its segment
+    glFinish();
+    std::vector<uint8_t> readBack(data.size());
+    glBindBuffer(GL_ARRAY_BUFFER, stream.getBuffer());
+    glGetBufferSubData(GL_ARRAY_BUFFER, offsets.back(), static_cast<GLsizeiptr>(readBack.size()), readBack.data());
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    SPACE_ENGINE_ASSERT(readBack == data, "streamed data corrupted");
+
+    //more than one frame of room, the ring grows and the offset is in the new buffer
+    GLuint oldBuffer = stream.getBuffer();
+    std::vector<uint8_t> big(FrameSize * 3, 7);
+    stream.beginFrame();
+    stream.upload(big.data(), static_cast<GLsizeiptr>(big.size()), Stride);
+    stream.endFrame();
+    SPACE_ENGINE_ASSERT(stream.getBuffer() != oldBuffer, "the ring didn't grow");
+
+    SPACE_ENGINE_INFO("Stream buffer stalls: {}", stream.getStalls());
+    GL_CHECK_ERRORS();
+    SPACE_ENGINE_INFO("Test done");
+
+    stream.destroy();
+    winManager.Shutdown();
+    logManager.Shutdown();
+
+    return 0;
+}
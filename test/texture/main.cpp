@@ -2,6 +2,7 @@
 #include "managers/logManager.h"
 #include "managers/windowManager.h"
 #include "texture.h"
+#include "glState.h"
 
 
 int main()
@@ -10,12 +11,37 @@ int main()
     SpaceEngine::WindowManager winManager{};
     SpaceEngine::TextureManager texManager{};
     logManager.Initialize();
+    SpaceEngine::WindowManager::headless = true;
     winManager.Initialize();
     texManager.Initialize();
     SPACE_ENGINE_DEBUG("Test the textureManager");
     SPACE_ENGINE_DEBUG("Test the opening image: nebula");
     SPACE_ENGINE_ASSERT(SpaceEngine::TextureManager::load(TEXTURES_PATH "/Nebula.png"), "null pointer");
     SPACE_ENGINE_ASSERT(SpaceEngine::TextureManager::findTexture("Nebula.png"), "Texture not found");
+
+    SPACE_ENGINE_DEBUG("Test the texture binds: only the changes reach the driver");
+    SpaceEngine::Texture* pTex = SpaceEngine::TextureManager::findTexture("Nebula.png");
+    pTex->setTexUnitHandle(GL_TEXTURE3);
+    SpaceEngine::GLStateCache::newFrame();
+    for(int i = 0; i < 10; i++)
+        pTex->bind();
+    SpaceEngine::GLStateCache::newFrame();
+    SPACE_ENGINE_ASSERT(SpaceEngine::GLStateCache::getFrameStats().textureBinds == 1, "redundant texture binds");
+    //a deleted name can be given back by the next glGenTextures
+    GLuint texObj = pTex->getTexture();
+    SpaceEngine::TextureManager::destroyTex(pTex);
+    GLuint newTex = 0;
+    glGenTextures(1, &newTex);
+    SpaceEngine::GLStateCache::bindTexture(3, GL_TEXTURE_2D, newTex);
+    SpaceEngine::GLStateCache::newFrame();
+    SPACE_ENGINE_ASSERT(SpaceEngine::GLStateCache::getFrameStats().textureBinds == 1, "bind of a recycled name skipped");
+    GLint bound = 0;
+    glActiveTexture(GL_TEXTURE3);
+    glGetIntegerv(GL_TEXTURE_BINDING_2D, &bound);
+    SPACE_ENGINE_ASSERT(static_cast<GLuint>(bound) == newTex, "wrong texture on the unit");
+    SpaceEngine::GLStateCache::onDeleteTexture(newTex);
+    glDeleteTextures(1, &newTex);
+    SPACE_ENGINE_DEBUG("Texture name recycled: {}", texObj == newTex);
     SPACE_ENGINE_INFO("Test done");
     texManager.Shutdown();
     winManager.Shutdown();
@@ -0,0 +1,88 @@
+#include "log.h"
+#include "managers/logManager.h"
+#include "managers/windowManager.h"
+#include "glCapture.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <numeric>
+#include <string>
+
+//GLReplay <capture> [warmup frames] [--hw]
+//replays a capture of the game, on the software rasterizer unless --hw, and reports where the CPU time goes
+int main(int argc, char** argv)
+{
+    std::string path;
+    uint32_t warmupFrames = 10;
+    bool hardware = false;
+    for(int i = 1; i < argc; i++)
+    {
+        if(std::strcmp(argv[i], "--hw") == 0)
+            hardware = true;
+        else if(path.empty())
+            path = argv[i];
+        else
+            warmupFrames = static_cast<uint32_t>(std::strtoul(argv[i], nullptr, 10));
+    }
+
+    SpaceEngine::LogManager logManager{};
+    logManager.Initialize();
+    if(path.empty())
+    {
+        SPACE_ENGINE_ERROR("usage: GLReplay <capture> [warmup frames] [--hw]");
+        logManager.Shutdown();
+        return -1;
+    }
+
+    //llvmpipe with Mesa: the costs of the calls don't depend on the GPU of the machine
+    if(!hardware)
+    {
+#ifdef _WIN32
+        _putenv_s("LIBGL_ALWAYS_SOFTWARE", "1");
+#else
+        setenv("LIBGL_ALWAYS_SOFTWARE", "1", 1);
+#endif
+    }
+
+    SpaceEngine::GLReplay replay;
+    if(!replay.load(path))
+    {
+        logManager.Shutdown();
+        return -1;
+    }
+
+    //same default framebuffer of the capture
+    SpaceEngine::WindowManager winManager{};
+    SpaceEngine::WindowManager::headless = true;
+    SpaceEngine::WindowManager::width = replay.getWidth();
+    SpaceEngine::WindowManager::height = replay.getHeight();
+    winManager.Initialize();
+    SPACE_ENGINE_INFO("Replay of {} ({} frames, {}x{}) on {}", path, replay.getFrames(), replay.getWidth(),
+        replay.getHeight(), reinterpret_cast<const char*>(glGetString(GL_RENDERER)));
+
+    bool done = replay.run(warmupFrames);
+
+    const std::vector<double>& frameMs = replay.getFrameMs();
+    if(!frameMs.empty())
+    {
+        double total = std::accumulate(frameMs.begin(), frameMs.end(), 0.0);
+        auto [minMs, maxMs] = std::minmax_element(frameMs.begin(), frameMs.end());
+        SPACE_ENGINE_INFO("{} timed frames: min {:.3f} ms, mean {:.3f} ms, max {:.3f} ms",
+            frameMs.size(), *minMs, total / static_cast<double>(frameMs.size()), *maxMs);
+
+        for(const SpaceEngine::GLReplayCallStats& stats : replay.getCallStats())
+            SPACE_ENGINE_INFO("{:<48} {:>8} calls {:>10.3f} ms {:>6.2f} us/call {:>5.1f}%", stats.name, stats.count,
+                stats.ms, stats.ms * 1000.0 / stats.count, stats.ms * 100.0 / total);
+    }
+    else SPACE_ENGINE_WARN("no frame after the warmup");
+
+    if(replay.getNameMismatches())
+        SPACE_ENGINE_WARN("{} object names differ from the capture, the replay can be wrong", replay.getNameMismatches());
+    if(replay.getSkippedCalls())
+        SPACE_ENGINE_WARN("{} calls skipped, entry points missing in this context", replay.getSkippedCalls());
+
+    winManager.Shutdown();
+    logManager.Shutdown();
+    return done ? 0 : -1;
+}